@@ -202,6 +202,123 @@ extern OPNMIDI_DECLSPEC int  opn2_getNumChips(struct OPN2_MIDIPlayer *device);
  */
 extern OPNMIDI_DECLSPEC int opn2_getNumChipsObtained(struct OPN2_MIDIPlayer *device);
 
+/**
+ * @brief Sets the maximum count of stereo frames rendered at once (512 by default)
+ *
+ * Larger blocks reduce the per-block overhead of offline rendering,
+ * smaller ones give finer granularity of the real-time MIDI processing.
+ *
+ * @param device Instance of the library
+ * @param frames Count of stereo frames per block (from 1 to 65536)
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_setBlockSize(struct OPN2_MIDIPlayer *device, int frames);
+
+/**
+ * @brief Get the maximum count of stereo frames rendered at once
+ * @param device Instance of the library
+ * @return Count of stereo frames per block
+ */
+extern OPNMIDI_DECLSPEC int opn2_getBlockSize(struct OPN2_MIDIPlayer *device);
+
+/**
+ * @brief Sets number of threads to render emulated chips in parallel
+ *
+ * Every chip renders into its own buffer, and the results are mixed in the
+ * chip order, so the output is identical to the single-threaded rendering.
+ * Makes sense only with multiple chips and heavy emulators.
+ *
+ * @param device Instance of the library
+ * @param threads Total count of rendering threads including the calling one. 0 or 1 disables parallel rendering
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_setRenderThreads(struct OPN2_MIDIPlayer *device, int threads);
+
+/**
+ * @brief Get current number of threads used to render emulated chips
+ * @param device Instance of the library
+ * @return Total count of rendering threads including the calling one
+ */
+extern OPNMIDI_DECLSPEC int opn2_getRenderThreads(struct OPN2_MIDIPlayer *device);
+
+/**
+ * @brief Get counts of chip register writes since the chips were set up
+ *
+ * Writes which repeat the value already held by an operator or channel
+ * register don't reach the chip emulators and are counted as dropped.
+ *
+ * @param device Instance of the library
+ * @param issued Destination for the count of writes passed to the chips, or NULL
+ * @param dropped Destination for the count of dropped writes, or NULL
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_getRegisterWriteCounts(struct OPN2_MIDIPlayer *device, size_t *issued, size_t *dropped);
+
+/**
+ * @brief Resampling methods converting the chip's native rate into the output rate
+ */
+enum OPNMIDI_ResamplerQuality
+{
+    /*! Linear interpolation, fastest */
+    OPNMIDI_Resampler_Linear = 0,
+    /*! Short windowed-sinc filter (8 taps) */
+    OPNMIDI_Resampler_Low,
+    /*! Windowed-sinc filter of 16 taps */
+    OPNMIDI_Resampler_Medium,
+    /*! Windowed-sinc filter of 32 taps, best quality */
+    OPNMIDI_Resampler_High
+};
+
+/**
+ * @brief Sets the resampling method of chip outputs (#OPNMIDI_ResamplerQuality)
+ *
+ * Takes no effect while emulator runs at PCM rate. By default, the linear
+ * interpolation is used, or the high quality when library was built with
+ * the OPNMIDI_ENABLE_HQ_RESAMPLER macro.
+ *
+ * @param device Instance of the library
+ * @param quality Resampling method (#OPNMIDI_ResamplerQuality)
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_setResamplerQuality(struct OPN2_MIDIPlayer *device, int quality);
+
+/**
+ * @brief Get current resampling method of chip outputs
+ * @param device Instance of the library
+ * @return Resampling method (#OPNMIDI_ResamplerQuality), <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_getResamplerQuality(struct OPN2_MIDIPlayer *device);
+
+/**
+ * @brief Resample the sum of all chips at once instead of every chip separately
+ *
+ * All chips render at the native rate into a common bus which gets resampled
+ * to the output rate by a single resampler, so the resampling cost doesn't
+ * grow with the number of chips. Takes no effect while emulator runs at PCM rate.
+ *
+ * @param device Instance of the library
+ * @param enabled 0 - disabled, 1 - enabled
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_setBusResampling(struct OPN2_MIDIPlayer *device, int enabled);
+
+/**
+ * @brief Stop clocking chips which went silent (disabled by default)
+ *
+ * A chip goes idle when none of its channels is keyed on, the DAC, SSG and
+ * ADPCM outputs are off, and its output stays at zero for a tenth of a second.
+ * Idle chips contribute nothing to the mix and aren't clocked until the next
+ * register write other than a key-off, which saves the time of unused chips.
+ * While a chip sleeps, its envelope, LFO and timer counters stand still,
+ * so the output is no longer identical to the continuously clocked chips.
+ * Has no effect with the lockstep Nuked OPN2 and the VGM file dumper.
+ *
+ * @param device Instance of the library
+ * @param enabled 0 - disabled, 1 - enabled
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_setIdleSkipping(struct OPN2_MIDIPlayer *device, int enabled);
+
 /**
  * @brief Reference to dynamic bank
  */
@@ -423,6 +540,47 @@ extern OPNMIDI_DECLSPEC void opn2_setFullRangeBrightness(struct OPN2_MIDIPlayer
  */
 extern OPNMIDI_DECLSPEC void opn2_setLoopEnabled(struct OPN2_MIDIPlayer *device, int loopEn);
 
+/**
+ * @brief Enable or disable sample-accurate timing of the built-in MIDI sequencer
+ *
+ * By default, when the requested output chunk ends between two MIDI events,
+ * the events are processed at the end of the chunk, so they are heard
+ * earlier by up to one block. When enabled, opn2_play() and opn2_playFormat()
+ * process every event at its exact frame regardless of the requested chunk size.
+ *
+ * @param device Instance of the library
+ * @param enabled 0 - disabled, 1 - enabled
+ */
+extern OPNMIDI_DECLSPEC void opn2_setSampleAccurate(struct OPN2_MIDIPlayer *device, int enabled);
+
+/**
+ * @brief Get the state of sample-accurate timing of the built-in MIDI sequencer
+ * @param device Instance of the library
+ * @return 0 - disabled, 1 - enabled
+ */
+extern OPNMIDI_DECLSPEC int opn2_getSampleAccurate(struct OPN2_MIDIPlayer *device);
+
+/**
+ * @brief Enable or disable the float mix bus of 32-bit float output
+ *
+ * By default, 32-bit float output is mixed on the integer bus and converted
+ * at the end, like every other format. When enabled, chips mix their output
+ * right into the float buffer, which saves the conversion pass. The float sum
+ * is rounded at every chip, so with several chips the output may differ from
+ * the integer bus by up to one unit in the last place.
+ *
+ * @param device Instance of the library
+ * @param enabled 0 - disabled, 1 - enabled
+ */
+extern OPNMIDI_DECLSPEC void opn2_setFloatMixBus(struct OPN2_MIDIPlayer *device, int enabled);
+
+/**
+ * @brief Get the state of the float mix bus
+ * @param device Instance of the library
+ * @return 0 - disabled, 1 - enabled
+ */
+extern OPNMIDI_DECLSPEC int opn2_getFloatMixBus(struct OPN2_MIDIPlayer *device);
+
 /**
  * @brief Enable or disable soft panning with chip emulators
  * @param device Instance of the library
@@ -514,18 +672,65 @@ enum Opn2_Emulator
     OPNMIDI_EMU_PMDWIN,
     /*! VGM file dumper (required for MIDI2VGM) */
     OPNMIDI_VGM_DUMPER,
+    /*! Nuked OPN2 clocking up to 8 chips at once, same output as Nuked OPN2 */
+    OPNMIDI_EMU_NUKED_LOCKSTEP,
     /*! Count instrument on the level */
     OPNMIDI_EMU_end
 };
 
 /**
  * @brief Switch the emulation core
+ *
+ * Running chips are replaced on the fly: the new chips get the register state
+ * of the old ones, so the playback goes on and held notes keep sounding,
+ * though their envelopes start over. The new chips are clocked ahead until the
+ * state is in, so there is no gap of silence; notes begun a few milliseconds
+ * before the switch may start that much earlier. Switching into or out of the
+ * VGM dumper resets the chips and silences all notes instead.
+ *
  * @param device Instance of the library
  * @param emulator Type of emulator (#Opn2_Emulator)
  * @return 0 on success, <0 when any error has occurred
  */
 extern OPNMIDI_DECLSPEC int opn2_switchEmulator(struct OPN2_MIDIPlayer *device, int emulator);
 
+/**
+ * @brief Get the size of the chips state snapshot
+ *
+ * Snapshots are supported by MAME YM2612, Nuked OPN2, GENS, Genesis Plus GX and
+ * Neko Project II emulators.
+ *
+ * @param device Instance of the library
+ * @return Size of the snapshot in bytes, 0 when the current emulator can't save its state
+ */
+extern OPNMIDI_DECLSPEC size_t opn2_stateSize(struct OPN2_MIDIPlayer *device);
+
+/**
+ * @brief Save the state of all running chips
+ *
+ * The snapshot holds the emulated chips with their resamplers and register caches,
+ * so the audio continues exactly from the same point after opn2_loadState().
+ * The MIDI sequencer and the state of MIDI channels are not included.
+ * The snapshot is only valid for the same build of the library, emulator,
+ * sample rate, count of chips and the chips setup.
+ *
+ * @param device Instance of the library
+ * @param data Output buffer of at least opn2_stateSize() bytes
+ * @param size Size of the output buffer
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_saveState(struct OPN2_MIDIPlayer *device, void *data, size_t size);
+
+/**
+ * @brief Restore the state of all running chips saved by opn2_saveState()
+ *
+ * @param device Instance of the library
+ * @param data Snapshot data
+ * @param size Size of the snapshot data
+ * @return 0 on success, <0 when the data is invalid or was saved with another setup
+ */
+extern OPNMIDI_DECLSPEC int opn2_loadState(struct OPN2_MIDIPlayer *device, const void *data, size_t size);
+
 /**
  * @brief Library version context
  */
@@ -795,6 +1000,15 @@ extern OPNMIDI_DECLSPEC struct Opn2_MarkerEntry opn2_metaMarker(struct OPN2_MIDI
 
 /* ======== Audio output Generation ======== */
 
+/*
+ * Real-time safety: once the setup is complete (the bank and the music file are
+ * loaded, the emulator, the number of chips, the block size and render threads
+ * are set), the opn2_play*(), opn2_generate*() and opn2_rt_*() calls never
+ * allocate or free heap memory, so they are safe to call from a real-time
+ * audio thread. Setup, loading, seeking and opn2_reset() calls may allocate.
+ * Installed hooks are called as is and must follow the same rules themselves.
+ */
+
 /**
  * @brief Generate PCM signed 16-bit stereo audio output and iterate MIDI timers
  *
@@ -873,6 +1087,135 @@ extern OPNMIDI_DECLSPEC int  opn2_generate(struct OPN2_MIDIPlayer *device, int s
  */
 extern OPNMIDI_DECLSPEC int  opn2_generateFormat(struct OPN2_MIDIPlayer *device, int sampleCount, OPN2_UInt8 *left, OPN2_UInt8 *right, const struct OPNMIDI_AudioFormat *format);
 
+/**
+ * @brief Generate planar 32-bit float stereo audio output and iterate MIDI timers
+ *
+ * Same as opn2_play(), but writes every channel into its own contiguous array.
+ * Unlike other output functions, the count of frames is used.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param frameCount Count of stereo frames to generate
+ * @param left Left channel output, must hold at least frameCount values
+ * @param right Right channel output, must hold at least frameCount values
+ * @return Count of given frames, otherwise, 0 or when catching an error while playing
+ */
+extern OPNMIDI_DECLSPEC int  opn2_playPlanar(struct OPN2_MIDIPlayer *device, int frameCount, float *left, float *right);
+
+/**
+ * @brief Generate planar 32-bit float stereo audio output without iteration of MIDI timers
+ *
+ * Same as opn2_generate(), but writes every channel into its own contiguous array.
+ * Unlike other output functions, the count of frames is used.
+ *
+ * @param device Instance of the library
+ * @param frameCount Count of stereo frames to generate
+ * @param left Left channel output, must hold at least frameCount values
+ * @param right Right channel output, must hold at least frameCount values
+ * @return Count of given frames, otherwise, 0 or when catching an error while playing
+ */
+extern OPNMIDI_DECLSPEC int  opn2_generatePlanar(struct OPN2_MIDIPlayer *device, int frameCount, float *left, float *right);
+
+/**
+ * @brief Generate interleaved 32-bit float stereo audio output and iterate MIDI timers
+ *
+ * Same as opn2_play(), but produces 32-bit float samples. With the float mix bus
+ * enabled by opn2_setFloatMixBus(), chips mix their output right into the buffer.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param sampleCount Count of samples (not frames!)
+ * @param out Pointer to output with 32-bit float stereo audio
+ * @return Count of given samples, otherwise, 0 or when catching an error while playing
+ */
+extern OPNMIDI_DECLSPEC int  opn2_playF32(struct OPN2_MIDIPlayer *device, int sampleCount, float *out);
+
+/**
+ * @brief Generate interleaved 32-bit float stereo audio output without iteration of MIDI timers
+ *
+ * Same as opn2_generate(), but produces 32-bit float samples. With the float mix bus
+ * enabled by opn2_setFloatMixBus(), chips mix their output right into the buffer.
+ *
+ * @param device Instance of the library
+ * @param sampleCount Count of samples (not frames!)
+ * @param out Pointer to output with 32-bit float stereo audio
+ * @return Count of given samples, otherwise, 0 or when catching an error while playing
+ */
+extern OPNMIDI_DECLSPEC int  opn2_generateF32(struct OPN2_MIDIPlayer *device, int sampleCount, float *out);
+
+/**
+ * @brief Statistics of the offline rendering
+ */
+struct OPNMIDI_RenderStats
+{
+    /*! Count of rendered stereo frames */
+    size_t frames;
+    /*! Duration of the rendered audio in seconds */
+    double audioTime;
+    /*! Elapsed real time of the rendering in seconds */
+    double renderTime;
+    /*! Real-time factor: seconds of audio rendered per one second of real time */
+    double realTimeFactor;
+};
+
+/**
+ * @brief Offline rendering output file type
+ */
+enum OPNMIDI_RenderFileType
+{
+    /*! WAV file (supports U8, S16, S32, F32 and F64 samples of their natural size) */
+    OPNMIDI_RenderFile_WAV = 0,
+    /*! Headerless raw interleaved samples */
+    OPNMIDI_RenderFile_RAW
+};
+
+/**
+ * @brief Receiver of the rendered audio
+ * @param userData Pointer to user data
+ * @param data Interleaved stereo samples
+ * @param size Size of data in bytes
+ * @return 0 to continue, <0 to abort the rendering
+ */
+typedef int (*OPN2_RenderCallback)(void *userData, const OPN2_UInt8 *data, size_t size);
+
+/**
+ * @brief Render the loaded music from the current position to the end as fast as possible
+ *
+ * Audio is generated by the calling thread by blocks of opn2_setBlockSize() frames,
+ * while a separate writer thread passes them into the callback, so the slow output
+ * doesn't stall the synthesis. The built-in loop is ignored during the rendering.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param format Sample format of the output, samples are always interleaved (sampleOffset is ignored). NULL for signed 16-bit
+ * @param callback Receiver of the rendered audio, called from the writer thread
+ * @param userData Pointer to user data for the callback
+ * @param stats Rendering statistics output, can be NULL
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_renderToCallback(struct OPN2_MIDIPlayer *device, const struct OPNMIDI_AudioFormat *format,
+                                                  OPN2_RenderCallback callback, void *userData, struct OPNMIDI_RenderStats *stats);
+
+/**
+ * @brief Render the loaded music from the current position to the end into the file as fast as possible
+ *
+ * Same as opn2_renderToCallback(), but writes the WAV or raw file.
+ *
+ * Available when library is built with built-in MIDI Sequencer support.
+ *
+ * @param device Instance of the library
+ * @param filePath Path to the output file
+ * @param fileType Type of the file (OPNMIDI_RenderFileType)
+ * @param format Sample format of the output, samples are always interleaved (sampleOffset is ignored). NULL for signed 16-bit
+ * @param stats Rendering statistics output, can be NULL
+ * @return 0 on success, <0 when any error has occurred
+ */
+extern OPNMIDI_DECLSPEC int opn2_renderToFile(struct OPN2_MIDIPlayer *device, const char *filePath, int fileType,
+                                              const struct OPNMIDI_AudioFormat *format, struct OPNMIDI_RenderStats *stats);
+
 /**
  * @brief Periodic tick handler.
  * @param device
@@ -1025,6 +1368,27 @@ extern OPNMIDI_DECLSPEC void opn2_rt_bankChange(struct OPN2_MIDIPlayer *device,
  */
 extern OPNMIDI_DECLSPEC int opn2_rt_systemExclusive(struct OPN2_MIDIPlayer *device, const OPN2_UInt8 *msg, size_t size);
 
+/**
+ * @brief Queue the raw MIDI message to process it at the given frame of the next generated chunk
+ *
+ * Unlike other real-time functions, this one is thread-safe and lock-free: it can be called
+ * from any thread at the same time with opn2_generate(), opn2_generateFormat() and
+ * opn2_generatePlanar(). Queued messages are processed by these functions at their exact
+ * frame offset, the generated chunk gets split at message boundaries. Messages having
+ * the offset beyond the generated chunk are kept for the next chunks.
+ *
+ * Channel messages must begin with the status byte (running status is not supported),
+ * SysEx messages must begin with 0xF0 and be not longer than 32 bytes. Up to 1024 messages
+ * can be queued at once.
+ *
+ * @param device Instance of the library
+ * @param frameOffset Offset in frames from the begin of the next generated chunk
+ * @param bytes Raw MIDI message
+ * @param len Size of the MIDI message
+ * @return 0 on success, <0 when message is invalid or the queue is full
+ */
+extern OPNMIDI_DECLSPEC int opn2_rt_enqueue(struct OPN2_MIDIPlayer *device, unsigned frameOffset, const OPN2_UInt8 *bytes, size_t len);
+
 /* ======== Hooks and debugging ======== */
 
 /**
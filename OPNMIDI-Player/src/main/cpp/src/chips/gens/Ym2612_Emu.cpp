@@ -1360,3 +1360,69 @@ void Ym2612_Impl::run( int pair_count, Ym2612_Emu::sample_t* out )
 }
 
 void Ym2612_Emu::run( int pair_count, sample_t* out ) { impl->run( pair_count, out ); }
+
+// Pointers into the tables are saved as offsets from the emulator
+template<class T>
+static inline T* ptr_to_offset( T* p, void const* base )
+{
+	return p ? (T*) (size_t) ((char const*) p - (char const*) base) : 0;
+}
+
+template<class T>
+static inline T* offset_to_ptr( T* p, void const* base )
+{
+	return p ? (T*) ((char const*) base + (size_t) p) : 0;
+}
+
+struct saved_state_t
+{
+	state_t YM2612;
+	int LFOcnt;
+	int LFOinc;
+};
+
+int Ym2612_Emu::state_size() const { return (int) sizeof (saved_state_t); }
+
+void Ym2612_Emu::save_state( void* out ) const
+{
+	saved_state_t st;
+	st.YM2612 = impl->YM2612;
+	st.LFOcnt = impl->g.LFOcnt;
+	st.LFOinc = impl->g.LFOinc;
+	for ( int i = 0; i < channel_count; i++ )
+	{
+		for ( int j = 0; j < 4; j++ )
+		{
+			slot_t& sl = st.YM2612.CHANNEL [i].SLOT [j];
+			sl.DT = ptr_to_offset( sl.DT, impl );
+			sl.AR = ptr_to_offset( sl.AR, impl );
+			sl.DR = ptr_to_offset( sl.DR, impl );
+			sl.SR = ptr_to_offset( sl.SR, impl );
+			sl.RR = ptr_to_offset( sl.RR, impl );
+			sl.OUTp = ptr_to_offset( sl.OUTp, impl );
+		}
+	}
+	memcpy( out, &st, sizeof st );
+}
+
+void Ym2612_Emu::load_state( void const* in )
+{
+	saved_state_t st;
+	memcpy( &st, in, sizeof st );
+	for ( int i = 0; i < channel_count; i++ )
+	{
+		for ( int j = 0; j < 4; j++ )
+		{
+			slot_t& sl = st.YM2612.CHANNEL [i].SLOT [j];
+			sl.DT = offset_to_ptr( sl.DT, impl );
+			sl.AR = offset_to_ptr( sl.AR, impl );
+			sl.DR = offset_to_ptr( sl.DR, impl );
+			sl.SR = offset_to_ptr( sl.SR, impl );
+			sl.RR = offset_to_ptr( sl.RR, impl );
+			sl.OUTp = offset_to_ptr( sl.OUTp, impl );
+		}
+	}
+	impl->YM2612 = st.YM2612;
+	impl->g.LFOcnt = st.LFOcnt;
+	impl->g.LFOinc = st.LFOinc;
+}
@@ -32,6 +32,13 @@ public:
 	// Write pan level channel data
 	void write_pan( int channel, int data );
 
+	// Size of the state snapshot, the tables made by set_rate() aren't included
+	int state_size() const;
+
+	// Save the state, to load it later into an emulator of the same rates
+	void save_state( void* out ) const;
+	void load_state( void const* in );
+
 	// Run and add pair_count samples into current output buffer contents
 	typedef short sample_t;
 	enum { out_chan_count = 2 }; // stereo
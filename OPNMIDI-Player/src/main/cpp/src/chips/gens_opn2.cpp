@@ -48,7 +48,7 @@ void GensOPN2::reset()
     chip->reset();
 }
 
-void GensOPN2::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+void GensOPN2::nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
 {
     switch (port)
     {
@@ -61,7 +61,7 @@ void GensOPN2::writeReg(uint32_t port, uint16_t addr, uint8_t data)
     }
 }
 
-void GensOPN2::writePan(uint16_t chan, uint8_t data)
+void GensOPN2::nativeWritePan(uint16_t chan, uint8_t data)
 {
     chip->write_pan(static_cast<int>(chan), static_cast<int>(data));
 }
@@ -72,6 +72,21 @@ void GensOPN2::nativeGenerateN(int16_t *output, size_t frames)
     chip->run((int)frames, output);
 }
 
+size_t GensOPN2::nativeStateSize() const
+{
+    return static_cast<size_t>(chip->state_size());
+}
+
+void GensOPN2::nativeSaveState(void *state) const
+{
+    chip->save_state(state);
+}
+
+void GensOPN2::nativeLoadState(const void *state)
+{
+    chip->load_state(state);
+}
+
 const char *GensOPN2::emulatorName()
 {
     return "GENS 2.10 OPN2";
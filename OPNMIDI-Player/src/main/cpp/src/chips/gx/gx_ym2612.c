@@ -2060,6 +2060,62 @@ unsigned int YM2612GXRead(YM2612 *ym2612)
   return ym2612->OPN.ST.status;
 }
 
+/* pointers into the chip itself are saved as offsets from its start */
+static void save_ptr(UINT8 *state, YM2612 *ym2612, INT32 **field)
+{
+  size_t at = (size_t)((UINT8 *)field - (UINT8 *)ym2612);
+  INT32 *offset = *field ? (INT32 *)(size_t)((UINT8 *)*field - (UINT8 *)ym2612) : NULL;
+  memcpy(state + at, &offset, sizeof(INT32 *));
+}
+
+static void load_ptr(YM2612 *ym2612, INT32 **field)
+{
+  if (*field)
+    *field = (INT32 *)((UINT8 *)ym2612 + (size_t)*field);
+}
+
+size_t YM2612GXStateSize()
+{
+  return sizeof(YM2612);
+}
+
+void YM2612GXSaveState(YM2612 *ym2612, void *state)
+{
+  UINT8 *out = (UINT8 *)state;
+  int c, s;
+
+  memcpy(out, ym2612, sizeof(YM2612));
+  for (c = 0; c < 6; c++)
+  {
+    FM_CH *CH = &ym2612->CH[c];
+    for (s = 0; s < 4; s++)
+      save_ptr(out, ym2612, &CH->SLOT[s].DT);
+    save_ptr(out, ym2612, &CH->connect1);
+    save_ptr(out, ym2612, &CH->connect2);
+    save_ptr(out, ym2612, &CH->connect3);
+    save_ptr(out, ym2612, &CH->connect4);
+    save_ptr(out, ym2612, &CH->mem_connect);
+  }
+}
+
+void YM2612GXLoadState(YM2612 *ym2612, const void *state)
+{
+  int c, s;
+
+  memcpy(ym2612, state, sizeof(YM2612));
+  for (c = 0; c < 6; c++)
+  {
+    FM_CH *CH = &ym2612->CH[c];
+    for (s = 0; s < 4; s++)
+      load_ptr(ym2612, &CH->SLOT[s].DT);
+    load_ptr(ym2612, &CH->connect1);
+    load_ptr(ym2612, &CH->connect2);
+    load_ptr(ym2612, &CH->connect3);
+    load_ptr(ym2612, &CH->connect4);
+    load_ptr(ym2612, &CH->mem_connect);
+  }
+}
+
 void YM2612GXPreGenerate(YM2612GX *ym2612)
 {
   /* refresh PG increments and EG rates if required */
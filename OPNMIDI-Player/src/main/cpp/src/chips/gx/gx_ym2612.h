@@ -18,6 +18,8 @@
 #ifndef _H_YM2612_
 #define _H_YM2612_
 
+#include <stddef.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -45,6 +47,9 @@ extern void YM2612GXGenerateOneNative(YM2612GX *ym2612, FMSAMPLE *frame);
 extern void YM2612GXWrite(YM2612GX *ym2612, unsigned int a, unsigned int v);
 extern void YM2612GXWritePan(YM2612GX *chip, int c, unsigned char v);
 extern unsigned int YM2612GXRead(YM2612GX *ym2612);
+extern size_t YM2612GXStateSize();
+extern void YM2612GXSaveState(YM2612GX *ym2612, void *state);
+extern void YM2612GXLoadState(YM2612GX *ym2612, const void *state);
 
 #if defined(__cplusplus)
 }  /* extern "C" */
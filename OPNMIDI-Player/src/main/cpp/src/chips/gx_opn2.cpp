@@ -22,13 +22,17 @@
 #include <cstring>
 
 #include "gx/gx_ym2612.h"
+#include "../opnmidi_threads.hpp"
 
 GXOPN2::GXOPN2(OPNFamily f)
     : OPNChipBaseT(f),
       m_chip(YM2612GXAlloc()),
       m_framecount(0)
 {
-    YM2612GXInit(m_chip);
+    {
+        OpnMutexLocker lock(g_opnChipTablesLock);
+        YM2612GXInit(m_chip);
+    }
     YM2612GXConfig(m_chip, YM2612_DISCRETE);
     setRate(m_rate, m_clock);
 }
@@ -78,6 +82,21 @@ void GXOPN2::nativeGenerate(int16_t *frame)
     ++m_framecount;
 }
 
+size_t GXOPN2::nativeStateSize() const
+{
+    return YM2612GXStateSize();
+}
+
+void GXOPN2::nativeSaveState(void *state) const
+{
+    YM2612GXSaveState(m_chip, state);
+}
+
+void GXOPN2::nativeLoadState(const void *state)
+{
+    YM2612GXLoadState(m_chip, state);
+}
+
 const char *GXOPN2::emulatorName()
 {
     return "Genesis Plus GX";
@@ -2194,12 +2194,16 @@ static void reset_channels( FM_ST *ST , FM_CH *CH , int num )
 }
 
 /* initialize generic tables */
+static int tables_ready = 0;
 static void init_tables(void)
 {
 	signed int i,x;
 	signed int n;
 	double o,m;
 
+	if (tables_ready)
+		return;
+
 	/* build Linear Power Table */
 	for (x=0; x<TL_RES_LEN; x++)
 	{
@@ -2292,6 +2296,8 @@ static void init_tables(void)
 		}
 	}
 
+	tables_ready = 1;
+
 #ifdef SAVE_SAMPLE
 	sample[0]=fopen("sampsum.pcm","wb");
 #endif
@@ -2879,6 +2885,76 @@ int ym2612_timer_over(void *chip,int c)
 }
 
 
+/* pointers into the chip itself are saved as offsets from its start */
+static void FM_save_ptr(UINT8 *state, YM2612 *F2612, INT32 **field)
+{
+	size_t at = (size_t)((UINT8 *)field - (UINT8 *)F2612);
+	INT32 *offset = *field ? (INT32 *)(size_t)((UINT8 *)*field - (UINT8 *)F2612) : NULL;
+	memcpy(state + at, &offset, sizeof(INT32 *));
+}
+
+static void FM_load_ptr(YM2612 *F2612, INT32 **field)
+{
+	if (*field)
+		*field = (INT32 *)((UINT8 *)F2612 + (size_t)*field);
+}
+
+size_t ym2612_state_size(void)
+{
+	return sizeof(YM2612);
+}
+
+void ym2612_save_state(void *chip, void *state)
+{
+	YM2612 *F2612 = (YM2612 *)chip;
+	UINT8 *out = (UINT8 *)state;
+	FM_CH *CH;
+	FM_CH *P_CH = NULL;
+	int c, s;
+
+	memcpy(out, F2612, sizeof(YM2612));
+	for (c = 0; c < 6; c++)
+	{
+		CH = &F2612->CH[c];
+		for (s = 0; s < 4; s++)
+			FM_save_ptr(out, F2612, &CH->SLOT[s].DT);
+		FM_save_ptr(out, F2612, &CH->connect1);
+		FM_save_ptr(out, F2612, &CH->connect2);
+		FM_save_ptr(out, F2612, &CH->connect3);
+		FM_save_ptr(out, F2612, &CH->connect4);
+		FM_save_ptr(out, F2612, &CH->mem_connect);
+	}
+	/* always points to the channels of the chip */
+	memcpy(out + offsetof(YM2612, OPN.P_CH), &P_CH, sizeof(FM_CH *));
+}
+
+void ym2612_load_state(void *chip, const void *state)
+{
+	YM2612 *F2612 = (YM2612 *)chip;
+	FM_ST ST = F2612->OPN.ST;
+	FM_CH *CH;
+	int c, s;
+
+	memcpy(F2612, state, sizeof(YM2612));
+	for (c = 0; c < 6; c++)
+	{
+		CH = &F2612->CH[c];
+		for (s = 0; s < 4; s++)
+			FM_load_ptr(F2612, &CH->SLOT[s].DT);
+		FM_load_ptr(F2612, &CH->connect1);
+		FM_load_ptr(F2612, &CH->connect2);
+		FM_load_ptr(F2612, &CH->connect3);
+		FM_load_ptr(F2612, &CH->connect4);
+		FM_load_ptr(F2612, &CH->mem_connect);
+	}
+	F2612->OPN.P_CH = F2612->CH;
+	/* keep the handlers of this instance */
+	F2612->OPN.ST.param = ST.param;
+	F2612->OPN.ST.timer_handler = ST.timer_handler;
+	F2612->OPN.ST.IRQ_Handler = ST.IRQ_Handler;
+	F2612->OPN.ST.SSG = ST.SSG;
+}
+
 void ym2612_set_mutemask(void *chip, UINT32 MuteMask)
 {
 	YM2612 *F2612 = (YM2612 *)chip;
@@ -7,6 +7,7 @@
 #define FM_HHHHH
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -154,6 +155,24 @@ unsigned char ym2612_read(void *chip, int a);
 int ym2612_timer_over(void *chip, int c );
 void ym2612_postload(void *chip);
 
+/**
+ * @brief Size of the chip state snapshot
+ * @return Size in bytes
+ */
+size_t ym2612_state_size(void);
+/**
+ * @brief Save the whole state of the chip
+ * @param chip Chip instance
+ * @param state Output of ym2612_state_size() bytes
+ */
+void ym2612_save_state(void *chip, void *state);
+/**
+ * @brief Restore the state saved from a chip of the same clock and sample rate
+ * @param chip Chip instance
+ * @param state State saved by ym2612_save_state()
+ */
+void ym2612_load_state(void *chip, const void *state);
+
 void ym2612_set_mutemask(void *chip, UINT32 MuteMask);
 void ym2612_setoptions(UINT8 Flags);
 #endif /* (BUILD_YM2612||BUILD_YM3438) */
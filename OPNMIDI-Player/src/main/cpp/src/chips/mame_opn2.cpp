@@ -20,6 +20,7 @@
 
 #include "mame_opn2.h"
 #include "mame/mame_ym2612fm.h"
+#include "../opnmidi_threads.hpp"
 #include <cstdlib>
 #include <assert.h>
 
@@ -41,7 +42,10 @@ void MameOPN2::setRate(uint32_t rate, uint32_t clock)
     if(chip)
         ym2612_shutdown(chip);
     uint32_t chipRate = isRunningAtPcmRate() ? rate : nativeRate();
-    chip = ym2612_init(NULL, (int)clock, (int)chipRate, NULL, NULL);
+    {
+        OpnMutexLocker lock(g_opnChipTablesLock);
+        chip = ym2612_init(NULL, (int)clock, (int)chipRate, NULL, NULL);
+    }
     ym2612_reset_chip(chip);
 }
 
@@ -74,6 +78,21 @@ void MameOPN2::nativeGenerate(int16_t *frame)
     ym2612_generate_one_native(chip, frame);
 }
 
+size_t MameOPN2::nativeStateSize() const
+{
+    return ym2612_state_size();
+}
+
+void MameOPN2::nativeSaveState(void *state) const
+{
+    ym2612_save_state(chip, state);
+}
+
+void MameOPN2::nativeLoadState(const void *state)
+{
+    ym2612_load_state(chip, state);
+}
+
 const char *MameOPN2::emulatorName()
 {
     return "MAME YM2612";
@@ -38,6 +38,9 @@ public:
     void nativePreGenerate() override;
     void nativePostGenerate() override {}
     void nativeGenerate(int16_t *frame) override;
+    size_t nativeStateSize() const;
+    void nativeSaveState(void *state) const;
+    void nativeLoadState(const void *state);
     const char *emulatorName() override;
 };
 
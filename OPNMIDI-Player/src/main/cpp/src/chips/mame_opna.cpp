@@ -23,6 +23,7 @@
 #include "mamefm/fmopn_2608rom.h"
 #include "mamefm/2608intf.h"
 #include "mamefm/resampler.hpp"
+#include "../opnmidi_threads.hpp"
 
 struct MameOPNA::Impl {
     ym2608_device dev;
@@ -83,11 +84,15 @@ void MameOPNA::setRate(uint32_t rate, uint32_t clock)
 
     uint32_t chipRate = isRunningAtPcmRate() ? rate : nativeRate();
     ym2608_device *device = &impl->dev;
-    void *chip = impl->chip = ym2608_init(
-        device, (int)clock, (int)chipRate,
-        &Impl::cbInternalReadByte, &Impl::cbExternalReadByte,
-        &Impl::cbExternalWriteByte,
-        &Impl::cbHandleTimer, &Impl::cbHandleIRQ, &Impl::cbssg);
+    void *chip;
+    {
+        OpnMutexLocker lock(g_opnChipTablesLock);
+        chip = impl->chip = ym2608_init(
+            device, (int)clock, (int)chipRate,
+            &Impl::cbInternalReadByte, &Impl::cbExternalReadByte,
+            &Impl::cbExternalWriteByte,
+            &Impl::cbHandleTimer, &Impl::cbHandleIRQ, &Impl::cbssg);
+    }
 
     PSG *psg = &device->m_psg;
     memset(psg, 0, sizeof(PSG));
@@ -117,14 +122,14 @@ void MameOPNA::reset()
     ym2608_write(chip, 1, 0x9f);
 }
 
-void MameOPNA::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+void MameOPNA::nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
 {
     void *chip = impl->chip;
     ym2608_write(chip, 0 + (int)(port) * 2, (uint8_t)addr);
     ym2608_write(chip, 1 + (int)(port) * 2, data);
 }
 
-void MameOPNA::writePan(uint16_t chan, uint8_t data)
+void MameOPNA::nativeWritePan(uint16_t chan, uint8_t data)
 {
     void *chip = impl->chip;
     ym2608_write_pan(chip, (int)chan, data);
@@ -34,8 +34,8 @@ public:
     bool canRunAtPcmRate() const override { return true; }
     void setRate(uint32_t rate, uint32_t clock) override;
     void reset() override;
-    void writeReg(uint32_t port, uint16_t addr, uint8_t data) override;
-    void writePan(uint16_t chan, uint8_t data) override;
+    void nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data);
+    void nativeWritePan(uint16_t chan, uint8_t data);
     void nativePreGenerate() override {}
     void nativePostGenerate() override {}
     void nativeGenerateN(int16_t *output, size_t frames) override;
@@ -1572,12 +1572,16 @@ static void reset_channels( FM_ST *ST , FM_CH *CH , int num )
 }
 
 /* initialize generic tables */
+static int tables_ready = 0;
 static int init_tables(void)
 {
 	signed int i,x;
 	signed int n;
 	double o,m;
 
+	if (tables_ready)
+		return 1;
+
 	for (x=0; x<TL_RES_LEN; x++)
 	{
 		m = (1<<16) / pow(2, (x+1) * (ENV_STEP/4.0) / 8.0);
@@ -1679,6 +1683,8 @@ static int init_tables(void)
 
 
 
+	tables_ready = 1;
+
 #ifdef SAVE_SAMPLE
 	sample[0]=fopen("sampsum.pcm","wb");
 #endif
@@ -2681,10 +2687,14 @@ CONSTEXPR int steps[49] =
 };
 
 
+static int adpcma_table_ready = 0;
 void Init_ADPCMATable()
 {
 	int step, nib;
 
+	if (adpcma_table_ready)
+		return;
+
 	for (step = 0; step < 49; step++)
 	{
 		/* loop over all nibbles and compute the difference */
@@ -2694,6 +2704,8 @@ void Init_ADPCMATable()
 			jedi_table[step*16 + nib] = (nib&0x08) ? -value : value;
 		}
 	}
+
+	adpcma_table_ready = 1;
 }
 
 #ifdef MAME_EMU_SAVE_H
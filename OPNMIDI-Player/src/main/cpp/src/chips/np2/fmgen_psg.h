@@ -107,9 +107,9 @@ protected:
 	int volume;
 	int mask;
 
-	static uint enveloptable[16][64];
+	uint enveloptable[16][64];
 	static uint noisetable[noisetablesize];
-	static int EmitTable[32];
+	int EmitTable[32];
 };
 
 #endif // PSG_H
@@ -20,6 +20,7 @@
 
 #include "np2_opna.h"
 #include "np2/fmgen_opna.h"
+#include "../opnmidi_threads.hpp"
 #include <new>
 #include <cstdio>
 #include <cstdlib>
@@ -30,8 +31,11 @@ NP2OPNA<ChipType>::NP2OPNA(OPNFamily f)
     : ChipBase(f)
 {
     ChipType *opn = (ChipType *)std::calloc(1, sizeof(ChipType));
-    chip = new(opn) ChipType;
-    opn->Init(ChipBase::m_clock, ChipBase::m_rate);
+    {
+        OpnMutexLocker lock(g_opnChipTablesLock);
+        chip = new(opn) ChipType;
+        opn->Init(ChipBase::m_clock, ChipBase::m_rate);
+    }
     opn->SetReg(0x29, 0x9f);  // enable channels 4-6
 }
 
@@ -60,13 +64,13 @@ void NP2OPNA<ChipType>::reset()
 }
 
 template <class ChipType>
-void NP2OPNA<ChipType>::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+void NP2OPNA<ChipType>::nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
 {
     chip->SetReg((port << 8) | addr, data);
 }
 
 template <class ChipType>
-void NP2OPNA<ChipType>::writePan(uint16_t chan, uint8_t data)
+void NP2OPNA<ChipType>::nativeWritePan(uint16_t chan, uint8_t data)
 {
     chip->SetPan(chan, data);
 }
@@ -78,6 +82,48 @@ void NP2OPNA<ChipType>::nativeGenerateN(int16_t *output, size_t frames)
     chip->Mix(output, static_cast<int>(frames));
 }
 
+template <>
+size_t NP2OPNA<FM::OPNA>::nativeStateSize() const
+{
+    return sizeof(FM::OPNAData);
+}
+
+template <>
+void NP2OPNA<FM::OPNA>::nativeSaveState(void *state) const
+{
+    FM::OPNAData *data = new FM::OPNAData;
+    std::memset(data, 0, sizeof(FM::OPNAData));
+    chip->DataSave(data);
+    std::memcpy(state, data, sizeof(FM::OPNAData));
+    delete data;
+}
+
+template <>
+void NP2OPNA<FM::OPNA>::nativeLoadState(const void *state)
+{
+    FM::OPNAData *data = new FM::OPNAData;
+    std::memcpy(data, state, sizeof(FM::OPNAData));
+    chip->DataLoad(data);
+    delete data;
+}
+
+// The ADPCM-A memory of OPNB is kept outside of the chip, its state is not saved
+template <>
+size_t NP2OPNA<FM::OPNB>::nativeStateSize() const
+{
+    return 0;
+}
+
+template <>
+void NP2OPNA<FM::OPNB>::nativeSaveState(void *) const
+{
+}
+
+template <>
+void NP2OPNA<FM::OPNB>::nativeLoadState(const void *)
+{
+}
+
 template <>
 const char *NP2OPNA<FM::OPNA>::emulatorName()
 {
@@ -242,8 +242,6 @@ static const Bit16u panlawtable[] =
     4858, 4050, 3240, 2431, 1620, 810, 0
 };
 
-static Bit32u chip_type = ym3438_mode_readmode;
-
 void OPN2_DoIO(ym3438_t *chip)
 {
     /* Write signal check */
@@ -1007,7 +1005,7 @@ void OPN2_ChOutput(ym3438_t *chip)
     chip->mol = 0;
     chip->mor = 0;
 
-    if (chip_type & ym3438_mode_ym2612)
+    if (chip->chip_type & ym3438_mode_ym2612)
     {
         out_en = ((cycles & 3) == 3) || test_dac;
         /* YM2612 DAC emulation(not verified) */
@@ -1211,9 +1209,11 @@ void OPN2_KeyOn(ym3438_t*chip)
 
 void OPN2_Reset(ym3438_t *chip, Bit32u rate, Bit32u clock)
 {
-    Bit32u i, rateratio;
+    Bit32u i, rateratio, chip_type;
     rateratio = (Bit32u)chip->rateratio;
+    chip_type = chip->chip_type;
     memset(chip, 0, sizeof(ym3438_t));
+    chip->chip_type = chip_type;
     for (i = 0; i < 24; i++)
     {
         chip->eg_out[i] = 0x3ff;
@@ -1239,9 +1239,9 @@ void OPN2_Reset(ym3438_t *chip, Bit32u rate, Bit32u clock)
     }
 }
 
-void OPN2_SetChipType(Bit32u type)
+void OPN2_SetChipType(ym3438_t *chip, Bit32u type)
 {
-    chip_type = type;
+    chip->chip_type = type;
 }
 
 void OPN2_Clock(ym3438_t *chip, Bit16s *buffer)
@@ -1381,6 +1381,276 @@ void OPN2_Clock(ym3438_t *chip, Bit16s *buffer)
         chip->status_time--;
 }
 
+/*
+ * Clock for the usual music setup: no CSM, no channel 3 special mode,
+ * timers stopped and LSI test registers cleared. Gives the same result
+ * as OPN2_Clock() with the branches for those features folded out.
+ */
+static Bit32u OPN2_ClockIsPlain(ym3438_t *chip)
+{
+    Bit32u i;
+    Bit8u test = 0;
+    if (chip->mode_ch3 || chip->mode_kon_csm)
+    {
+        return 0;
+    }
+    for (i = 0; i < 8; i++)
+    {
+        test |= chip->mode_test_21[i] | chip->mode_test_2c[i];
+    }
+    if (test)
+    {
+        return 0;
+    }
+    /* Timers must be stopped with nothing left to load or to flag */
+    return !(chip->timer_a_load | chip->timer_a_load_lock | chip->timer_a_load_latch
+           | chip->timer_a_overflow | chip->timer_a_reset
+           | chip->timer_b_load | chip->timer_b_load_lock | chip->timer_b_load_latch
+           | chip->timer_b_overflow | chip->timer_b_reset);
+}
+
+static void OPN2_ClockPlain(ym3438_t *chip, Bit16s *buffer)
+{
+    Bit32u cycles = chip->cycles;
+    Bit32u channel = chip->channel;
+    Bit32u slot, op, chan;
+    Bit16u phase, quarter, level;
+    Bit16s out, sign, acc, add, sum, output;
+
+    chip->lfo_inc = 0;
+    chip->pg_read >>= 1;
+    chip->eg_read[1] >>= 1;
+    chip->eg_cycle++;
+    /* Lock envelope generator timer value */
+    if (cycles == 1 && chip->eg_quotient == 2)
+    {
+        if (chip->eg_cycle_stop)
+        {
+            chip->eg_shift_lock = 0;
+        }
+        else
+        {
+            chip->eg_shift_lock = chip->eg_shift + 1;
+        }
+        chip->eg_timer_low_lock = chip->eg_timer & 0x03;
+    }
+    /* Cycle specific functions */
+    switch (cycles)
+    {
+    case 0:
+        chip->lfo_pm = chip->lfo_cnt >> 2;
+        if (chip->lfo_cnt & 0x40)
+        {
+            chip->lfo_am = chip->lfo_cnt & 0x3f;
+        }
+        else
+        {
+            chip->lfo_am = chip->lfo_cnt ^ 0x3f;
+        }
+        chip->lfo_am <<= 1;
+        break;
+    case 1:
+        chip->eg_quotient++;
+        chip->eg_quotient %= 3;
+        chip->eg_cycle = 0;
+        chip->eg_cycle_stop = 1;
+        chip->eg_shift = 0;
+        chip->eg_timer_inc |= chip->eg_quotient >> 1;
+        chip->eg_timer = chip->eg_timer + chip->eg_timer_inc;
+        chip->eg_timer_inc = chip->eg_timer >> 12;
+        chip->eg_timer &= 0xfff;
+        /* Timers are stopped, only the timer B prescaler runs */
+        chip->timer_b_subcnt = (chip->timer_b_subcnt + 1) & 0x0f;
+        break;
+    case 2:
+        chip->pg_read = chip->pg_phase[21] & 0x3ff;
+        chip->eg_read[1] = chip->eg_out[0];
+        break;
+    case 13:
+        chip->eg_cycle = 0;
+        chip->eg_cycle_stop = 1;
+        chip->eg_shift = 0;
+        chip->eg_timer = chip->eg_timer + chip->eg_timer_inc;
+        chip->eg_timer_inc = chip->eg_timer >> 12;
+        chip->eg_timer &= 0xfff;
+        break;
+    case 23:
+        chip->lfo_inc |= 1;
+        break;
+    }
+    if ((chip->eg_timer >> chip->eg_cycle) & chip->eg_cycle_stop)
+    {
+        chip->eg_shift = chip->eg_cycle;
+        chip->eg_cycle_stop = 0;
+    }
+
+    OPN2_DoIO(chip);
+
+    /* Key On */
+    chip->eg_kon_latch[cycles] = chip->mode_kon[cycles];
+    chip->eg_kon_csm[cycles] = 0;
+    if (cycles == chip->mode_kon_channel)
+    {
+        chip->mode_kon[channel] = chip->mode_kon_operator[0];
+        chip->mode_kon[channel + 12] = chip->mode_kon_operator[1];
+        chip->mode_kon[channel + 6] = chip->mode_kon_operator[2];
+        chip->mode_kon[channel + 18] = chip->mode_kon_operator[3];
+    }
+
+    /* Channel output */
+    chip->ch_read = chip->ch_lock;
+    chan = channel;
+    if (cycles < 12)
+    {
+        /* Ch 4,5,6 */
+        chan++;
+    }
+    if ((cycles & 3) == 0)
+    {
+        chip->ch_lock = chip->ch_out[chan];
+        chip->ch_lock_l = chip->pan_l[chan];
+        chip->ch_lock_r = chip->pan_r[chan];
+    }
+    if ((cycles >> 2) == 1 && chip->dacen)
+    {
+        out = (Bit16s)chip->dacdata;
+        out <<= 7;
+        out >>= 7;
+    }
+    else
+    {
+        out = chip->ch_lock;
+    }
+    chip->mol = 0;
+    chip->mor = 0;
+    if (chip->chip_type & ym3438_mode_ym2612)
+    {
+        Bit32u out_en = (cycles & 3) == 3;
+        sign = out >> 8;
+        if (out >= 0)
+        {
+            out++;
+            sign++;
+        }
+        chip->mol = (chip->ch_lock_l && out_en) ? out : sign;
+        chip->mor = (chip->ch_lock_r && out_en) ? out : sign;
+        chip->mol *= 3;
+        chip->mor *= 3;
+    }
+    else if ((cycles & 3) != 0)
+    {
+        if (chip->ch_lock_l)
+        {
+            chip->mol = out;
+        }
+        if (chip->ch_lock_r)
+        {
+            chip->mor = out;
+        }
+    }
+
+    /* Channel accumulation */
+    slot = (cycles + 18) % 24;
+    op = slot / 6;
+    acc = op == 0 ? 0 : chip->ch_acc[channel];
+    add = 0;
+    if (fm_algorithm[op][5][chip->connect[channel]])
+    {
+        add += chip->fm_out[slot] >> 5;
+    }
+    sum = acc + add;
+    if (sum > 255)
+    {
+        sum = 255;
+    }
+    else if (sum < -256)
+    {
+        sum = -256;
+    }
+    if (op == 0)
+    {
+        chip->ch_out[channel] = chip->ch_acc[channel];
+    }
+    chip->ch_acc[channel] = sum;
+
+    OPN2_FMPrepare(chip);
+
+    /* Operator output */
+    slot = (cycles + 19) % 24;
+    phase = (chip->fm_mod[slot] + (chip->pg_phase[slot] >> 10)) & 0x3ff;
+    if (phase & 0x100)
+    {
+        quarter = (phase ^ 0xff) & 0xff;
+    }
+    else
+    {
+        quarter = phase & 0xff;
+    }
+    level = logsinrom[quarter];
+    level += chip->eg_out[slot] << 2;
+    if (level > 0x1fff)
+    {
+        level = 0x1fff;
+    }
+    output = ((exprom[(level & 0xff) ^ 0xff] | 0x400) << 2) >> (level >> 8);
+    if (phase & 0x200)
+    {
+        output = (~output) + 1;
+    }
+    output <<= 2;
+    output >>= 2;
+    chip->fm_out[slot] = output;
+
+    /* Phase generator */
+    if (chip->pg_reset[(cycles + 20) % 24])
+    {
+        chip->pg_inc[(cycles + 20) % 24] = 0;
+    }
+    chip->pg_phase[slot] += chip->pg_inc[slot];
+    chip->pg_phase[slot] &= 0xfffff;
+    if (chip->pg_reset[slot])
+    {
+        chip->pg_phase[slot] = 0;
+    }
+    OPN2_PhaseCalcIncrement(chip);
+
+    OPN2_EnvelopeADSR(chip);
+    /* Envelope output */
+    slot = (cycles + 23) % 24;
+    level = chip->eg_level[slot];
+    if (chip->eg_ssg_inv[slot])
+    {
+        level = 512 - level;
+    }
+    level &= 0x3ff;
+    level += chip->eg_lfo_am;
+    level += chip->eg_tl[0] << 3;
+    if (level > 0x3ff)
+    {
+        level = 0x3ff;
+    }
+    chip->eg_out[slot] = level;
+    OPN2_EnvelopeSSGEG(chip);
+    OPN2_EnvelopePrepare(chip);
+
+    /* Prepare fnum & block */
+    chan = (channel + 1) % 6;
+    chip->pg_fnum = chip->fnum[chan];
+    chip->pg_block = chip->block[chan];
+    chip->pg_kcode = chip->kcode[chan];
+
+    OPN2_UpdateLFO(chip);
+    OPN2_DoRegWrite(chip);
+    chip->cycles = (cycles + 1) % 24;
+    chip->channel = chip->cycles % 6;
+
+    buffer[0] = chip->mol;
+    buffer[1] = chip->mor;
+
+    if (chip->status_time)
+        chip->status_time--;
+}
+
 void OPN2_Write(ym3438_t *chip, Bit32u port, Bit8u data)
 {
     port &= 3;
@@ -1418,7 +1688,7 @@ Bit32u OPN2_ReadIRQPin(ym3438_t *chip)
 
 Bit8u OPN2_Read(ym3438_t *chip, Bit32u port)
 {
-    if ((port & 3) == 0 || (chip_type & ym3438_mode_readmode))
+    if ((port & 3) == 0 || (chip->chip_type & ym3438_mode_readmode))
     {
         if (chip->mode_test_21[6])
         {
@@ -1448,7 +1718,7 @@ Bit8u OPN2_Read(ym3438_t *chip, Bit32u port)
             chip->status = (chip->busy << 7) | (chip->timer_b_overflow_flag << 1)
                  | chip->timer_a_overflow_flag;
         }
-        if (chip_type & ym3438_mode_ym2612)
+        if (chip->chip_type & ym3438_mode_ym2612)
         {
             chip->status_time = 300000;
         }
@@ -1511,6 +1781,7 @@ void OPN2_Generate(ym3438_t *chip, Bit16s *buf)
     Bit16s buffer[2];
     Bit32u mute;
     Bit32s channel = -1;
+    Bit32u plain = OPN2_ClockIsPlain(chip);
 
     buf[0] = 0;
     buf[1] = 0;
@@ -1547,7 +1818,19 @@ void OPN2_Generate(ym3438_t *chip, Bit16s *buf)
             mute = 0;
             break;
         }
-        OPN2_Clock(chip, buffer);
+        if (plain)
+        {
+            OPN2_ClockPlain(chip, buffer);
+            /* Mode registers only change on a data write */
+            if (chip->write_d_en)
+            {
+                plain = OPN2_ClockIsPlain(chip);
+            }
+        }
+        else
+        {
+            OPN2_Clock(chip, buffer);
+        }
         if (!mute)
         {
             if (channel >= 0)
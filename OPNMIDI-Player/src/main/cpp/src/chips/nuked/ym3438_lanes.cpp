@@ -0,0 +1,1750 @@
+/*
+ * Copyright (C) 2017-2018 Alexey Khokholov (Nuke.YKT)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ *
+ *  Nuked OPN2(Yamaha YM3438) emulator, lockstep variant.
+ *  Every routine follows the one of ym3438.c, version 1.0.9,
+ *  statement by statement over the lanes.
+ */
+
+#include <string.h>
+#include "ym3438_lanes.h"
+
+enum {
+    eg_num_attack = 0,
+    eg_num_decay = 1,
+    eg_num_sustain = 2,
+    eg_num_release = 3
+};
+
+/* logsin table */
+static const Bit16u logsinrom[256] = {
+    0x859, 0x6c3, 0x607, 0x58b, 0x52e, 0x4e4, 0x4a6, 0x471,
+    0x443, 0x41a, 0x3f5, 0x3d3, 0x3b5, 0x398, 0x37e, 0x365,
+    0x34e, 0x339, 0x324, 0x311, 0x2ff, 0x2ed, 0x2dc, 0x2cd,
+    0x2bd, 0x2af, 0x2a0, 0x293, 0x286, 0x279, 0x26d, 0x261,
+    0x256, 0x24b, 0x240, 0x236, 0x22c, 0x222, 0x218, 0x20f,
+    0x206, 0x1fd, 0x1f5, 0x1ec, 0x1e4, 0x1dc, 0x1d4, 0x1cd,
+    0x1c5, 0x1be, 0x1b7, 0x1b0, 0x1a9, 0x1a2, 0x19b, 0x195,
+    0x18f, 0x188, 0x182, 0x17c, 0x177, 0x171, 0x16b, 0x166,
+    0x160, 0x15b, 0x155, 0x150, 0x14b, 0x146, 0x141, 0x13c,
+    0x137, 0x133, 0x12e, 0x129, 0x125, 0x121, 0x11c, 0x118,
+    0x114, 0x10f, 0x10b, 0x107, 0x103, 0x0ff, 0x0fb, 0x0f8,
+    0x0f4, 0x0f0, 0x0ec, 0x0e9, 0x0e5, 0x0e2, 0x0de, 0x0db,
+    0x0d7, 0x0d4, 0x0d1, 0x0cd, 0x0ca, 0x0c7, 0x0c4, 0x0c1,
+    0x0be, 0x0bb, 0x0b8, 0x0b5, 0x0b2, 0x0af, 0x0ac, 0x0a9,
+    0x0a7, 0x0a4, 0x0a1, 0x09f, 0x09c, 0x099, 0x097, 0x094,
+    0x092, 0x08f, 0x08d, 0x08a, 0x088, 0x086, 0x083, 0x081,
+    0x07f, 0x07d, 0x07a, 0x078, 0x076, 0x074, 0x072, 0x070,
+    0x06e, 0x06c, 0x06a, 0x068, 0x066, 0x064, 0x062, 0x060,
+    0x05e, 0x05c, 0x05b, 0x059, 0x057, 0x055, 0x053, 0x052,
+    0x050, 0x04e, 0x04d, 0x04b, 0x04a, 0x048, 0x046, 0x045,
+    0x043, 0x042, 0x040, 0x03f, 0x03e, 0x03c, 0x03b, 0x039,
+    0x038, 0x037, 0x035, 0x034, 0x033, 0x031, 0x030, 0x02f,
+    0x02e, 0x02d, 0x02b, 0x02a, 0x029, 0x028, 0x027, 0x026,
+    0x025, 0x024, 0x023, 0x022, 0x021, 0x020, 0x01f, 0x01e,
+    0x01d, 0x01c, 0x01b, 0x01a, 0x019, 0x018, 0x017, 0x017,
+    0x016, 0x015, 0x014, 0x014, 0x013, 0x012, 0x011, 0x011,
+    0x010, 0x00f, 0x00f, 0x00e, 0x00d, 0x00d, 0x00c, 0x00c,
+    0x00b, 0x00a, 0x00a, 0x009, 0x009, 0x008, 0x008, 0x007,
+    0x007, 0x007, 0x006, 0x006, 0x005, 0x005, 0x005, 0x004,
+    0x004, 0x004, 0x003, 0x003, 0x003, 0x002, 0x002, 0x002,
+    0x002, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001,
+    0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000
+};
+
+/* exp table */
+static const Bit16u exprom[256] = {
+    0x000, 0x003, 0x006, 0x008, 0x00b, 0x00e, 0x011, 0x014,
+    0x016, 0x019, 0x01c, 0x01f, 0x022, 0x025, 0x028, 0x02a,
+    0x02d, 0x030, 0x033, 0x036, 0x039, 0x03c, 0x03f, 0x042,
+    0x045, 0x048, 0x04b, 0x04e, 0x051, 0x054, 0x057, 0x05a,
+    0x05d, 0x060, 0x063, 0x066, 0x069, 0x06c, 0x06f, 0x072,
+    0x075, 0x078, 0x07b, 0x07e, 0x082, 0x085, 0x088, 0x08b,
+    0x08e, 0x091, 0x094, 0x098, 0x09b, 0x09e, 0x0a1, 0x0a4,
+    0x0a8, 0x0ab, 0x0ae, 0x0b1, 0x0b5, 0x0b8, 0x0bb, 0x0be,
+    0x0c2, 0x0c5, 0x0c8, 0x0cc, 0x0cf, 0x0d2, 0x0d6, 0x0d9,
+    0x0dc, 0x0e0, 0x0e3, 0x0e7, 0x0ea, 0x0ed, 0x0f1, 0x0f4,
+    0x0f8, 0x0fb, 0x0ff, 0x102, 0x106, 0x109, 0x10c, 0x110,
+    0x114, 0x117, 0x11b, 0x11e, 0x122, 0x125, 0x129, 0x12c,
+    0x130, 0x134, 0x137, 0x13b, 0x13e, 0x142, 0x146, 0x149,
+    0x14d, 0x151, 0x154, 0x158, 0x15c, 0x160, 0x163, 0x167,
+    0x16b, 0x16f, 0x172, 0x176, 0x17a, 0x17e, 0x181, 0x185,
+    0x189, 0x18d, 0x191, 0x195, 0x199, 0x19c, 0x1a0, 0x1a4,
+    0x1a8, 0x1ac, 0x1b0, 0x1b4, 0x1b8, 0x1bc, 0x1c0, 0x1c4,
+    0x1c8, 0x1cc, 0x1d0, 0x1d4, 0x1d8, 0x1dc, 0x1e0, 0x1e4,
+    0x1e8, 0x1ec, 0x1f0, 0x1f5, 0x1f9, 0x1fd, 0x201, 0x205,
+    0x209, 0x20e, 0x212, 0x216, 0x21a, 0x21e, 0x223, 0x227,
+    0x22b, 0x230, 0x234, 0x238, 0x23c, 0x241, 0x245, 0x249,
+    0x24e, 0x252, 0x257, 0x25b, 0x25f, 0x264, 0x268, 0x26d,
+    0x271, 0x276, 0x27a, 0x27f, 0x283, 0x288, 0x28c, 0x291,
+    0x295, 0x29a, 0x29e, 0x2a3, 0x2a8, 0x2ac, 0x2b1, 0x2b5,
+    0x2ba, 0x2bf, 0x2c4, 0x2c8, 0x2cd, 0x2d2, 0x2d6, 0x2db,
+    0x2e0, 0x2e5, 0x2e9, 0x2ee, 0x2f3, 0x2f8, 0x2fd, 0x302,
+    0x306, 0x30b, 0x310, 0x315, 0x31a, 0x31f, 0x324, 0x329,
+    0x32e, 0x333, 0x338, 0x33d, 0x342, 0x347, 0x34c, 0x351,
+    0x356, 0x35b, 0x360, 0x365, 0x36a, 0x370, 0x375, 0x37a,
+    0x37f, 0x384, 0x38a, 0x38f, 0x394, 0x399, 0x39f, 0x3a4,
+    0x3a9, 0x3ae, 0x3b4, 0x3b9, 0x3bf, 0x3c4, 0x3c9, 0x3cf,
+    0x3d4, 0x3da, 0x3df, 0x3e4, 0x3ea, 0x3ef, 0x3f5, 0x3fa
+};
+
+/* Note table */
+static const Bit32u fn_note[16] = {
+    0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 3, 3, 3, 3, 3, 3
+};
+
+/* Envelope generator */
+static const Bit32u eg_stephi[4][4] = {
+    { 0, 0, 0, 0 },
+    { 1, 0, 0, 0 },
+    { 1, 0, 1, 0 },
+    { 1, 1, 1, 0 }
+};
+
+static const Bit8u eg_am_shift[4] = {
+    7, 3, 1, 0
+};
+
+/* Phase generator */
+static const Bit32u pg_detune[8] = { 16, 17, 19, 20, 22, 24, 27, 29 };
+
+static const Bit32u pg_lfo_sh1[8][8] = {
+    { 7, 7, 7, 7, 7, 7, 7, 7 },
+    { 7, 7, 7, 7, 7, 7, 7, 7 },
+    { 7, 7, 7, 7, 7, 7, 1, 1 },
+    { 7, 7, 7, 7, 1, 1, 1, 1 },
+    { 7, 7, 7, 1, 1, 1, 1, 0 },
+    { 7, 7, 1, 1, 0, 0, 0, 0 },
+    { 7, 7, 1, 1, 0, 0, 0, 0 },
+    { 7, 7, 1, 1, 0, 0, 0, 0 }
+};
+
+static const Bit32u pg_lfo_sh2[8][8] = {
+    { 7, 7, 7, 7, 7, 7, 7, 7 },
+    { 7, 7, 7, 7, 2, 2, 2, 2 },
+    { 7, 7, 7, 2, 2, 2, 7, 7 },
+    { 7, 7, 2, 2, 7, 7, 2, 2 },
+    { 7, 7, 2, 7, 7, 7, 2, 7 },
+    { 7, 7, 7, 2, 7, 7, 2, 1 },
+    { 7, 7, 7, 2, 7, 7, 2, 1 },
+    { 7, 7, 7, 2, 7, 7, 2, 1 }
+};
+
+/* Address decoder */
+static const Bit32u op_offset[12] = {
+    0x000, /* Ch1 OP1/OP2 */
+    0x001, /* Ch2 OP1/OP2 */
+    0x002, /* Ch3 OP1/OP2 */
+    0x100, /* Ch4 OP1/OP2 */
+    0x101, /* Ch5 OP1/OP2 */
+    0x102, /* Ch6 OP1/OP2 */
+    0x004, /* Ch1 OP3/OP4 */
+    0x005, /* Ch2 OP3/OP4 */
+    0x006, /* Ch3 OP3/OP4 */
+    0x104, /* Ch4 OP3/OP4 */
+    0x105, /* Ch5 OP3/OP4 */
+    0x106  /* Ch6 OP3/OP4 */
+};
+
+static const Bit32u ch_offset[6] = {
+    0x000, /* Ch1 */
+    0x001, /* Ch2 */
+    0x002, /* Ch3 */
+    0x100, /* Ch4 */
+    0x101, /* Ch5 */
+    0x102  /* Ch6 */
+};
+
+/* LFO */
+static const Bit32u lfo_cycles[8] = {
+    108, 77, 71, 67, 62, 44, 8, 5
+};
+
+/* FM algorithm */
+static const Bit32u fm_algorithm[4][6][8] = {
+    {
+        { 1, 1, 1, 1, 1, 1, 1, 1 }, /* OP1_0         */
+        { 1, 1, 1, 1, 1, 1, 1, 1 }, /* OP1_1         */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP2           */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 0, 0, 0, 1 }  /* Out           */
+    },
+    {
+        { 0, 1, 0, 0, 0, 1, 0, 0 }, /* OP1_0         */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP1_1         */
+        { 1, 1, 1, 0, 0, 0, 0, 0 }, /* OP2           */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 0, 1, 1, 1 }  /* Out           */
+    },
+    {
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP1_0         */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP1_1         */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP2           */
+        { 1, 0, 0, 1, 1, 1, 1, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 0, 0, 1, 1, 1, 1 }  /* Out           */
+    },
+    {
+        { 0, 0, 1, 0, 0, 1, 0, 0 }, /* OP1_0         */
+        { 0, 0, 0, 0, 0, 0, 0, 0 }, /* OP1_1         */
+        { 0, 0, 0, 1, 0, 0, 0, 0 }, /* OP2           */
+        { 1, 1, 0, 1, 1, 0, 0, 0 }, /* Last operator */
+        { 0, 0, 1, 0, 0, 0, 0, 0 }, /* Last operator */
+        { 1, 1, 1, 1, 1, 1, 1, 1 }  /* Out           */
+    }
+};
+
+/*
+ * Pan law table
+ */
+
+static const Bit16u panlawtable[] =
+{
+    65535, 65529, 65514, 65489, 65454, 65409, 65354, 65289,
+    65214, 65129, 65034, 64929, 64814, 64689, 64554, 64410,
+    64255, 64091, 63917, 63733, 63540, 63336, 63123, 62901,
+    62668, 62426, 62175, 61914, 61644, 61364, 61075, 60776,
+    60468, 60151, 59825, 59489, 59145, 58791, 58428, 58057,
+    57676, 57287, 56889, 56482, 56067, 55643, 55211, 54770,
+    54320, 53863, 53397, 52923, 52441, 51951, 51453, 50947,
+    50433, 49912, 49383, 48846, 48302, 47750, 47191,
+    46340, /* Center left */
+    46340, /* Center right */
+    45472, 44885, 44291, 43690, 43083, 42469, 41848, 41221,
+    40588, 39948, 39303, 38651, 37994, 37330, 36661, 35986,
+    35306, 34621, 33930, 33234, 32533, 31827, 31116, 30400,
+    29680, 28955, 28225, 27492, 26754, 26012, 25266, 24516,
+    23762, 23005, 22244, 21480, 20713, 19942, 19169, 18392,
+    17613, 16831, 16046, 15259, 14469, 13678, 12884, 12088,
+    11291, 10492, 9691, 8888, 8085, 7280, 6473, 5666,
+    4858, 4050, 3240, 2431, 1620, 810, 0
+};
+
+#define LANES(l) for (l = 0; l < Lanes; l++)
+
+template <unsigned Lanes>
+static void OPN2L_DoIO(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    LANES(l)
+    {
+        /* Write signal check */
+        chip->write_a_en[l] = (chip->write_a[l] & 0x03) == 0x01;
+        chip->write_d_en[l] = (chip->write_d[l] & 0x03) == 0x01;
+        chip->write_a[l] <<= 1;
+        chip->write_d[l] <<= 1;
+        /* Busy counter */
+        chip->busy[l] = chip->write_busy[l];
+        chip->write_busy_cnt[l] += chip->write_busy[l];
+        chip->write_busy[l] = (chip->write_busy[l] && !(chip->write_busy_cnt[l] >> 5)) || chip->write_d_en[l];
+        chip->write_busy_cnt[l] &= 0x1f;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_DoRegWriteLane(ym3438_lanes_t<Lanes> *chip, Bit32u l)
+{
+    Bit32u i;
+    Bit32u slot = chip->cycles % 12;
+    Bit32u address;
+    Bit32u channel = chip->channel;
+    /* Update registers */
+    if (chip->write_fm_data[l])
+    {
+        /* Slot */
+        if (op_offset[slot] == (chip->address[l] & 0x107))
+        {
+            if (chip->address[l] & 0x08)
+            {
+                /* OP2, OP4 */
+                slot += 12;
+            }
+            address = chip->address[l] & 0xf0;
+            switch (address)
+            {
+            case 0x30: /* DT, MULTI */
+                chip->multi[slot][l] = chip->data[l] & 0x0f;
+                if (!chip->multi[slot][l])
+                {
+                    chip->multi[slot][l] = 1;
+                }
+                else
+                {
+                    chip->multi[slot][l] <<= 1;
+                }
+                chip->dt[slot][l] = (chip->data[l] >> 4) & 0x07;
+                break;
+            case 0x40: /* TL */
+                chip->tl[slot][l] = chip->data[l] & 0x7f;
+                break;
+            case 0x50: /* KS, AR */
+                chip->ar[slot][l] = chip->data[l] & 0x1f;
+                chip->ks[slot][l] = (chip->data[l] >> 6) & 0x03;
+                break;
+            case 0x60: /* AM, DR */
+                chip->dr[slot][l] = chip->data[l] & 0x1f;
+                chip->am[slot][l] = (chip->data[l] >> 7) & 0x01;
+                break;
+            case 0x70: /* SR */
+                chip->sr[slot][l] = chip->data[l] & 0x1f;
+                break;
+            case 0x80: /* SL, RR */
+                chip->rr[slot][l] = chip->data[l] & 0x0f;
+                chip->sl[slot][l] = (chip->data[l] >> 4) & 0x0f;
+                chip->sl[slot][l] |= (chip->sl[slot][l] + 1) & 0x10;
+                break;
+            case 0x90: /* SSG-EG */
+                chip->ssg_eg[slot][l] = chip->data[l] & 0x0f;
+                break;
+            default:
+                break;
+            }
+        }
+
+        /* Channel */
+        if (ch_offset[channel] == (chip->address[l] & 0x103))
+        {
+            address = chip->address[l] & 0xfc;
+            switch (address)
+            {
+            case 0xa0:
+                chip->fnum[channel][l] = (chip->data[l] & 0xff) | ((chip->reg_a4[l] & 0x07) << 8);
+                chip->block[channel][l] = (chip->reg_a4[l] >> 3) & 0x07;
+                chip->kcode[channel][l] = (chip->block[channel][l] << 2) | fn_note[chip->fnum[channel][l] >> 7];
+                break;
+            case 0xa4:
+                chip->reg_a4[l] = chip->data[l] & 0xff;
+                break;
+            case 0xa8:
+                chip->fnum_3ch[channel][l] = (chip->data[l] & 0xff) | ((chip->reg_ac[l] & 0x07) << 8);
+                chip->block_3ch[channel][l] = (chip->reg_ac[l] >> 3) & 0x07;
+                chip->kcode_3ch[channel][l] = (chip->block_3ch[channel][l] << 2) | fn_note[chip->fnum_3ch[channel][l] >> 7];
+                break;
+            case 0xac:
+                chip->reg_ac[l] = chip->data[l] & 0xff;
+                break;
+            case 0xb0:
+                chip->connect[channel][l] = chip->data[l] & 0x07;
+                chip->fb[channel][l] = (chip->data[l] >> 3) & 0x07;
+                break;
+            case 0xb4:
+                chip->pms[channel][l] = chip->data[l] & 0x07;
+                chip->ams[channel][l] = (chip->data[l] >> 4) & 0x03;
+                chip->pan_l[channel][l] = (chip->data[l] >> 7) & 0x01;
+                chip->pan_r[channel][l] = (chip->data[l] >> 6) & 0x01;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    if (chip->write_a_en[l] || chip->write_d_en[l])
+    {
+        /* Data */
+        if (chip->write_a_en[l])
+        {
+            chip->write_fm_data[l] = 0;
+        }
+
+        if (chip->write_fm_address[l] && chip->write_d_en[l])
+        {
+            chip->write_fm_data[l] = 1;
+        }
+
+        /* Address */
+        if (chip->write_a_en[l])
+        {
+            if ((chip->write_data[l] & 0xf0) != 0x00)
+            {
+                /* FM Write */
+                chip->address[l] = chip->write_data[l];
+                chip->write_fm_address[l] = 1;
+            }
+            else
+            {
+                /* SSG write */
+                chip->write_fm_address[l] = 0;
+            }
+        }
+
+        /* FM Mode */
+        /* Data */
+        if (chip->write_d_en[l] && (chip->write_data[l] & 0x100) == 0)
+        {
+            switch (chip->write_fm_mode_a[l])
+            {
+            case 0x21: /* LSI test 1 */
+                for (i = 0; i < 8; i++)
+                {
+                    chip->mode_test_21[i][l] = (chip->write_data[l] >> i) & 0x01;
+                }
+                break;
+            case 0x22: /* LFO control */
+                if ((chip->write_data[l] >> 3) & 0x01)
+                {
+                    chip->lfo_en[l] = 0x7f;
+                }
+                else
+                {
+                    chip->lfo_en[l] = 0;
+                }
+                chip->lfo_freq[l] = chip->write_data[l] & 0x07;
+                break;
+            case 0x24: /* Timer A */
+                chip->timer_a_reg[l] &= 0x03;
+                chip->timer_a_reg[l] |= (chip->write_data[l] & 0xff) << 2;
+                break;
+            case 0x25:
+                chip->timer_a_reg[l] &= 0x3fc;
+                chip->timer_a_reg[l] |= chip->write_data[l] & 0x03;
+                break;
+            case 0x26: /* Timer B */
+                chip->timer_b_reg[l] = chip->write_data[l] & 0xff;
+                break;
+            case 0x27: /* CSM, Timer control */
+                chip->mode_ch3[l] = (chip->write_data[l] & 0xc0) >> 6;
+                chip->mode_csm[l] = chip->mode_ch3[l] == 2;
+                chip->timer_a_load[l] = chip->write_data[l] & 0x01;
+                chip->timer_a_enable[l] = (chip->write_data[l] >> 2) & 0x01;
+                chip->timer_a_reset[l] = (chip->write_data[l] >> 4) & 0x01;
+                chip->timer_b_load[l] = (chip->write_data[l] >> 1) & 0x01;
+                chip->timer_b_enable[l] = (chip->write_data[l] >> 3) & 0x01;
+                chip->timer_b_reset[l] = (chip->write_data[l] >> 5) & 0x01;
+                break;
+            case 0x28: /* Key on/off */
+                for (i = 0; i < 4; i++)
+                {
+                    chip->mode_kon_operator[i][l] = (chip->write_data[l] >> (4 + i)) & 0x01;
+                }
+                if ((chip->write_data[l] & 0x03) == 0x03)
+                {
+                    /* Invalid address */
+                    chip->mode_kon_channel[l] = 0xff;
+                }
+                else
+                {
+                    chip->mode_kon_channel[l] = (chip->write_data[l] & 0x03) + ((chip->write_data[l] >> 2) & 1) * 3;
+                }
+                break;
+            case 0x2a: /* DAC data */
+                chip->dacdata[l] &= 0x01;
+                chip->dacdata[l] |= (chip->write_data[l] ^ 0x80) << 1;
+                break;
+            case 0x2b: /* DAC enable */
+                chip->dacen[l] = chip->write_data[l] >> 7;
+                break;
+            case 0x2c: /* LSI test 2 */
+                for (i = 0; i < 8; i++)
+                {
+                    chip->mode_test_2c[i][l] = (chip->write_data[l] >> i) & 0x01;
+                }
+                chip->dacdata[l] &= 0x1fe;
+                chip->dacdata[l] |= chip->mode_test_2c[3][l];
+                chip->eg_custom_timer[l] = !chip->mode_test_2c[7][l] && chip->mode_test_2c[6][l];
+                break;
+            default:
+                break;
+            }
+        }
+
+        /* Address */
+        if (chip->write_a_en[l])
+        {
+            chip->write_fm_mode_a[l] = chip->write_data[l] & 0x1ff;
+        }
+    }
+
+    if (chip->write_fm_data[l])
+    {
+        chip->data[l] = chip->write_data[l] & 0xff;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_DoRegWrite(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    LANES(l)
+    {
+        /* Most of cycles of a lane don't touch registers */
+        if (chip->write_fm_data[l] || chip->write_a_en[l] || chip->write_d_en[l])
+        {
+            OPN2L_DoRegWriteLane(chip, l);
+        }
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_PhaseCalcIncrement(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u chan = chip->channel;
+    Bit32u slot = chip->cycles;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit32u fnum = chip->pg_fnum[l];
+        Bit32u fnum_h = fnum >> 4;
+        Bit32u fm;
+        Bit32u basefreq;
+        Bit8u lfo = chip->lfo_pm[l];
+        Bit8u lfo_l = lfo & 0x0f;
+        Bit8u pms = chip->pms[chan][l];
+        Bit8u dt = chip->dt[slot][l];
+        Bit8u dt_l = dt & 0x03;
+        Bit8u detune = 0;
+        Bit8u block, note;
+        Bit8u sum, sum_h, sum_l;
+        Bit8u kcode = chip->pg_kcode[l];
+
+        fnum <<= 1;
+        /* Apply LFO */
+        if (lfo_l & 0x08)
+        {
+            lfo_l ^= 0x0f;
+        }
+        fm = (fnum_h >> pg_lfo_sh1[pms][lfo_l]) + (fnum_h >> pg_lfo_sh2[pms][lfo_l]);
+        if (pms > 5)
+        {
+            fm <<= pms - 5;
+        }
+        fm >>= 2;
+        if (lfo & 0x10)
+        {
+            fnum -= fm;
+        }
+        else
+        {
+            fnum += fm;
+        }
+        fnum &= 0xfff;
+
+        basefreq = (fnum << chip->pg_block[l]) >> 2;
+
+        /* Apply detune */
+        if (dt_l)
+        {
+            if (kcode > 0x1c)
+            {
+                kcode = 0x1c;
+            }
+            block = kcode >> 2;
+            note = kcode & 0x03;
+            sum = block + 9 + ((dt_l == 3) | (dt_l & 0x02));
+            sum_h = sum >> 1;
+            sum_l = sum & 0x01;
+            detune = pg_detune[(sum_l << 2) | note] >> (9 - sum_h);
+        }
+        if (dt & 0x04)
+        {
+            basefreq -= detune;
+        }
+        else
+        {
+            basefreq += detune;
+        }
+        basefreq &= 0x1ffff;
+        chip->pg_inc[slot][l] = (basefreq * chip->multi[slot][l]) >> 1;
+        chip->pg_inc[slot][l] &= 0xfffff;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_PhaseGenerate(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot;
+    Bit32u l;
+    /* Mask increment */
+    slot = (chip->cycles + 20) % 24;
+    LANES(l)
+    {
+        if (chip->pg_reset[slot][l])
+        {
+            chip->pg_inc[slot][l] = 0;
+        }
+    }
+    /* Phase step */
+    slot = (chip->cycles + 19) % 24;
+    LANES(l)
+    {
+        chip->pg_phase[slot][l] += chip->pg_inc[slot][l];
+        chip->pg_phase[slot][l] &= 0xfffff;
+        if (chip->pg_reset[slot][l] || chip->mode_test_21[3][l])
+        {
+            chip->pg_phase[slot][l] = 0;
+        }
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_EnvelopeSSGEG(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = chip->cycles;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit8u direction = 0;
+        chip->eg_ssg_pgrst_latch[slot][l] = 0;
+        chip->eg_ssg_repeat_latch[slot][l] = 0;
+        chip->eg_ssg_hold_up_latch[slot][l] = 0;
+        chip->eg_ssg_inv[slot][l] = 0;
+        if (chip->ssg_eg[slot][l] & 0x08)
+        {
+            direction = chip->eg_ssg_dir[slot][l];
+            if (chip->eg_level[slot][l] & 0x200)
+            {
+                /* Reset */
+                if ((chip->ssg_eg[slot][l] & 0x03) == 0x00)
+                {
+                    chip->eg_ssg_pgrst_latch[slot][l] = 1;
+                }
+                /* Repeat */
+                if ((chip->ssg_eg[slot][l] & 0x01) == 0x00)
+                {
+                    chip->eg_ssg_repeat_latch[slot][l] = 1;
+                }
+                /* Inverse */
+                if ((chip->ssg_eg[slot][l] & 0x03) == 0x02)
+                {
+                    direction ^= 1;
+                }
+                if ((chip->ssg_eg[slot][l] & 0x03) == 0x03)
+                {
+                    direction = 1;
+                }
+            }
+            /* Hold up */
+            if (chip->eg_kon_latch[slot][l]
+             && ((chip->ssg_eg[slot][l] & 0x07) == 0x05 || (chip->ssg_eg[slot][l] & 0x07) == 0x03))
+            {
+                chip->eg_ssg_hold_up_latch[slot][l] = 1;
+            }
+            direction &= chip->eg_kon[slot][l];
+            chip->eg_ssg_inv[slot][l] = (chip->eg_ssg_dir[slot][l] ^ ((chip->ssg_eg[slot][l] >> 2) & 0x01))
+                                      & chip->eg_kon[slot][l];
+        }
+        chip->eg_ssg_dir[slot][l] = direction;
+        chip->eg_ssg_enable[slot][l] = (chip->ssg_eg[slot][l] >> 3) & 0x01;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_EnvelopeADSR(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = (chip->cycles + 22) % 24;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit8u nkon = chip->eg_kon_latch[slot][l];
+        Bit8u okon = chip->eg_kon[slot][l];
+        Bit8u kon_event;
+        Bit8u koff_event;
+        Bit8u eg_off;
+        Bit16s level;
+        Bit16s nextlevel = 0;
+        Bit16s ssg_level;
+        Bit8u nextstate = chip->eg_state[slot][l];
+        Bit16s inc = 0;
+        chip->eg_read[0][l] = chip->eg_read_inc[l];
+        chip->eg_read_inc[l] = chip->eg_inc[l] > 0;
+
+        /* Reset phase generator */
+        chip->pg_reset[slot][l] = (nkon && !okon) || chip->eg_ssg_pgrst_latch[slot][l];
+
+        /* KeyOn/Off */
+        kon_event = (nkon && !okon) || (okon && chip->eg_ssg_repeat_latch[slot][l]);
+        koff_event = okon && !nkon;
+
+        ssg_level = level = (Bit16s)chip->eg_level[slot][l];
+
+        if (chip->eg_ssg_inv[slot][l])
+        {
+            /* Inverse */
+            ssg_level = 512 - level;
+            ssg_level &= 0x3ff;
+        }
+        if (koff_event)
+        {
+            level = ssg_level;
+        }
+        if (chip->eg_ssg_enable[slot][l])
+        {
+            eg_off = level >> 9;
+        }
+        else
+        {
+            eg_off = (level & 0x3f0) == 0x3f0;
+        }
+        nextlevel = level;
+        if (kon_event)
+        {
+            nextstate = eg_num_attack;
+            /* Instant attack */
+            if (chip->eg_ratemax[l])
+            {
+                nextlevel = 0;
+            }
+            else if (chip->eg_state[slot][l] == eg_num_attack && level != 0 && chip->eg_inc[l] && nkon)
+            {
+                inc = (~level << chip->eg_inc[l]) >> 5;
+            }
+        }
+        else
+        {
+            switch (chip->eg_state[slot][l])
+            {
+            case eg_num_attack:
+                if (level == 0)
+                {
+                    nextstate = eg_num_decay;
+                }
+                else if(chip->eg_inc[l] && !chip->eg_ratemax[l] && nkon)
+                {
+                    inc = (~level << chip->eg_inc[l]) >> 5;
+                }
+                break;
+            case eg_num_decay:
+                if ((level >> 5) == chip->eg_sl[1][l])
+                {
+                    nextstate = eg_num_sustain;
+                }
+                else if (!eg_off && chip->eg_inc[l])
+                {
+                    inc = 1 << (chip->eg_inc[l] - 1);
+                    if (chip->eg_ssg_enable[slot][l])
+                    {
+                        inc <<= 2;
+                    }
+                }
+                break;
+            case eg_num_sustain:
+            case eg_num_release:
+                if (!eg_off && chip->eg_inc[l])
+                {
+                    inc = 1 << (chip->eg_inc[l] - 1);
+                    if (chip->eg_ssg_enable[slot][l])
+                    {
+                        inc <<= 2;
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+            if (!nkon)
+            {
+                nextstate = eg_num_release;
+            }
+        }
+        if (chip->eg_kon_csm[slot][l])
+        {
+            nextlevel |= chip->eg_tl[1][l] << 3;
+        }
+
+        /* Envelope off */
+        if (!kon_event && !chip->eg_ssg_hold_up_latch[slot][l] && chip->eg_state[slot][l] != eg_num_attack && eg_off)
+        {
+            nextstate = eg_num_release;
+            nextlevel = 0x3ff;
+        }
+
+        nextlevel += inc;
+
+        chip->eg_kon[slot][l] = chip->eg_kon_latch[slot][l];
+        chip->eg_level[slot][l] = (Bit16u)nextlevel & 0x3ff;
+        chip->eg_state[slot][l] = nextstate;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_EnvelopePrepare(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = chip->cycles;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit8u rate;
+        Bit8u sum;
+        Bit8u inc = 0;
+        Bit8u rate_sel;
+
+        /* Prepare increment */
+        rate = (chip->eg_rate[l] << 1) + chip->eg_ksv[l];
+
+        if (rate > 0x3f)
+        {
+            rate = 0x3f;
+        }
+
+        sum = ((rate >> 2) + chip->eg_shift_lock[l]) & 0x0f;
+        if (chip->eg_rate[l] != 0 && chip->eg_quotient[l] == 2)
+        {
+            if (rate < 48)
+            {
+                switch (sum)
+                {
+                case 12:
+                    inc = 1;
+                    break;
+                case 13:
+                    inc = (rate >> 1) & 0x01;
+                    break;
+                case 14:
+                    inc = rate & 0x01;
+                    break;
+                default:
+                    break;
+                }
+            }
+            else
+            {
+                inc = eg_stephi[rate & 0x03][chip->eg_timer_low_lock[l]] + (rate >> 2) - 11;
+                if (inc > 4)
+                {
+                    inc = 4;
+                }
+            }
+        }
+        chip->eg_inc[l] = inc;
+        chip->eg_ratemax[l] = (rate >> 1) == 0x1f;
+
+        /* Prepare rate & ksv */
+        rate_sel = chip->eg_state[slot][l];
+        if ((chip->eg_kon[slot][l] && chip->eg_ssg_repeat_latch[slot][l])
+         || (!chip->eg_kon[slot][l] && chip->eg_kon_latch[slot][l]))
+        {
+            rate_sel = eg_num_attack;
+        }
+        switch (rate_sel)
+        {
+        case eg_num_attack:
+            chip->eg_rate[l] = chip->ar[slot][l];
+            break;
+        case eg_num_decay:
+            chip->eg_rate[l] = chip->dr[slot][l];
+            break;
+        case eg_num_sustain:
+            chip->eg_rate[l] = chip->sr[slot][l];
+            break;
+        case eg_num_release:
+            chip->eg_rate[l] = (chip->rr[slot][l] << 1) | 0x01;
+            break;
+        default:
+            break;
+        }
+        chip->eg_ksv[l] = chip->pg_kcode[l] >> (chip->ks[slot][l] ^ 0x03);
+        if (chip->am[slot][l])
+        {
+            chip->eg_lfo_am[l] = chip->lfo_am[l] >> eg_am_shift[chip->ams[chip->channel][l]];
+        }
+        else
+        {
+            chip->eg_lfo_am[l] = 0;
+        }
+        /* Delay TL & SL value */
+        chip->eg_tl[1][l] = chip->eg_tl[0][l];
+        chip->eg_tl[0][l] = chip->tl[slot][l];
+        chip->eg_sl[1][l] = chip->eg_sl[0][l];
+        chip->eg_sl[0][l] = chip->sl[slot][l];
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_EnvelopeGenerate(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = (chip->cycles + 23) % 24;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit16u level;
+
+        level = chip->eg_level[slot][l];
+
+        if (chip->eg_ssg_inv[slot][l])
+        {
+            /* Inverse */
+            level = 512 - level;
+        }
+        if (chip->mode_test_21[5][l])
+        {
+            level = 0;
+        }
+        level &= 0x3ff;
+
+        /* Apply AM LFO */
+        level += chip->eg_lfo_am[l];
+
+        /* Apply TL */
+        if (!(chip->mode_csm[l] && chip->channel == 2 + 1))
+        {
+            level += chip->eg_tl[0][l] << 3;
+        }
+        if (level > 0x3ff)
+        {
+            level = 0x3ff;
+        }
+        chip->eg_out[slot][l] = level;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_UpdateLFO(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    LANES(l)
+    {
+        if ((chip->lfo_quotient[l] & lfo_cycles[chip->lfo_freq[l]]) == lfo_cycles[chip->lfo_freq[l]])
+        {
+            chip->lfo_quotient[l] = 0;
+            chip->lfo_cnt[l]++;
+        }
+        else
+        {
+            chip->lfo_quotient[l] += chip->lfo_inc[l];
+        }
+        chip->lfo_cnt[l] &= chip->lfo_en[l];
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_FMPrepare(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = (chip->cycles + 6) % 24;
+    Bit32u channel = chip->channel;
+    Bit32u op = slot / 6;
+    Bit32u prevslot = (chip->cycles + 18) % 24;
+    Bit32u l;
+
+    LANES(l)
+    {
+        Bit16s mod, mod1, mod2;
+        Bit8u connect = chip->connect[channel][l];
+
+        /* Calculate modulation */
+        mod1 = mod2 = 0;
+
+        if (fm_algorithm[op][0][connect])
+        {
+            mod2 |= chip->fm_op1[channel][0][l];
+        }
+        if (fm_algorithm[op][1][connect])
+        {
+            mod1 |= chip->fm_op1[channel][1][l];
+        }
+        if (fm_algorithm[op][2][connect])
+        {
+            mod1 |= chip->fm_op2[channel][l];
+        }
+        if (fm_algorithm[op][3][connect])
+        {
+            mod2 |= chip->fm_out[prevslot][l];
+        }
+        if (fm_algorithm[op][4][connect])
+        {
+            mod1 |= chip->fm_out[prevslot][l];
+        }
+        mod = mod1 + mod2;
+        if (op == 0)
+        {
+            /* Feedback */
+            mod = mod >> (10 - chip->fb[channel][l]);
+            if (!chip->fb[channel][l])
+            {
+                mod = 0;
+            }
+        }
+        else
+        {
+            mod >>= 1;
+        }
+        chip->fm_mod[slot][l] = mod;
+    }
+
+    slot = (chip->cycles + 18) % 24;
+    /* OP1 */
+    if (slot / 6 == 0)
+    {
+        LANES(l)
+        {
+            chip->fm_op1[channel][1][l] = chip->fm_op1[channel][0][l];
+            chip->fm_op1[channel][0][l] = chip->fm_out[slot][l];
+        }
+    }
+    /* OP2 */
+    if (slot / 6 == 2)
+    {
+        LANES(l)
+        {
+            chip->fm_op2[channel][l] = chip->fm_out[slot][l];
+        }
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_ChGenerate(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = (chip->cycles + 18) % 24;
+    Bit32u channel = chip->channel;
+    Bit32u op = slot / 6;
+    Bit32u l;
+    LANES(l)
+    {
+        Bit32u test_dac = chip->mode_test_2c[5][l];
+        Bit16s acc = chip->ch_acc[channel][l];
+        Bit16s add = test_dac;
+        Bit16s sum = 0;
+        if (op == 0 && !test_dac)
+        {
+            acc = 0;
+        }
+        if (fm_algorithm[op][5][chip->connect[channel][l]] && !test_dac)
+        {
+            add += chip->fm_out[slot][l] >> 5;
+        }
+        sum = acc + add;
+        /* Clamp */
+        if (sum > 255)
+        {
+            sum = 255;
+        }
+        else if(sum < -256)
+        {
+            sum = -256;
+        }
+
+        if (op == 0 || test_dac)
+        {
+            chip->ch_out[channel][l] = chip->ch_acc[channel][l];
+        }
+        chip->ch_acc[channel][l] = sum;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_ChOutput(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u cycles = chip->cycles;
+    Bit32u slot = chip->cycles;
+    Bit32u channel = chip->channel;
+    Bit32u l;
+    if (slot < 12)
+    {
+        /* Ch 4,5,6 */
+        channel++;
+    }
+    LANES(l)
+    {
+        Bit32u test_dac = chip->mode_test_2c[5][l];
+        Bit16s out;
+        Bit16s sign;
+        Bit32u out_en;
+        chip->ch_read[l] = chip->ch_lock[l];
+        if ((cycles & 3) == 0)
+        {
+            if (!test_dac)
+            {
+                /* Lock value */
+                chip->ch_lock[l] = chip->ch_out[channel][l];
+            }
+            chip->ch_lock_l[l] = chip->pan_l[channel][l];
+            chip->ch_lock_r[l] = chip->pan_r[channel][l];
+        }
+        /* Ch 6 */
+        if (((cycles >> 2) == 1 && chip->dacen[l]) || test_dac)
+        {
+            out = (Bit16s)chip->dacdata[l];
+            out <<= 7;
+            out >>= 7;
+        }
+        else
+        {
+            out = chip->ch_lock[l];
+        }
+        chip->mol[l] = 0;
+        chip->mor[l] = 0;
+
+        if (chip->chip_type[l] & ym3438_mode_ym2612)
+        {
+            out_en = ((cycles & 3) == 3) || test_dac;
+            /* YM2612 DAC emulation(not verified) */
+            sign = out >> 8;
+            if (out >= 0)
+            {
+                out++;
+                sign++;
+            }
+            if (chip->ch_lock_l[l] && out_en)
+            {
+                chip->mol[l] = out;
+            }
+            else
+            {
+                chip->mol[l] = sign;
+            }
+            if (chip->ch_lock_r[l] && out_en)
+            {
+                chip->mor[l] = out;
+            }
+            else
+            {
+                chip->mor[l] = sign;
+            }
+            /* Amplify signal */
+            chip->mol[l] *= 3;
+            chip->mor[l] *= 3;
+        }
+        else
+        {
+            out_en = ((cycles & 3) != 0) || test_dac;
+            if (chip->ch_lock_l[l] && out_en)
+            {
+                chip->mol[l] = out;
+            }
+            if (chip->ch_lock_r[l] && out_en)
+            {
+                chip->mor[l] = out;
+            }
+        }
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_FMGenerate(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = (chip->cycles + 19) % 24;
+    Bit32u l;
+    LANES(l)
+    {
+        /* Calculate phase */
+        Bit16u phase = (chip->fm_mod[slot][l] + (chip->pg_phase[slot][l] >> 10)) & 0x3ff;
+        Bit16u quarter;
+        Bit16u level;
+        Bit16s output;
+        if (phase & 0x100)
+        {
+            quarter = (phase ^ 0xff) & 0xff;
+        }
+        else
+        {
+            quarter = phase & 0xff;
+        }
+        level = logsinrom[quarter];
+        /* Apply envelope */
+        level += chip->eg_out[slot][l] << 2;
+        /* Transform */
+        if (level > 0x1fff)
+        {
+            level = 0x1fff;
+        }
+        output = ((exprom[(level & 0xff) ^ 0xff] | 0x400) << 2) >> (level >> 8);
+        if (phase & 0x200)
+        {
+            output = ((~output) ^ (chip->mode_test_21[4][l] << 13)) + 1;
+        }
+        else
+        {
+            output = output ^ (chip->mode_test_21[4][l] << 13);
+        }
+        output <<= 2;
+        output >>= 2;
+        chip->fm_out[slot][l] = output;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_DoTimerA(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    LANES(l)
+    {
+        Bit16u time;
+        Bit8u load;
+        load = chip->timer_a_overflow[l];
+        if (chip->cycles == 2)
+        {
+            /* Lock load value */
+            load |= (!chip->timer_a_load_lock[l] && chip->timer_a_load[l]);
+            chip->timer_a_load_lock[l] = chip->timer_a_load[l];
+            if (chip->mode_csm[l])
+            {
+                /* CSM KeyOn */
+                chip->mode_kon_csm[l] = load;
+            }
+            else
+            {
+                chip->mode_kon_csm[l] = 0;
+            }
+        }
+        /* Load counter */
+        if (chip->timer_a_load_latch[l])
+        {
+            time = chip->timer_a_reg[l];
+        }
+        else
+        {
+            time = chip->timer_a_cnt[l];
+        }
+        chip->timer_a_load_latch[l] = load;
+        /* Increase counter */
+        if ((chip->cycles == 1 && chip->timer_a_load_lock[l]) || chip->mode_test_21[2][l])
+        {
+            time++;
+        }
+        /* Set overflow flag */
+        if (chip->timer_a_reset[l])
+        {
+            chip->timer_a_reset[l] = 0;
+            chip->timer_a_overflow_flag[l] = 0;
+        }
+        else
+        {
+            chip->timer_a_overflow_flag[l] |= chip->timer_a_overflow[l] & chip->timer_a_enable[l];
+        }
+        chip->timer_a_overflow[l] = (time >> 10);
+        chip->timer_a_cnt[l] = time & 0x3ff;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_DoTimerB(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    LANES(l)
+    {
+        Bit16u time;
+        Bit8u load;
+        load = chip->timer_b_overflow[l];
+        if (chip->cycles == 2)
+        {
+            /* Lock load value */
+            load |= (!chip->timer_b_load_lock[l] && chip->timer_b_load[l]);
+            chip->timer_b_load_lock[l] = chip->timer_b_load[l];
+        }
+        /* Load counter */
+        if (chip->timer_b_load_latch[l])
+        {
+            time = chip->timer_b_reg[l];
+        }
+        else
+        {
+            time = chip->timer_b_cnt[l];
+        }
+        chip->timer_b_load_latch[l] = load;
+        /* Increase counter */
+        if (chip->cycles == 1)
+        {
+            chip->timer_b_subcnt[l]++;
+        }
+        if ((chip->timer_b_subcnt[l] == 0x10 && chip->timer_b_load_lock[l]) || chip->mode_test_21[2][l])
+        {
+            time++;
+        }
+        chip->timer_b_subcnt[l] &= 0x0f;
+        /* Set overflow flag */
+        if (chip->timer_b_reset[l])
+        {
+            chip->timer_b_reset[l] = 0;
+            chip->timer_b_overflow_flag[l] = 0;
+        }
+        else
+        {
+            chip->timer_b_overflow_flag[l] |= chip->timer_b_overflow[l] & chip->timer_b_enable[l];
+        }
+        chip->timer_b_overflow[l] = (time >> 8);
+        chip->timer_b_cnt[l] = time & 0xff;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_KeyOn(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = chip->cycles;
+    Bit32u chan = chip->channel;
+    Bit32u l;
+    LANES(l)
+    {
+        /* Key On */
+        chip->eg_kon_latch[slot][l] = chip->mode_kon[slot][l];
+        chip->eg_kon_csm[slot][l] = 0;
+        if (chip->channel == 2 && chip->mode_kon_csm[l])
+        {
+            /* CSM Key On */
+            chip->eg_kon_latch[slot][l] = 1;
+            chip->eg_kon_csm[slot][l] = 1;
+        }
+        if (chip->cycles == chip->mode_kon_channel[l])
+        {
+            /* OP1 */
+            chip->mode_kon[chan][l] = chip->mode_kon_operator[0][l];
+            /* OP2 */
+            chip->mode_kon[chan + 12][l] = chip->mode_kon_operator[1][l];
+            /* OP3 */
+            chip->mode_kon[chan + 6][l] = chip->mode_kon_operator[2][l];
+            /* OP4 */
+            chip->mode_kon[chan + 18][l] = chip->mode_kon_operator[3][l];
+        }
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_Clock(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u slot = chip->cycles;
+    Bit32u l;
+    LANES(l)
+    {
+        chip->lfo_inc[l] = chip->mode_test_21[1][l];
+        chip->pg_read[l] >>= 1;
+        chip->eg_read[1][l] >>= 1;
+        chip->eg_cycle[l]++;
+    }
+    /* Lock envelope generator timer value */
+    if (chip->cycles == 1)
+    {
+        LANES(l)
+        {
+            if (chip->eg_quotient[l] == 2)
+            {
+                if (chip->eg_cycle_stop[l])
+                {
+                    chip->eg_shift_lock[l] = 0;
+                }
+                else
+                {
+                    chip->eg_shift_lock[l] = chip->eg_shift[l] + 1;
+                }
+                chip->eg_timer_low_lock[l] = chip->eg_timer[l] & 0x03;
+            }
+        }
+    }
+    /* Cycle specific functions */
+    switch (chip->cycles)
+    {
+    case 0:
+        LANES(l)
+        {
+            chip->lfo_pm[l] = chip->lfo_cnt[l] >> 2;
+            if (chip->lfo_cnt[l] & 0x40)
+            {
+                chip->lfo_am[l] = chip->lfo_cnt[l] & 0x3f;
+            }
+            else
+            {
+                chip->lfo_am[l] = chip->lfo_cnt[l] ^ 0x3f;
+            }
+            chip->lfo_am[l] <<= 1;
+        }
+        break;
+    case 1:
+        LANES(l)
+        {
+            chip->eg_quotient[l]++;
+            chip->eg_quotient[l] %= 3;
+            chip->eg_cycle[l] = 0;
+            chip->eg_cycle_stop[l] = 1;
+            chip->eg_shift[l] = 0;
+            chip->eg_timer_inc[l] |= chip->eg_quotient[l] >> 1;
+            chip->eg_timer[l] = chip->eg_timer[l] + chip->eg_timer_inc[l];
+            chip->eg_timer_inc[l] = chip->eg_timer[l] >> 12;
+            chip->eg_timer[l] &= 0xfff;
+        }
+        break;
+    case 2:
+        LANES(l)
+        {
+            chip->pg_read[l] = chip->pg_phase[21][l] & 0x3ff;
+            chip->eg_read[1][l] = chip->eg_out[0][l];
+        }
+        break;
+    case 13:
+        LANES(l)
+        {
+            chip->eg_cycle[l] = 0;
+            chip->eg_cycle_stop[l] = 1;
+            chip->eg_shift[l] = 0;
+            chip->eg_timer[l] = chip->eg_timer[l] + chip->eg_timer_inc[l];
+            chip->eg_timer_inc[l] = chip->eg_timer[l] >> 12;
+            chip->eg_timer[l] &= 0xfff;
+        }
+        break;
+    case 23:
+        LANES(l)
+        {
+            chip->lfo_inc[l] |= 1;
+        }
+        break;
+    }
+    LANES(l)
+    {
+        chip->eg_timer[l] &= ~(chip->mode_test_21[5][l] << chip->eg_cycle[l]);
+        if (((chip->eg_timer[l] >> chip->eg_cycle[l]) | (chip->pin_test_in[l] & chip->eg_custom_timer[l])) & chip->eg_cycle_stop[l])
+        {
+            chip->eg_shift[l] = chip->eg_cycle[l];
+            chip->eg_cycle_stop[l] = 0;
+        }
+    }
+
+    OPN2L_DoIO(chip);
+
+    OPN2L_DoTimerA(chip);
+    OPN2L_DoTimerB(chip);
+    OPN2L_KeyOn(chip);
+
+    OPN2L_ChOutput(chip);
+    OPN2L_ChGenerate(chip);
+
+    OPN2L_FMPrepare(chip);
+    OPN2L_FMGenerate(chip);
+
+    OPN2L_PhaseGenerate(chip);
+    OPN2L_PhaseCalcIncrement(chip);
+
+    OPN2L_EnvelopeADSR(chip);
+    OPN2L_EnvelopeGenerate(chip);
+    OPN2L_EnvelopeSSGEG(chip);
+    OPN2L_EnvelopePrepare(chip);
+
+    /* Prepare fnum & block */
+    LANES(l)
+    {
+        Bit32u ch = (chip->channel + 1) % 6;
+        if (chip->mode_ch3[l])
+        {
+            /* Channel 3 special mode */
+            switch (slot)
+            {
+            case 1: /* OP1 */
+                chip->pg_fnum[l] = chip->fnum_3ch[1][l];
+                chip->pg_block[l] = chip->block_3ch[1][l];
+                chip->pg_kcode[l] = chip->kcode_3ch[1][l];
+                continue;
+            case 7: /* OP3 */
+                chip->pg_fnum[l] = chip->fnum_3ch[0][l];
+                chip->pg_block[l] = chip->block_3ch[0][l];
+                chip->pg_kcode[l] = chip->kcode_3ch[0][l];
+                continue;
+            case 13: /* OP2 */
+                chip->pg_fnum[l] = chip->fnum_3ch[2][l];
+                chip->pg_block[l] = chip->block_3ch[2][l];
+                chip->pg_kcode[l] = chip->kcode_3ch[2][l];
+                continue;
+            case 19: /* OP4 */
+            default:
+                break;
+            }
+        }
+        chip->pg_fnum[l] = chip->fnum[ch][l];
+        chip->pg_block[l] = chip->block[ch][l];
+        chip->pg_kcode[l] = chip->kcode[ch][l];
+    }
+
+    OPN2L_UpdateLFO(chip);
+    OPN2L_DoRegWrite(chip);
+    chip->cycles = (chip->cycles + 1) % 24;
+    chip->channel = chip->cycles % 6;
+
+    LANES(l)
+    {
+        if (chip->status_time[l])
+            chip->status_time[l]--;
+    }
+}
+
+template <unsigned Lanes>
+static void OPN2L_Write(ym3438_lanes_t<Lanes> *chip, Bit32u l, Bit32u port, Bit8u data)
+{
+    port &= 3;
+    chip->write_data[l] = ((port << 7) & 0x100) | data;
+    if (port & 1)
+    {
+        /* Data */
+        chip->write_d[l] |= 1;
+    }
+    else
+    {
+        /* Address */
+        chip->write_a[l] |= 1;
+    }
+}
+
+template <unsigned Lanes>
+static Bit32u OPN2L_CountPending(const ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l, i, count = 0;
+    LANES(l)
+    {
+        for (i = 0; i < OPN_WRITEBUF_SIZE; i++)
+        {
+            if (chip->writebuf[l][i].port & 0x04)
+            {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+template <unsigned Lanes>
+void OPN2L_Init(ym3438_lanes_t<Lanes> *chip)
+{
+    Bit32u l;
+    memset(chip, 0, sizeof(ym3438_lanes_t<Lanes>));
+    LANES(l)
+    {
+        OPN2L_Reset(chip, l, 0, 0);
+    }
+}
+
+template <unsigned Lanes>
+void OPN2L_Reset(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u rate, Bit32u clock)
+{
+    ym3438_t *state = new ym3438_t;
+    OPN2L_GetLane(chip, lane, state);
+    OPN2_Reset(state, rate, clock);
+    state->cycles = chip->cycles;
+    state->channel = chip->channel;
+    OPN2L_SetLane(chip, lane, state);
+    delete state;
+}
+
+template <unsigned Lanes>
+void OPN2L_SetChipType(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u type)
+{
+    chip->chip_type[lane] = type;
+}
+
+template <unsigned Lanes>
+void OPN2L_WritePan(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u channel, Bit8u data)
+{
+    chip->pan_volume_l[channel][lane] = panlawtable[data & 0x7F];
+    chip->pan_volume_r[channel][lane] = panlawtable[0x7F - (data & 0x7F)];
+}
+
+template <unsigned Lanes>
+void OPN2L_WriteBuffered(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u port, Bit8u data)
+{
+    opn2_writebuf *writebuf = chip->writebuf[lane];
+    Bit32u last = chip->writebuf_last[lane];
+    Bit64u time1, time2;
+
+    if (writebuf[last].port & 0x04)
+    {
+        /* The buffer is full: the single chip emulator clocks itself up to
+         * the time of the oldest write, a lane can't leave the others, so
+         * that write goes in at once */
+        OPN2L_Write(chip, lane, writebuf[last].port & 0X03, writebuf[last].data);
+        chip->writebuf_cur[lane] = (last + 1) % OPN_WRITEBUF_SIZE;
+        chip->writebuf_pending--;
+    }
+
+    writebuf[last].port = (port & 0x03) | 0x04;
+    writebuf[last].data = data;
+    time1 = chip->writebuf_lasttime[lane] + OPN_WRITEBUF_DELAY;
+    time2 = chip->writebuf_samplecnt[lane];
+
+    if (time1 < time2)
+    {
+        time1 = time2;
+    }
+
+    writebuf[last].time = time1;
+    chip->writebuf_lasttime[lane] = time1;
+    chip->writebuf_last[lane] = (last + 1) % OPN_WRITEBUF_SIZE;
+    chip->writebuf_pending++;
+}
+
+template <unsigned Lanes>
+void OPN2L_Generate(ym3438_lanes_t<Lanes> *chip, Bit16s *buf)
+{
+    Bit32u i, l;
+    Bit32u mute[Lanes];
+    Bit32s channel;
+    Bit32u mute_ch;
+    Bit16s out_l[Lanes], out_r[Lanes];
+
+    LANES(l)
+    {
+        out_l[l] = 0;
+        out_r[l] = 0;
+    }
+
+    for (i = 0; i < 24; i++)
+    {
+        switch (chip->cycles >> 2)
+        {
+        case 0: /* Ch 2 */
+            mute_ch = 1;
+            channel = 1;
+            break;
+        case 1: /* Ch 6, DAC */
+            mute_ch = 5;
+            channel = 5;
+            break;
+        case 2: /* Ch 4 */
+            mute_ch = 3;
+            channel = 3;
+            break;
+        case 3: /* Ch 1 */
+            mute_ch = 0;
+            channel = 0;
+            break;
+        case 4: /* Ch 5 */
+            mute_ch = 4;
+            channel = 4;
+            break;
+        case 5: /* Ch 3 */
+        default:
+            mute_ch = 2;
+            channel = 2;
+            break;
+        }
+        LANES(l)
+        {
+            mute[l] = chip->mute[mute_ch + (channel == 5 ? chip->dacen[l] : 0)][l];
+        }
+        OPN2L_Clock(chip);
+        LANES(l)
+        {
+            Bit16s buffer[2];
+            if (!mute[l])
+            {
+                buffer[0] = chip->mol[l];
+                buffer[1] = chip->mor[l];
+                buffer[0] = buffer[0] * chip->pan_volume_l[channel][l] / 65535;
+                buffer[1] = buffer[1] * chip->pan_volume_r[channel][l] / 65535;
+                out_l[l] += buffer[0];
+                out_r[l] += buffer[1];
+            }
+        }
+
+        if (chip->writebuf_pending)
+        {
+            LANES(l)
+            {
+                opn2_writebuf *writebuf = chip->writebuf[l];
+                while (writebuf[chip->writebuf_cur[l]].time <= chip->writebuf_samplecnt[l])
+                {
+                    Bit32u cur = chip->writebuf_cur[l];
+                    if (!(writebuf[cur].port & 0x04))
+                    {
+                        break;
+                    }
+                    writebuf[cur].port &= 0x03;
+                    OPN2L_Write(chip, l, writebuf[cur].port, writebuf[cur].data);
+                    chip->writebuf_cur[l] = (cur + 1) % OPN_WRITEBUF_SIZE;
+                    chip->writebuf_pending--;
+                }
+            }
+        }
+        LANES(l)
+        {
+            chip->writebuf_samplecnt[l]++;
+        }
+    }
+
+    LANES(l)
+    {
+        buf[2 * l] = out_l[l];
+        buf[2 * l + 1] = out_r[l];
+    }
+}
+
+#define OPN2L_LANE_FIELDS(F, A, A2) \
+    F(mol) F(mor) \
+    F(write_data) F(write_a) F(write_d) F(write_a_en) F(write_d_en) \
+    F(write_busy) F(write_busy_cnt) F(write_fm_address) F(write_fm_data) \
+    F(write_fm_mode_a) F(address) F(data) F(pin_test_in) F(pin_irq) F(busy) \
+    F(lfo_en) F(lfo_freq) F(lfo_pm) F(lfo_am) F(lfo_cnt) F(lfo_inc) F(lfo_quotient) \
+    F(pg_fnum) F(pg_block) F(pg_kcode) A(pg_inc, 24) A(pg_phase, 24) A(pg_reset, 24) \
+    F(pg_read) \
+    F(eg_cycle) F(eg_cycle_stop) F(eg_shift) F(eg_shift_lock) F(eg_timer_low_lock) \
+    F(eg_timer) F(eg_timer_inc) F(eg_quotient) F(eg_custom_timer) F(eg_rate) \
+    F(eg_ksv) F(eg_inc) F(eg_ratemax) A(eg_sl, 2) F(eg_lfo_am) A(eg_tl, 2) \
+    A(eg_state, 24) A(eg_level, 24) A(eg_out, 24) A(eg_kon, 24) A(eg_kon_csm, 24) \
+    A(eg_kon_latch, 24) A(eg_csm_mode, 24) A(eg_ssg_enable, 24) \
+    A(eg_ssg_pgrst_latch, 24) A(eg_ssg_repeat_latch, 24) A(eg_ssg_hold_up_latch, 24) \
+    A(eg_ssg_dir, 24) A(eg_ssg_inv, 24) A(eg_read, 2) F(eg_read_inc) \
+    A2(fm_op1, 6, 2) A(fm_op2, 6) A(fm_out, 24) A(fm_mod, 24) \
+    A(ch_acc, 6) A(ch_out, 6) F(ch_lock) F(ch_lock_l) F(ch_lock_r) F(ch_read) \
+    F(timer_a_cnt) F(timer_a_reg) F(timer_a_load_lock) F(timer_a_load) \
+    F(timer_a_enable) F(timer_a_reset) F(timer_a_load_latch) \
+    F(timer_a_overflow_flag) F(timer_a_overflow) \
+    F(timer_b_cnt) F(timer_b_subcnt) F(timer_b_reg) F(timer_b_load_lock) \
+    F(timer_b_load) F(timer_b_enable) F(timer_b_reset) F(timer_b_load_latch) \
+    F(timer_b_overflow_flag) F(timer_b_overflow) \
+    A(mode_test_21, 8) A(mode_test_2c, 8) F(mode_ch3) F(mode_kon_channel) \
+    A(mode_kon_operator, 4) A(mode_kon, 24) F(mode_csm) F(mode_kon_csm) \
+    F(dacen) F(dacdata) \
+    A(ks, 24) A(ar, 24) A(sr, 24) A(dt, 24) A(multi, 24) A(sl, 24) A(rr, 24) \
+    A(dr, 24) A(am, 24) A(tl, 24) A(ssg_eg, 24) \
+    A(fnum, 6) A(block, 6) A(kcode, 6) A(fnum_3ch, 6) A(block_3ch, 6) \
+    A(kcode_3ch, 6) F(reg_a4) F(reg_ac) A(connect, 6) A(fb, 6) \
+    A(pan_l, 6) A(pan_r, 6) A(ams, 6) A(pms, 6) F(status) F(status_time) \
+    F(chip_type) A(mute, 7) F(rateratio) A(pan_volume_l, 6) A(pan_volume_r, 6) \
+    F(writebuf_samplecnt) F(writebuf_cur) F(writebuf_last) F(writebuf_lasttime)
+
+template <unsigned Lanes>
+void OPN2L_GetLane(const ym3438_lanes_t<Lanes> *chip, Bit32u lane, ym3438_t *out)
+{
+    Bit32u i, j;
+    memset(out, 0, sizeof(ym3438_t));
+    out->cycles = chip->cycles;
+    out->channel = chip->channel;
+#define F(f) out->f = chip->f[lane];
+#define A(f, n) for (i = 0; i < n; i++) out->f[i] = chip->f[i][lane];
+#define A2(f, n, m) for (i = 0; i < n; i++) for (j = 0; j < m; j++) out->f[i][j] = chip->f[i][j][lane];
+    OPN2L_LANE_FIELDS(F, A, A2)
+#undef F
+#undef A
+#undef A2
+    memcpy(out->writebuf, chip->writebuf[lane], sizeof(out->writebuf));
+}
+
+template <unsigned Lanes>
+void OPN2L_SetLane(ym3438_lanes_t<Lanes> *chip, Bit32u lane, const ym3438_t *in)
+{
+    Bit32u i, j;
+    chip->cycles = in->cycles;
+    chip->channel = in->channel;
+#define F(f) chip->f[lane] = in->f;
+#define A(f, n) for (i = 0; i < n; i++) chip->f[i][lane] = in->f[i];
+#define A2(f, n, m) for (i = 0; i < n; i++) for (j = 0; j < m; j++) chip->f[i][j][lane] = in->f[i][j];
+    OPN2L_LANE_FIELDS(F, A, A2)
+#undef F
+#undef A
+#undef A2
+    memcpy(chip->writebuf[lane], in->writebuf, sizeof(in->writebuf));
+    chip->writebuf_pending = OPN2L_CountPending(chip);
+}
+
+#define OPN2L_INSTANTIATE(L) \
+    template void OPN2L_Init<L>(ym3438_lanes_t<L> *); \
+    template void OPN2L_Reset<L>(ym3438_lanes_t<L> *, Bit32u, Bit32u, Bit32u); \
+    template void OPN2L_SetChipType<L>(ym3438_lanes_t<L> *, Bit32u, Bit32u); \
+    template void OPN2L_WritePan<L>(ym3438_lanes_t<L> *, Bit32u, Bit32u, Bit8u); \
+    template void OPN2L_WriteBuffered<L>(ym3438_lanes_t<L> *, Bit32u, Bit32u, Bit8u); \
+    template void OPN2L_Generate<L>(ym3438_lanes_t<L> *, Bit16s *); \
+    template void OPN2L_GetLane<L>(const ym3438_lanes_t<L> *, Bit32u, ym3438_t *); \
+    template void OPN2L_SetLane<L>(ym3438_lanes_t<L> *, Bit32u, const ym3438_t *);
+
+OPN2L_INSTANTIATE(1)
+OPN2L_INSTANTIATE(2)
+OPN2L_INSTANTIATE(4)
+OPN2L_INSTANTIATE(8)
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017-2018 Alexey Khokholov (Nuke.YKT)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ *
+ *  Nuked OPN2(Yamaha YM3438) emulator, lockstep variant.
+ *
+ *  Several chips are clocked together, every field of ym3438_t becomes
+ *  an array with one element per chip ("lane"), so that the same step
+ *  of all chips runs as one loop over the lanes. The cycle counter is
+ *  shared by all lanes, each lane produces the same output as ym3438.c
+ *  does for a single chip while its write buffer doesn't run full.
+ */
+
+#ifndef YM3438_LANES_H
+#define YM3438_LANES_H
+
+#include "ym3438.h"
+
+template <unsigned Lanes>
+struct ym3438_lanes_t
+{
+    /* Shared by all lanes */
+    Bit32u cycles;
+    Bit32u channel;
+    /* Count of buffered writes over all lanes */
+    Bit32u writebuf_pending;
+
+    Bit16s mol[Lanes], mor[Lanes];
+    /* IO */
+    Bit16u write_data[Lanes];
+    Bit8u write_a[Lanes];
+    Bit8u write_d[Lanes];
+    Bit8u write_a_en[Lanes];
+    Bit8u write_d_en[Lanes];
+    Bit8u write_busy[Lanes];
+    Bit8u write_busy_cnt[Lanes];
+    Bit8u write_fm_address[Lanes];
+    Bit8u write_fm_data[Lanes];
+    Bit16u write_fm_mode_a[Lanes];
+    Bit16u address[Lanes];
+    Bit8u data[Lanes];
+    Bit8u pin_test_in[Lanes];
+    Bit8u pin_irq[Lanes];
+    Bit8u busy[Lanes];
+    /* LFO */
+    Bit8u lfo_en[Lanes];
+    Bit8u lfo_freq[Lanes];
+    Bit8u lfo_pm[Lanes];
+    Bit8u lfo_am[Lanes];
+    Bit8u lfo_cnt[Lanes];
+    Bit8u lfo_inc[Lanes];
+    Bit8u lfo_quotient[Lanes];
+    /* Phase generator */
+    Bit16u pg_fnum[Lanes];
+    Bit8u pg_block[Lanes];
+    Bit8u pg_kcode[Lanes];
+    Bit32u pg_inc[24][Lanes];
+    Bit32u pg_phase[24][Lanes];
+    Bit8u pg_reset[24][Lanes];
+    Bit32u pg_read[Lanes];
+    /* Envelope generator */
+    Bit8u eg_cycle[Lanes];
+    Bit8u eg_cycle_stop[Lanes];
+    Bit8u eg_shift[Lanes];
+    Bit8u eg_shift_lock[Lanes];
+    Bit8u eg_timer_low_lock[Lanes];
+    Bit16u eg_timer[Lanes];
+    Bit8u eg_timer_inc[Lanes];
+    Bit16u eg_quotient[Lanes];
+    Bit8u eg_custom_timer[Lanes];
+    Bit8u eg_rate[Lanes];
+    Bit8u eg_ksv[Lanes];
+    Bit8u eg_inc[Lanes];
+    Bit8u eg_ratemax[Lanes];
+    Bit8u eg_sl[2][Lanes];
+    Bit8u eg_lfo_am[Lanes];
+    Bit8u eg_tl[2][Lanes];
+    Bit8u eg_state[24][Lanes];
+    Bit16u eg_level[24][Lanes];
+    Bit16u eg_out[24][Lanes];
+    Bit8u eg_kon[24][Lanes];
+    Bit8u eg_kon_csm[24][Lanes];
+    Bit8u eg_kon_latch[24][Lanes];
+    Bit8u eg_csm_mode[24][Lanes];
+    Bit8u eg_ssg_enable[24][Lanes];
+    Bit8u eg_ssg_pgrst_latch[24][Lanes];
+    Bit8u eg_ssg_repeat_latch[24][Lanes];
+    Bit8u eg_ssg_hold_up_latch[24][Lanes];
+    Bit8u eg_ssg_dir[24][Lanes];
+    Bit8u eg_ssg_inv[24][Lanes];
+    Bit32u eg_read[2][Lanes];
+    Bit8u eg_read_inc[Lanes];
+    /* FM */
+    Bit16s fm_op1[6][2][Lanes];
+    Bit16s fm_op2[6][Lanes];
+    Bit16s fm_out[24][Lanes];
+    Bit16u fm_mod[24][Lanes];
+    /* Channel */
+    Bit16s ch_acc[6][Lanes];
+    Bit16s ch_out[6][Lanes];
+    Bit16s ch_lock[Lanes];
+    Bit8u ch_lock_l[Lanes];
+    Bit8u ch_lock_r[Lanes];
+    Bit16s ch_read[Lanes];
+    /* Timer */
+    Bit16u timer_a_cnt[Lanes];
+    Bit16u timer_a_reg[Lanes];
+    Bit8u timer_a_load_lock[Lanes];
+    Bit8u timer_a_load[Lanes];
+    Bit8u timer_a_enable[Lanes];
+    Bit8u timer_a_reset[Lanes];
+    Bit8u timer_a_load_latch[Lanes];
+    Bit8u timer_a_overflow_flag[Lanes];
+    Bit8u timer_a_overflow[Lanes];
+
+    Bit16u timer_b_cnt[Lanes];
+    Bit8u timer_b_subcnt[Lanes];
+    Bit16u timer_b_reg[Lanes];
+    Bit8u timer_b_load_lock[Lanes];
+    Bit8u timer_b_load[Lanes];
+    Bit8u timer_b_enable[Lanes];
+    Bit8u timer_b_reset[Lanes];
+    Bit8u timer_b_load_latch[Lanes];
+    Bit8u timer_b_overflow_flag[Lanes];
+    Bit8u timer_b_overflow[Lanes];
+
+    /* Register set */
+    Bit8u mode_test_21[8][Lanes];
+    Bit8u mode_test_2c[8][Lanes];
+    Bit8u mode_ch3[Lanes];
+    Bit8u mode_kon_channel[Lanes];
+    Bit8u mode_kon_operator[4][Lanes];
+    Bit8u mode_kon[24][Lanes];
+    Bit8u mode_csm[Lanes];
+    Bit8u mode_kon_csm[Lanes];
+    Bit8u dacen[Lanes];
+    Bit16s dacdata[Lanes];
+
+    Bit8u ks[24][Lanes];
+    Bit8u ar[24][Lanes];
+    Bit8u sr[24][Lanes];
+    Bit8u dt[24][Lanes];
+    Bit8u multi[24][Lanes];
+    Bit8u sl[24][Lanes];
+    Bit8u rr[24][Lanes];
+    Bit8u dr[24][Lanes];
+    Bit8u am[24][Lanes];
+    Bit8u tl[24][Lanes];
+    Bit8u ssg_eg[24][Lanes];
+
+    Bit16u fnum[6][Lanes];
+    Bit8u block[6][Lanes];
+    Bit8u kcode[6][Lanes];
+    Bit16u fnum_3ch[6][Lanes];
+    Bit8u block_3ch[6][Lanes];
+    Bit8u kcode_3ch[6][Lanes];
+    Bit8u reg_a4[Lanes];
+    Bit8u reg_ac[Lanes];
+    Bit8u connect[6][Lanes];
+    Bit8u fb[6][Lanes];
+    Bit8u pan_l[6][Lanes], pan_r[6][Lanes];
+    Bit8u ams[6][Lanes];
+    Bit8u pms[6][Lanes];
+    Bit8u status[Lanes];
+    Bit32u status_time[Lanes];
+
+    /*EXTRA*/
+    Bit32u chip_type[Lanes];
+    Bit32u mute[7][Lanes];
+    Bit32s rateratio[Lanes];
+
+    Bit32u pan_volume_l[6][Lanes];
+    Bit32u pan_volume_r[6][Lanes];
+
+    /* Write buffers stay apart, a lane takes in its writes alone */
+    Bit64u writebuf_samplecnt[Lanes];
+    Bit32u writebuf_cur[Lanes];
+    Bit32u writebuf_last[Lanes];
+    Bit64u writebuf_lasttime[Lanes];
+    opn2_writebuf writebuf[Lanes][OPN_WRITEBUF_SIZE];
+};
+
+/* Clears all lanes, the cycle counter starts from zero */
+template <unsigned Lanes>
+void OPN2L_Init(ym3438_lanes_t<Lanes> *chip);
+/* Like OPN2_Reset() for one lane, the lane stays at the shared cycle */
+template <unsigned Lanes>
+void OPN2L_Reset(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u rate, Bit32u clock);
+template <unsigned Lanes>
+void OPN2L_SetChipType(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u type);
+template <unsigned Lanes>
+void OPN2L_WritePan(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u channel, Bit8u data);
+template <unsigned Lanes>
+void OPN2L_WriteBuffered(ym3438_lanes_t<Lanes> *chip, Bit32u lane, Bit32u port, Bit8u data);
+/* One output frame of every lane, buf holds the stereo pairs of lanes in a row */
+template <unsigned Lanes>
+void OPN2L_Generate(ym3438_lanes_t<Lanes> *chip, Bit16s *buf);
+/* Convert a lane from and into the state of the single chip emulator;
+ * a loaded lane brings its cycle counter to the whole group */
+template <unsigned Lanes>
+void OPN2L_GetLane(const ym3438_lanes_t<Lanes> *chip, Bit32u lane, ym3438_t *out);
+template <unsigned Lanes>
+void OPN2L_SetLane(ym3438_lanes_t<Lanes> *chip, Bit32u lane, const ym3438_t *in);
+
+#endif
@@ -0,0 +1,472 @@
+/*
+ * Interfaces over Yamaha OPN2 (YM2612) chip emulators
+ *
+ * Copyright (c) 2017-2020 Vitaly Novichkov (Wohlstand)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "nuked_lockstep_opn2.h"
+#include "nuked/ym3438_lanes.h"
+#include "../opnmidi_threads.hpp"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Lanes of one core shared by the chips, with the frames rendered ahead
+// for the chips which didn't take them yet.
+// A lane whose write buffer runs full can't keep the pace of the single chip
+// emulator, which clocks itself alone up to its oldest write. That lane leaves
+// the core for a single chip of its own and comes back once its cycle is the
+// one of the core again.
+class NukedLockstepGroup
+{
+public:
+    enum { max_lanes = 8 };
+    static NukedLockstepGroup *create(unsigned remaining);
+    virtual ~NukedLockstepGroup();
+
+    bool full() const { return m_members == (1u << m_lanes) - 1; }
+    unsigned join();
+    // Returns true when the last chip has left
+    bool leave(unsigned lane);
+
+    void setChipType(unsigned lane, uint32_t type);
+    void reset(unsigned lane, uint32_t rate, uint32_t clock);
+    void write(unsigned lane, uint32_t port, uint8_t data);
+    void writeRegs(unsigned lane, uint32_t port, const OPNRegPair *regs, size_t count);
+    void writePan(unsigned lane, uint32_t chan, uint8_t data);
+    void preroll();
+    void reserve(size_t frames);
+    void generate(unsigned lane, int16_t *output, size_t frames);
+    void saveLane(unsigned lane, ym3438_t *state);
+    void loadLane(unsigned lane, const ym3438_t *state);
+
+protected:
+    explicit NukedLockstepGroup(unsigned lanes);
+
+    virtual void coreSetChipType(unsigned lane, uint32_t type) = 0;
+    virtual void coreReset(unsigned lane, uint32_t rate, uint32_t clock) = 0;
+    virtual void coreWrite(unsigned lane, uint32_t port, uint8_t data) = 0;
+    virtual void coreWritePan(unsigned lane, uint32_t chan, uint8_t data) = 0;
+    virtual bool coreBufferFull(unsigned lane) const = 0;
+    virtual bool corePending() const = 0;
+    virtual uint32_t coreCycle() const = 0;
+    virtual void coreGenerate(int16_t *row) = 0;
+    virtual void coreGetLane(unsigned lane, ym3438_t *state) const = 0;
+    virtual void coreSetLane(unsigned lane, const ym3438_t *state) = 0;
+
+private:
+    unsigned m_lanes;
+    unsigned m_members;
+    // Lanes running on their own chips instead of the core
+    unsigned m_solo;
+    ym3438_t *m_soloChips[max_lanes];
+    OpnMutex m_lock;
+    // Rows of output frames of all lanes, the first row is the frame m_base
+    std::vector<int16_t> m_frames;
+    uint64_t m_base;
+    uint64_t m_rendered;
+    uint64_t m_consumed[max_lanes];
+
+    void leaveCore(unsigned lane);
+    void writeByte(unsigned lane, uint32_t port, uint8_t data);
+    bool pending() const;
+    void renderFrame(int16_t *row);
+    void render(size_t frames);
+    void dropFrames(unsigned lane);
+};
+
+template <unsigned L>
+class NukedLockstepGroupT final : public NukedLockstepGroup
+{
+    ym3438_lanes_t<L> *m_chip;
+public:
+    NukedLockstepGroupT()
+        : NukedLockstepGroup(L), m_chip(new ym3438_lanes_t<L>)
+    {
+        OPN2L_Init(m_chip);
+    }
+    ~NukedLockstepGroupT() override
+    {
+        delete m_chip;
+    }
+
+protected:
+    void coreSetChipType(unsigned lane, uint32_t type) override
+    {
+        OPN2L_SetChipType(m_chip, lane, type);
+    }
+    void coreReset(unsigned lane, uint32_t rate, uint32_t clock) override
+    {
+        OPN2L_Reset(m_chip, lane, rate, clock);
+    }
+    void coreWrite(unsigned lane, uint32_t port, uint8_t data) override
+    {
+        OPN2L_WriteBuffered(m_chip, lane, port, data);
+    }
+    void coreWritePan(unsigned lane, uint32_t chan, uint8_t data) override
+    {
+        OPN2L_WritePan(m_chip, lane, chan, data);
+    }
+    bool coreBufferFull(unsigned lane) const override
+    {
+        return (m_chip->writebuf[lane][m_chip->writebuf_last[lane]].port & 0x04) != 0;
+    }
+    bool corePending() const override
+    {
+        return m_chip->writebuf_pending > 0;
+    }
+    uint32_t coreCycle() const override
+    {
+        return m_chip->cycles;
+    }
+    void coreGenerate(int16_t *row) override
+    {
+        OPN2L_Generate(m_chip, row);
+    }
+    void coreGetLane(unsigned lane, ym3438_t *state) const override
+    {
+        OPN2L_GetLane(m_chip, lane, state);
+    }
+    void coreSetLane(unsigned lane, const ym3438_t *state) override
+    {
+        OPN2L_SetLane(m_chip, lane, state);
+    }
+};
+
+NukedLockstepGroup *NukedLockstepGroup::create(unsigned remaining)
+{
+    // The widest core the chips still to come fill up, no lane stays unused
+    if(remaining >= 8)
+        return new NukedLockstepGroupT<8>;
+    if(remaining >= 4)
+        return new NukedLockstepGroupT<4>;
+    if(remaining >= 2)
+        return new NukedLockstepGroupT<2>;
+    return new NukedLockstepGroupT<1>;
+}
+
+NukedLockstepGroup::NukedLockstepGroup(unsigned lanes)
+    : m_lanes(lanes), m_members(0), m_solo(0),
+      m_base(0), m_rendered(0)
+{
+    std::memset(m_consumed, 0, sizeof(m_consumed));
+    for(unsigned i = 0; i < max_lanes; ++i)
+        m_soloChips[i] = (i < m_lanes) ? new ym3438_t : NULL;
+}
+
+NukedLockstepGroup::~NukedLockstepGroup()
+{
+    for(unsigned i = 0; i < max_lanes; ++i)
+        delete m_soloChips[i];
+}
+
+unsigned NukedLockstepGroup::join()
+{
+    unsigned lane = 0;
+    while(m_members & (1u << lane))
+        ++lane;
+    m_members |= 1u << lane;
+    m_consumed[lane] = m_rendered;
+    return lane;
+}
+
+bool NukedLockstepGroup::leave(unsigned lane)
+{
+    OpnMutexLocker lock(m_lock);
+    m_members &= ~(1u << lane);
+    m_solo &= ~(1u << lane);
+    return m_members == 0;
+}
+
+void NukedLockstepGroup::setChipType(unsigned lane, uint32_t type)
+{
+    OpnMutexLocker lock(m_lock);
+    coreSetChipType(lane, type);
+    if(m_solo & (1u << lane))
+        OPN2_SetChipType(m_soloChips[lane], type);
+}
+
+void NukedLockstepGroup::reset(unsigned lane, uint32_t rate, uint32_t clock)
+{
+    OpnMutexLocker lock(m_lock);
+    // The reset lane starts over at the cycle of the core
+    m_solo &= ~(1u << lane);
+    coreReset(lane, rate, clock);
+    dropFrames(lane);
+}
+
+void NukedLockstepGroup::leaveCore(unsigned lane)
+{
+    coreGetLane(lane, m_soloChips[lane]);
+    m_solo |= 1u << lane;
+}
+
+void NukedLockstepGroup::writeByte(unsigned lane, uint32_t port, uint8_t data)
+{
+    if(!(m_solo & (1u << lane)) && coreBufferFull(lane))
+        leaveCore(lane);
+    if(m_solo & (1u << lane))
+        OPN2_WriteBuffered(m_soloChips[lane], port, data);
+    else
+        coreWrite(lane, port, data);
+}
+
+void NukedLockstepGroup::write(unsigned lane, uint32_t port, uint8_t data)
+{
+    OpnMutexLocker lock(m_lock);
+    writeByte(lane, port, data);
+}
+
+void NukedLockstepGroup::writeRegs(unsigned lane, uint32_t port, const OPNRegPair *regs, size_t count)
+{
+    OpnMutexLocker lock(m_lock);
+    for(size_t i = 0; i < count; ++i)
+    {
+        writeByte(lane, 0 + port * 2, (uint8_t)regs[i].addr);
+        writeByte(lane, 1 + port * 2, regs[i].data);
+    }
+}
+
+void NukedLockstepGroup::writePan(unsigned lane, uint32_t chan, uint8_t data)
+{
+    OpnMutexLocker lock(m_lock);
+    if(m_solo & (1u << lane))
+        OPN2_WritePan(m_soloChips[lane], chan, data);
+    else
+        coreWritePan(lane, chan, data);
+}
+
+bool NukedLockstepGroup::pending() const
+{
+    if(corePending())
+        return true;
+    for(unsigned i = 0; i < m_lanes; ++i)
+    {
+        const ym3438_t *solo = m_soloChips[i];
+        if((m_solo & (1u << i)) && (solo->writebuf[solo->writebuf_cur].port & 0x04))
+            return true;
+    }
+    return false;
+}
+
+void NukedLockstepGroup::preroll()
+{
+    OpnMutexLocker lock(m_lock);
+    // Frames still owed to some chip keep the group where it is
+    if(m_base != m_rendered)
+        return;
+    int16_t row[2 * max_lanes];
+    while(pending())
+        renderFrame(row);
+}
+
+void NukedLockstepGroup::reserve(size_t frames)
+{
+    OpnMutexLocker lock(m_lock);
+    // Kept through the block sizes used before, the chips of the group
+    // may have asked for them with other output rates
+    if(m_frames.capacity() < frames * 2 * m_lanes)
+        m_frames.reserve(frames * 2 * m_lanes);
+}
+
+void NukedLockstepGroup::renderFrame(int16_t *row)
+{
+    coreGenerate(row);
+    if(m_solo == 0)
+        return;
+    for(unsigned i = 0; i < m_lanes; ++i)
+    {
+        if(!(m_solo & (1u << i)))
+            continue;
+        ym3438_t *solo = m_soloChips[i];
+        OPN2_Generate(solo, row + 2 * i);
+        // Back in step with the core, or the core has nobody else to keep
+        // step with and takes up the cycle of the lane. The cycle is read
+        // again for every lane, a lane which came back may have moved it.
+        if(solo->cycles == coreCycle() || (m_members & ~m_solo) == 0)
+        {
+            coreSetLane(i, solo);
+            m_solo &= ~(1u << i);
+        }
+    }
+}
+
+void NukedLockstepGroup::render(size_t frames)
+{
+    const size_t row = 2 * m_lanes;
+    size_t at = m_frames.size();
+    m_frames.resize(at + frames * row);
+    for(size_t i = 0; i < frames; ++i, at += row)
+        renderFrame(&m_frames[at]);
+    m_rendered += frames;
+}
+
+void NukedLockstepGroup::dropFrames(unsigned lane)
+{
+    m_consumed[lane] = m_rendered;
+    for(unsigned i = 0; i < m_lanes; ++i)
+    {
+        if((m_members & (1u << i)) && m_consumed[i] != m_rendered)
+            return;
+    }
+    // Every chip has taken its frames
+    m_frames.clear();
+    m_base = m_rendered;
+}
+
+void NukedLockstepGroup::generate(unsigned lane, int16_t *output, size_t frames)
+{
+    OpnMutexLocker lock(m_lock);
+    const uint64_t end = m_consumed[lane] + frames;
+    if(end > m_rendered)
+        render(static_cast<size_t>(end - m_rendered));
+
+    const size_t row = 2 * m_lanes;
+    const int16_t *in = &m_frames[static_cast<size_t>(m_consumed[lane] - m_base) * row + 2 * lane];
+    for(size_t i = 0; i < frames; ++i, in += row)
+    {
+        output[2 * i] = in[0];
+        output[2 * i + 1] = in[1];
+    }
+    m_consumed[lane] = end;
+    if(end == m_rendered)
+        dropFrames(lane);
+}
+
+void NukedLockstepGroup::saveLane(unsigned lane, ym3438_t *state)
+{
+    OpnMutexLocker lock(m_lock);
+    if(m_solo & (1u << lane))
+        std::memcpy(state, m_soloChips[lane], sizeof(ym3438_t));
+    else
+        coreGetLane(lane, state);
+}
+
+void NukedLockstepGroup::loadLane(unsigned lane, const ym3438_t *state)
+{
+    OpnMutexLocker lock(m_lock);
+    // A state of another cycle runs on its own until the core meets it
+    if(state->cycles == coreCycle())
+    {
+        coreSetLane(lane, state);
+        m_solo &= ~(1u << lane);
+    }
+    else
+    {
+        std::memcpy(m_soloChips[lane], state, sizeof(ym3438_t));
+        m_solo |= 1u << lane;
+    }
+    dropFrames(lane);
+}
+
+NukedLockstepOPN2::NukedLockstepOPN2(OPNFamily f, NukedLockstepOPN2 *previous, size_t remaining)
+    : OPNChipBaseT(f), m_group(NULL), m_lane(0)
+{
+    if(previous && !previous->m_group->full())
+        m_group = previous->m_group;
+    else
+        m_group = NukedLockstepGroup::create(static_cast<unsigned>(remaining));
+    m_lane = m_group->join();
+    m_group->setChipType(m_lane, ym3438_mode_readmode);
+    setRate(m_rate, m_clock);
+}
+
+NukedLockstepOPN2::~NukedLockstepOPN2()
+{
+    if(m_group->leave(m_lane))
+        delete m_group;
+}
+
+void NukedLockstepOPN2::setRate(uint32_t rate, uint32_t clock)
+{
+    OPNChipBaseT::setRate(rate, clock);
+    m_group->reset(m_lane, rate, clock);
+}
+
+void NukedLockstepOPN2::reset()
+{
+    OPNChipBaseT::reset();
+    m_group->reset(m_lane, m_rate, m_clock);
+}
+
+void NukedLockstepOPN2::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+{
+    m_group->write(m_lane, 0 + (port) * 2, (uint8_t)addr);
+    m_group->write(m_lane, 1 + (port) * 2, data);
+}
+
+void NukedLockstepOPN2::writeRegs(uint32_t port, const OPNRegPair *regs, size_t count)
+{
+    m_group->writeRegs(m_lane, port, regs, count);
+}
+
+void NukedLockstepOPN2::writePan(uint16_t chan, uint8_t data)
+{
+    m_group->writePan(m_lane, chan, data);
+}
+
+void NukedLockstepOPN2::preroll()
+{
+    m_group->preroll();
+}
+
+void NukedLockstepOPN2::reserveBlock(size_t frames)
+{
+    // Native frames of the block, with room for the look-ahead of the
+    // resampler and the rounding of the pulls
+    enum { lookAhead = 1024 };
+    const double ratio = static_cast<double>(nativeRate()) / static_cast<double>(m_rate);
+    const size_t natives = static_cast<size_t>(std::ceil(static_cast<double>(frames + 1) * ratio));
+    m_group->reserve(natives + lookAhead);
+}
+
+void NukedLockstepOPN2::nativeGenerate(int16_t *frame)
+{
+    m_group->generate(m_lane, frame, 1);
+}
+
+void NukedLockstepOPN2::nativeGenerateBlock(int16_t *output, size_t frames)
+{
+    m_group->generate(m_lane, output, frames);
+}
+
+size_t NukedLockstepOPN2::nativeStateSize() const
+{
+    // Same as of the single chip emulator
+    return sizeof(ym3438_t);
+}
+
+void NukedLockstepOPN2::nativeSaveState(void *state) const
+{
+    ym3438_t *lane = new ym3438_t;
+    m_group->saveLane(m_lane, lane);
+    std::memcpy(state, lane, sizeof(ym3438_t));
+    delete lane;
+}
+
+void NukedLockstepOPN2::nativeLoadState(const void *state)
+{
+    ym3438_t *lane = new ym3438_t;
+    std::memcpy(lane, state, sizeof(ym3438_t));
+    m_group->loadLane(m_lane, lane);
+    delete lane;
+}
+
+const char *NukedLockstepOPN2::emulatorName()
+{
+    return "Nuked OPN2 (lockstep)";
+}
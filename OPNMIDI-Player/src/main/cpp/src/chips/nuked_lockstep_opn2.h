@@ -0,0 +1,68 @@
+/*
+ * Interfaces over Yamaha OPN2 (YM2612) chip emulators
+ *
+ * Copyright (c) 2017-2020 Vitaly Novichkov (Wohlstand)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef NUKED_LOCKSTEP_OPN2_H
+#define NUKED_LOCKSTEP_OPN2_H
+
+#include "opn_chip_base.h"
+
+class NukedLockstepGroup;
+
+// Nuked OPN2 clocking up to 8 chips together, one per lane of a shared core.
+// The first chip to ask for frames renders them for the whole group, the others
+// take theirs from the group buffer, so all chips of a group must be generated
+// by the same count of frames between register writes, as OPN2 does.
+// Groups are 1, 2, 4 or 8 lanes wide and have no lane left unused.
+class NukedLockstepOPN2 final : public OPNChipBaseT<NukedLockstepOPN2>
+{
+    NukedLockstepGroup *m_group;
+    unsigned m_lane;
+public:
+    // Joins the group of the previous chip while it has a free lane, otherwise
+    // starts the widest group the chips which are still to come fill up
+    NukedLockstepOPN2(OPNFamily f, NukedLockstepOPN2 *previous, size_t remaining);
+    ~NukedLockstepOPN2() override;
+
+    bool canRunAtPcmRate() const override { return false; }
+    void setRate(uint32_t rate, uint32_t clock) override;
+    void reset() override;
+    void writeReg(uint32_t port, uint16_t addr, uint8_t data) override;
+    void writeRegs(uint32_t port, const OPNRegPair *regs, size_t count) override;
+    void writePan(uint16_t chan, uint8_t data) override;
+    // Pre-rolls the whole group, so all chips must be written before the first call
+    void preroll() override;
+    // The group keeps the frames of the whole block for its slowest chip
+    void reserveBlock(size_t frames) override;
+    void nativePreGenerate() override {}
+    void nativePostGenerate() override {}
+    void nativeGenerate(int16_t *frame) override;
+    void nativeGenerateBlock(int16_t *output, size_t frames);
+    size_t nativeStateSize() const;
+    void nativeSaveState(void *state) const;
+    void nativeLoadState(const void *state);
+    const char *emulatorName() override;
+    // amplitude scale factors to use in resampling
+    enum { resamplerPreAmplify = 11, resamplerPostAttenuate = 2 };
+    // the lanes are clocked with the group anyway, and every chip
+    // must take its frames to keep the group going
+    enum { idleSkipping = 0 };
+};
+
+#endif // NUKED_LOCKSTEP_OPN2_H
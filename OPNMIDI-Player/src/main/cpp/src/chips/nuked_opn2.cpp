@@ -25,8 +25,10 @@
 NukedOPN2::NukedOPN2(OPNFamily f)
     : OPNChipBaseT(f)
 {
-    OPN2_SetChipType(ym3438_mode_readmode);
-    chip = new ym3438_t;
+    ym3438_t *chip_r = new ym3438_t;
+    std::memset(chip_r, 0, sizeof(ym3438_t));
+    OPN2_SetChipType(chip_r, ym3438_mode_readmode);
+    chip = chip_r;
     setRate(m_rate, m_clock);
 }
 
@@ -58,18 +60,52 @@ void NukedOPN2::writeReg(uint32_t port, uint16_t addr, uint8_t data)
     //qDebug() << QString("%1: 0x%2 => 0x%3").arg(port).arg(addr, 2, 16, QChar('0')).arg(data, 2, 16, QChar('0'));
 }
 
+void NukedOPN2::writeRegs(uint32_t port, const OPNRegPair *regs, size_t count)
+{
+    ym3438_t *chip_r = reinterpret_cast<ym3438_t*>(chip);
+    for(size_t i = 0; i < count; ++i)
+    {
+        OPN2_WriteBuffered(chip_r, 0 + (port) * 2, (uint8_t)regs[i].addr);
+        OPN2_WriteBuffered(chip_r, 1 + (port) * 2, regs[i].data);
+    }
+}
+
 void NukedOPN2::writePan(uint16_t chan, uint8_t data)
 {
     ym3438_t *chip_r = reinterpret_cast<ym3438_t*>(chip);
     OPN2_WritePan(chip_r, (Bit32u)chan, data);
 }
 
+void NukedOPN2::preroll()
+{
+    ym3438_t *chip_r = reinterpret_cast<ym3438_t*>(chip);
+    int16_t frame[2];
+    // The write buffer passes a write per 15 cycles, as the real chip takes them
+    while(chip_r->writebuf[chip_r->writebuf_cur].port & 0x04)
+        OPN2_Generate(chip_r, frame);
+}
+
 void NukedOPN2::nativeGenerate(int16_t *frame)
 {
     ym3438_t *chip_r = reinterpret_cast<ym3438_t*>(chip);
     OPN2_Generate(chip_r, frame);
 }
 
+size_t NukedOPN2::nativeStateSize() const
+{
+    return sizeof(ym3438_t);
+}
+
+void NukedOPN2::nativeSaveState(void *state) const
+{
+    std::memcpy(state, chip, sizeof(ym3438_t));
+}
+
+void NukedOPN2::nativeLoadState(const void *state)
+{
+    std::memcpy(chip, state, sizeof(ym3438_t));
+}
+
 const char *NukedOPN2::emulatorName()
 {
     return "Nuked OPN2";
@@ -34,10 +34,15 @@ public:
     void setRate(uint32_t rate, uint32_t clock) override;
     void reset() override;
     void writeReg(uint32_t port, uint16_t addr, uint8_t data) override;
+    void writeRegs(uint32_t port, const OPNRegPair *regs, size_t count) override;
     void writePan(uint16_t chan, uint8_t data) override;
+    void preroll() override;
     void nativePreGenerate() override {}
     void nativePostGenerate() override {}
     void nativeGenerate(int16_t *frame) override;
+    size_t nativeStateSize() const;
+    void nativeSaveState(void *state) const;
+    void nativeLoadState(const void *state);
     const char *emulatorName() override;
     // amplitude scale factors to use in resampling
     enum { resamplerPreAmplify = 11, resamplerPostAttenuate = 2 };
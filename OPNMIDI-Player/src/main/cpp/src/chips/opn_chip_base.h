@@ -30,14 +30,22 @@
 #define override
 #endif
 
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-class VResampler;
-#endif
+class OPNChipResampler;
+
+// Float outputs reach 1.0 at the 16-bit full scale
+#define OPN_CHIP_FLOAT_SCALE (1.0f / 32767.0f)
 
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
 extern void opn2_audioTickHandler(void *instance, uint32_t chipId, uint32_t rate);
 #endif
 
+// Register address and value of one write in a batch
+struct OPNRegPair
+{
+    uint16_t addr;
+    uint8_t data;
+};
+
 class OPNChipBase
 {
 protected:
@@ -45,6 +53,21 @@ protected:
     uint32_t m_rate;
     uint32_t m_clock;
     OPNFamily m_family;
+    // Sources which keep sounding without register writes, the low 8 bits
+    // are key-ons of channels addressed by the 0x28 register
+    uint32_t m_activeMask;
+    // Count of trailing silent output frames while nothing is active
+    uint32_t m_silentFrames;
+    // The chip is known to be silent and doesn't get clocked
+    bool m_idle;
+    // The chip may go idle, off by default since frozen counters change the output
+    bool m_idleSkipping;
+    enum
+    {
+        active_dac = 1 << 8,
+        active_ssg = 1 << 9, // Three bits for every SSG channel
+        active_adpcm = 1 << 12
+    };
 public:
     explicit OPNChipBase(OPNFamily f);
     virtual ~OPNChipBase();
@@ -59,6 +82,8 @@ public:
     virtual bool canRunAtPcmRate() const = 0;
     virtual bool isRunningAtPcmRate() const = 0;
     virtual bool setRunningAtPcmRate(bool r) = 0;
+    // 0 for the linear interpolation, otherwise the tier of OPNChipResampler
+    virtual void setResamplerQuality(int quality) = 0;
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
     virtual void setAudioTickHandlerInstance(void *instance) = 0;
 #endif
@@ -69,9 +94,30 @@ public:
     virtual void reset() = 0;
     virtual void writeReg(uint32_t port, uint16_t addr, uint8_t data) = 0;
 
+    // Writes registers of one port in the given order, like writeReg() for
+    // each of them, with a single call into the emulator
+    virtual void writeRegs(uint32_t port, const OPNRegPair *regs, size_t count) = 0;
+
     // extended
     virtual void writePan(uint16_t addr, uint8_t data) { (void)addr; (void)data; }
 
+    // Brings the register writes made so far into effect before the next
+    // output frame; a fresh chip starts sounding at once instead of after
+    // its write latency. The frames clocked meanwhile are thrown away.
+    virtual void preroll() {}
+    // Makes room for the largest count of output frames generated at once,
+    // for the chips which keep frames rendered ahead of their output
+    virtual void reserveBlock(size_t /*frames*/) {}
+
+    // Tracks the silence from register writes, called before every writeReg();
+    // any write but a key-off brings an idle chip back to work
+    void trackWrite(uint32_t port, uint16_t addr, uint8_t data);
+    bool isIdle() const { return m_idle; }
+    // Lets the silent chip stop clocking; while it sleeps, the envelope, LFO
+    // and timer counters stand still, so the output is no longer identical
+    // to the continuously clocked chip
+    void setIdleSkipping(bool enabled);
+
     virtual void nativePreGenerate() = 0;
     virtual void nativePostGenerate() = 0;
     virtual void nativeGenerate(int16_t *frame) = 0;
@@ -80,8 +126,24 @@ public:
     virtual void generateAndMix(int16_t *output, size_t frames) = 0;
     virtual void generate32(int32_t *output, size_t frames) = 0;
     virtual void generateAndMix32(int32_t *output, size_t frames) = 0;
+    virtual void generateF32(float *output, size_t frames) = 0;
+    virtual void generateAndMixF32(float *output, size_t frames) = 0;
+
+    // Native rate output without resampling, used to resample many chips at once;
+    // the frames must be scaled by nativeGain() to match the resampled output
+    virtual void generateNativeAndMix32(int32_t *output, size_t frames) = 0;
+    virtual float nativeGain() const = 0;
 
     virtual const char* emulatorName() = 0;
+
+    // Snapshot of the whole chip state, valid for another chip of the same
+    // emulator and setup; the size of 0 means the emulator can't save it
+    virtual size_t stateSize() const = 0;
+    virtual void saveState(void *state) const = 0;
+    // Whether loadState() takes the state, checked without touching the chip
+    virtual bool checkState(const void *state) const = 0;
+    // Returns false when the state was saved with another rate or setup
+    virtual bool loadState(const void *state) = 0;
 private:
     OPNChipBase(const OPNChipBase &c);
     OPNChipBase &operator=(const OPNChipBase &c);
@@ -101,6 +163,7 @@ public:
 
     bool isRunningAtPcmRate() const override;
     bool setRunningAtPcmRate(bool r) override;
+    void setResamplerQuality(int quality) override;
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
     void setAudioTickHandlerInstance(void *instance);
 #endif
@@ -109,10 +172,30 @@ public:
     uint32_t effectiveRate() const override;
     uint32_t nativeRate() const override;
     virtual void reset() override;
+    void writeRegs(uint32_t port, const OPNRegPair *regs, size_t count) override;
     void generate(int16_t *output, size_t frames) override;
     void generateAndMix(int16_t *output, size_t frames) override;
     void generate32(int32_t *output, size_t frames) override;
     void generateAndMix32(int32_t *output, size_t frames) override;
+    void generateF32(float *output, size_t frames) override;
+    void generateAndMixF32(float *output, size_t frames) override;
+    void generateNativeAndMix32(int32_t *output, size_t frames) override;
+    float nativeGain() const override;
+    size_t stateSize() const override;
+    void saveState(void *state) const override;
+    bool checkState(const void *state) const override;
+    bool loadState(const void *state) override;
+
+    // Produce a run of native frames, the backends may provide a faster version
+    void nativeGenerateBlock(int16_t *output, size_t frames);
+    // State of the emulator itself, the backends which can save it provide these
+    size_t nativeStateSize() const { return 0; }
+    void nativeSaveState(void *state) const { (void)state; }
+    void nativeLoadState(const void *state) { (void)state; }
+protected:
+    // One output frame at a time, the reference of the block path
+    void resampledGenerate(int32_t *output);
+    void resampledGenerateBlock(int32_t *output, size_t frames);
 private:
     bool m_runningAtPcmRate;
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
@@ -121,41 +204,111 @@ private:
     void nativeTick(int16_t *frame);
     void setupResampler(uint32_t rate);
     void resetResampler();
-    void resampledGenerate(int32_t *output);
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-    VResampler *m_resampler;
-#else
+    // Become idle when all keys are off and the output stays silent for a while
+    template <class Sample>
+    void trackSilence(const Sample *output, size_t frames, uint32_t rate);
+    void clearIdle();
+    // Resampling and idle state, leading the state of the emulator
+    struct BaseState
+    {
+        uint32_t rate;
+        uint32_t clock;
+        int32_t resamplerQuality;
+        uint32_t runningAtPcmRate;
+        uint32_t activeMask;
+        uint32_t silentFrames;
+        uint32_t idle;
+        int32_t oldsamples[2];
+        int32_t samples[2];
+        int32_t samplecnt;
+    };
+    // Maximum count of frames processed in one block
+    enum { rsm_block = 256 };
+    int m_resamplerQuality;
+    OPNChipResampler *m_resampler;
     int32_t m_oldsamples[2];
     int32_t m_samples[2];
     int32_t m_samplecnt;
     int32_t m_rateratio;
+    // Reciprocal of the rate ratio, exact division of values under 2^31
+    uint64_t m_ratemagic;
+    uint32_t m_rateshift;
     enum { rsm_frac = 10 };
-#endif
+    int32_t divideByRateRatio(int32_t value) const;
     // amplitude scale factors in and out of resampler, varying for chips;
     // values are OK to "redefine", the static polymorphism will accept it.
     enum { resamplerPreAmplify = 1, resamplerPostAttenuate = 1 };
+    // whether the chip may stop clocking while silent
+    enum { idleSkipping = 1 };
 };
 
 // A base class which provides frame-by-frame interfaces on emulations which
 // don't have a routine for it. It produces outputs in fixed size buffers.
-// Fast register updates will suffer some latency because of buffering.
+// Register writes are queued with the frame they arrive at and applied right
+// at that frame, one buffer behind, so the buffered output keeps the exact
+// timing of writes at the cost of a constant latency of the buffer size.
+// A full queue renders the next buffer ahead up to its oldest write.
 template <class T, unsigned Buffer = 256>
 class OPNChipBaseBufferedT : public OPNChipBaseT<T>
 {
 public:
     explicit OPNChipBaseBufferedT(OPNFamily f)
-        : OPNChipBaseT<T>(f), m_bufferIndex(0) {}
+        : OPNChipBaseT<T>(f), m_bufferIndex(0), m_nextDone(0),
+          m_time(0), m_queueHead(0), m_queueTail(0) {}
     virtual ~OPNChipBaseBufferedT()
         {}
     enum { buffer_size = Buffer };
 public:
+    void setRate(uint32_t rate, uint32_t clock) override;
     void reset() override;
+    void writeReg(uint32_t port, uint16_t addr, uint8_t data) override;
+    void writeRegs(uint32_t port, const OPNRegPair *regs, size_t count) override;
+    void writePan(uint16_t chan, uint8_t data) override;
+    void preroll() override;
     void nativeGenerate(int16_t *frame) override;
+    void nativeGenerateBlock(int16_t *output, size_t frames);
+    size_t stateSize() const override;
+    void saveState(void *state) const override;
+    bool checkState(const void *state) const override;
+    bool loadState(const void *state) override;
 protected:
     virtual void nativeGenerateN(int16_t *output, size_t frames) = 0;
+    // whether writes wait for their frame, otherwise they reach the chip at once;
+    // the value is OK to "redefine", like the resampler scale factors
+    enum { writeQueueing = 1 };
 private:
     unsigned m_bufferIndex;
     int16_t m_buffer[2 * Buffer];
+    // Frames of the buffer after the current one, rendered ahead when the queue was full
+    unsigned m_nextDone;
+    int16_t m_next[2 * Buffer];
+
+    struct QueuedWrite
+    {
+        uint32_t time;
+        uint16_t addr;
+        uint8_t port;
+        uint8_t data;
+    };
+    enum { queue_size = 1024, pan_port = 0xFF };
+    // Count of frames given out, the clock of queued writes
+    uint32_t m_time;
+    uint32_t m_queueHead;
+    uint32_t m_queueTail;
+    QueuedWrite m_queue[queue_size];
+
+    // Leads the output buffer and pending writes, which follow the state of OPNChipBaseT
+    struct BufferedState
+    {
+        uint32_t bufferIndex;
+        uint32_t nextDone;
+        uint32_t time;
+        uint32_t queueCount;
+    };
+
+    void renderBuffer();
+    void applyWrite(const QueuedWrite &w);
+    void flushWrites();
 };
 
 #include "opn_chip_base.tcc"
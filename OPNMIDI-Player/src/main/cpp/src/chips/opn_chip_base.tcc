@@ -1,10 +1,8 @@
 #include "opn_chip_base.h"
+#include "opn_chip_resampler.h"
 #include <cmath>
 #include <cstdio>
-
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-#include <zita-resampler/vresampler.h>
-#endif
+#include <cstring>
 
 #if !defined(LIKELY) && defined(__GNUC__)
 #define LIKELY(x) __builtin_expect((x), 1)
@@ -23,7 +21,11 @@ inline OPNChipBase::OPNChipBase(OPNFamily f) :
     m_id(0),
     m_rate(44100),
     m_clock(7670454),
-    m_family(f)
+    m_family(f),
+    m_activeMask(0),
+    m_silentFrames(0),
+    m_idle(false),
+    m_idleSkipping(false)
 {
 }
 
@@ -36,29 +38,64 @@ inline uint32_t OPNChipBase::clockRate() const
     return m_clock;
 }
 
+inline void OPNChipBase::trackWrite(uint32_t port, uint16_t addr, uint8_t data)
+{
+    if(port == 0 && addr == 0x28)
+    {
+        uint32_t key = 1u << (data & 0x07);
+        if((data & 0xF0) == 0)
+        {
+            m_activeMask &= ~key;
+            return;
+        }
+        m_activeMask |= key;
+    }
+    else if(m_family == OPNChip_OPN2)
+    {
+        if(port == 0 && addr == 0x2B)
+            m_activeMask = (data & 0x80) ? (m_activeMask | active_dac) : (m_activeMask & ~active_dac);
+    }
+    else if(m_family == OPNChip_OPNA)
+    {
+        if(port == 0 && addr >= 0x08 && addr <= 0x0A)
+        {
+            // SSG envelopes may raise the level from zero by themselves
+            uint32_t ssg = active_ssg << (addr - 0x08);
+            m_activeMask = (data & 0x1F) ? (m_activeMask | ssg) : (m_activeMask & ~ssg);
+        }
+        else if(port == 1 && addr == 0x00)
+            m_activeMask = (data & 0x80) ? (m_activeMask | active_adpcm) : (m_activeMask & ~active_adpcm);
+    }
+    m_silentFrames = 0;
+    m_idle = false;
+}
+
+inline void OPNChipBase::setIdleSkipping(bool enabled)
+{
+    m_idleSkipping = enabled;
+    m_silentFrames = 0;
+    m_idle = false;
+}
+
 /* OPNChipBaseT */
 
 template <class T>
 OPNChipBaseT<T>::OPNChipBaseT(OPNFamily f)
     : OPNChipBase(f),
-      m_runningAtPcmRate(false)
+      m_runningAtPcmRate(false),
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
-    ,
-      m_audioTickHandlerInstance(NULL)
+      m_audioTickHandlerInstance(NULL),
 #endif
+      m_resamplerQuality(0),
+      m_resampler(NULL)
 {
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-    m_resampler = new VResampler;
-#endif
     setupResampler(m_rate);
 }
 
 template <class T>
 OPNChipBaseT<T>::~OPNChipBaseT()
 {
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
     delete m_resampler;
-#endif
 }
 
 template <class T>
@@ -92,6 +129,22 @@ bool OPNChipBaseT<T>::setRunningAtPcmRate(bool r)
     return true;
 }
 
+template <class T>
+void OPNChipBaseT<T>::setResamplerQuality(int quality)
+{
+    if(quality == m_resamplerQuality)
+        return;
+    m_resamplerQuality = quality;
+    if(quality <= 0)
+    {
+        delete m_resampler;
+        m_resampler = NULL;
+    }
+    else if(!m_resampler)
+        m_resampler = new OPNChipResampler;
+    setupResampler(m_rate);
+}
+
 #if defined(OPNMIDI_AUDIO_TICK_HANDLER)
 template <class T>
 void OPNChipBaseT<T>::setAudioTickHandlerInstance(void *instance)
@@ -129,23 +182,42 @@ template <class T>
 void OPNChipBaseT<T>::reset()
 {
     resetResampler();
+    clearIdle();
+}
+
+template <class T>
+void OPNChipBaseT<T>::writeRegs(uint32_t port, const OPNRegPair *regs, size_t count)
+{
+    // Calls through the final class don't need the virtual dispatch
+    T *chip = static_cast<T *>(this);
+    for(size_t i = 0; i < count; ++i)
+        chip->writeReg(port, regs[i].addr, regs[i].data);
 }
 
 template <class T>
 void OPNChipBaseT<T>::generate(int16_t *output, size_t frames)
 {
+    if(m_idle)
+    {
+        std::memset(output, 0, 2 * frames * sizeof(int16_t));
+        return;
+    }
     static_cast<T *>(this)->nativePreGenerate();
-    for(size_t i = 0; i < frames; ++i)
+    int32_t block[2 * rsm_block];
+    while(frames > 0)
     {
-        int32_t frame[2];
-        static_cast<T *>(this)->resampledGenerate(frame);
-        for (unsigned c = 0; c < 2; ++c) {
-            int32_t temp = frame[c];
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        resampledGenerateBlock(block, count);
+        trackSilence(block, count, m_rate);
+        for(size_t i = 0; i < 2 * count; ++i)
+        {
+            int32_t temp = block[i];
             temp = (temp > -32768) ? temp : -32768;
             temp = (temp < 32767) ? temp : 32767;
-            output[c] = (int16_t)temp;
+            output[i] = (int16_t)temp;
         }
-        output += 2;
+        output += 2 * count;
+        frames -= count;
     }
     static_cast<T *>(this)->nativePostGenerate();
 }
@@ -153,18 +225,24 @@ void OPNChipBaseT<T>::generate(int16_t *output, size_t frames)
 template <class T>
 void OPNChipBaseT<T>::generateAndMix(int16_t *output, size_t frames)
 {
+    if(m_idle)
+        return;
     static_cast<T *>(this)->nativePreGenerate();
-    for(size_t i = 0; i < frames; ++i)
+    int32_t block[2 * rsm_block];
+    while(frames > 0)
     {
-        int32_t frame[2];
-        static_cast<T *>(this)->resampledGenerate(frame);
-        for (unsigned c = 0; c < 2; ++c) {
-            int32_t temp = (int32_t)output[c] + frame[c];
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        resampledGenerateBlock(block, count);
+        trackSilence(block, count, m_rate);
+        for(size_t i = 0; i < 2 * count; ++i)
+        {
+            int32_t temp = (int32_t)output[i] + block[i];
             temp = (temp > -32768) ? temp : -32768;
             temp = (temp < 32767) ? temp : 32767;
-            output[c] = (int16_t)temp;
+            output[i] = (int16_t)temp;
         }
-        output += 2;
+        output += 2 * count;
+        frames -= count;
     }
     static_cast<T *>(this)->nativePostGenerate();
 }
@@ -172,30 +250,187 @@ void OPNChipBaseT<T>::generateAndMix(int16_t *output, size_t frames)
 template <class T>
 void OPNChipBaseT<T>::generate32(int32_t *output, size_t frames)
 {
-    static_cast<T *>(this)->nativePreGenerate();
-    for(size_t i = 0; i < frames; ++i)
+    if(m_idle)
     {
-        static_cast<T *>(this)->resampledGenerate(output);
-        output += 2;
+        std::memset(output, 0, 2 * frames * sizeof(int32_t));
+        return;
     }
+    static_cast<T *>(this)->nativePreGenerate();
+    resampledGenerateBlock(output, frames);
+    trackSilence(output, frames, m_rate);
     static_cast<T *>(this)->nativePostGenerate();
 }
 
 template <class T>
 void OPNChipBaseT<T>::generateAndMix32(int32_t *output, size_t frames)
 {
+    if(m_idle)
+        return;
     static_cast<T *>(this)->nativePreGenerate();
-    for(size_t i = 0; i < frames; ++i)
+    int32_t block[2 * rsm_block];
+    while(frames > 0)
+    {
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        resampledGenerateBlock(block, count);
+        trackSilence(block, count, m_rate);
+        for(size_t i = 0; i < 2 * count; ++i)
+            output[i] += block[i];
+        output += 2 * count;
+        frames -= count;
+    }
+    static_cast<T *>(this)->nativePostGenerate();
+}
+
+template <class T>
+void OPNChipBaseT<T>::generateF32(float *output, size_t frames)
+{
+    if(m_idle)
     {
-        int32_t frame[2];
-        static_cast<T *>(this)->resampledGenerate(frame);
-        output[0] += frame[0];
-        output[1] += frame[1];
-        output += 2;
+        std::memset(output, 0, 2 * frames * sizeof(float));
+        return;
+    }
+    static_cast<T *>(this)->nativePreGenerate();
+    int32_t block[2 * rsm_block];
+    while(frames > 0)
+    {
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        resampledGenerateBlock(block, count);
+        trackSilence(block, count, m_rate);
+        for(size_t i = 0; i < 2 * count; ++i)
+            output[i] = (float)block[i] * OPN_CHIP_FLOAT_SCALE;
+        output += 2 * count;
+        frames -= count;
+    }
+    static_cast<T *>(this)->nativePostGenerate();
+}
+
+template <class T>
+void OPNChipBaseT<T>::generateAndMixF32(float *output, size_t frames)
+{
+    if(m_idle)
+        return;
+    static_cast<T *>(this)->nativePreGenerate();
+    int32_t block[2 * rsm_block];
+    while(frames > 0)
+    {
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        resampledGenerateBlock(block, count);
+        trackSilence(block, count, m_rate);
+        for(size_t i = 0; i < 2 * count; ++i)
+            output[i] += (float)block[i] * OPN_CHIP_FLOAT_SCALE;
+        output += 2 * count;
+        frames -= count;
     }
     static_cast<T *>(this)->nativePostGenerate();
 }
 
+template <class T>
+void OPNChipBaseT<T>::generateNativeAndMix32(int32_t *output, size_t frames)
+{
+    if(m_idle)
+        return;
+    static_cast<T *>(this)->nativePreGenerate();
+    int16_t in[2 * rsm_block];
+    while(frames > 0)
+    {
+        size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+        static_cast<T *>(this)->nativeGenerateBlock(in, count);
+        trackSilence(in, count, nativeRate());
+        for(size_t i = 0; i < 2 * count; ++i)
+            output[i] += in[i];
+        output += 2 * count;
+        frames -= count;
+    }
+    static_cast<T *>(this)->nativePostGenerate();
+}
+
+template <class T>
+float OPNChipBaseT<T>::nativeGain() const
+{
+    return (float)T::resamplerPreAmplify / (float)T::resamplerPostAttenuate;
+}
+
+template <class T>
+size_t OPNChipBaseT<T>::stateSize() const
+{
+    size_t native = static_cast<const T *>(this)->nativeStateSize();
+    if(native == 0)
+        return 0;
+    size_t resampler = m_resampler ? m_resampler->stateSize() : 0;
+    return sizeof(BaseState) + resampler + native;
+}
+
+template <class T>
+void OPNChipBaseT<T>::saveState(void *state) const
+{
+    uint8_t *out = static_cast<uint8_t *>(state);
+    BaseState base;
+    std::memset(&base, 0, sizeof(BaseState));
+    base.rate = m_rate;
+    base.clock = m_clock;
+    base.resamplerQuality = m_resamplerQuality;
+    base.runningAtPcmRate = m_runningAtPcmRate ? 1 : 0;
+    base.activeMask = m_activeMask;
+    base.silentFrames = m_silentFrames;
+    base.idle = m_idle ? 1 : 0;
+    base.oldsamples[0] = m_oldsamples[0];
+    base.oldsamples[1] = m_oldsamples[1];
+    base.samples[0] = m_samples[0];
+    base.samples[1] = m_samples[1];
+    base.samplecnt = m_samplecnt;
+    std::memcpy(out, &base, sizeof(BaseState));
+    out += sizeof(BaseState);
+    if(m_resampler)
+    {
+        m_resampler->saveState(out);
+        out += m_resampler->stateSize();
+    }
+    static_cast<const T *>(this)->nativeSaveState(out);
+}
+
+template <class T>
+bool OPNChipBaseT<T>::checkState(const void *state) const
+{
+    BaseState base;
+    std::memcpy(&base, state, sizeof(BaseState));
+    return base.rate == m_rate && base.clock == m_clock &&
+           base.resamplerQuality == m_resamplerQuality &&
+           (base.runningAtPcmRate != 0) == m_runningAtPcmRate;
+}
+
+template <class T>
+bool OPNChipBaseT<T>::loadState(const void *state)
+{
+    if(!OPNChipBaseT<T>::checkState(state))
+        return false;
+    const uint8_t *in = static_cast<const uint8_t *>(state);
+    BaseState base;
+    std::memcpy(&base, in, sizeof(BaseState));
+    in += sizeof(BaseState);
+    m_activeMask = base.activeMask;
+    m_silentFrames = base.silentFrames;
+    m_idle = (base.idle != 0);
+    m_oldsamples[0] = base.oldsamples[0];
+    m_oldsamples[1] = base.oldsamples[1];
+    m_samples[0] = base.samples[0];
+    m_samples[1] = base.samples[1];
+    m_samplecnt = base.samplecnt;
+    if(m_resampler)
+    {
+        m_resampler->loadState(in);
+        in += m_resampler->stateSize();
+    }
+    static_cast<T *>(this)->nativeLoadState(in);
+    return true;
+}
+
+template <class T>
+void OPNChipBaseT<T>::nativeGenerateBlock(int16_t *output, size_t frames)
+{
+    for(size_t i = 0; i < frames; ++i)
+        static_cast<T *>(this)->nativeTick(output + 2 * i);
+}
+
 template <class T>
 void OPNChipBaseT<T>::nativeTick(int16_t *frame)
 {
@@ -206,32 +441,74 @@ void OPNChipBaseT<T>::nativeTick(int16_t *frame)
 }
 
 template <class T>
-void OPNChipBaseT<T>::setupResampler(uint32_t rate)
+template <class Sample>
+inline void OPNChipBaseT<T>::trackSilence(const Sample *output, size_t frames, uint32_t rate)
 {
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-    double ratio = rate * (1.0 / opn2_getNativeRate(m_family));
-    m_resampler->setup(ratio, 2, 48);
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER) // Every chip must keep ticking the handler
+    (void)output; (void)frames; (void)rate;
 #else
+    if(!T::idleSkipping || !m_idleSkipping)
+        return;
+    if(m_activeMask != 0)
+    {
+        m_silentFrames = 0;
+        return;
+    }
+    size_t silent = 0;
+    while(silent < frames)
+    {
+        const Sample *frame = output + 2 * (frames - 1 - silent);
+        if(frame[0] != 0 || frame[1] != 0)
+            break;
+        ++silent;
+    }
+    m_silentFrames = (silent < frames) ? (uint32_t)silent : m_silentFrames + (uint32_t)silent;
+    // A tenth of second of silence: the releasing envelopes went out
+    if(m_silentFrames >= rate / 10)
+        m_idle = true;
+#endif
+}
+
+template <class T>
+void OPNChipBaseT<T>::clearIdle()
+{
+    m_activeMask = 0;
+    m_silentFrames = 0;
+    m_idle = false;
+}
+
+template <class T>
+void OPNChipBaseT<T>::setupResampler(uint32_t rate)
+{
     m_oldsamples[0] = m_oldsamples[1] = 0;
     m_samples[0] = m_samples[1] = 0;
     m_samplecnt = 0;
     m_rateratio = (int32_t)(uint32_t)((((uint64_t)144 * rate) << rsm_frac) / m_clock);
-#endif
+    // With the shift of 31 + ceil(log2(ratio)) the rounded-up reciprocal
+    // gives the exact quotient for every dividend below 2^31
+    uint32_t ratioBits = 0;
+    while(ratioBits < 32 && ((uint64_t)1 << ratioBits) < (uint64_t)(uint32_t)m_rateratio)
+        ++ratioBits;
+    m_rateshift = 31 + ratioBits;
+    m_ratemagic = (m_rateratio > 0) ? ((uint64_t)1 << m_rateshift) / (uint32_t)m_rateratio + 1 : 0;
+
+    if(m_resampler)
+    {
+        m_resampler->setup(OPNChipResampler::nativeStep(m_clock, rate, m_resamplerQuality),
+                           m_resamplerQuality, nativeGain(), rsm_block);
+    }
 }
 
 template <class T>
 void OPNChipBaseT<T>::resetResampler()
 {
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
-    m_resampler->reset();
-#else
     m_oldsamples[0] = m_oldsamples[1] = 0;
     m_samples[0] = m_samples[1] = 0;
     m_samplecnt = 0;
-#endif
+    if(m_resampler)
+        m_resampler->reset();
 }
 
-#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
 template <class T>
 void OPNChipBaseT<T>::resampledGenerate(int32_t *output)
 {
@@ -244,39 +521,16 @@ void OPNChipBaseT<T>::resampledGenerate(int32_t *output)
         return;
     }
 
-    VResampler *rsm = m_resampler;
-    float scale = (float)T::resamplerPreAmplify /
-        (float)T::resamplerPostAttenuate;
-    float f_in[2];
-    float f_out[2];
-    rsm->inp_count = 0;
-    rsm->inp_data = f_in;
-    rsm->out_count = 1;
-    rsm->out_data = f_out;
-    while(rsm->process(), rsm->out_count != 0)
-    {
-        int16_t in[2];
-        static_cast<T *>(this)->nativeTick(in);
-        f_in[0] = scale * (float)in[0];
-        f_in[1] = scale * (float)in[1];
-        rsm->inp_count = 1;
-        rsm->inp_data = f_in;
-        rsm->out_count = 1;
-        rsm->out_data = f_out;
-    }
-    output[0] = static_cast<int32_t>(lround(f_out[0]));
-    output[1] = static_cast<int32_t>(lround(f_out[1]));
-}
-#else
-template <class T>
-void OPNChipBaseT<T>::resampledGenerate(int32_t *output)
-{
-    if(UNLIKELY(m_runningAtPcmRate))
+    if(m_resampler)
     {
-        int16_t in[2];
-        static_cast<T *>(this)->nativeTick(in);
-        output[0] = (int32_t)in[0] * T::resamplerPreAmplify / T::resamplerPostAttenuate;
-        output[1] = (int32_t)in[1] * T::resamplerPreAmplify / T::resamplerPostAttenuate;
+        OPNChipResampler *rsm = m_resampler;
+        for(size_t need = rsm->inputFrames(1); need > 0; --need)
+        {
+            int16_t in[2];
+            static_cast<T *>(this)->nativeTick(in);
+            rsm->feed(in, 1);
+        }
+        rsm->process(output, 1);
         return;
     }
 
@@ -298,15 +552,358 @@ void OPNChipBaseT<T>::resampledGenerate(int32_t *output)
                             + m_samples[1] * samplecnt) / rateratio)/T::resamplerPostAttenuate);
     m_samplecnt = samplecnt + (1 << rsm_frac);
 }
+
+template <class T>
+inline int32_t OPNChipBaseT<T>::divideByRateRatio(int32_t value) const
+{
+    uint32_t absolute = (value < 0) ? (0u - (uint32_t)value) : (uint32_t)value;
+    int32_t quotient = (int32_t)(uint32_t)(((uint64_t)absolute * m_ratemagic) >> m_rateshift);
+    return (value < 0) ? -quotient : quotient;
+}
+
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
+template <class T>
+void OPNChipBaseT<T>::resampledGenerateBlock(int32_t *output, size_t frames)
+{
+    for(size_t i = 0; i < frames; ++i)
+        static_cast<T *>(this)->resampledGenerate(output + 2 * i);
+}
+#else
+template <class T>
+void OPNChipBaseT<T>::resampledGenerateBlock(int32_t *output, size_t frames)
+{
+    int16_t in[2 * rsm_block];
+
+    if(UNLIKELY(m_runningAtPcmRate))
+    {
+        while(frames > 0)
+        {
+            size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+            static_cast<T *>(this)->nativeGenerateBlock(in, count);
+            for(size_t i = 0; i < 2 * count; ++i)
+                output[i] = (int32_t)in[i] * T::resamplerPreAmplify / T::resamplerPostAttenuate;
+            output += 2 * count;
+            frames -= count;
+        }
+        return;
+    }
+
+    if(m_resampler)
+    {
+        OPNChipResampler *rsm = m_resampler;
+        while(frames > 0)
+        {
+            size_t count = (frames < (size_t)rsm_block) ? frames : (size_t)rsm_block;
+            size_t need = rsm->inputFrames(count);
+            while(need > 0)
+            {
+                size_t pull = (need < (size_t)rsm_block) ? need : (size_t)rsm_block;
+                static_cast<T *>(this)->nativeGenerateBlock(in, pull);
+                rsm->feed(in, pull);
+                need -= pull;
+            }
+            rsm->process(output, count);
+            output += 2 * count;
+            frames -= count;
+        }
+        return;
+    }
+
+    // Natives are laid out as [old, current, fresh...]: every output frame
+    // interpolates between the pair at its index and the next one
+    int32_t natives[2 * (rsm_block + 2)];
+    uint32_t index[rsm_block];
+    int32_t weight[rsm_block];
+    const int32_t rateratio = m_rateratio;
+    int32_t samplecnt = m_samplecnt;
+
+    while(frames > 0)
+    {
+        // Plan the block: count natives to pull and positions between them
+        size_t count = 0;
+        uint32_t pulled = 0;
+        while(count < frames && count < (size_t)rsm_block)
+        {
+            int32_t cnt = samplecnt;
+            uint32_t need = 0;
+            while(cnt >= rateratio)
+            {
+                cnt -= rateratio;
+                ++need;
+            }
+            if(pulled + need > (uint32_t)rsm_block)
+                break;
+            pulled += need;
+            index[count] = pulled;
+            weight[count] = cnt;
+            samplecnt = cnt + (1 << rsm_frac);
+            ++count;
+        }
+
+        if(UNLIKELY(count == 0))
+        {
+            // Output rate is too low to fit a single frame into the block
+            static_cast<T *>(this)->resampledGenerate(output);
+            samplecnt = m_samplecnt;
+            output += 2;
+            --frames;
+            continue;
+        }
+
+        static_cast<T *>(this)->nativeGenerateBlock(in, pulled);
+        natives[0] = m_oldsamples[0];
+        natives[1] = m_oldsamples[1];
+        natives[2] = m_samples[0];
+        natives[3] = m_samples[1];
+        for(size_t i = 0; i < 2 * pulled; ++i)
+            natives[4 + i] = in[i] * T::resamplerPreAmplify;
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            const int32_t *old = natives + 2 * index[i];
+            const int32_t *cur = old + 2;
+            const int32_t cnt = weight[i];
+            const int32_t rest = rateratio - cnt;
+            output[0] = divideByRateRatio(old[0] * rest + cur[0] * cnt) / T::resamplerPostAttenuate;
+            output[1] = divideByRateRatio(old[1] * rest + cur[1] * cnt) / T::resamplerPostAttenuate;
+            output += 2;
+        }
+
+        m_oldsamples[0] = natives[2 * pulled];
+        m_oldsamples[1] = natives[2 * pulled + 1];
+        m_samples[0] = natives[2 * pulled + 2];
+        m_samples[1] = natives[2 * pulled + 3];
+        m_samplecnt = samplecnt;
+        frames -= count;
+    }
+}
 #endif
 
 /* OPNChipBaseBufferedT */
 
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::setRate(uint32_t rate, uint32_t clock)
+{
+    OPNChipBaseT<T>::setRate(rate, clock);
+    // Backends set up their chip anew, drop what was meant for the old one
+    m_bufferIndex = 0;
+    m_nextDone = 0;
+    m_queueHead = m_queueTail;
+}
+
 template <class T, unsigned Buffer>
 void OPNChipBaseBufferedT<T, Buffer>::reset()
 {
     OPNChipBaseT<T>::reset();
     m_bufferIndex = 0;
+    m_nextDone = 0;
+    m_time = 0;
+    m_queueHead = m_queueTail = 0;
+}
+
+template <class T, unsigned Buffer>
+size_t OPNChipBaseBufferedT<T, Buffer>::stateSize() const
+{
+    size_t base = OPNChipBaseT<T>::stateSize();
+    if(base == 0)
+        return 0;
+    return base + sizeof(BufferedState) + sizeof(m_buffer) + sizeof(m_next) + sizeof(m_queue);
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::saveState(void *state) const
+{
+    OPNChipBaseT<T>::saveState(state);
+    uint8_t *out = static_cast<uint8_t *>(state) + OPNChipBaseT<T>::stateSize();
+    BufferedState buffered;
+    buffered.bufferIndex = m_bufferIndex;
+    buffered.nextDone = m_nextDone;
+    buffered.time = m_time;
+    buffered.queueCount = m_queueTail - m_queueHead;
+    std::memcpy(out, &buffered, sizeof(BufferedState));
+    out += sizeof(BufferedState);
+    std::memcpy(out, m_buffer, sizeof(m_buffer));
+    out += sizeof(m_buffer);
+    std::memcpy(out, m_next, sizeof(m_next));
+    out += sizeof(m_next);
+    // The pending writes are saved from the head of the queue
+    std::memset(out, 0, sizeof(m_queue));
+    for(uint32_t i = 0; i < buffered.queueCount; ++i)
+    {
+        const QueuedWrite &w = m_queue[(m_queueHead + i) & (queue_size - 1)];
+        std::memcpy(out + i * sizeof(QueuedWrite), &w, sizeof(QueuedWrite));
+    }
+}
+
+template <class T, unsigned Buffer>
+bool OPNChipBaseBufferedT<T, Buffer>::checkState(const void *state) const
+{
+    if(!OPNChipBaseT<T>::checkState(state))
+        return false;
+    const uint8_t *in = static_cast<const uint8_t *>(state) + OPNChipBaseT<T>::stateSize();
+    BufferedState buffered;
+    std::memcpy(&buffered, in, sizeof(BufferedState));
+    return buffered.bufferIndex < Buffer && buffered.nextDone <= Buffer &&
+           buffered.queueCount <= (uint32_t)queue_size;
+}
+
+template <class T, unsigned Buffer>
+bool OPNChipBaseBufferedT<T, Buffer>::loadState(const void *state)
+{
+    if(!checkState(state) || !OPNChipBaseT<T>::loadState(state))
+        return false;
+    const uint8_t *in = static_cast<const uint8_t *>(state) + OPNChipBaseT<T>::stateSize();
+    BufferedState buffered;
+    std::memcpy(&buffered, in, sizeof(BufferedState));
+    in += sizeof(BufferedState);
+    std::memcpy(m_buffer, in, sizeof(m_buffer));
+    in += sizeof(m_buffer);
+    std::memcpy(m_next, in, sizeof(m_next));
+    in += sizeof(m_next);
+    std::memcpy(m_queue, in, sizeof(m_queue));
+    m_bufferIndex = buffered.bufferIndex;
+    m_nextDone = buffered.nextDone;
+    m_time = buffered.time;
+    m_queueHead = 0;
+    m_queueTail = buffered.queueCount;
+    return true;
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+{
+    if(!T::writeQueueing)
+    {
+        static_cast<T *>(this)->nativeWriteReg(port, addr, data);
+        return;
+    }
+    if(m_queueTail - m_queueHead == (uint32_t)queue_size)
+        flushWrites();
+    QueuedWrite &w = m_queue[m_queueTail & (queue_size - 1)];
+    w.time = m_time;
+    w.addr = addr;
+    w.port = (uint8_t)port;
+    w.data = data;
+    ++m_queueTail;
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::writeRegs(uint32_t port, const OPNRegPair *regs, size_t count)
+{
+    if(!T::writeQueueing)
+    {
+        for(size_t i = 0; i < count; ++i)
+            static_cast<T *>(this)->nativeWriteReg(port, regs[i].addr, regs[i].data);
+        return;
+    }
+    while(count > 0)
+    {
+        // Queue the writes by runs which fit into the free space
+        uint32_t room = (uint32_t)queue_size - (m_queueTail - m_queueHead);
+        if(room == 0)
+        {
+            flushWrites();
+            room = (uint32_t)queue_size - (m_queueTail - m_queueHead);
+        }
+        size_t run = (count < room) ? count : room;
+        for(size_t i = 0; i < run; ++i)
+        {
+            QueuedWrite &w = m_queue[(m_queueTail + i) & (queue_size - 1)];
+            w.time = m_time;
+            w.addr = regs[i].addr;
+            w.port = (uint8_t)port;
+            w.data = regs[i].data;
+        }
+        m_queueTail += (uint32_t)run;
+        regs += run;
+        count -= run;
+    }
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::writePan(uint16_t chan, uint8_t data)
+{
+    if(!T::writeQueueing)
+    {
+        static_cast<T *>(this)->nativeWritePan(chan, data);
+        return;
+    }
+    if(m_queueTail - m_queueHead == (uint32_t)queue_size)
+        flushWrites();
+    QueuedWrite &w = m_queue[m_queueTail & (queue_size - 1)];
+    w.time = m_time;
+    w.addr = chan;
+    w.port = pan_port;
+    w.data = data;
+    ++m_queueTail;
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::preroll()
+{
+    // Move the pending writes onto the first frame which isn't rendered yet
+    const uint32_t start = m_time - (m_bufferIndex ? m_bufferIndex : Buffer) + m_nextDone;
+    for(uint32_t i = m_queueHead; i != m_queueTail; ++i)
+        m_queue[i & (queue_size - 1)].time = start;
+}
+
+template <class T, unsigned Buffer>
+inline void OPNChipBaseBufferedT<T, Buffer>::applyWrite(const QueuedWrite &w)
+{
+    if(w.port == pan_port)
+        static_cast<T *>(this)->nativeWritePan(w.addr, w.data);
+    else
+        static_cast<T *>(this)->nativeWriteReg(w.port, w.addr, w.data);
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::flushWrites()
+{
+    // Queue is full: all queued writes land on the next buffer, so render it
+    // ahead up to the frame of the oldest one and apply the writes due by then
+    const uint32_t start = m_time - (m_bufferIndex ? m_bufferIndex : Buffer);
+    const uint32_t offset = m_queue[m_queueHead & (queue_size - 1)].time - start;
+    if(offset > m_nextDone)
+    {
+        static_cast<T *>(this)->nativeGenerateN(m_next + 2 * m_nextDone, offset - m_nextDone);
+        m_nextDone = offset;
+    }
+    while(m_queueHead != m_queueTail)
+    {
+        const QueuedWrite &w = m_queue[m_queueHead & (queue_size - 1)];
+        if(w.time - start > m_nextDone)
+            break;
+        applyWrite(w);
+        ++m_queueHead;
+    }
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::renderBuffer()
+{
+    // The buffer takes the frames going one buffer behind the write clock,
+    // so every write which can land on them has already been queued
+    const uint32_t start = m_time - Buffer;
+    size_t done = m_nextDone;
+    if(done > 0)
+        std::memcpy(m_buffer, m_next, done * 2 * sizeof(int16_t));
+    m_nextDone = 0;
+    while(m_queueHead != m_queueTail)
+    {
+        const QueuedWrite &w = m_queue[m_queueHead & (queue_size - 1)];
+        int32_t offset = (int32_t)(w.time - start);
+        if(offset >= (int32_t)Buffer)
+            break;
+        if(offset > (int32_t)done)
+        {
+            static_cast<T *>(this)->nativeGenerateN(m_buffer + 2 * done, (size_t)offset - done);
+            done = (size_t)offset;
+        }
+        applyWrite(w);
+        ++m_queueHead;
+    }
+    if(done < Buffer)
+        static_cast<T *>(this)->nativeGenerateN(m_buffer + 2 * done, Buffer - done);
 }
 
 template <class T, unsigned Buffer>
@@ -314,9 +911,30 @@ void OPNChipBaseBufferedT<T, Buffer>::nativeGenerate(int16_t *frame)
 {
     unsigned bufferIndex = m_bufferIndex;
     if(bufferIndex == 0)
-        static_cast<T *>(this)->nativeGenerateN(m_buffer, Buffer);
+        renderBuffer();
     frame[0] = m_buffer[2 * bufferIndex];
     frame[1] = m_buffer[2 * bufferIndex + 1];
     bufferIndex = (bufferIndex + 1 < Buffer) ? (bufferIndex + 1) : 0;
     m_bufferIndex = bufferIndex;
+    ++m_time;
+}
+
+template <class T, unsigned Buffer>
+void OPNChipBaseBufferedT<T, Buffer>::nativeGenerateBlock(int16_t *output, size_t frames)
+{
+    unsigned bufferIndex = m_bufferIndex;
+    while(frames > 0)
+    {
+        if(bufferIndex == 0)
+            renderBuffer();
+        size_t count = Buffer - bufferIndex;
+        count = (count < frames) ? count : frames;
+        std::memcpy(output, m_buffer + 2 * bufferIndex, count * 2 * sizeof(int16_t));
+        output += 2 * count;
+        frames -= count;
+        m_time += (uint32_t)count;
+        bufferIndex += (unsigned)count;
+        bufferIndex = (bufferIndex < Buffer) ? bufferIndex : 0;
+    }
+    m_bufferIndex = bufferIndex;
 }
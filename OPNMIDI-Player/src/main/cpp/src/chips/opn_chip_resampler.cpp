@@ -0,0 +1,326 @@
+/*
+ * Interfaces over Yamaha OPN2 (YM2612) chip emulators
+ *
+ * Copyright (c) 2017-2020 Vitaly Novichkov (Wohlstand)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "opn_chip_resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// OPNMIDI_DISABLE_SIMD keeps the scalar kernel, the reference of the vector ones
+#if defined(OPNMIDI_DISABLE_SIMD)
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   include <xmmintrin.h>
+#   define OPN_RESAMPLER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define OPN_RESAMPLER_NEON
+#endif
+
+struct OPNResamplerTier
+{
+    //! Filter length in native frames when not decimating, multiple of 4
+    unsigned taps;
+    //! Cutoff relative to the Nyquist frequency of the lower rate
+    double passband;
+    //! Kaiser window shape
+    double beta;
+};
+
+static const OPNResamplerTier s_tiers[4] =
+{
+    {4,  1.00, 0.0},
+    {8,  0.80, 5.0},
+    {16, 0.90, 7.0},
+    {32, 0.95, 9.0}
+};
+
+static const double s_pi = 3.14159265358979323846;
+
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for(int k = 1; k < 64 && term > sum * 1e-12; ++k)
+    {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+// Both channels through the coefficients interpolated between two phases;
+// the taps count is always a multiple of 4
+static inline void convolve(const float *h0, const float *h1, float a,
+                            const float *xl, const float *xr, size_t taps,
+                            float &outL, float &outR)
+{
+#if defined(OPN_RESAMPLER_SSE)
+    __m128 va = _mm_set1_ps(a);
+    __m128 accL = _mm_setzero_ps();
+    __m128 accR = _mm_setzero_ps();
+    for(size_t k = 0; k < taps; k += 4)
+    {
+        __m128 c0 = _mm_loadu_ps(h0 + k);
+        __m128 c = _mm_add_ps(c0, _mm_mul_ps(va, _mm_sub_ps(_mm_loadu_ps(h1 + k), c0)));
+        accL = _mm_add_ps(accL, _mm_mul_ps(c, _mm_loadu_ps(xl + k)));
+        accR = _mm_add_ps(accR, _mm_mul_ps(c, _mm_loadu_ps(xr + k)));
+    }
+    float l[4], r[4];
+    _mm_storeu_ps(l, accL);
+    _mm_storeu_ps(r, accR);
+#elif defined(OPN_RESAMPLER_NEON)
+    float32x4_t accL = vdupq_n_f32(0.0f);
+    float32x4_t accR = vdupq_n_f32(0.0f);
+    for(size_t k = 0; k < taps; k += 4)
+    {
+        float32x4_t c0 = vld1q_f32(h0 + k);
+        float32x4_t c = vmlaq_n_f32(c0, vsubq_f32(vld1q_f32(h1 + k), c0), a);
+        accL = vmlaq_f32(accL, c, vld1q_f32(xl + k));
+        accR = vmlaq_f32(accR, c, vld1q_f32(xr + k));
+    }
+    float l[4], r[4];
+    vst1q_f32(l, accL);
+    vst1q_f32(r, accR);
+#else
+    float l[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float r[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for(size_t k = 0; k < taps; k += 4)
+    {
+        for(size_t j = 0; j < 4; ++j)
+        {
+            float c = h0[k + j] + a * (h1[k + j] - h0[k + j]);
+            l[j] += c * xl[k + j];
+            r[j] += c * xr[k + j];
+        }
+    }
+#endif
+    outL = (l[0] + l[1]) + (l[2] + l[3]);
+    outR = (r[0] + r[1]) + (r[2] + r[3]);
+}
+
+static inline void storeSample(int32_t &dst, float x, float)
+{
+    dst = (x >= 0.0f) ? (int32_t)(x + 0.5f) : -(int32_t)(0.5f - x);
+}
+
+static inline void storeSample(float &dst, float x, float scale)
+{
+    dst = x * scale;
+}
+
+OPNChipResampler::OPNChipResampler() :
+    m_step((uint64_t)1 << 32),
+    m_pos(0),
+    m_taps(0),
+    m_delay(0),
+    m_fill(0)
+{
+}
+
+void OPNChipResampler::setup(uint64_t step, int quality, float gain, size_t maxBlock)
+{
+    if(quality < Quality_Linear)
+        quality = Quality_Linear;
+    else if(quality > Quality_High)
+        quality = Quality_High;
+    const OPNResamplerTier &tier = s_tiers[quality];
+
+    m_step = (step > 0) ? step : 1;
+    const double ratio = (double)m_step / 4294967296.0;
+
+    // While decimating the filter stretches to keep the same transition band
+    size_t taps = tier.taps;
+    if(ratio > 1.0 && quality != Quality_Linear)
+        taps = (size_t)std::ceil(tier.taps * ratio);
+    taps = (taps + 3) & ~(size_t)3;
+    m_taps = taps;
+    // Pulls frames in step with the integer linear interpolation of the chips
+    m_delay = (quality == Quality_Linear) ? 3 : 0;
+
+    const double cutoff = tier.passband / ((ratio > 1.0) ? ratio : 1.0);
+    const double half = (double)(taps / 2);
+    const double norm = 1.0 / besselI0(tier.beta);
+    m_phases.resize((phase_count + 1) * taps);
+    std::vector<double> row(taps);
+
+    for(size_t p = 0; p <= (size_t)phase_count; ++p)
+    {
+        const double frac = (double)p / phase_count;
+        double sum = 0.0;
+        for(size_t k = 0; k < taps; ++k)
+        {
+            double t = (double)k - (half - 1.0) - frac;
+            if(quality == Quality_Linear)
+            {
+                // Triangle over the last two frames, no look-ahead is needed
+                t -= 1.0;
+                row[k] = (t > -1.0 && t < 1.0) ? 1.0 - std::fabs(t) : 0.0;
+                sum += row[k];
+                continue;
+            }
+            double x = t / half;
+            double w = (x * x < 1.0) ? besselI0(tier.beta * std::sqrt(1.0 - x * x)) * norm : 0.0;
+            double s = cutoff * t;
+            double sinc = (s == 0.0) ? 1.0 : std::sin(s_pi * s) / (s_pi * s);
+            row[k] = cutoff * sinc * w;
+            sum += row[k];
+        }
+        for(size_t k = 0; k < taps; ++k)
+            m_phases[p * taps + k] = (float)(row[k] * gain / sum);
+    }
+
+    size_t capacity = taps + m_delay + (size_t)std::ceil((maxBlock + 1) * ratio) + 4;
+    m_historyL.assign(capacity, 0.0f);
+    m_historyR.assign(capacity, 0.0f);
+    reset();
+}
+
+void OPNChipResampler::reset()
+{
+    // The first native frame fed lands right under the first output frame,
+    // or that many frames later with the delay
+    size_t lead = m_taps / 2 - 1;
+    std::fill(m_historyL.begin(), m_historyL.end(), 0.0f);
+    std::fill(m_historyR.begin(), m_historyR.end(), 0.0f);
+    m_fill = lead + m_delay;
+    m_pos = (uint64_t)lead << 32;
+}
+
+uint64_t OPNChipResampler::nativeStep(uint32_t clock, uint32_t rate, int quality)
+{
+    if(quality == Quality_Linear)
+    {
+        uint64_t ratio = (((uint64_t)144 * rate) << 10) / clock;
+        return (ratio > 0) ? ((uint64_t)1 << 42) / ratio : 0;
+    }
+    return (rate > 0) ? ((uint64_t)clock << 32) / ((uint64_t)144 * rate) : 0;
+}
+
+size_t OPNChipResampler::inputFrames(size_t outputFrames) const
+{
+    if(outputFrames == 0)
+        return 0;
+    uint64_t last = m_pos + (uint64_t)(outputFrames - 1) * m_step;
+    size_t need = (size_t)(last >> 32) + m_taps / 2 + 1;
+    return (need > m_fill) ? (need - m_fill) : 0;
+}
+
+void OPNChipResampler::feed(const int16_t *input, size_t frames)
+{
+    float *l = &m_historyL[m_fill];
+    float *r = &m_historyR[m_fill];
+    for(size_t i = 0; i < frames; ++i)
+    {
+        l[i] = (float)input[2 * i];
+        r[i] = (float)input[2 * i + 1];
+    }
+    m_fill += frames;
+}
+
+void OPNChipResampler::feed(const int32_t *input, size_t frames)
+{
+    float *l = &m_historyL[m_fill];
+    float *r = &m_historyR[m_fill];
+    for(size_t i = 0; i < frames; ++i)
+    {
+        l[i] = (float)input[2 * i];
+        r[i] = (float)input[2 * i + 1];
+    }
+    m_fill += frames;
+}
+
+void OPNChipResampler::process(int32_t *output, size_t frames)
+{
+    processBlock(output, frames, 1.0f);
+}
+
+void OPNChipResampler::process(float *output, size_t frames, float scale)
+{
+    processBlock(output, frames, scale);
+}
+
+size_t OPNChipResampler::stateSize() const
+{
+    return sizeof(uint64_t) + sizeof(uint64_t) + 2 * m_historyL.size() * sizeof(float);
+}
+
+void OPNChipResampler::saveState(void *state) const
+{
+    uint8_t *out = static_cast<uint8_t *>(state);
+    const uint64_t fill = m_fill;
+    const size_t history = m_historyL.size() * sizeof(float);
+    std::memcpy(out, &m_pos, sizeof(uint64_t));
+    std::memcpy(out + sizeof(uint64_t), &fill, sizeof(uint64_t));
+    out += 2 * sizeof(uint64_t);
+    std::memcpy(out, &m_historyL[0], history);
+    std::memcpy(out + history, &m_historyR[0], history);
+}
+
+void OPNChipResampler::loadState(const void *state)
+{
+    const uint8_t *in = static_cast<const uint8_t *>(state);
+    uint64_t fill;
+    const size_t history = m_historyL.size() * sizeof(float);
+    std::memcpy(&m_pos, in, sizeof(uint64_t));
+    std::memcpy(&fill, in + sizeof(uint64_t), sizeof(uint64_t));
+    in += 2 * sizeof(uint64_t);
+    std::memcpy(&m_historyL[0], in, history);
+    std::memcpy(&m_historyR[0], in + history, history);
+    m_fill = (size_t)fill;
+}
+
+template <class Sample>
+void OPNChipResampler::processBlock(Sample *output, size_t frames, float scale)
+{
+    const size_t taps = m_taps;
+    const size_t lead = taps / 2 - 1;
+    const float *phases = &m_phases[0];
+    const float *histL = &m_historyL[0];
+    const float *histR = &m_historyR[0];
+    const uint32_t phaseShift = 32 - phase_bits;
+    const float phaseScale = 1.0f / (float)((uint32_t)1 << phaseShift);
+    uint64_t pos = m_pos;
+
+    for(size_t i = 0; i < frames; ++i)
+    {
+        size_t start = (size_t)(pos >> 32) - lead;
+        uint32_t frac = (uint32_t)pos;
+        const float *h0 = phases + (frac >> phaseShift) * taps;
+        float a = (float)(frac & (((uint32_t)1 << phaseShift) - 1)) * phaseScale;
+        float l, r;
+        convolve(h0, h0 + taps, a, histL + start, histR + start, taps, l, r);
+        storeSample(output[2 * i], l, scale);
+        storeSample(output[2 * i + 1], r, scale);
+        pos += m_step;
+    }
+
+    // Drop the history which no further output frame reaches
+    size_t drop = (size_t)(pos >> 32) - lead;
+    drop = (drop < m_fill) ? drop : m_fill;
+    if(drop > 0)
+    {
+        std::memmove(&m_historyL[0], &m_historyL[drop], (m_fill - drop) * sizeof(float));
+        std::memmove(&m_historyR[0], &m_historyR[drop], (m_fill - drop) * sizeof(float));
+        m_fill -= drop;
+        m_pos = pos - ((uint64_t)drop << 32);
+    }
+    else
+        m_pos = pos;
+}
@@ -0,0 +1,85 @@
+/*
+ * Interfaces over Yamaha OPN2 (YM2612) chip emulators
+ *
+ * Copyright (c) 2017-2020 Vitaly Novichkov (Wohlstand)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef OPN_CHIP_RESAMPLER_H
+#define OPN_CHIP_RESAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Polyphase windowed-sinc resampler of the chip's native stereo output,
+// the linear tier uses a triangle kernel in place of sinc. Filter phases
+// are tabulated once on setup, coefficients between two neighbouring
+// phases are interpolated linearly.
+class OPNChipResampler
+{
+public:
+    // Matches OPNMIDI_ResamplerQuality
+    enum Quality
+    {
+        Quality_Linear = 0,
+        Quality_Low,
+        Quality_Medium,
+        Quality_High
+    };
+
+    OPNChipResampler();
+
+    // step: native frames per output frame as 32.32 fixed point,
+    // gain: amplitude factor applied to output,
+    // maxBlock: the largest count of output frames processed at once
+    void setup(uint64_t step, int quality, float gain, size_t maxBlock);
+    void reset();
+
+    // The step between chip's native frames, clocked by 144 cycles per frame;
+    // the linear tier keeps the 10-bit precision of the chips' interpolation
+    static uint64_t nativeStep(uint32_t clock, uint32_t rate, int quality);
+
+    // Count of native frames to feed before producing the given output frames
+    size_t inputFrames(size_t outputFrames) const;
+    // The most native frames ever requested for a block of maxBlock frames
+    size_t maxInputFrames() const { return m_historyL.size(); }
+    void feed(const int16_t *input, size_t frames);
+    void feed(const int32_t *input, size_t frames);
+    void process(int32_t *output, size_t frames);
+    // Unrounded output, multiplied by the scale
+    void process(float *output, size_t frames, float scale);
+
+    // Snapshot of the position and the history, its size depends on the setup
+    size_t stateSize() const;
+    void saveState(void *state) const;
+    void loadState(const void *state);
+
+private:
+    uint64_t m_step;
+    uint64_t m_pos;
+    size_t m_taps;
+    size_t m_delay;
+    size_t m_fill;
+    std::vector<float> m_phases;
+    std::vector<float> m_historyL;
+    std::vector<float> m_historyR;
+    enum { phase_bits = 7, phase_count = 1 << phase_bits };
+    template <class Sample>
+    void processBlock(Sample *output, size_t frames, float scale);
+};
+
+#endif // OPN_CHIP_RESAMPLER_H
@@ -214,14 +214,17 @@ void PSGInit(PSG *psg)
 {
     int i;
     float base = 0x4000 / 3.0f;
-    for (i=31; i>=2; i--)
+    if (EmitTable[0] == -1)
     {
-        EmitTable[i] = lrintf(base);
-        base *= 0.840896415f; /* 1.0f / 1.189207115f */
+        for (i=31; i>=2; i--)
+        {
+            EmitTable[i] = lrintf(base);
+            base *= 0.840896415f; /* 1.0f / 1.189207115f */
+        }
+        EmitTable[1] = 0;
+        MakeEnvelopTable();
+        EmitTable[0] = 0;
     }
-    EmitTable[1] = 0;
-    EmitTable[0] = 0;
-    MakeEnvelopTable();
 
     PSGSetChannelMask(psg, psg->mask);
     psg->rng = 14231;
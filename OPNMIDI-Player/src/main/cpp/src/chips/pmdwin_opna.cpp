@@ -20,6 +20,7 @@
 
 #include "pmdwin_opna.h"
 #include "pmdwin/opna.h"
+#include "../opnmidi_threads.hpp"
 #include <cstring>
 #include <cassert>
 
@@ -44,7 +45,10 @@ void PMDWinOPNA::setRate(uint32_t rate, uint32_t clock)
 
     uint32_t chipRate = isRunningAtPcmRate() ? rate : nativeRate();
     std::memset(chip, 0, sizeof(*opn));
-    OPNAInit(opn, m_clock, chipRate, 0);
+    {
+        OpnMutexLocker lock(g_opnChipTablesLock);
+        OPNAInit(opn, m_clock, chipRate, 0);
+    }
     OPNASetReg(opn, 0x29, 0x9f);
 }
 
@@ -56,13 +60,13 @@ void PMDWinOPNA::reset()
     OPNASetReg(opn, 0x29, 0x9f);
 }
 
-void PMDWinOPNA::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+void PMDWinOPNA::nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
 {
     OPNA *opn = reinterpret_cast<OPNA *>(chip);
     OPNASetReg(opn, (port << 8) | addr, data);
 }
 
-void PMDWinOPNA::writePan(uint16_t chan, uint8_t data)
+void PMDWinOPNA::nativeWritePan(uint16_t chan, uint8_t data)
 {
     OPNA *opn = reinterpret_cast<OPNA *>(chip);
     OPNASetPan(opn, chan, data);
@@ -25,6 +25,7 @@
 #include <opnmidi_private.hpp>
 
 //! FIXME: Replace this ugly crap with proper public call
+//! Must be set before creating the player, every dumper copies the path on construction
 static const char *g_vgm_path = "output.vgm";
 
 extern "C"
@@ -33,9 +34,6 @@ OPNMIDI_EXPORT void opn2_set_vgm_out_path(const char *path)
     g_vgm_path = path;
 }
 
-static int g_chip_index = 0;
-static VGMFileDumper* g_master = NULL;
-
 #define VGM_LOOP_START_BASE 0x1C
 #define VGM_SONG_DATA_START 0x38
 
@@ -158,10 +156,12 @@ void VGMFileDumper::writeCommand(uint_fast8_t cmd, uint_fast16_t key, uint_fast8
     m_bytes_written += 3;
 }
 
-VGMFileDumper::VGMFileDumper(OPNFamily f)
-    : OPNChipBaseBufferedT(f)
+VGMFileDumper::VGMFileDumper(OPNFamily f, int chipIndex, VGMFileDumper *master)
+    : OPNChipBaseBufferedT(f),
+      m_master(master),
+      m_path(g_vgm_path)
 {
-    m_chip_index = g_chip_index++;
+    m_chip_index = chipIndex;
     m_bytes_written = 0;
     m_samples_written = 0;
     m_samples_loop = 0;
@@ -171,8 +171,6 @@ VGMFileDumper::VGMFileDumper(OPNFamily f)
     std::memset(&m_vgm_head, 0, sizeof(VgmHead));
     m_needInit = (m_chip_index == 0);
     m_output = NULL;
-    if(m_chip_index == 0)
-        g_master = this;
 }
 
 void VGMFileDumper::initFile()
@@ -182,13 +180,12 @@ void VGMFileDumper::initFile()
 
     if(m_chip_index == 0)
     {
-        m_output = std::fopen(g_vgm_path, "wb");
+        m_output = std::fopen(m_path.c_str(), "wb");
         assert(m_output);
         std::memcpy(m_vgm_head.magic, "Vgm ", 4);
         m_vgm_head.version = 0x00000150;
         m_vgm_head.offset_loop = VGM_LOOP_START_BASE;
         std::fseek(m_output, VGM_SONG_DATA_START, SEEK_SET);
-        g_master = this;
     }
 
     m_needInit = false;
@@ -196,7 +193,6 @@ void VGMFileDumper::initFile()
 
 VGMFileDumper::~VGMFileDumper()
 {
-    g_chip_index--;
     if(m_chip_index > 0)
         return;
 
@@ -217,7 +213,6 @@ VGMFileDumper::~VGMFileDumper()
 
     if(m_output)
         std::fclose(m_output);
-    g_master = NULL;
 }
 
 void VGMFileDumper::setRate(uint32_t rate, uint32_t clock)
@@ -240,12 +235,12 @@ void VGMFileDumper::reset()
     m_delay = 0;
 }
 
-void VGMFileDumper::writeReg(uint32_t port, uint16_t addr, uint8_t data)
+void VGMFileDumper::nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
 {
     if(m_chip_index > 0) // When it's a second chip
     {
-        if(g_master)
-            g_master->writeReg(port + 2, addr, data);
+        if(m_master)
+            m_master->writeReg(port + 2, addr, data);
         return;
     }
 
@@ -264,7 +259,7 @@ void VGMFileDumper::writeReg(uint32_t port, uint16_t addr, uint8_t data)
     writeCommand(ports[port], addr, data);
 }
 
-void VGMFileDumper::writePan(uint16_t /*chan*/, uint8_t /*data*/)
+void VGMFileDumper::nativeWritePan(uint16_t /*chan*/, uint8_t /*data*/)
 {}
 
 void VGMFileDumper::nativeGenerateN(int16_t *output, size_t frames)
@@ -22,6 +22,7 @@
 #define VGM_FILE_DUMPER_H
 
 #include "opn_chip_base.h"
+#include <string>
 
 class VGMFileDumper final : public OPNChipBaseBufferedT<VGMFileDumper>
 {
@@ -43,6 +44,10 @@ class VGMFileDumper final : public OPNChipBaseBufferedT<VGMFileDumper>
     bool     m_end_caught;
     //! Index of chip (0'th is master, 1 is a helper)
     int      m_chip_index;
+    //! Master chip which receives writes of the helper chip
+    VGMFileDumper *m_master;
+    //! Path to the output file, taken at construction
+    std::string m_path;
 
     struct VgmHead
     {
@@ -73,14 +78,14 @@ class VGMFileDumper final : public OPNChipBaseBufferedT<VGMFileDumper>
     void initFile();
 
 public:
-    explicit VGMFileDumper(OPNFamily f);
+    VGMFileDumper(OPNFamily f, int chipIndex, VGMFileDumper *master);
     ~VGMFileDumper() override;
 
     bool canRunAtPcmRate() const override { return true; }
     void setRate(uint32_t rate, uint32_t clock) override;
     void reset() override;
-    void writeReg(uint32_t port, uint16_t addr, uint8_t data) override;
-    void writePan(uint16_t chan, uint8_t data) override;
+    void nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data);
+    void nativeWritePan(uint16_t chan, uint8_t data);
     void nativePreGenerate() override {}
     void nativePostGenerate() override {}
     void nativeGenerateN(int16_t *output, size_t frames) override;
@@ -89,6 +94,9 @@ public:
     void writeLoopEnd();
     static void loopStartHook(void *self);
     static void loopEndHook(void *self);
+    // every frame counts into the delays of the file,
+    // the writes go to the file at once, between waits of whole buffers
+    enum { idleSkipping = 0, writeQueueing = 0 };
 };
 
 #endif // VGM_FILE_DUMPER_H
@@ -343,6 +343,8 @@ private:
     Position m_trackBeginPosition;
     //! Loop start point
     Position m_loopBeginPosition;
+    //! Snapshot of the position at begin of the currently processing row (reused to avoid allocations)
+    Position m_rowBeginPosition;
 
     //! Is looping enabled or not
     bool    m_loopEnabled;
@@ -371,6 +373,8 @@ private:
     std::string m_musCopyright;
     //! List of track titles
     std::vector<std::string> m_musTrackTitles;
+    //! List of unique MIDI device names used by device switch events
+    std::vector<std::string> m_musDeviceNames;
     //! List of MIDI markers
     std::vector<MIDI_MarkerEntry> m_musMarkers;
 
@@ -641,6 +645,12 @@ public:
      */
     const std::vector<std::string> &getTrackTitles();
 
+    /**
+     * @brief Get list of MIDI device names used by device switch events
+     * @return array of unique device name strings in order of their appearance in the file
+     */
+    const std::vector<std::string> &getDeviceNames();
+
     /**
      * @brief Get list of MIDI markers
      * @return Array of MIDI marker structures
@@ -464,6 +464,11 @@ const std::vector<std::string> &BW_MidiSequencer::getTrackTitles()
     return m_musTrackTitles;
 }
 
+const std::vector<std::string> &BW_MidiSequencer::getDeviceNames()
+{
+    return m_musDeviceNames;
+}
+
 const std::vector<BW_MidiSequencer::MIDI_MarkerEntry> &BW_MidiSequencer::getMarkers()
 {
     return m_musMarkers;
@@ -491,6 +496,7 @@ void BW_MidiSequencer::buildSmfSetupReset(size_t trackCount)
     m_musTitle.clear();
     m_musCopyright.clear();
     m_musTrackTitles.clear();
+    m_musDeviceNames.clear();
     m_musMarkers.clear();
     m_trackData.clear();
     m_trackData.resize(trackCount, MidiTrackQueue());
@@ -896,6 +902,10 @@ void BW_MidiSequencer::buildTimeLine(const std::vector<MidiEvent> &tempos,
     m_trackBeginPosition = m_currentPosition;
     // Initial loop position will begin at begin of track until passing of the loop point
     m_loopBeginPosition  = m_currentPosition;
+    // Pre-allocate position snapshots to keep the playback free of heap allocations
+    m_rowBeginPosition   = m_currentPosition;
+    for(size_t i = 0; i < m_loop.stack.size(); ++i)
+        m_loop.stack[i].startPosition = m_currentPosition;
     // Set lowest level of the loop stack
     m_loop.stackLevel = -1;
 
@@ -1030,7 +1040,9 @@ bool BW_MidiSequencer::processEvents(bool isSeek)
 
     m_loop.caughtEnd = false;
     const size_t        trackCount = m_currentPosition.track.size();
-    const Position      rowBeginPosition(m_currentPosition);
+    // Assignment reuses the pre-allocated track storage of the snapshot
+    m_rowBeginPosition = m_currentPosition;
+    const Position      &rowBeginPosition = m_rowBeginPosition;
     bool     doLoopJump = false;
     unsigned caughLoopStart = 0;
     unsigned caughLoopStackStart = 0;
@@ -1350,6 +1362,12 @@ BW_MidiSequencer::MidiEvent BW_MidiSequencer::parseEvent(const uint8_t **pptr, c
                 m_interface->onDebugMessage(m_interface->onDebugMessage_userData, "Instrument: %s", str.c_str());
             }
         }
+        else if(evt.subtype == MidiEvent::ST_DEVICESWITCH)
+        {
+            std::string str((const char *)evt.data.data(), evt.data.size());
+            if(std::find(m_musDeviceNames.begin(), m_musDeviceNames.end(), str) == m_musDeviceNames.end())
+                m_musDeviceNames.push_back(str);
+        }
         else if(evt.subtype == MidiEvent::ST_MARKER)
         {
             // To lower
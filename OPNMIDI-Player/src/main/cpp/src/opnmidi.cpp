@@ -24,6 +24,8 @@
 #include "opnmidi_midiplay.hpp"
 #include "opnmidi_opn2.hpp"
 #include "opnmidi_private.hpp"
+#include "opnmidi_render.hpp"
+#include "opnmidi_sample_cvt.hpp"
 #include "chips/opn_chip_base.h"
 #ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
 #include "midi_sequencer.hpp"
@@ -46,6 +48,20 @@ static const OPNMIDI_AudioFormat opn2_DefaultAudioFormat =
     2 * sizeof(int16_t),
 };
 
+static const OPNMIDI_AudioFormat opn2_F32AudioFormat =
+{
+    OPNMIDI_SampleType_F32,
+    sizeof(float),
+    2 * sizeof(float),
+};
+
+static const OPNMIDI_AudioFormat opn2_PlanarF32AudioFormat =
+{
+    OPNMIDI_SampleType_F32,
+    sizeof(float),
+    sizeof(float),
+};
+
 /*---------------------------EXPORTS---------------------------*/
 
 OPNMIDI_EXPORT struct OPN2_MIDIPlayer *opn2_init(long sample_rate)
@@ -121,6 +137,120 @@ OPNMIDI_EXPORT int opn2_getNumChipsObtained(struct OPN2_MIDIPlayer *device)
     return (int)play->m_synth->m_numChips;
 }
 
+OPNMIDI_EXPORT int opn2_setBlockSize(struct OPN2_MIDIPlayer *device, int frames)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(frames < 1 || frames > OPN_MAX_BLOCK_SIZE)
+    {
+        play->setErrorString("block size may only be 1.." OPN_MAX_BLOCK_SIZE_STR " frames.\n");
+        return -1;
+    }
+    MidiPlayer::Setup &setup = play->m_setup;
+    setup.blockSize = static_cast<unsigned int>(frames);
+    setup.maxdelay = static_cast<double>(setup.blockSize) / static_cast<double>(setup.PCM_RATE);
+    play->m_outBuf.resize(setup.blockSize * 2, 0);
+    play->m_outBufF32.resize(setup.blockSize * 2, 0.0f);
+    play->m_synth->setRenderBlockSize(setup.blockSize);
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_getBlockSize(struct OPN2_MIDIPlayer *device)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return (int)play->m_setup.blockSize;
+}
+
+OPNMIDI_EXPORT int opn2_setRenderThreads(struct OPN2_MIDIPlayer *device, int threads)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(threads < 0)
+    {
+        play->setErrorString("number of render threads can't be negative.\n");
+        return -1;
+    }
+    if(!play->m_synth->setRenderThreads(static_cast<unsigned>(threads)))
+    {
+        play->setErrorString("Can't start render threads.\n");
+        return -1;
+    }
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_getRenderThreads(struct OPN2_MIDIPlayer *device)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return (int)play->m_synth->renderThreads();
+}
+
+OPNMIDI_EXPORT int opn2_getRegisterWriteCounts(struct OPN2_MIDIPlayer *device, size_t *issued, size_t *dropped)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(issued)
+        *issued = static_cast<size_t>(play->m_synth->m_regWritesIssued);
+    if(dropped)
+        *dropped = static_cast<size_t>(play->m_synth->m_regWritesDropped);
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_setResamplerQuality(struct OPN2_MIDIPlayer *device, int quality)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(quality < OPNMIDI_Resampler_Linear || quality > OPNMIDI_Resampler_High)
+    {
+        play->setErrorString("Unknown resampler quality.\n");
+        return -1;
+    }
+    play->m_synth->setResamplerQuality(quality);
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_getResamplerQuality(struct OPN2_MIDIPlayer *device)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return play->m_synth->resamplerQuality();
+}
+
+OPNMIDI_EXPORT int opn2_setBusResampling(struct OPN2_MIDIPlayer *device, int enabled)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->m_synth->setBusResampling(enabled != 0);
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_setIdleSkipping(struct OPN2_MIDIPlayer *device, int enabled)
+{
+    if(device == NULL)
+        return -2;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->m_synth->setIdleSkipping(enabled != 0);
+    return 0;
+}
+
 
 OPNMIDI_EXPORT int opn2_reserveBanks(OPN2_MIDIPlayer *device, unsigned banks)
 {
@@ -399,6 +529,42 @@ OPNMIDI_EXPORT void opn2_setLoopEnabled(OPN2_MIDIPlayer *device, int loopEn)
 #endif
 }
 
+OPNMIDI_EXPORT void opn2_setSampleAccurate(OPN2_MIDIPlayer *device, int enabled)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->m_setup.sampleAccurate = (enabled != 0);
+}
+
+OPNMIDI_EXPORT int opn2_getSampleAccurate(OPN2_MIDIPlayer *device)
+{
+    if(!device)
+        return 0;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return play->m_setup.sampleAccurate ? 1 : 0;
+}
+
+OPNMIDI_EXPORT void opn2_setFloatMixBus(OPN2_MIDIPlayer *device, int enabled)
+{
+    if(!device)
+        return;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    play->m_setup.floatMixBus = (enabled != 0);
+}
+
+OPNMIDI_EXPORT int opn2_getFloatMixBus(OPN2_MIDIPlayer *device)
+{
+    if(!device)
+        return 0;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return play->m_setup.floatMixBus ? 1 : 0;
+}
+
 OPNMIDI_EXPORT void opn2_setSoftPanEnabled(OPN2_MIDIPlayer *device, int softPanEn)
 {
     if(!device)
@@ -534,7 +700,10 @@ OPNMIDI_EXPORT int opn2_switchEmulator(struct OPN2_MIDIPlayer *device, int emula
         if(opn2_isEmulatorAvailable(emulator))
         {
             play->m_setup.emulator = emulator;
-            play->partialReset();
+            // Running chips hand their registers over, otherwise start anew
+            play->m_synth->m_runAtPcmRate = play->m_setup.runAtPcmRate;
+            if(!play->m_synth->switchEmulator(emulator, play))
+                play->partialReset();
             return 0;
         }
         play->setErrorString("OPN2 MIDI: Unknown emulation core!");
@@ -543,6 +712,87 @@ OPNMIDI_EXPORT int opn2_switchEmulator(struct OPN2_MIDIPlayer *device, int emula
 }
 
 
+/* Leads the state snapshot, refuses the states of other emulators and chip counts */
+struct OpnStateHeader
+{
+    char magic[8];
+    uint32_t emulator;
+    uint32_t chips;
+    uint64_t size;
+};
+
+static const char opn2_stateMagic[8] = "OPNSTAT";
+
+OPNMIDI_EXPORT size_t opn2_stateSize(struct OPN2_MIDIPlayer *device)
+{
+    if(!device)
+        return 0;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    size_t size = play->m_synth->stateSize();
+    return (size > 0) ? (sizeof(OpnStateHeader) + size) : 0;
+}
+
+OPNMIDI_EXPORT int opn2_saveState(struct OPN2_MIDIPlayer *device, void *data, size_t size)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    Synth &synth = *play->m_synth;
+    const size_t synthSize = synth.stateSize();
+    if(synthSize == 0)
+    {
+        play->setErrorString("Chip emulator can't save its state.\n");
+        return -1;
+    }
+    if(!data || size < sizeof(OpnStateHeader) + synthSize)
+    {
+        play->setErrorString("State buffer is too small.\n");
+        return -1;
+    }
+    OpnStateHeader header;
+    std::memcpy(header.magic, opn2_stateMagic, sizeof(header.magic));
+    header.emulator = static_cast<uint32_t>(play->m_setup.emulator);
+    header.chips = static_cast<uint32_t>(synth.m_chips.size());
+    header.size = synthSize;
+    std::memcpy(data, &header, sizeof(OpnStateHeader));
+    synth.saveState(static_cast<uint8_t *>(data) + sizeof(OpnStateHeader));
+    return 0;
+}
+
+OPNMIDI_EXPORT int opn2_loadState(struct OPN2_MIDIPlayer *device, const void *data, size_t size)
+{
+    if(!device)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    Synth &synth = *play->m_synth;
+    OpnStateHeader header;
+    if(!data || size < sizeof(OpnStateHeader))
+    {
+        play->setErrorString("Invalid state data.\n");
+        return -1;
+    }
+    std::memcpy(&header, data, sizeof(OpnStateHeader));
+    if(std::memcmp(header.magic, opn2_stateMagic, sizeof(header.magic)) != 0 ||
+       size < sizeof(OpnStateHeader) + header.size)
+    {
+        play->setErrorString("Invalid state data.\n");
+        return -1;
+    }
+    if(header.emulator != static_cast<uint32_t>(play->m_setup.emulator) ||
+       header.chips != static_cast<uint32_t>(synth.m_chips.size()) ||
+       header.size != synth.stateSize() ||
+       !synth.loadState(static_cast<const uint8_t *>(data) + sizeof(OpnStateHeader)))
+    {
+        play->setErrorString("State was saved with another emulator or setup.\n");
+        return -1;
+    }
+    return 0;
+}
+
+
 OPNMIDI_EXPORT int opn2_setRunAtPcmRate(OPN2_MIDIPlayer *device, int enabled)
 {
     if(device)
@@ -902,6 +1152,15 @@ static void CopySamplesTransformed(OPN2_UInt8 *dstLeft, OPN2_UInt8 *dstRight, co
     }
 }
 
+/**
+ * @brief Is output a plain interleaved stereo stream that suits block converters
+ */
+static inline bool IsInterleaved(const OPN2_UInt8 *left, const OPN2_UInt8 *right,
+                                 unsigned containerSize, unsigned sampleOffset)
+{
+    return (right == left + containerSize) && (sampleOffset == 2 * containerSize);
+}
+
 static int SendStereoAudio(int         samples_requested,
                            ssize_t     in_size,
                            int32_t    *_in,
@@ -952,7 +1211,10 @@ static int SendStereoAudio(int         samples_requested,
         pfnConvert cvt = (sampleType == OPNMIDI_SampleType_S16) ? opn2_cvtS16 : opn2_cvtU16;
         switch(containerSize) {
         case sizeof(int16_t):
-            CopySamplesTransformed<int16_t>(left, right, _in, toCopy / 2, sampleOffset, cvt);
+            if(sampleType == OPNMIDI_SampleType_S16 && IsInterleaved(left, right, containerSize, sampleOffset))
+                opn2_cvtBlockS16((int16_t *)left, _in, (toCopy / 2) * 2);
+            else
+                CopySamplesTransformed<int16_t>(left, right, _in, toCopy / 2, sampleOffset, cvt);
             break;
         case sizeof(int32_t):
             CopySamplesRaw<int32_t>(left, right, _in, toCopy / 2, sampleOffset);
@@ -991,7 +1253,12 @@ static int SendStereoAudio(int         samples_requested,
     case OPNMIDI_SampleType_F32:
         if(containerSize != sizeof(float))
             return -1;
-        CopySamplesTransformed<float>(left, right, _in, toCopy / 2, sampleOffset, opn2_cvtReal<float>);
+        if(IsInterleaved(left, right, containerSize, sampleOffset))
+            opn2_cvtBlockF32((float *)left, _in, (toCopy / 2) * 2);
+        else if(sampleOffset == containerSize)
+            opn2_cvtBlockF32Planar((float *)left, (float *)right, _in, toCopy / 2);
+        else
+            CopySamplesTransformed<float>(left, right, _in, toCopy / 2, sampleOffset, opn2_cvtReal<float>);
         break;
     case OPNMIDI_SampleType_F64:
         if(containerSize != sizeof(double))
@@ -1005,6 +1272,62 @@ static int SendStereoAudio(int         samples_requested,
     return 0;
 }
 
+/**
+ * @brief Do chips mix right into the output of this format, skipping the integer bus
+ */
+static inline bool IsFloatBusFormat(const MidiPlayer *player, const OPNMIDI_AudioFormat *format)
+{
+    return player->m_setup.floatMixBus &&
+           (format->type == OPNMIDI_SampleType_F32) && (format->containerSize == sizeof(float));
+}
+
+/**
+ * @brief Buffer to mix the float output of chips into
+ *
+ * Interleaved output takes the mix in place, other layouts go through the player's buffer
+ */
+static float *FloatBusTarget(MidiPlayer *player, ssize_t out_pos,
+                             OPN2_UInt8 *left, OPN2_UInt8 *right,
+                             const OPNMIDI_AudioFormat *format)
+{
+    if(IsInterleaved(left, right, format->containerSize, format->sampleOffset))
+        return reinterpret_cast<float *>(left) + out_pos;
+    return &player->m_outBufF32[0];
+}
+
+static void SendStereoAudioF32(ssize_t     in_size,
+                               const float *_in,
+                               ssize_t     out_pos,
+                               OPN2_UInt8 *left,
+                               OPN2_UInt8 *right,
+                               const OPNMIDI_AudioFormat *format)
+{
+    const unsigned sampleOffset = format->sampleOffset;
+    if(IsInterleaved(left, right, format->containerSize, sampleOffset))
+        return; // Already mixed in place
+
+    const size_t frames = static_cast<size_t>(in_size);
+    left  += (static_cast<size_t>(out_pos) / 2) * sampleOffset;
+    right += (static_cast<size_t>(out_pos) / 2) * sampleOffset;
+
+    if(sampleOffset == sizeof(float))
+    {
+        float *l = reinterpret_cast<float *>(left);
+        float *r = reinterpret_cast<float *>(right);
+        for(size_t i = 0; i < frames; ++i)
+        {
+            l[i] = _in[2 * i];
+            r[i] = _in[2 * i + 1];
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < frames; ++i)
+    {
+        *reinterpret_cast<float *>(left + (i * sampleOffset)) = _in[2 * i];
+        *reinterpret_cast<float *>(right + (i * sampleOffset)) = _in[2 * i + 1];
+    }
+}
 
 OPNMIDI_EXPORT int opn2_play(struct OPN2_MIDIPlayer *device, int sampleCount, short *out)
 {
@@ -1037,6 +1360,7 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
 
     ssize_t gotten_len = 0;
     ssize_t n_periodCountStereo = 512;
+    const ssize_t blockSize = static_cast<ssize_t>(setup.blockSize);
     //ssize_t n_periodCountPhys = n_periodCountStereo * 2;
     int left = sampleCount;
     bool hasSkipped = setup.tick_skip_samples_delay > 0;
@@ -1044,6 +1368,9 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
     while(left > 0)
     {
         {//
+            if(!hasSkipped && (player->m_sequencer->positionAtEnd()) && (setup.delay <= 0.0))
+                break;//Stop to fetch samples at reaching the song end with disabled loop
+
             const double eat_delay = setup.delay < setup.maxdelay ? setup.delay : setup.maxdelay;
             if(hasSkipped)
             {
@@ -1062,9 +1389,6 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
             //    setup.SkipForward -= 1;
             //else
             {
-                if((player->m_sequencer->positionAtEnd()) && (setup.delay <= 0.0))
-                    break;//Stop to fetch samples at reaching the song end with disabled loop
-
                 ssize_t leftSamples = left / 2;
                 if(n_periodCountStereo > leftSamples)
                 {
@@ -1072,37 +1396,46 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
                     n_periodCountStereo = leftSamples;
                 }
                 //! Count of stereo samples
-                ssize_t in_generatedStereo = (n_periodCountStereo > 512) ? 512 : n_periodCountStereo;
+                ssize_t in_generatedStereo = (n_periodCountStereo > blockSize) ? blockSize : n_periodCountStereo;
                 //! Total count of samples
                 ssize_t in_generatedPhys = in_generatedStereo * 2;
                 //! Unsigned total sample count
-                //fill buffer with zeros
-                int32_t *out_buf = player->m_outBuf;
-                std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
-                Synth &synth = *player->m_synth;
-                unsigned int chips = synth.m_numChips;
-                if(chips == 1)
-                    synth.m_chips[0]->generate32(out_buf, (size_t)in_generatedStereo);
-                else/* if(n_periodCountStereo > 0)*/
+                if(IsFloatBusFormat(player, format))
                 {
+                    /* Chips mix their output right into the float buffer */
+                    float *out_buf = FloatBusTarget(player, gotten_len, out_left, out_right, format);
+                    std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
+                    player->m_synth->generateF32(out_buf, (size_t)in_generatedStereo);
+                    SendStereoAudioF32(in_generatedStereo, out_buf, gotten_len, out_left, out_right, format);
+                }
+                else
+                {
+                    //fill buffer with zeros
+                    int32_t *out_buf = &player->m_outBuf[0];
+                    std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
                     /* Generate data from every chip and mix result */
-                    for(size_t card = 0; card < chips; ++card)
-                        synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                    player->m_synth->generate32(out_buf, (size_t)in_generatedStereo);
+                    /* Process it */
+                    if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
+                        return 0;
                 }
-                /* Process it */
-                if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
-                    return 0;
 
                 left -= (int)in_generatedPhys;
                 gotten_len += (in_generatedPhys) /* - setup.stored_samples*/;
+
+                if(hasSkipped)
+                {
+                    // The block size may have cut the period, only the generated part is done
+                    setup.tick_skip_samples_delay -= in_generatedPhys;
+                    hasSkipped = setup.tick_skip_samples_delay > 0;
+                    if(!hasSkipped && setup.sampleAccurate) // The period is complete, process its events now
+                        setup.delay = player->Tick(setup.tick_skip_delay, setup.mindelay);
+                }
+                else if(setup.sampleAccurate && (setup.tick_skip_samples_delay > 0))
+                    setup.tick_skip_delay = eat_delay; // Process events once the rest of the period is generated
+                else
+                    setup.delay = player->Tick(eat_delay, setup.mindelay);
             }
-            if(hasSkipped)
-            {
-                setup.tick_skip_samples_delay -= n_periodCountStereo * 2;
-                hasSkipped = setup.tick_skip_samples_delay > 0;
-            }
-            else
-                setup.delay = player->Tick(eat_delay, setup.mindelay);
         }//
     }
 
@@ -1111,6 +1444,45 @@ OPNMIDI_EXPORT int opn2_playFormat(OPN2_MIDIPlayer *device, int sampleCount,
 }
 
 
+/**
+ * @brief Mix the output of all chips into the bus of the given sample type
+ */
+static inline void GenerateMix(Synth &synth, int32_t *out_buf, size_t frames)
+{
+    synth.generate32(out_buf, frames);
+}
+
+static inline void GenerateMix(Synth &synth, float *out_buf, size_t frames)
+{
+    synth.generateF32(out_buf, frames);
+}
+
+/**
+ * @brief Generate the block of frames, splitting it at frames of queued real-time events
+ * @param player MIDI player instance
+ * @param out_buf Zero-filled output buffer
+ * @param frames Count of frames to generate
+ * @param offset Frame offset of the block from the begin of the current chunk
+ */
+template <class Sample>
+static void GenerateWithQueuedEvents(MidiPlayer *player, Sample *out_buf, size_t frames, size_t offset)
+{
+    size_t done = 0;
+
+    while(done < frames)
+    {
+        const uint32_t frame = static_cast<uint32_t>(offset + done);
+        const uint32_t next = player->realTime_processQueue(frame);
+        size_t piece = frames - done;
+
+        if(static_cast<size_t>(next - frame) < piece)
+            piece = static_cast<size_t>(next - frame);
+
+        GenerateMix(*player->m_synth, out_buf + done * 2, piece);
+        done += piece;
+    }
+}
+
 OPNMIDI_EXPORT int opn2_generate(struct OPN2_MIDIPlayer *device, int sampleCount, short *out)
 {
     return opn2_generateFormat(device, sampleCount, (OPN2_UInt8 *)out, (OPN2_UInt8 *)(out + 1), &opn2_DefaultAudioFormat);
@@ -1132,10 +1504,13 @@ OPNMIDI_EXPORT int opn2_generateFormat(struct OPN2_MIDIPlayer *device, int sampl
 
     ssize_t gotten_len = 0;
     ssize_t n_periodCountStereo = 512;
+    const ssize_t blockSize = static_cast<ssize_t>(setup.blockSize);
 
     int     left = sampleCount;
     double  delay = double(sampleCount) / double(setup.PCM_RATE);
 
+    player->realTime_fetchQueue();
+
     while(left > 0)
     {
         {//
@@ -1150,26 +1525,29 @@ OPNMIDI_EXPORT int opn2_generateFormat(struct OPN2_MIDIPlayer *device, int sampl
                 if(n_periodCountStereo > leftSamples)
                     n_periodCountStereo = leftSamples;
                 //! Count of stereo samples
-                ssize_t in_generatedStereo = (n_periodCountStereo > 512) ? 512 : n_periodCountStereo;
+                ssize_t in_generatedStereo = (n_periodCountStereo > blockSize) ? blockSize : n_periodCountStereo;
                 //! Total count of samples
                 ssize_t in_generatedPhys = in_generatedStereo * 2;
                 //! Unsigned total sample count
-                //fill buffer with zeros
-                int32_t *out_buf = player->m_outBuf;
-                std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
-                Synth &synth = *player->m_synth;
-                unsigned int chips = synth.m_numChips;
-                if(chips == 1)
-                    synth.m_chips[0]->generate32(out_buf, (size_t)in_generatedStereo);
-                else/* if(n_periodCountStereo > 0)*/
+                if(IsFloatBusFormat(player, format))
                 {
-                    /* Generate data from every chip and mix result */
-                    for(size_t card = 0; card < chips; ++card)
-                        synth.m_chips[card]->generateAndMix32(out_buf, (size_t)in_generatedStereo);
+                    /* Chips mix their output right into the float buffer */
+                    float *out_buf = FloatBusTarget(player, gotten_len, out_left, out_right, format);
+                    std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
+                    GenerateWithQueuedEvents(player, out_buf, (size_t)in_generatedStereo, (size_t)(gotten_len / 2));
+                    SendStereoAudioF32(in_generatedStereo, out_buf, gotten_len, out_left, out_right, format);
+                }
+                else
+                {
+                    //fill buffer with zeros
+                    int32_t *out_buf = &player->m_outBuf[0];
+                    std::memset(out_buf, 0, static_cast<size_t>(in_generatedPhys) * sizeof(out_buf[0]));
+                    /* Generate data from every chip and mix result, apply queued real-time events in time */
+                    GenerateWithQueuedEvents(player, out_buf, (size_t)in_generatedStereo, (size_t)(gotten_len / 2));
+                    /* Process it */
+                    if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
+                        return 0;
                 }
-                /* Process it */
-                if(SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out_left, out_right, format) == -1)
-                    return 0;
 
                 left -= (int)in_generatedPhys;
                 gotten_len += (in_generatedPhys) /* - setup.stored_samples*/;
@@ -1179,9 +1557,250 @@ OPNMIDI_EXPORT int opn2_generateFormat(struct OPN2_MIDIPlayer *device, int sampl
         }//...
     }
 
+    player->realTime_advanceQueue(static_cast<uint32_t>(gotten_len / 2));
+
     return static_cast<int>(gotten_len);
 }
 
+OPNMIDI_EXPORT int opn2_playPlanar(struct OPN2_MIDIPlayer *device, int frameCount, float *left, float *right)
+{
+    if(frameCount <= 0)
+        return 0;
+    if(frameCount > INT_MAX / 2)
+        frameCount = INT_MAX / 2;
+    return opn2_playFormat(device, frameCount * 2, (OPN2_UInt8 *)left, (OPN2_UInt8 *)right, &opn2_PlanarF32AudioFormat) / 2;
+}
+
+OPNMIDI_EXPORT int opn2_generatePlanar(struct OPN2_MIDIPlayer *device, int frameCount, float *left, float *right)
+{
+    if(frameCount <= 0)
+        return 0;
+    if(frameCount > INT_MAX / 2)
+        frameCount = INT_MAX / 2;
+    return opn2_generateFormat(device, frameCount * 2, (OPN2_UInt8 *)left, (OPN2_UInt8 *)right, &opn2_PlanarF32AudioFormat) / 2;
+}
+
+OPNMIDI_EXPORT int opn2_playF32(struct OPN2_MIDIPlayer *device, int sampleCount, float *out)
+{
+    return opn2_playFormat(device, sampleCount, (OPN2_UInt8 *)out, (OPN2_UInt8 *)(out + 1), &opn2_F32AudioFormat);
+}
+
+OPNMIDI_EXPORT int opn2_generateF32(struct OPN2_MIDIPlayer *device, int sampleCount, float *out)
+{
+    return opn2_generateFormat(device, sampleCount, (OPN2_UInt8 *)out, (OPN2_UInt8 *)(out + 1), &opn2_F32AudioFormat);
+}
+
+#ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
+/**
+ * @brief Does SendStereoAudio() take this sample type in this container size
+ * @param format Sample format of the output
+ * @return true when the format can be rendered
+ */
+static bool IsRenderableFormat(const OPNMIDI_AudioFormat *format)
+{
+    const unsigned containerSize = format->containerSize;
+    switch(format->type) {
+    case OPNMIDI_SampleType_S8:
+    case OPNMIDI_SampleType_U8:
+        return containerSize == sizeof(int8_t) || containerSize == sizeof(int16_t) || containerSize == sizeof(int32_t);
+    case OPNMIDI_SampleType_S16:
+    case OPNMIDI_SampleType_U16:
+        return containerSize == sizeof(int16_t) || containerSize == sizeof(int32_t);
+    case OPNMIDI_SampleType_S24:
+    case OPNMIDI_SampleType_U24:
+    case OPNMIDI_SampleType_S32:
+    case OPNMIDI_SampleType_U32:
+        return containerSize == sizeof(int32_t);
+    case OPNMIDI_SampleType_F32:
+        return containerSize == sizeof(float);
+    case OPNMIDI_SampleType_F64:
+        return containerSize == sizeof(double);
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Render the music to the end and pass it to the sink through the writer thread
+ * @param device Instance of the library
+ * @param format Sample format of the output, samples are interleaved
+ * @param sink Receiver of the rendered data
+ * @param userData User data for the sink
+ * @param stats Rendering statistics output, can be NULL
+ * @return 0 on success, <0 when any error has occurred
+ */
+static int RenderStream(OPN2_MIDIPlayer *device, const OPNMIDI_AudioFormat *format,
+                        OpnRenderWriter::SinkProc sink, void *userData,
+                        OPNMIDI_RenderStats *stats)
+{
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    MidiSequencer &seq = *play->m_sequencer;
+
+    OPNMIDI_AudioFormat outFormat = *format;
+    outFormat.sampleOffset = 2 * outFormat.containerSize;
+
+    const size_t blockFrames = play->m_setup.blockSize;
+    const size_t blockBytes = blockFrames * outFormat.sampleOffset;
+    const int blockSamples = static_cast<int>(blockFrames * 2);
+
+    OpnRenderWriter writer;
+    if(!writer.start(sink, userData, blockBytes))
+    {
+        play->setErrorString("Can't start the writer thread.\n");
+        return -1;
+    }
+
+    const bool loopEnabled = seq.getLoopEnabled();
+    seq.setLoopEnabled(false);
+
+    size_t frames = 0;
+    const double begin = opn_monotonicTime();
+
+    for(;;)
+    {
+        uint8_t *block = writer.acquire();
+        if(!block)
+            break; // The sink has failed
+
+        int got = opn2_playFormat(device, blockSamples, block, block + outFormat.containerSize, &outFormat);
+        if(got <= 0)
+            break; // Reached the end of the song
+
+        writer.commit(static_cast<size_t>(got) * outFormat.containerSize);
+        frames += static_cast<size_t>(got / 2);
+
+        if(got < blockSamples && seq.positionAtEnd())
+            break;
+    }
+
+    bool ok = writer.finish();
+    const double elapsed = opn_monotonicTime() - begin;
+
+    seq.setLoopEnabled(loopEnabled);
+
+    if(stats)
+    {
+        stats->frames = frames;
+        stats->audioTime = static_cast<double>(frames) / static_cast<double>(play->m_setup.PCM_RATE);
+        stats->renderTime = elapsed;
+        stats->realTimeFactor = (elapsed > 0.0) ? (stats->audioTime / elapsed) : 0.0;
+    }
+
+    if(!ok)
+    {
+        play->setErrorString("Rendering was aborted by the output writer.\n");
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+OPNMIDI_EXPORT int opn2_renderToCallback(struct OPN2_MIDIPlayer *device, const OPNMIDI_AudioFormat *format,
+                                         OPN2_RenderCallback callback, void *userData, OPNMIDI_RenderStats *stats)
+{
+#ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
+    if(!device || !callback)
+        return -1;
+    if(!format)
+        format = &opn2_DefaultAudioFormat;
+    if(!IsRenderableFormat(format))
+    {
+        MidiPlayer *play = GET_MIDI_PLAYER(device);
+        assert(play);
+        play->setErrorString("Unsupported sample format.\n");
+        return -1;
+    }
+    return RenderStream(device, format, callback, userData, stats);
+#else
+    ADL_UNUSED(device);
+    ADL_UNUSED(format);
+    ADL_UNUSED(callback);
+    ADL_UNUSED(userData);
+    ADL_UNUSED(stats);
+    return -1;
+#endif
+}
+
+OPNMIDI_EXPORT int opn2_renderToFile(struct OPN2_MIDIPlayer *device, const char *filePath, int fileType,
+                                     const OPNMIDI_AudioFormat *format, OPNMIDI_RenderStats *stats)
+{
+#ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
+    if(!device || !filePath)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    if(!format)
+        format = &opn2_DefaultAudioFormat;
+
+    uint8_t header[OPN_WAV_HEADER_SIZE];
+    const bool isWav = (fileType == OPNMIDI_RenderFile_WAV);
+    if(!isWav && fileType != OPNMIDI_RenderFile_RAW)
+    {
+        play->setErrorString("Unknown output file type.\n");
+        return -1;
+    }
+    if(!IsRenderableFormat(format))
+    {
+        play->setErrorString("Unsupported sample format.\n");
+        return -1;
+    }
+    if(isWav && !opn2_makeWavHeader(header, format->type, format->containerSize, play->m_setup.PCM_RATE, 0))
+    {
+        play->setErrorString("This sample format can't be stored in the WAV file.\n");
+        return -1;
+    }
+
+    FILE *file = std::fopen(filePath, "wb");
+    if(!file)
+    {
+        play->setErrorString("Can't open the output file.\n");
+        return -1;
+    }
+
+    if(isWav && std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+    {
+        std::fclose(file);
+        play->setErrorString("Can't write the output file.\n");
+        return -1;
+    }
+
+    OPNMIDI_RenderStats localStats;
+    if(!stats)
+        stats = &localStats;
+
+    int ret = RenderStream(device, format, &OpnRenderWriter::fileSink, file, stats);
+
+    if(ret == 0 && isWav)
+    {
+        // Now the size of the data is known
+        const uint64_t dataSize = static_cast<uint64_t>(stats->frames) * 2 * format->containerSize;
+        opn2_makeWavHeader(header, format->type, format->containerSize, play->m_setup.PCM_RATE, dataSize);
+        if(std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+        {
+            play->setErrorString("Can't write the output file.\n");
+            ret = -1;
+        }
+    }
+
+    if(std::fclose(file) != 0 && ret == 0)
+    {
+        play->setErrorString("Can't write the output file.\n");
+        ret = -1;
+    }
+
+    return ret;
+#else
+    ADL_UNUSED(device);
+    ADL_UNUSED(filePath);
+    ADL_UNUSED(fileType);
+    ADL_UNUSED(format);
+    ADL_UNUSED(stats);
+    return -1;
+#endif
+}
+
 OPNMIDI_EXPORT double opn2_tickEvents(struct OPN2_MIDIPlayer *device, double seconds, double granuality)
 {
 #ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
@@ -1392,3 +2011,12 @@ OPNMIDI_EXPORT int opn2_rt_systemExclusive(struct OPN2_MIDIPlayer *device, const
     assert(play);
     return play->realTime_SysEx(msg, size);
 }
+
+OPNMIDI_EXPORT int opn2_rt_enqueue(struct OPN2_MIDIPlayer *device, unsigned frameOffset, const OPN2_UInt8 *bytes, size_t len)
+{
+    if(!device || !bytes || len == 0)
+        return -1;
+    MidiPlayer *play = GET_MIDI_PLAYER(device);
+    assert(play);
+    return play->realTime_enqueue(static_cast<uint32_t>(frameOffset), bytes, len) ? 0 : -1;
+}
@@ -194,9 +194,14 @@ bool OPNMIDIplay::LoadMIDI_post()
 
     m_setup.tick_skip_samples_delay = 0;
     synth.reset(m_setup.emulator, m_setup.PCM_RATE, synth.chipFamily(), this); // Reset OPN2 chip
-    m_chipChannels.clear();
-    m_chipChannels.resize(synth.m_numChannels);
+    resetChipChannels();
     resetMIDIDefaults();
+
+    // Register all devices and tracks before playback to avoid allocations on device switches
+    const std::vector<std::string> &devices = seq.getDeviceNames();
+    for(size_t i = 0; i < devices.size(); ++i)
+        chooseDevice(devices[i]);
+    m_currentMidiDevice.assign(seq.getTrackCount(), 0);
 #ifdef OPNMIDI_MIDI2VGM
     m_sequencerInterface->onloopStart = synth.m_loopStartHook;
     m_sequencerInterface->onloopStart_userData = synth.m_loopStartHookData;
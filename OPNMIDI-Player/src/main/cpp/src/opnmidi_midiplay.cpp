@@ -32,14 +32,20 @@ static const double drum_note_min_time = 0.03;
 
 enum { MasterVolumeDefault = 127 };
 
+// Time left of held notes which lets their chip channel win over idle channels:
+// up to 105 seconds of release and 40000 points are against 150000 points
+// of a sustained note 700 seconds after the end of its sounding
+static const int64_t aged_note_kon_us = -700000000;
+
 inline bool isXgPercChannel(uint8_t msb, uint8_t lsb)
 {
     return (msb == 0x7E || msb == 0x7F) && (lsb == 0);
 }
 
-void OPNMIDIplay::OpnChannel::addAge(int64_t us)
+bool OPNMIDIplay::OpnChannel::addAge(int64_t us)
 {
     const int64_t neg = 1000 * static_cast<int64_t>(-0x1FFFFFFFl);
+    bool aged = false;
     if(users.empty())
     {
         koff_time_until_neglible_us = std::max(koff_time_until_neglible_us - us, neg);
@@ -55,15 +61,30 @@ void OPNMIDIplay::OpnChannel::addAge(int64_t us)
             if(!d.fixed_sustain)
                 d.kon_time_until_neglible_us = std::max(d.kon_time_until_neglible_us - us, neg);
             d.vibdelay_us += us;
+            aged |= (d.kon_time_until_neglible_us < aged_note_kon_us);
         }
     }
+    return aged;
+}
+
+uint32_t OPNMIDIplay::OpnChannel::instrumentKey(const MIDIchannel::NoteInfo::Phys &ins)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(&ins.ains);
+    uint32_t key = 0, word;
+    for(size_t i = 0; i + 4 <= sizeof(opnInstData); i += 4)
+    {
+        std::memcpy(&word, data + i, 4);
+        key = ((key << 5) | (key >> 27)) ^ word;
+    }
+    return key;
 }
 
 OPNMIDIplay::OPNMIDIplay(unsigned long sampleRate) :
     m_sysExDeviceId(0),
     m_synthMode(Mode_XG),
+    m_chipChannelsAged(false),
     m_arpeggioCounter(0)
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
     , m_audioTickCounter(0)
 #endif
 {
@@ -74,7 +95,10 @@ OPNMIDIplay::OPNMIDIplay(unsigned long sampleRate) :
 
     m_setup.PCM_RATE = sampleRate;
     m_setup.mindelay = 1.0 / static_cast<double>(m_setup.PCM_RATE);
-    m_setup.maxdelay = 512.0 / static_cast<double>(m_setup.PCM_RATE);
+    m_setup.blockSize = OPN_DEFAULT_BLOCK_SIZE;
+    m_setup.maxdelay = static_cast<double>(m_setup.blockSize) / static_cast<double>(m_setup.PCM_RATE);
+    m_outBuf.resize(m_setup.blockSize * 2, 0);
+    m_outBufF32.resize(m_setup.blockSize * 2, 0.0f);
 
     m_setup.OpnBank    = 0;
     m_setup.numChips   = 2;
@@ -89,9 +113,19 @@ OPNMIDIplay::OPNMIDIplay(unsigned long sampleRate) :
     m_setup.delay = 0.0;
     m_setup.carry = 0.0;
     m_setup.tick_skip_samples_delay = 0;
+    m_setup.tick_skip_delay = 0.0;
+    m_setup.sampleAccurate = false;
+    m_setup.floatMixBus = false;
 
     m_synth.reset(new Synth);
 
+    caugh_missing_instruments.resize(256, false);
+    caugh_missing_banks_melodic.resize(0x10000, false);
+    caugh_missing_banks_percussion.resize(0x10000, false);
+
+    m_rtSchedule.resize(OPN_RT_QUEUE_SIZE);
+    m_rtScheduleCount = 0;
+
 #ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
     m_sequencer.reset(new MidiSequencer);
     initSequencerInterface();
@@ -144,8 +178,7 @@ void OPNMIDIplay::applySetup()
         chipType = m_setup.chipType;
 
     synth.reset(m_setup.emulator, m_setup.PCM_RATE, static_cast<OPNFamily>(chipType), this);
-    m_chipChannels.clear();
-    m_chipChannels.resize(synth.m_numChannels, OpnChannel());
+    resetChipChannels();
     resetMIDIDefaults();
 #ifdef OPNMIDI_MIDI2VGM
     m_sequencerInterface->onloopStart = synth.m_loopStartHook;
@@ -165,8 +198,7 @@ void OPNMIDIplay::partialReset()
     m_setup.tick_skip_samples_delay = 0;
     synth.m_runAtPcmRate = m_setup.runAtPcmRate;
     synth.reset(m_setup.emulator, m_setup.PCM_RATE, synth.chipFamily(), this);
-    m_chipChannels.clear();
-    m_chipChannels.resize(synth.m_numChannels);
+    resetChipChannels();
     resetMIDIDefaults();
 #ifdef OPNMIDI_MIDI2VGM
     m_sequencerInterface->onloopStart = synth.m_loopStartHook;
@@ -187,12 +219,23 @@ void OPNMIDIplay::resetMIDI()
 
     m_midiChannels.clear();
     m_midiChannels.resize(16, MIDIchannel());
+    m_midiDevices.clear();
+    m_currentMidiDevice.clear();
 
     resetMIDIDefaults();
 
-    caugh_missing_instruments.clear();
-    caugh_missing_banks_melodic.clear();
-    caugh_missing_banks_percussion.clear();
+    std::fill(caugh_missing_instruments.begin(), caugh_missing_instruments.end(), false);
+    std::fill(caugh_missing_banks_melodic.begin(), caugh_missing_banks_melodic.end(), false);
+    std::fill(caugh_missing_banks_percussion.begin(), caugh_missing_banks_percussion.end(), false);
+}
+
+void OPNMIDIplay::resetChipChannels()
+{
+    Synth &synth = *m_synth;
+    m_chipChannels.clear();
+    m_chipChannels.resize(synth.m_numChannels);
+    m_chipChannelsIdle.assign((synth.m_numChannels + 31) / 32, ~0u);
+    m_chipChannelsAged = false;
 }
 
 void OPNMIDIplay::resetMIDIDefaults(int offset)
@@ -217,11 +260,13 @@ void OPNMIDIplay::resetMIDIDefaults(int offset)
 void OPNMIDIplay::TickIterators(double s)
 {
     Synth &synth = *m_synth;
+    bool aged = false;
     for(uint32_t c = 0, n = synth.m_numChannels; c < n; ++c)
     {
         OpnChannel &ch = m_chipChannels[c];
-        ch.addAge(static_cast<int64_t>(s * 1e6));
+        aged |= ch.addAge(static_cast<int64_t>(s * 1e6));
     }
+    m_chipChannelsAged = aged;
 
     // Resolve "hell of all times" of too short drum notes
     for(size_t c = 0, n = m_midiChannels.size(); c < n; ++c)
@@ -254,7 +299,7 @@ void OPNMIDIplay::TickIterators(double s)
 
     updateVibrato(s);
     updateArpeggio(s);
-#if !defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER)
     updateGlide(s);
 #endif
 }
@@ -364,12 +409,16 @@ bool OPNMIDIplay::realTime_NoteOn(uint8_t channel, uint8_t note, uint8_t velocit
             ains = &bnk->ins[midiins];
         else if(hooks.onDebugMessage)
         {
-            std::set<size_t> &missing = (isPercussion) ?
-                                          caugh_missing_banks_percussion : caugh_missing_banks_melodic;
+            std::vector<bool> &missing = (isPercussion) ?
+                                           caugh_missing_banks_percussion : caugh_missing_banks_melodic;
             const char *text = (isPercussion) ?
                                "percussion" : "melodic";
-            if(missing.insert(bank).second)
+            std::vector<bool>::reference caught = missing[bank & 0xFFFF];
+            if(!caught)
+            {
+                caught = true;
                 hooks.onDebugMessage(hooks.onDebugMessage_userData, "[%i] Playing missing %s MIDI bank %i (patch %i)", channel, text, bank, midiins);
+            }
         }
     }
     //Or fall back to first bank
@@ -393,10 +442,10 @@ bool OPNMIDIplay::realTime_NoteOn(uint8_t channel, uint8_t note, uint8_t velocit
         {
             if(hooks.onDebugMessage)
             {
-                if(!caugh_missing_instruments.count(static_cast<uint8_t>(midiins)))
+                if(!caugh_missing_instruments[static_cast<uint8_t>(midiins)])
                 {
                     hooks.onDebugMessage(hooks.onDebugMessage_userData, "[%i] Caught a blank instrument %i (offset %i) in the MIDI bank %u", channel, midiChan.patch, midiins, bank);
-                    caugh_missing_instruments.insert(static_cast<uint8_t>(midiins));
+                    caugh_missing_instruments[static_cast<uint8_t>(midiins)] = true;
                 }
             }
             bank = 0;
@@ -426,10 +475,10 @@ bool OPNMIDIplay::realTime_NoteOn(uint8_t channel, uint8_t note, uint8_t velocit
 
     if(hooks.onDebugMessage)
     {
-        if(!caugh_missing_instruments.count(static_cast<uint8_t>(midiins)) && isBlankNote)
+        if(!caugh_missing_instruments[static_cast<uint8_t>(midiins)] && isBlankNote)
         {
             hooks.onDebugMessage(hooks.onDebugMessage_userData, "[%i] Playing missing instrument %i", channel, midiins);
-            caugh_missing_instruments.insert(static_cast<uint8_t>(midiins));
+            caugh_missing_instruments[static_cast<uint8_t>(midiins)] = true;
         }
     }
 
@@ -461,35 +510,10 @@ bool OPNMIDIplay::realTime_NoteOn(uint8_t channel, uint8_t note, uint8_t velocit
                 break; // No secondary if primary failed
         }
 
-        int32_t c = -1;
-        int32_t bs = -0x7FFFFFFFl;
-
-        for(size_t a = 0; a < static_cast<size_t>(synth.m_numChannels); ++a)
-        {
-            if(ccount == 1 && static_cast<int32_t>(a) == adlchannel[0]) continue;
-            // ^ Don't use the same channel for primary&secondary
-            // ===== Kept for future pseudo-8-op mode
-            //if(voices[0] == voices[1] || pseudo_4op)
-            //{
-            //    // Only use regular channels
-            //    uint8_t expected_mode = 0;
-            //    if(opn.AdlPercussionMode == 1)
-            //    {
-            //        if(cmf_percussion_mode)
-            //            expected_mode = MidCh < 11 ? 0 : (3 + MidCh - 11); // CMF
-            //        else
-            //            expected_mode = PercussionMap[midiins & 0xFF];
-            //    }
-            //    if(opn.four_op_category[a] != expected_mode)
-            //        continue;
-            //}
-            int64_t s = calculateChipChannelGoodness(a, voices[ccount]);
-            if(s > bs)
-            {
-                bs = static_cast<int32_t>(s);    // Best candidate wins
-                c = static_cast<int32_t>(a);
-            }
-        }
+        int32_t c = findChipChannel(voices[ccount], ccount == 1 ? adlchannel[0] : -1);
+#if defined(OPNMIDI_CHECK_CHANNEL_INDEX)
+        checkChipChannel(c, voices[ccount], ccount == 1 ? adlchannel[0] : -1);
+#endif
 
         if(c < 0)
         {
@@ -572,6 +596,7 @@ bool OPNMIDIplay::realTime_NoteOn(uint8_t channel, uint8_t note, uint8_t velocit
         if(c < 0)
             continue;
         m_chipChannels[c].recent_ins = voices[ccount];
+        m_chipChannels[c].recent_ins_key = OpnChannel::instrumentKey(voices[ccount]);
         m_chipChannels[c].addAge(0);
     }
 
@@ -1034,18 +1059,130 @@ void OPNMIDIplay::realTime_panic()
 
 void OPNMIDIplay::realTime_deviceSwitch(size_t track, const char *data, size_t length)
 {
-    const std::string indata(data, length);
-    m_currentMidiDevice[track] = chooseDevice(indata);
+    size_t device = ~static_cast<size_t>(0);
+
+    // Look for already known device without making a temporary string
+    for(std::map<std::string, size_t>::const_iterator i = m_midiDevices.begin(); i != m_midiDevices.end(); ++i)
+    {
+        if(i->first.size() == length && std::memcmp(i->first.data(), data, length) == 0)
+        {
+            device = i->second;
+            break;
+        }
+    }
+
+    if(device == ~static_cast<size_t>(0))
+        device = chooseDevice(std::string(data, length));
+
+    if(track >= m_currentMidiDevice.size())
+        m_currentMidiDevice.resize(track + 1, 0);
+    m_currentMidiDevice[track] = device;
 }
 
 size_t OPNMIDIplay::realTime_currentDevice(size_t track)
 {
-    if(m_currentMidiDevice.empty())
+    if(track >= m_currentMidiDevice.size())
         return 0;
     return m_currentMidiDevice[track];
 }
 
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+void OPNMIDIplay::realTime_rawEvent(const uint8_t *data, size_t size)
+{
+    if(size == 0 || (data[0] & 0x80) == 0)
+        return; // Running status is not supported
+
+    const uint8_t status = data[0] & 0xF0;
+    const uint8_t channel = data[0] & 0x0F;
+    const uint8_t d1 = (size > 1) ? data[1] : 0;
+    const uint8_t d2 = (size > 2) ? data[2] : 0;
+
+    switch(status)
+    {
+    case 0x80:
+        realTime_NoteOff(channel, d1);
+        break;
+    case 0x90:
+        realTime_NoteOn(channel, d1, d2);
+        break;
+    case 0xA0:
+        realTime_NoteAfterTouch(channel, d1, d2);
+        break;
+    case 0xB0:
+        realTime_Controller(channel, d1, d2);
+        break;
+    case 0xC0:
+        realTime_PatchChange(channel, d1);
+        break;
+    case 0xD0:
+        realTime_ChannelAfterTouch(channel, d1);
+        break;
+    case 0xE0:
+        realTime_PitchBend(channel, d2, d1);
+        break;
+    case 0xF0:
+        if(data[0] == 0xF0)
+            realTime_SysEx(data, size);
+        break;
+    }
+}
+
+bool OPNMIDIplay::realTime_enqueue(uint32_t frame, const uint8_t *data, size_t size)
+{
+    return m_rtQueue.push(frame, data, size);
+}
+
+void OPNMIDIplay::realTime_fetchQueue()
+{
+    OpnRtEventQueue::Event *schedule = &m_rtSchedule[0];
+
+    while(m_rtScheduleCount < m_rtSchedule.size())
+    {
+        OpnRtEventQueue::Event e;
+        if(!m_rtQueue.pop(e))
+            break;
+
+        // Insert keeping the order of messages which have the same frame
+        size_t i = m_rtScheduleCount;
+        while(i > 0 && schedule[i - 1].frame > e.frame)
+        {
+            schedule[i] = schedule[i - 1];
+            --i;
+        }
+        schedule[i] = e;
+        m_rtScheduleCount++;
+    }
+}
+
+uint32_t OPNMIDIplay::realTime_processQueue(uint32_t frame)
+{
+    const OpnRtEventQueue::Event *schedule = &m_rtSchedule[0];
+    size_t done = 0;
+
+    while(done < m_rtScheduleCount && schedule[done].frame <= frame)
+    {
+        realTime_rawEvent(schedule[done].data, schedule[done].size);
+        ++done;
+    }
+
+    if(done > 0)
+    {
+        m_rtScheduleCount -= done;
+        std::memmove(&m_rtSchedule[0], &m_rtSchedule[done], m_rtScheduleCount * sizeof(OpnRtEventQueue::Event));
+    }
+
+    return m_rtScheduleCount > 0 ? schedule[0].frame : ~static_cast<uint32_t>(0);
+}
+
+void OPNMIDIplay::realTime_advanceQueue(uint32_t frames)
+{
+    for(size_t i = 0; i < m_rtScheduleCount; ++i)
+    {
+        OpnRtEventQueue::Event &e = m_rtSchedule[i];
+        e.frame = (e.frame > frames) ? (e.frame - frames) : 0;
+    }
+}
+
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
 void OPNMIDIplay::AudioTick(uint32_t chipId, uint32_t rate)
 {
     if(chipId != 0)  // do first chip ticks only
@@ -1059,7 +1196,7 @@ void OPNMIDIplay::AudioTick(uint32_t chipId, uint32_t rate)
     if(tickNumber % portamentoInterval == 0)
     {
         double portamentoDelta = timeDelta * portamentoInterval;
-        UpdateGlide(portamentoDelta);
+        updateGlide(portamentoDelta);
     }
 }
 #endif
@@ -1132,6 +1269,7 @@ void OPNMIDIplay::noteUpdate(size_t midCh,
 
                 if(do_erase_user && m_chipChannels[c].users.empty())
                 {
+                    markChipChannelIdle(c);
                     synth.noteOff(c);
                     if(props_mask & Upd_Mute) // Mute the note
                     {
@@ -1207,7 +1345,7 @@ void OPNMIDIplay::noteUpdate(size_t midCh,
                 if(vibrato && (d.is_end() || d->value.vibdelay_us >= chan.vibdelay_us))
                     bend += static_cast<double>(vibrato) * chan.vibdepth * std::sin(chan.vibpos);
 
-                synth.noteOn(c, std::exp(0.057762265 * (currentTone + bend + phase)));
+                synth.noteOn(c, currentTone + bend + phase);
                 if(hooks.onNote)
                     hooks.onNote(hooks.onNote_userData, c, noteTone, static_cast<int>(midiins), vol, midibend);
             }
@@ -1317,6 +1455,103 @@ int64_t OPNMIDIplay::calculateChipChannelGoodness(size_t c, const MIDIchannel::N
 }
 
 
+int32_t OPNMIDIplay::findChipChannel(const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel)
+{
+    const size_t numChannels = static_cast<size_t>(m_synth->m_numChannels);
+    int32_t c = -1;
+    int32_t bs = -0x7FFFFFFFl;
+
+    // Idle channels are always better than busy ones, unless some note
+    // is held for ages, so the busy ones need no look while any is idle
+    if(!m_chipChannelsAged)
+    {
+        const bool cmf = m_synth->m_musicMode == Synth::MODE_CMF;
+        const uint32_t key = OpnChannel::instrumentKey(ins);
+        for(size_t w = 0; w < m_chipChannelsIdle.size(); ++w)
+        {
+            uint32_t bits = m_chipChannelsIdle[w];
+            for(size_t a = w * 32; bits != 0 && a < numChannels; ++a, bits >>= 1)
+            {
+                if((bits & 1) == 0)
+                    continue;
+                const OpnChannel &chan = m_chipChannels[a];
+                if(!chan.users.empty())
+                {
+                    m_chipChannelsIdle[w] &= ~(1u << (a % 32)); // Got busy since
+                    continue;
+                }
+                if(static_cast<int32_t>(a) == skip_channel)
+                    continue;
+                // Same as calculateChipChannelGoodness() gives for a channel without users
+                int64_t koff_ms = chan.koff_time_until_neglible_us / 1000;
+                int64_t s = -koff_ms;
+                if(s < 0)
+                {
+                    s -= 40000;
+                    if(chan.recent_ins_key == key && chan.recent_ins == ins)
+                        s = cmf ? 0 : -koff_ms;
+                }
+                if(s > bs)
+                {
+                    bs = static_cast<int32_t>(s);
+                    c = static_cast<int32_t>(a);
+                    if(bs == 0)
+                        return c; // No idle channel is better than a free one
+                }
+            }
+        }
+        if(c >= 0)
+            return c;
+    }
+
+    return scanChipChannels(ins, skip_channel);
+}
+
+int32_t OPNMIDIplay::scanChipChannels(const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel) const
+{
+    const size_t numChannels = static_cast<size_t>(m_synth->m_numChannels);
+    int32_t c = -1;
+    int32_t bs = -0x7FFFFFFFl;
+
+    for(size_t a = 0; a < numChannels; ++a)
+    {
+        if(static_cast<int32_t>(a) == skip_channel) continue;
+        // ^ Don't use the same channel for primary&secondary
+        // ===== Kept for future pseudo-8-op mode
+        //if(voices[0] == voices[1] || pseudo_4op)
+        //{
+        //    // Only use regular channels
+        //    uint8_t expected_mode = 0;
+        //    if(opn.AdlPercussionMode == 1)
+        //    {
+        //        if(cmf_percussion_mode)
+        //            expected_mode = MidCh < 11 ? 0 : (3 + MidCh - 11); // CMF
+        //        else
+        //            expected_mode = PercussionMap[midiins & 0xFF];
+        //    }
+        //    if(opn.four_op_category[a] != expected_mode)
+        //        continue;
+        //}
+        int64_t s = calculateChipChannelGoodness(a, ins);
+        if(s > bs)
+        {
+            bs = static_cast<int32_t>(s);    // Best candidate wins
+            c = static_cast<int32_t>(a);
+        }
+    }
+
+    return c;
+}
+
+#if defined(OPNMIDI_CHECK_CHANNEL_INDEX)
+void OPNMIDIplay::checkChipChannel(int32_t c, const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel) const
+{
+    if(hooks.onDebugMessage)
+        hooks.onDebugMessage(hooks.onDebugMessage_userData, "Chip channel check: picked %d, scan %d, aged %d",
+                             c, scanChipChannels(ins, skip_channel), m_chipChannelsAged ? 1 : 0);
+}
+#endif
+
 void OPNMIDIplay::prepareChipChannelForNewNote(size_t c, const MIDIchannel::NoteInfo::Phys &ins)
 {
     if(m_chipChannels[c].users.empty()) return; // Nothing to do
@@ -1421,6 +1656,8 @@ void OPNMIDIplay::killOrEvacuate(size_t from_channel,
             info.phys_ensure_find_or_create(cs)->assign(jd.ins);
             m_chipChannels[cs].users.push_back(jd);
             m_chipChannels[from_channel].users.erase(j);
+            if(m_chipChannels[from_channel].users.empty())
+                markChipChannelIdle(from_channel);
             return;
         }
     }
@@ -1484,7 +1721,10 @@ void OPNMIDIplay::killSustainingNotes(int32_t midCh, int32_t this_adlchn, uint32
 
         // Keyoff the channel, if there are no users left.
         if(m_chipChannels[c].users.empty())
+        {
+            markChipChannelIdle(c);
             synth.noteOff(c);
+        }
     }
 }
 
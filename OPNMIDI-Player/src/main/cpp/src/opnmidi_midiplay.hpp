@@ -27,6 +27,7 @@
 #include "opnbank.h"
 #include "opnmidi_private.hpp"
 #include "opnmidi_ptr.hpp"
+#include "opnmidi_rt_queue.hpp"
 #include "structures/pl_list.hpp"
 
 /**
@@ -66,6 +67,8 @@ public:
 
 private:
     void resetMIDIDefaults(int offset = 0);
+    //! Clears the chip channels, all of them become idle
+    void resetChipChannels();
 
 public:
     /**********************Internal structures and classes**********************/
@@ -444,6 +447,8 @@ public:
 
         //! Recently passed instrument, improves a goodness of released but busy channel when matching
         MIDIchannel::NoteInfo::Phys recent_ins;
+        //! Hash of the recent instrument, compared before the whole instrument
+        uint32_t recent_ins_key;
 
         pl_list<LocationData> users;
         typedef pl_list<LocationData>::iterator users_iterator;
@@ -467,27 +472,38 @@ public:
         }
 
         // For channel allocation:
-        OpnChannel(): koff_time_until_neglible_us(0), users(128)
+        OpnChannel(): koff_time_until_neglible_us(0), recent_ins_key(0), users(128)
         {
             std::memset(&recent_ins, 0, sizeof(MIDIchannel::NoteInfo::Phys));
         }
 
-        OpnChannel(const OpnChannel &oth): koff_time_until_neglible_us(oth.koff_time_until_neglible_us), users(oth.users)
+        OpnChannel(const OpnChannel &oth): koff_time_until_neglible_us(oth.koff_time_until_neglible_us),
+            recent_ins(oth.recent_ins), recent_ins_key(oth.recent_ins_key), users(oth.users)
         {
         }
 
         OpnChannel &operator=(const OpnChannel &oth)
         {
             koff_time_until_neglible_us = oth.koff_time_until_neglible_us;
+            recent_ins = oth.recent_ins;
+            recent_ins_key = oth.recent_ins_key;
             users = oth.users;
             return *this;
         }
 
+        /**
+         * @brief Hash of the instrument for recent_ins_key, zero for the zeroed instrument
+         * @param ins Instrument
+         * @return Hash value
+         */
+        static uint32_t instrumentKey(const MIDIchannel::NoteInfo::Phys &ins);
+
         /**
          * @brief Increases age of active note in microseconds time
          * @param us Amount time in microseconds
+         * @return true when a note is held so long that the channel may win over idle channels
          */
-        void addAge(int64_t us);
+        bool addAge(int64_t us);
     };
 
 #ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
@@ -530,8 +546,16 @@ public:
         double mindelay;
         double maxdelay;
 
+        //! Maximum count of stereo frames generated at once
+        unsigned int blockSize;
+        //! Process sequencer events at their exact frame even when the output chunk ends between them
+        bool    sampleAccurate;
+        //! Chips mix 32-bit float output right into the float buffer
+        bool    floatMixBus;
+
         /* For internal usage */
         ssize_t tick_skip_samples_delay; /* Skip tick processing after samples count. */
+        double  tick_skip_delay; /* Delay to tick after skipped samples are generated (sample-accurate mode) */
         /* For internal usage */
 
         unsigned long PCM_RATE;
@@ -575,15 +599,19 @@ public:
 private:
     //! Per-track MIDI devices map
     std::map<std::string, size_t> m_midiDevices;
-    //! Current MIDI device per track
-    std::map<size_t /*track*/, size_t /*channel begin index*/> m_currentMidiDevice;
+    //! Current MIDI device per track (channel begin index, indexed by track)
+    std::vector<size_t> m_currentMidiDevice;
 
     //! Chip channels map
     std::vector<OpnChannel> m_chipChannels;
+    //! Bits of chip channels which may have no users, every channel without users has its bit
+    std::vector<uint32_t> m_chipChannelsIdle;
+    //! Some note is held so long that a busy chip channel may win over idle ones
+    bool m_chipChannelsAged;
     //! Counter of arpeggio processing
     size_t m_arpeggioCounter;
 
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
     //! Audio tick counter
     uint32_t m_audioTickCounter;
 #endif
@@ -591,12 +619,23 @@ private:
     //! Local error string
     std::string errorStringOut;
 
-    //! Missing instruments catches
-    std::set<size_t> caugh_missing_instruments;
-    //! Missing melodic banks catches
-    std::set<size_t> caugh_missing_banks_melodic;
-    //! Missing percussion banks catches
-    std::set<size_t> caugh_missing_banks_percussion;
+    /*
+     * Missing instruments and banks catches. These are fixed-size bitmaps
+     * allocated once at construction to keep note-on free of heap allocations.
+     */
+    //! Missing instruments catches (indexed by the instrument number)
+    std::vector<bool> caugh_missing_instruments;
+    //! Missing melodic banks catches (indexed by the bank number)
+    std::vector<bool> caugh_missing_banks_melodic;
+    //! Missing percussion banks catches (indexed by the bank number)
+    std::vector<bool> caugh_missing_banks_percussion;
+
+    //! Lock-free queue of timestamped real-time MIDI messages
+    OpnRtEventQueue m_rtQueue;
+    //! Messages fetched from the queue, sorted by their frame offset
+    std::vector<OpnRtEventQueue::Event> m_rtSchedule;
+    //! Count of messages in the schedule
+    size_t m_rtScheduleCount;
 
 public:
 
@@ -606,8 +645,10 @@ public:
     //! OPN2 Chip manager
     AdlMIDI_UPtr<Synth> m_synth;
 
-    //! Generator output buffer
-    int32_t m_outBuf[1024];
+    //! Generator output buffer, holds the block of interleaved stereo frames
+    std::vector<int32_t> m_outBuf;
+    //! Float generator output buffer, used when the output layout can't take the mix in place
+    std::vector<float> m_outBufF32;
 
     //! Synthesizer setup
     Setup m_setup;
@@ -801,7 +842,41 @@ public:
      */
     size_t realTime_currentDevice(size_t track);
 
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+    /**
+     * @brief Process the raw MIDI message
+     * @param data Raw MIDI message which begins with the status byte
+     * @param size Size of the message
+     */
+    void realTime_rawEvent(const uint8_t *data, size_t size);
+
+    /**
+     * @brief Queue the raw MIDI message, can be called from any thread
+     * @param frame Offset in frames from the begin of the next generated chunk
+     * @param data Raw MIDI message which begins with the status byte
+     * @param size Size of the message
+     * @return true on success, false if the queue is full or message is too long
+     */
+    bool realTime_enqueue(uint32_t frame, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Move messages from the real-time queue into the schedule
+     */
+    void realTime_fetchQueue();
+
+    /**
+     * @brief Process all scheduled messages up to the given frame
+     * @param frame Frame offset from the begin of the current chunk
+     * @return Frame offset of the next scheduled message, or ~0 when schedule is empty
+     */
+    uint32_t realTime_processQueue(uint32_t frame);
+
+    /**
+     * @brief Shift frame offsets of scheduled messages after the chunk has been generated
+     * @param frames Count of generated frames
+     */
+    void realTime_advanceQueue(uint32_t frames);
+
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
     // Audio rate tick handler
     void AudioTick(uint32_t chipId, uint32_t rate);
 #endif
@@ -903,6 +978,41 @@ private:
      */
     int64_t calculateChipChannelGoodness(size_t c, const MIDIchannel::NoteInfo::Phys &ins) const;
 
+    /**
+     * @brief Finds the chip channel of the best goodness for playing a note from this instrument
+     * @param ins Instrument wanted to be used in the channel
+     * @param skip_channel Chip channel to leave out, or -1
+     * @return Index of the chip channel, or -1 when no channel can take the note
+     */
+    int32_t findChipChannel(const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel);
+
+    /**
+     * @brief Finds the chip channel like findChipChannel(), rating every channel by its goodness
+     * @param ins Instrument wanted to be used in the channel
+     * @param skip_channel Chip channel to leave out, or -1
+     * @return Index of the chip channel, or -1 when no channel can take the note
+     */
+    int32_t scanChipChannels(const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel) const;
+
+#if defined(OPNMIDI_CHECK_CHANNEL_INDEX)
+    /**
+     * @brief Reports the picked chip channel together with the one of the full scan to the debug hook
+     * @param c Chip channel picked by findChipChannel()
+     * @param ins Instrument wanted to be used in the channel
+     * @param skip_channel Chip channel to leave out, or -1
+     */
+    void checkChipChannel(int32_t c, const MIDIchannel::NoteInfo::Phys &ins, int32_t skip_channel) const;
+#endif
+
+    /**
+     * @brief Marks the chip channel which has just lost its last user
+     * @param c Chip channel
+     */
+    void markChipChannelIdle(size_t c)
+    {
+        m_chipChannelsIdle[c / 32] |= 1u << (c % 32);
+    }
+
     /**
      * @brief A new note will be played on this channel using this instrument.
      * @param c Wanted chip channel
@@ -23,6 +23,7 @@
 
 #include "opnmidi_opn2.hpp"
 #include "opnmidi_private.hpp"
+#include "opnmidi_volume.hpp"
 
 #if defined(OPNMIDI_DISABLE_NUKED_EMULATOR) && defined(OPNMIDI_DISABLE_MAME_EMULATOR) && \
     defined(OPNMIDI_DISABLE_GENS_EMULATOR) && defined(OPNMIDI_DISABLE_GX_EMULATOR) && \
@@ -34,6 +35,7 @@
 // Nuked OPN2 emulator, Most accurate, but requires the powerful CPU
 #ifndef OPNMIDI_DISABLE_NUKED_EMULATOR
 #include "chips/nuked_opn2.h"
+#include "chips/nuked_lockstep_opn2.h"
 #endif
 
 // MAME YM2612 emulator, Well-accurate and fast
@@ -74,6 +76,7 @@
 static const unsigned opn2_emulatorSupport = 0
 #ifndef OPNMIDI_DISABLE_NUKED_EMULATOR
     | (1u << OPNMIDI_EMU_NUKED)
+    | (1u << OPNMIDI_EMU_NUKED_LOCKSTEP)
 #endif
 #ifndef OPNMIDI_DISABLE_MAME_EMULATOR
     | (1u << OPNMIDI_EMU_MAME)
@@ -194,6 +197,17 @@ const opnInstMeta2 OPN2::m_emptyInstrument = makeEmptyInstrument();
 
 OPN2::OPN2() :
     m_regLFOSetup(0),
+    m_emulator(-1),
+    m_renderFrames(0),
+    m_renderBlockSize(OPN_DEFAULT_BLOCK_SIZE),
+#if defined(OPNMIDI_ENABLE_HQ_RESAMPLER)
+    m_resamplerQuality(OPNMIDI_Resampler_High),
+#else
+    m_resamplerQuality(OPNMIDI_Resampler_Linear),
+#endif
+    m_outputRate(44100),
+    m_busResampling(false),
+    m_idleSkipping(false),
     m_numChips(1),
     m_scaleModulators(false),
     m_runAtPcmRate(false),
@@ -203,7 +217,9 @@ OPN2::OPN2() :
     m_volumeScale(VOLUME_Generic),
     m_lfoEnable(false),
     m_lfoFrequency(0),
-    m_chipFamily(OPNChip_OPN2)
+    m_chipFamily(OPNChip_OPN2),
+    m_regWritesIssued(0),
+    m_regWritesDropped(0)
 {
     m_insBankSetup.volumeModel = OPN2::VOLUME_Generic;
     m_insBankSetup.lfoEnable = false;
@@ -226,18 +242,101 @@ bool OPN2::setupLocked()
             m_musicMode == MODE_RSXX);
 }
 
+/**
+ * @brief Whether a write of the held value into the register changes nothing
+ *
+ * True for operator parameters and panning/LFO sensitivity. Mode registers
+ * trigger actions on write, the high byte of frequency goes through a latch
+ * shared by channels, and fmgen based emulators clear the feedback on every
+ * write of the algorithm.
+ */
+static inline bool isPlainRegister(uint8_t index)
+{
+    return index >= 0x30 && (index < 0xA0 || (index >= 0xB4 && index < 0xB8));
+}
+
+/**
+ * @brief Whether the register is the latched high byte of a frequency
+ */
+static inline bool isFrequencyLatch(uint16_t index)
+{
+    return (index >= 0xA4 && index < 0xA7) || (index >= 0xAC && index < 0xAF);
+}
+
+inline bool OPN2::shadowHolds(size_t chip, uint8_t port, uint8_t index, uint8_t value) const
+{
+    const RegShadow &shadow = m_regShadow[chip];
+    return (shadow.known[port & 1][index >> 3] & (1 << (index & 7))) &&
+            shadow.regs[port & 1][index] == value;
+}
+
+inline bool OPN2::shadowWrite(size_t chip, uint8_t port, uint8_t index, uint8_t value)
+{
+    if(isPlainRegister(index) && shadowHolds(chip, port, index, value))
+    {
+        ++m_regWritesDropped;
+        return false;
+    }
+    RegShadow &shadow = m_regShadow[chip];
+    shadow.regs[port & 1][index] = value;
+    shadow.known[port & 1][index >> 3] |= static_cast<uint8_t>(1 << (index & 7));
+    if(port == 0 && index == 0x28)
+        shadow.keys[value & 7] = value & 0xF0;
+    ++m_regWritesIssued;
+    return true;
+}
+
 void OPN2::writeReg(size_t chip, uint8_t port, uint8_t index, uint8_t value)
 {
+    if(!shadowWrite(chip, port, index, value))
+        return;
+    m_chips[chip]->trackWrite(port, index, value);
     m_chips[chip]->writeReg(port, index, value);
 }
 
 void OPN2::writeRegI(size_t chip, uint8_t port, uint32_t index, uint32_t value)
 {
+    if(!shadowWrite(chip, port, static_cast<uint8_t>(index), static_cast<uint8_t>(value)))
+        return;
+    m_chips[chip]->trackWrite(port, static_cast<uint8_t>(index), static_cast<uint8_t>(value));
     m_chips[chip]->writeReg(port, static_cast<uint8_t>(index), static_cast<uint8_t>(value));
 }
 
+void OPN2::writeRegs(size_t chip, uint8_t port, const OPNRegPair *regs, size_t count)
+{
+    OPNChipBase *c = m_chips[chip].get();
+    OPNRegPair issued[32];
+    size_t n = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        const OPNRegPair &r = regs[i];
+        const uint8_t index = static_cast<uint8_t>(r.addr);
+        // A frequency followed by its low byte: drop both when neither changes
+        if(isFrequencyLatch(r.addr) && i + 1 < count && regs[i + 1].addr == r.addr - 4 &&
+           shadowHolds(chip, port, index, r.data) &&
+           shadowHolds(chip, port, static_cast<uint8_t>(regs[i + 1].addr), regs[i + 1].data))
+        {
+            m_regWritesDropped += 2;
+            ++i;
+            continue;
+        }
+        if(!shadowWrite(chip, port, index, r.data))
+            continue;
+        c->trackWrite(port, index, r.data);
+        issued[n++] = r;
+        if(n == sizeof(issued) / sizeof(OPNRegPair))
+        {
+            c->writeRegs(port, issued, n);
+            n = 0;
+        }
+    }
+    if(n > 0)
+        c->writeRegs(port, issued, n);
+}
+
 void OPN2::writePan(size_t chip, uint32_t index, uint32_t value)
 {
+    m_regShadow[chip].pans[index] = static_cast<uint8_t>(value);
     m_chips[chip]->writePan(static_cast<uint16_t>(index), static_cast<uint8_t>(value));
 }
 
@@ -251,48 +350,26 @@ void OPN2::noteOff(size_t c)
     writeRegI(chip, 0, 0x28, g_noteChannelsMap[ch4]);
 }
 
-void OPN2::noteOn(size_t c, double hertz) // Hertz range: 0..131071
+void OPN2::noteOn(size_t c, double tone)
 {
-    if(hertz < 0) // Avoid infinite loop
-        return;
-
-    double coef;
-    switch(m_chipFamily)
-    {
-    case OPNChip_OPN2: default:
-        coef = 321.88557; break;
-    case OPNChip_OPNA:
-        coef = 309.12412; break;
-    }
-    hertz *= coef;
-
     size_t      chip;
     uint8_t     port;
     uint32_t    cc;
     size_t      ch4 = c % 6;
     getOpnChannel(c, chip, port, cc);
 
-    uint32_t octave = 0, ftone = 0, mul_offset = 0;
     const opnInstData &adli = m_insCache[c];
 
-    //Basic range until max of octaves reaching
-    while((hertz >= 1023.75) && (octave < 0x3800))
-    {
-        hertz /= 2.0;    // Calculate octave
-        octave += 0x800;
-    }
-    //Extended range, rely on frequency multiplication increment
-    while(hertz >= 2036.75)
-    {
-        hertz /= 2.0;    // Calculate octave
-        mul_offset++;
-    }
-    ftone = octave + static_cast<uint32_t>(hertz + 0.5);
+    uint32_t ftone = m_toneTable.ftone(tone);
+
+    uint32_t mul_offset = ftone >> 14;
+    ftone &= 0x3FFF;
 
+    OPNRegPair regs[6];
     for(size_t op = 0; op < 4; op++)
     {
         uint32_t reg = adli.OPS[op].data[0];
-        uint16_t address = static_cast<uint16_t>(0x30 + (op * 4) + cc);
+        regs[op].addr = static_cast<uint16_t>(0x30 + (op * 4) + cc);
         if(mul_offset > 0) // Increase frequency multiplication value
         {
             uint32_t dt  = reg & 0xF0;
@@ -302,16 +379,19 @@ void OPN2::noteOn(size_t c, double hertz) // Hertz range: 0..131071
                 mul_offset = 0;
                 mul = 0x0F;
             }
-            writeRegI(chip, port, address, uint8_t(dt | (mul + mul_offset)));
+            regs[op].data = uint8_t(dt | (mul + mul_offset));
         }
         else
         {
-            writeRegI(chip, port, address, uint8_t(reg));
+            regs[op].data = uint8_t(reg);
         }
     }
 
-    writeRegI(chip, port, 0xA4 + cc, (ftone>>8) & 0xFF);//Set frequency and octave
-    writeRegI(chip, port, 0xA0 + cc, ftone & 0xFF);
+    regs[4].addr = static_cast<uint16_t>(0xA4 + cc);//Set frequency and octave
+    regs[4].data = (ftone>>8) & 0xFF;
+    regs[5].addr = static_cast<uint16_t>(0xA0 + cc);
+    regs[5].data = ftone & 0xFF;
+    writeRegs(chip, port, regs, 6);
     writeRegI(chip, 0, 0x28, 0xF0 + g_noteChannelsMap[ch4]);
 }
 
@@ -338,24 +418,6 @@ void OPN2::touchNote(size_t c,
         adli.OPS[OPERATOR4].data[1],
     };
 
-    bool alg_do[8][4] =
-    {
-        /*
-         * Yeah, Operator 2 and 3 are seems swapped
-         * which we can see in the algorithm 4
-         */
-        //OP1   OP3   OP2    OP4
-        //30    34    38     3C
-        {false,false,false,true},//Algorithm #0:  W = 1 * 2 * 3 * 4
-        {false,false,false,true},//Algorithm #1:  W = (1 + 2) * 3 * 4
-        {false,false,false,true},//Algorithm #2:  W = (1 + (2 * 3)) * 4
-        {false,false,false,true},//Algorithm #3:  W = ((1 * 2) + 3) * 4
-        {false,false,true, true},//Algorithm #4:  W = (1 * 2) + (3 * 4)
-        {false,true ,true ,true},//Algorithm #5:  W = (1 * (2 + 3 + 4)
-        {false,true ,true ,true},//Algorithm #6:  W = (1 * 2) + 3 + 4
-        {true ,true ,true ,true},//Algorithm #7:  W = 1 + 2 + 3 + 4
-    };
-
     switch(m_volumeScale)
     {
     default:
@@ -372,18 +434,8 @@ void OPN2::touchNote(size_t c,
              * increment sounds wrong. Therefore, using the square root.
              */
         //volume = (int)(volume * std::sqrt( (double) ch[c].users.size() ));
-        const double c1 = 11.541560327111707;
-        const double c2 = 1.601379199767093e+02;
-        const uint_fast32_t minVolume = 1108075; // 8725 * 127
-
-        // The formula below: SOLVE(V=127^4 * 2^( (A-63.49999) / 8), A)
-        if(volume > minVolume)
-        {
-            double lv = std::log(static_cast<double>(volume));
-            volume = static_cast<uint_fast32_t>(lv * c1 - c2) * 2.0;
-        }
-        else
-            volume = 0;
+        // The formula: SOLVE(V=127^4 * 2^( (A-63.49999) / 8), A), looked up by its steps
+        volume = opn2_genericVolumeLevel(volume);
     }
     break;
 
@@ -432,19 +484,22 @@ void OPN2::touchNote(size_t c,
         volume = 127;
 
     uint8_t alg = adli.fbalg & 0x07;
+    OPNRegPair regs[4];
     for(uint8_t op = 0; op < 4; op++)
     {
-        bool do_op = alg_do[alg][op] || m_scaleModulators;
+        bool do_op = opn2_isCarrier(alg, op) || m_scaleModulators;
         uint32_t x = op_vol[op];
         uint32_t vol_res = do_op ? (127 - (static_cast<uint32_t>(volume) * (127 - (x & 127))) / 127) : x;
         if(brightness != 127)
         {
-            brightness = static_cast<uint32_t>(::round(127.0 * ::sqrt((static_cast<double>(brightness)) * (1.0 / 127.0))));
+            brightness = opn2_brightnessCurve[brightness & 127];
             if(!do_op)
                 vol_res = (127 - (brightness * (127 - (static_cast<uint32_t>(vol_res) & 127))) / 127);
         }
-        writeRegI(chip, port, 0x40 + cc + (4 * op), vol_res);
+        regs[op].addr = static_cast<uint16_t>(0x40 + cc + (4 * op));
+        regs[op].data = static_cast<uint8_t>(vol_res);
     }
+    writeRegs(chip, port, regs, 4);
     // Correct formula (ST3, AdPlug):
     //   63-((63-(instrvol))/63)*chanvol
     // Reduces to (tested identical):
@@ -460,15 +515,23 @@ void OPN2::setPatch(size_t c, const opnInstData &instrument)
     uint32_t    cc;
     getOpnChannel(c, chip, port, cc);
     m_insCache[c] = instrument;
+    OPNRegPair regs[30];
+    size_t n = 0;
     for(uint8_t d = 0; d < 7; d++)
     {
-        for(uint8_t op = 0; op < 4; op++)
-            writeRegI(chip, port, 0x30 + (0x10 * d) + (op * 4) + cc, instrument.OPS[op].data[d]);
+        for(uint8_t op = 0; op < 4; op++, n++)
+        {
+            regs[n].addr = static_cast<uint16_t>(0x30 + (0x10 * d) + (op * 4) + cc);
+            regs[n].data = instrument.OPS[op].data[d];
+        }
     }
 
-    writeRegI(chip, port, 0xB0 + cc, instrument.fbalg);//Feedback/Algorithm
+    regs[n].addr = static_cast<uint16_t>(0xB0 + cc);//Feedback/Algorithm
+    regs[n++].data = instrument.fbalg;
     m_regLFOSens[c] = (m_regLFOSens[c] & 0xC0) | (instrument.lfosens & 0x3F);
-    writeRegI(chip, port, 0xB4 + cc, m_regLFOSens[c]);//Panorame and LFO bits
+    regs[n].addr = static_cast<uint16_t>(0xB4 + cc);//Panorame and LFO bits
+    regs[n++].data = m_regLFOSens[c];
+    writeRegs(chip, port, regs, n);
 }
 
 void OPN2::setPan(size_t c, uint8_t value)
@@ -568,9 +631,89 @@ void OPN2::clearChips()
     m_chips.clear();
 }
 
+OPNChipBase *OPN2::createChip(int emulator, size_t index, OPNFamily family, void *audioTickHandler)
+{
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER)
+    ADL_UNUSED(audioTickHandler);
+#endif
+    OPNChipBase *chip;
+
+    switch(emulator)
+    {
+    default:
+        assert(false);
+        abort();
+#ifndef OPNMIDI_DISABLE_MAME_EMULATOR
+    case OPNMIDI_EMU_MAME:
+        chip = new MameOPN2(family);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_NUKED_EMULATOR
+    case OPNMIDI_EMU_NUKED:
+        chip = new NukedOPN2(family);
+        break;
+    case OPNMIDI_EMU_NUKED_LOCKSTEP:
+        chip = new NukedLockstepOPN2(family,
+                                     index > 0 ? static_cast<NukedLockstepOPN2 *>(m_chips[index - 1].get()) : NULL,
+                                     m_chips.size() - index);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_GENS_EMULATOR
+    case OPNMIDI_EMU_GENS:
+        chip = new GensOPN2(family);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_GX_EMULATOR
+    case OPNMIDI_EMU_GX:
+        chip = new GXOPN2(family);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_NP2_EMULATOR
+    case OPNMIDI_EMU_NP2:
+        chip = new NP2OPNA<>(family);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_MAME_2608_EMULATOR
+    case OPNMIDI_EMU_MAME_2608:
+        chip = new MameOPNA(family);
+        break;
+#endif
+#ifndef OPNMIDI_DISABLE_PMDWIN_EMULATOR
+    case OPNMIDI_EMU_PMDWIN:
+        chip = new PMDWinOPNA(family);
+        break;
+#endif
+#ifdef OPNMIDI_MIDI2VGM
+    case OPNMIDI_VGM_DUMPER:
+        chip = new VGMFileDumper(family, static_cast<int>(index),
+                                 index > 0 ? static_cast<VGMFileDumper *>(m_chips[0].get()) : NULL);
+        if(index == 0)//Set hooks for first chip only
+        {
+            m_loopStartHook = &VGMFileDumper::loopStartHook;
+            m_loopStartHookData = chip;
+            m_loopEndHook  = &VGMFileDumper::loopEndHook;
+            m_loopEndHookData = chip;
+        }
+        break;
+#endif
+    }
+    chip->setChipId(static_cast<uint32_t>(index));
+    chip->setRate(m_outputRate, chip->nativeClockRate());
+    if(m_runAtPcmRate)
+        chip->setRunningAtPcmRate(true);
+    if(m_resamplerQuality != OPNMIDI_Resampler_Linear)
+        chip->setResamplerQuality(m_resamplerQuality);
+    if(m_idleSkipping)
+        chip->setIdleSkipping(true);
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
+    chip->setAudioTickHandlerInstance(audioTickHandler);
+#endif
+    return chip;
+}
+
 void OPN2::reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *audioTickHandler)
 {
-#if !defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER)
     ADL_UNUSED(audioTickHandler);
 #endif
     clearChips();
@@ -581,6 +724,7 @@ void OPN2::reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *a
         m_numChips = 2;// VGM Dumper can't work in multichip mode
 #endif
     m_chips.resize(m_numChips, AdlMIDI_SPtr<OPNChipBase>());
+    m_outputRate = static_cast<uint32_t>(PCM_RATE);
 
 #ifdef OPNMIDI_MIDI2VGM
     m_loopStartHook = NULL;
@@ -591,72 +735,22 @@ void OPN2::reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *a
 
     for(size_t i = 0; i < m_chips.size(); i++)
     {
-        OPNChipBase *chip;
-
-        switch(emulator)
-        {
-        default:
-            assert(false);
-            abort();
-#ifndef OPNMIDI_DISABLE_MAME_EMULATOR
-        case OPNMIDI_EMU_MAME:
-            chip = new MameOPN2(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_NUKED_EMULATOR
-        case OPNMIDI_EMU_NUKED:
-            chip = new NukedOPN2(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_GENS_EMULATOR
-        case OPNMIDI_EMU_GENS:
-            chip = new GensOPN2(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_GX_EMULATOR
-        case OPNMIDI_EMU_GX:
-            chip = new GXOPN2(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_NP2_EMULATOR
-        case OPNMIDI_EMU_NP2:
-            chip = new NP2OPNA<>(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_MAME_2608_EMULATOR
-        case OPNMIDI_EMU_MAME_2608:
-            chip = new MameOPNA(family);
-            break;
-#endif
-#ifndef OPNMIDI_DISABLE_PMDWIN_EMULATOR
-        case OPNMIDI_EMU_PMDWIN:
-            chip = new PMDWinOPNA(family);
-            break;
-#endif
-#ifdef OPNMIDI_MIDI2VGM
-        case OPNMIDI_VGM_DUMPER:
-            chip = new VGMFileDumper(family);
-            if(i == 0)//Set hooks for first chip only
-            {
-                m_loopStartHook = &VGMFileDumper::loopStartHook;
-                m_loopStartHookData = chip;
-                m_loopEndHook  = &VGMFileDumper::loopEndHook;
-                m_loopEndHookData = chip;
-            }
-            break;
-#endif
-        }
+        OPNChipBase *chip = createChip(emulator, i, family, audioTickHandler);
         m_chips[i].reset(chip);
-        chip->setChipId(static_cast<uint32_t>(i));
-        chip->setRate(static_cast<uint32_t>(PCM_RATE), chip->nativeClockRate());
-        if(m_runAtPcmRate)
-            chip->setRunningAtPcmRate(true);
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
-        chip->setAudioTickHandlerInstance(audioTickHandler);
-#endif
         family = chip->family();
     }
 
+    m_emulator = emulator;
+    m_regShadow.clear();
+    RegShadow shadow;
+    std::memset(&shadow, 0, sizeof(RegShadow));
+    std::memset(shadow.pans, 64, sizeof(shadow.pans));
+    m_regShadow.resize(m_chips.size(), shadow);
+    m_regWritesIssued = 0;
+    m_regWritesDropped = 0;
+
+    m_toneTable.build(family);
+
     m_chipFamily = family;
     m_numChannels = m_numChips * 6;
     m_insCache.resize(m_numChannels,   m_emptyInstrument.opn[0]);
@@ -680,13 +774,383 @@ void OPN2::reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *a
     }
 
     silenceAll();
+    setupBusResampler();
+    reserveRenderScratch();
 #ifdef OPNMIDI_MIDI2VGM
     if(m_loopStartHook) // Post-initialization Loop Start hook (fix for loop edge passing clicks)
         m_loopStartHook(m_loopStartHookData);
 #endif
 }
 
+bool OPN2::switchEmulator(int emulator, void *audioTickHandler)
+{
+    if(m_chips.empty() || m_regShadow.size() != m_chips.size())
+        return false;
+#ifdef OPNMIDI_MIDI2VGM
+    // The dumper records the music from the start, it can't join or leave in the middle
+    if(emulator == OPNMIDI_VGM_DUMPER || m_emulator == OPNMIDI_VGM_DUMPER)
+        return false;
+#endif
+
+    for(size_t i = 0; i < m_chips.size(); i++)
+        m_chips[i].reset(createChip(emulator, i, m_chipFamily, audioTickHandler));
+    m_emulator = emulator;
+
+    for(size_t i = 0; i < m_chips.size(); i++)
+        restoreRegisters(i);
+    // The new chips sound at once rather than after their write latency
+    for(size_t i = 0; i < m_chips.size(); i++)
+        m_chips[i]->preroll();
+
+    setupBusResampler();
+    reserveRenderScratch();
+    return true;
+}
+
+void OPN2::restoreRegisters(size_t chip)
+{
+    // A copy, the writes below go through the shadow too
+    const RegShadow shadow = m_regShadow[chip];
+    // The new chip holds none of the values yet
+    std::memset(m_regShadow[chip].known, 0, sizeof(shadow.known));
+
+    writeReg(chip, 0, 0x22, shadow.regs[0][0x22]);
+    writeReg(chip, 0, 0x27, shadow.regs[0][0x27] & 0xC0); // Channel 3 mode, timers stay off
+    writeReg(chip, 0, 0x2B, shadow.regs[0][0x2B]);
+    if(shadow.regs[0][0x2B] & 0x80)
+        writeReg(chip, 0, 0x2A, shadow.regs[0][0x2A]);
+
+    for(uint8_t port = 0; port < 2; ++port)
+    {
+        const uint8_t *regs = shadow.regs[port];
+        for(uint32_t addr = 0x30; addr < 0xA0; ++addr)
+        {
+            if((addr & 3) != 3)
+                writeRegI(chip, port, addr, regs[addr]);
+        }
+        for(uint32_t cc = 0; cc < 3; ++cc)
+        {
+            // The high byte of frequency is latched until the low one is written
+            writeRegI(chip, port, 0xA4 + cc, regs[0xA4 + cc]);
+            writeRegI(chip, port, 0xA0 + cc, regs[0xA0 + cc]);
+            if(port == 0) // Frequencies of channel 3 operators in its special mode
+            {
+                writeRegI(chip, port, 0xAC + cc, regs[0xAC + cc]);
+                writeRegI(chip, port, 0xA8 + cc, regs[0xA8 + cc]);
+            }
+            writeRegI(chip, port, 0xB0 + cc, regs[0xB0 + cc]);
+            writeRegI(chip, port, 0xB4 + cc, regs[0xB4 + cc]);
+        }
+    }
+
+    for(uint32_t ch = 0; ch < 6; ++ch)
+        writePan(chip, ch, shadow.pans[ch]);
+
+    for(uint8_t n = 0; n < 8; ++n)
+    {
+        if((n & 3) != 3 && shadow.keys[n] != 0)
+            writeReg(chip, 0, 0x28, shadow.keys[n] | n);
+    }
+}
+
 OPNFamily OPN2::chipFamily() const
 {
     return m_chipFamily;
 }
+
+bool OPN2::setRenderThreads(unsigned threads)
+{
+    if(threads > OPN_MAX_CHIPS)
+        threads = OPN_MAX_CHIPS;
+    bool ret = m_renderPool.setThreads(threads);
+    reserveRenderScratch();
+    return ret;
+}
+
+unsigned OPN2::renderThreads() const
+{
+    return m_renderPool.threads();
+}
+
+void OPN2::setRenderBlockSize(size_t frames)
+{
+    m_renderBlockSize = frames;
+    reserveRenderScratch();
+}
+
+void OPN2::setResamplerQuality(int quality)
+{
+    m_resamplerQuality = quality;
+    for(size_t i = 0; i < m_chips.size(); ++i)
+        m_chips[i]->setResamplerQuality(quality);
+    setupBusResampler();
+}
+
+int OPN2::resamplerQuality() const
+{
+    return m_resamplerQuality;
+}
+
+void OPN2::setBusResampling(bool enabled)
+{
+    m_busResampling = enabled;
+    setupBusResampler();
+    reserveRenderScratch();
+}
+
+void OPN2::setIdleSkipping(bool enabled)
+{
+    m_idleSkipping = enabled;
+    for(size_t i = 0; i < m_chips.size(); ++i)
+        m_chips[i]->setIdleSkipping(enabled);
+}
+
+void OPN2::setupBusResampler()
+{
+    if(!m_busResampling || m_chips.empty())
+        return;
+    const OPNChipBase *chip = m_chips[0].get();
+    m_busResampler.setup(OPNChipResampler::nativeStep(chip->clockRate(), m_outputRate, m_resamplerQuality),
+                         m_resamplerQuality, chip->nativeGain(), OPN_BUS_BLOCK_SIZE);
+    m_busNatives.resize(m_busResampler.maxInputFrames() * 2);
+}
+
+void OPN2::reserveRenderScratch()
+{
+    const size_t chips = m_chips.size();
+    for(size_t i = 0; i < chips; ++i)
+        m_chips[i]->reserveBlock(m_renderBlockSize);
+    size_t samples = chips * m_renderBlockSize * 2;
+    if(m_busResampling && !m_busNatives.empty())
+        samples = std::max(samples, chips * m_busNatives.size());
+    if(chips > 1 && m_renderPool.threads() > 1 && m_renderScratch.size() < samples)
+        m_renderScratch.resize(samples);
+    if(chips > 1 && m_renderPool.threads() > 1 && m_renderScratchF32.size() < chips * m_renderBlockSize * 2)
+        m_renderScratchF32.resize(chips * m_renderBlockSize * 2);
+}
+
+void OPN2::generate32(int32_t *output, size_t frames)
+{
+    const size_t chips = m_chips.size();
+
+    if(m_busResampling && !m_chips[0]->isRunningAtPcmRate())
+    {
+        generateBus(output, frames);
+        return;
+    }
+
+    if(chips == 1)
+    {
+        m_chips[0]->generate32(output, frames);
+        return;
+    }
+
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER) // Tick handler is not thread-safe
+    if(m_renderPool.threads() > 1)
+    {
+        const size_t samples = frames * 2;
+        if(m_renderScratch.size() < chips * samples)
+            m_renderScratch.resize(chips * samples);
+
+        m_renderFrames = frames;
+        m_renderPool.run(&renderChipJob, this, chips);
+
+        // Sum in the chip order to keep the result identical to the serial mixing
+        const int32_t *scratch = &m_renderScratch[0];
+        for(size_t card = 0; card < chips; ++card)
+        {
+            for(size_t i = 0; i < samples; ++i)
+                output[i] += scratch[i];
+            scratch += samples;
+        }
+        return;
+    }
+#endif
+
+    for(size_t card = 0; card < chips; ++card)
+        m_chips[card]->generateAndMix32(output, frames);
+}
+
+void OPN2::generateF32(float *output, size_t frames)
+{
+    const size_t chips = m_chips.size();
+
+    if(m_busResampling && !m_chips[0]->isRunningAtPcmRate())
+    {
+        generateBus(output, frames);
+        return;
+    }
+
+    if(chips == 1)
+    {
+        m_chips[0]->generateF32(output, frames);
+        return;
+    }
+
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER) // Tick handler is not thread-safe
+    if(m_renderPool.threads() > 1)
+    {
+        const size_t samples = frames * 2;
+        if(m_renderScratchF32.size() < chips * samples)
+            m_renderScratchF32.resize(chips * samples);
+
+        m_renderFrames = frames;
+        m_renderPool.run(&renderChipJobF32, this, chips);
+
+        // Sum in the chip order to keep the result identical to the serial mixing
+        const float *scratch = &m_renderScratchF32[0];
+        for(size_t card = 0; card < chips; ++card)
+        {
+            for(size_t i = 0; i < samples; ++i)
+                output[i] += scratch[i];
+            scratch += samples;
+        }
+        return;
+    }
+#endif
+
+    for(size_t card = 0; card < chips; ++card)
+        m_chips[card]->generateAndMixF32(output, frames);
+}
+
+static inline void processBus(OPNChipResampler &resampler, int32_t *output, size_t frames)
+{
+    resampler.process(output, frames);
+}
+
+static inline void processBus(OPNChipResampler &resampler, float *output, size_t frames)
+{
+    resampler.process(output, frames, OPN_CHIP_FLOAT_SCALE);
+}
+
+template <class Sample>
+void OPN2::generateBus(Sample *output, size_t frames)
+{
+    const size_t chips = m_chips.size();
+    int32_t *bus = &m_busNatives[0];
+
+    while(frames > 0)
+    {
+        size_t count = (frames < (size_t)OPN_BUS_BLOCK_SIZE) ? frames : (size_t)OPN_BUS_BLOCK_SIZE;
+        size_t natives = m_busResampler.inputFrames(count);
+        if(natives > 0)
+        {
+            const size_t samples = natives * 2;
+#if !defined(OPNMIDI_AUDIO_TICK_HANDLER) // Tick handler is not thread-safe
+            if(chips > 1 && m_renderPool.threads() > 1)
+            {
+                if(m_renderScratch.size() < chips * samples)
+                    m_renderScratch.resize(chips * samples);
+
+                m_renderFrames = natives;
+                m_renderPool.run(&renderNativeJob, this, chips);
+
+                const int32_t *scratch = &m_renderScratch[0];
+                std::memcpy(bus, scratch, samples * sizeof(int32_t));
+                for(size_t card = 1; card < chips; ++card)
+                {
+                    scratch += samples;
+                    for(size_t i = 0; i < samples; ++i)
+                        bus[i] += scratch[i];
+                }
+            }
+            else
+#endif
+            {
+                std::memset(bus, 0, samples * sizeof(int32_t));
+                for(size_t card = 0; card < chips; ++card)
+                    m_chips[card]->generateNativeAndMix32(bus, natives);
+            }
+            m_busResampler.feed(bus, natives);
+        }
+        processBus(m_busResampler, output, count);
+        output += 2 * count;
+        frames -= count;
+    }
+}
+
+size_t OPN2::stateSize() const
+{
+    if(m_chips.empty())
+        return 0;
+    const size_t chipSize = m_chips[0]->stateSize();
+    if(chipSize == 0)
+        return 0;
+    size_t size = m_chips.size() * chipSize;
+    size += m_numChannels * (sizeof(opnInstData) + sizeof(uint8_t)) + sizeof(uint8_t);
+    size += m_regShadow.size() * sizeof(RegShadow);
+    if(m_busResampling && !m_busNatives.empty())
+        size += m_busResampler.stateSize();
+    return size;
+}
+
+void OPN2::saveState(void *state) const
+{
+    uint8_t *out = static_cast<uint8_t *>(state);
+    const size_t chipSize = m_chips[0]->stateSize();
+    for(size_t i = 0; i < m_chips.size(); ++i)
+    {
+        m_chips[i]->saveState(out);
+        out += chipSize;
+    }
+    std::memcpy(out, &m_insCache[0], m_numChannels * sizeof(opnInstData));
+    out += m_numChannels * sizeof(opnInstData);
+    std::memcpy(out, &m_regLFOSens[0], m_numChannels);
+    out += m_numChannels;
+    *out++ = m_regLFOSetup;
+    std::memcpy(out, &m_regShadow[0], m_regShadow.size() * sizeof(RegShadow));
+    out += m_regShadow.size() * sizeof(RegShadow);
+    if(m_busResampling && !m_busNatives.empty())
+        m_busResampler.saveState(out);
+}
+
+bool OPN2::loadState(const void *state)
+{
+    const uint8_t *in = static_cast<const uint8_t *>(state);
+    const size_t chipSize = m_chips[0]->stateSize();
+    // Check all chips first, a state taken by some of them only would mix up the song
+    for(size_t i = 0; i < m_chips.size(); ++i)
+    {
+        if(m_chips[i]->stateSize() != chipSize || !m_chips[i]->checkState(in + i * chipSize))
+            return false;
+    }
+    for(size_t i = 0; i < m_chips.size(); ++i)
+    {
+        if(!m_chips[i]->loadState(in))
+            return false;
+        in += chipSize;
+    }
+    std::memcpy(&m_insCache[0], in, m_numChannels * sizeof(opnInstData));
+    in += m_numChannels * sizeof(opnInstData);
+    std::memcpy(&m_regLFOSens[0], in, m_numChannels);
+    in += m_numChannels;
+    m_regLFOSetup = *in++;
+    std::memcpy(&m_regShadow[0], in, m_regShadow.size() * sizeof(RegShadow));
+    in += m_regShadow.size() * sizeof(RegShadow);
+    if(m_busResampling && !m_busNatives.empty())
+        m_busResampler.loadState(in);
+    return true;
+}
+
+void OPN2::renderNativeJob(void *self, size_t chip)
+{
+    OPN2 *synth = reinterpret_cast<OPN2 *>(self);
+    const size_t samples = synth->m_renderFrames * 2;
+    int32_t *scratch = &synth->m_renderScratch[chip * samples];
+    std::memset(scratch, 0, samples * sizeof(int32_t));
+    synth->m_chips[chip]->generateNativeAndMix32(scratch, synth->m_renderFrames);
+}
+
+void OPN2::renderChipJob(void *self, size_t chip)
+{
+    OPN2 *synth = reinterpret_cast<OPN2 *>(self);
+    const size_t samples = synth->m_renderFrames * 2;
+    synth->m_chips[chip]->generate32(&synth->m_renderScratch[chip * samples], synth->m_renderFrames);
+}
+
+void OPN2::renderChipJobF32(void *self, size_t chip)
+{
+    OPN2 *synth = reinterpret_cast<OPN2 *>(self);
+    const size_t samples = synth->m_renderFrames * 2;
+    synth->m_chips[chip]->generateF32(&synth->m_renderScratchF32[chip * samples], synth->m_renderFrames);
+}
@@ -28,7 +28,10 @@
 #include "opnmidi_ptr.hpp"
 #include "opnmidi_private.hpp"
 #include "opnmidi_bankmap.h"
+#include "opnmidi_threads.hpp"
+#include "opnmidi_tone.hpp"
 #include "chips/opn_chip_family.h"
+#include "chips/opn_chip_resampler.h"
 
 /**
  * @brief OPN2 Chip management class
@@ -62,6 +65,46 @@ private:
     std::vector<uint8_t>        m_regLFOSens;
     //! LFO setup registry cache
     uint8_t                     m_regLFOSetup;
+    /**
+     * @brief Last values written into the registers of one chip
+     */
+    struct RegShadow
+    {
+        //! Registers of both ports
+        uint8_t regs[2][256];
+        //! Operator key-on bits written into 0x28 for every channel number
+        uint8_t keys[8];
+        //! Soft panning of every channel
+        uint8_t pans[6];
+        //! Bits of the registers which hold the shadowed value since the chip was created
+        uint8_t known[2][32];
+    };
+    //! Register shadows of every chip, used to migrate into chips of another emulator
+    std::vector<RegShadow>      m_regShadow;
+    //! Type of running chip emulators
+    int                         m_emulator;
+    //! Worker threads of the parallel chip rendering
+    OpnWorkerPool               m_renderPool;
+    //! Per-chip output buffers of the parallel chip rendering
+    std::vector<int32_t>        m_renderScratch;
+    //! Per-chip float output buffers of the parallel chip rendering
+    std::vector<float>          m_renderScratchF32;
+    //! Count of frames to render by every chip in the current parallel job
+    size_t                      m_renderFrames;
+    //! Maximum count of frames per one generate32() call
+    size_t                      m_renderBlockSize;
+    //! Resampling method of chip outputs (OPNMIDI_ResamplerQuality)
+    int                         m_resamplerQuality;
+    //! Output sample rate of chips
+    uint32_t                    m_outputRate;
+    //! Resample the sum of all chips at once instead of every chip separately
+    bool                        m_busResampling;
+    //! Resampler of the summed native output of all chips
+    OPNChipResampler            m_busResampler;
+    //! Native rate frames of the chip bus
+    std::vector<int32_t>        m_busNatives;
+    //! Let silent chips stop clocking
+    bool                        m_idleSkipping;
 
 public:
     /**
@@ -142,6 +185,14 @@ public:
     //! Chip family
     OPNFamily m_chipFamily;
 
+    //! Block, F-number and multiplier offset of tones, for the chip family
+    OpnToneTable m_toneTable;
+
+    //! Count of register writes passed to the chips since the last reset
+    uint64_t m_regWritesIssued;
+    //! Count of register writes dropped since the last reset, as they repeated the held value
+    uint64_t m_regWritesDropped;
+
     /**
      * @brief C.O. Constructor
      */
@@ -176,6 +227,15 @@ public:
      */
     void writeRegI(size_t chip, uint8_t port, uint32_t index, uint32_t value);
 
+    /**
+     * @brief Write a batch of registers of one port of OPN2 chip
+     * @param chip Index of emulated chip
+     * @param port Port of the chip to write
+     * @param regs Addresses and values to write, in order
+     * @param count Count of register writes
+     */
+    void writeRegs(size_t chip, uint8_t port, const OPNRegPair *regs, size_t count);
+
     /**
      * @brief Write to soft panning control of OPN2 chip emulator
      * @param chip Index of emulated chip.
@@ -191,11 +251,11 @@ public:
     void noteOff(size_t c);
 
     /**
-     * @brief On the note in specified chip channel with specified frequency of the tone
+     * @brief On the note in specified chip channel with specified tone
      * @param c Channel of chip (Emulated chip choosing by next formula: [c = ch + (chipId * 23)])
-     * @param hertz Frequency of the tone in hertzes
+     * @param tone MIDI tone in semitones, fractional with the pitch bend
      */
-    void noteOn(size_t c, double hertz);
+    void noteOn(size_t c, double tone);
 
     /**
      * @brief Change setup of instrument in specified chip channel
@@ -257,11 +317,170 @@ public:
      */
     void reset(int emulator, unsigned long PCM_RATE, OPNFamily family, void *audioTickHandler);
 
+    /**
+     * @brief Replace running chips with chips of another emulator, keeping their registers
+     *
+     * Fresh chips get the shadowed register state replayed, so the held notes
+     * keep sounding, though their envelopes start over.
+     *
+     * @param emulator Type of chip emulator
+     * @param audioTickHandler PCM-accurate clock hook
+     * @return false when chips can't be switched on the fly and reset() is required
+     */
+    bool switchEmulator(int emulator, void *audioTickHandler);
+
     /**
      * @brief Gets the family of current chips
      * @return the chip family
      */
     OPNFamily chipFamily() const;
+
+    /**
+     * @brief Set the count of threads used to render chips in parallel
+     * @param threads Total count of threads, 1 or less disables parallel rendering
+     * @return true on success, false if worker threads can't be started
+     */
+    bool setRenderThreads(unsigned threads);
+
+    /**
+     * @brief Get the count of threads used to render chips
+     * @return Total count of rendering threads
+     */
+    unsigned renderThreads() const;
+
+    /**
+     * @brief Set the maximum count of frames per one generate32() call
+     * @param frames Count of stereo frames, used to pre-allocate the render buffers
+     */
+    void setRenderBlockSize(size_t frames);
+
+    /**
+     * @brief Set the resampling method of chip outputs, applied to running chips immediately
+     * @param quality Resampling method (OPNMIDI_ResamplerQuality)
+     */
+    void setResamplerQuality(int quality);
+
+    /**
+     * @brief Get the resampling method of chip outputs
+     * @return Resampling method (OPNMIDI_ResamplerQuality)
+     */
+    int resamplerQuality() const;
+
+    /**
+     * @brief Resample the sum of all chips at once instead of every chip separately
+     * @param enabled Chips render at the native rate into a common bus when enabled
+     */
+    void setBusResampling(bool enabled);
+
+    /**
+     * @brief Let chips which went silent stop clocking until the next key-on
+     * @param enabled Idle chips are skipped when enabled, applied to running chips immediately
+     */
+    void setIdleSkipping(bool enabled);
+
+    /**
+     * @brief Generate and mix output of all running chips
+     * @param output Zero-filled stereo output buffer
+     * @param frames Count of stereo frames to generate
+     */
+    void generate32(int32_t *output, size_t frames);
+
+    /**
+     * @brief Generate and mix output of all running chips into the float bus
+     * @param output Zero-filled stereo output buffer, 1.0 stands for the 16-bit full scale
+     * @param frames Count of stereo frames to generate
+     */
+    void generateF32(float *output, size_t frames);
+
+    /**
+     * @brief Get the size of the state snapshot of all running chips
+     * @return Size in bytes, 0 when the chip emulator can't save its state
+     */
+    size_t stateSize() const;
+
+    /**
+     * @brief Save the state of all running chips together with the register caches
+     * @param state Output buffer of stateSize() bytes
+     */
+    void saveState(void *state) const;
+
+    /**
+     * @brief Restore the state saved from chips of the same emulator and setup
+     * @param state State of stateSize() bytes, saved by saveState()
+     * @return false when the state was saved with another rate or setup
+     */
+    bool loadState(const void *state);
+
+private:
+    /**
+     * @brief Create a chip emulator set up for the current rate and resampling
+     * @param emulator Type of chip emulator
+     * @param index Index of the chip
+     * @param family Family of the chip
+     * @param audioTickHandler PCM-accurate clock hook
+     * @return New chip instance
+     */
+    OPNChipBase *createChip(int emulator, size_t index, OPNFamily family, void *audioTickHandler);
+
+    /**
+     * @brief Check the register holds the value by the last write into it
+     */
+    bool shadowHolds(size_t chip, uint8_t port, uint8_t index, uint8_t value) const;
+
+    /**
+     * @brief Remember the register write for the migration between emulators
+     *
+     * Dropping is output-neutral for the emulators whose writes are queued by
+     * time stamp; only the Nuked cores, which pace the writes by cycles, hear
+     * the later writes land earlier.
+     * @return false when the write repeats the held value and must be dropped
+     */
+    bool shadowWrite(size_t chip, uint8_t port, uint8_t index, uint8_t value);
+
+    /**
+     * @brief Write the shadowed register state into the chip
+     * @param chip Index of emulated chip
+     */
+    void restoreRegisters(size_t chip);
+
+    /**
+     * @brief Pre-allocate scratch buffers of the parallel rendering for the current setup
+     */
+    void reserveRenderScratch();
+
+    /**
+     * @brief Set up the bus resampler for the current chips and output rate
+     */
+    void setupBusResampler();
+
+    /**
+     * @brief Generate all chips at the native rate and resample their sum
+     * @param output Stereo output buffer
+     * @param frames Count of stereo frames to generate
+     */
+    template <class Sample>
+    void generateBus(Sample *output, size_t frames);
+
+    /**
+     * @brief Parallel rendering job: generate one chip into its own scratch buffer
+     * @param self Pointer to the OPN2 instance
+     * @param chip Index of chip to render
+     */
+    static void renderChipJob(void *self, size_t chip);
+
+    /**
+     * @brief Parallel rendering job: generate one chip into its own float scratch buffer
+     * @param self Pointer to the OPN2 instance
+     * @param chip Index of chip to render
+     */
+    static void renderChipJobF32(void *self, size_t chip);
+
+    /**
+     * @brief Parallel rendering job: generate native frames of one chip into its own scratch buffer
+     * @param self Pointer to the OPN2 instance
+     * @param chip Index of chip to render
+     */
+    static void renderNativeJob(void *self, size_t chip);
 };
 
 /**
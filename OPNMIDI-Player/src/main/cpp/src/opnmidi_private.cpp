@@ -29,7 +29,7 @@ std::string OPN2MIDI_ErrorString;
 
 // Generator callback on audio rate ticks
 
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
 void opn2_audioTickHandler(void *instance, uint32_t chipId, uint32_t rate)
 {
     reinterpret_cast<OPNMIDIplay *>(instance)->AudioTick(chipId, rate);
@@ -67,6 +67,7 @@ typedef int32_t ssize_t;
 #include <set>
 #include <new> // nothrow
 #include <cstdlib>
+#include <climits>
 #include <cstring>
 #include <cmath>
 #include <cstdarg>
@@ -121,6 +122,7 @@ typedef struct BW_MidiRtInterface BW_MidiRtInterface;
 
 class OPN2;
 class OPNChipBase;
+struct OPNRegPair;
 
 typedef class OPN2 Synth;
 
@@ -138,6 +140,12 @@ class MIDIplay;
 #define OPN_MAX_CHIPS 100
 #define OPN_MAX_CHIPS_STR "100"
 
+#define OPN_DEFAULT_BLOCK_SIZE 512
+#define OPN_MAX_BLOCK_SIZE 65536
+#define OPN_MAX_BLOCK_SIZE_STR "65536"
+// Count of output frames resampled at once from the summed chip bus
+#define OPN_BUS_BLOCK_SIZE 256
+
 extern std::string OPN2MIDI_ErrorString;
 
 /*
@@ -185,7 +193,7 @@ inline int32_t opn2_cvtU32(int32_t x)
     return (uint32_t)opn2_cvtS32(x) - (uint32_t)INT32_MIN;
 }
 
-#if defined(ADLMIDI_AUDIO_TICK_HANDLER)
+#if defined(OPNMIDI_AUDIO_TICK_HANDLER)
 extern void opn2_audioTickHandler(void *instance, uint32_t chipId, uint32_t rate);
 #endif
 
@@ -0,0 +1,209 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_render.hpp"
+#include "opnmidi.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+
+/* OpnRenderWriter */
+
+OpnRenderWriter::OpnRenderWriter() :
+    m_sink(NULL),
+    m_sinkData(NULL),
+    m_blockSize(0),
+    m_head(0),
+    m_tail(0),
+    m_filled(0),
+    m_finishing(false),
+    m_failed(false)
+{
+    for(size_t i = 0; i < OPN_RENDER_RING_BLOCKS; ++i)
+        m_sizes[i] = 0;
+}
+
+OpnRenderWriter::~OpnRenderWriter()
+{
+    finish();
+}
+
+bool OpnRenderWriter::start(SinkProc sink, void *userData, size_t blockSize)
+{
+    assert(!m_thread.running());
+    m_sink = sink;
+    m_sinkData = userData;
+    m_blockSize = blockSize;
+    m_buffer.resize(blockSize * OPN_RENDER_RING_BLOCKS);
+    m_head = 0;
+    m_tail = 0;
+    m_filled = 0;
+    m_finishing = false;
+    m_failed = false;
+    return m_thread.start(&writerEntry, this);
+}
+
+uint8_t *OpnRenderWriter::acquire()
+{
+    OpnMutexLocker lock(m_mutex);
+    while(m_filled == OPN_RENDER_RING_BLOCKS && !m_failed)
+        m_freeCond.wait(m_mutex);
+    if(m_failed)
+        return NULL;
+    return &m_buffer[m_head * m_blockSize];
+}
+
+void OpnRenderWriter::commit(size_t size)
+{
+    assert(size <= m_blockSize);
+    OpnMutexLocker lock(m_mutex);
+    m_sizes[m_head] = size;
+    m_head = (m_head + 1) % OPN_RENDER_RING_BLOCKS;
+    m_filled++;
+    m_filledCond.signal();
+}
+
+bool OpnRenderWriter::finish()
+{
+    if(!m_thread.running())
+        return !m_failed;
+    {
+        OpnMutexLocker lock(m_mutex);
+        m_finishing = true;
+        m_filledCond.signal();
+    }
+    m_thread.join();
+    return !m_failed;
+}
+
+int OpnRenderWriter::fileSink(void *file, const uint8_t *data, size_t size)
+{
+    FILE *f = reinterpret_cast<FILE *>(file);
+    return (std::fwrite(data, 1, size, f) == size) ? 0 : -1;
+}
+
+void OpnRenderWriter::writerEntry(void *self)
+{
+    reinterpret_cast<OpnRenderWriter *>(self)->writerLoop();
+}
+
+void OpnRenderWriter::writerLoop()
+{
+    OpnMutexLocker lock(m_mutex);
+
+    for(;;)
+    {
+        while(m_filled == 0 && !m_finishing)
+            m_filledCond.wait(m_mutex);
+        if(m_filled == 0)
+            break; // All blocks are written
+
+        const uint8_t *block = &m_buffer[m_tail * m_blockSize];
+        const size_t size = m_sizes[m_tail];
+
+        // Write without holding the lock to let the renderer fill other blocks meanwhile
+        m_mutex.unlock();
+        bool ok = (m_sink(m_sinkData, block, size) >= 0);
+        m_mutex.lock();
+
+        m_tail = (m_tail + 1) % OPN_RENDER_RING_BLOCKS;
+        m_filled--;
+        if(!ok)
+        {
+            m_failed = true;
+            m_filled = 0;
+            m_freeCond.signal();
+            break;
+        }
+        m_freeCond.signal();
+    }
+}
+
+
+/* WAV file header */
+
+static void writeLE(uint8_t *out, uint32_t value, unsigned bytes)
+{
+    for(unsigned i = 0; i < bytes; ++i)
+        out[i] = static_cast<uint8_t>((value >> (i * 8)) & 0xFF);
+}
+
+bool opn2_makeWavHeader(uint8_t *header, int sampleType, unsigned containerSize,
+                        unsigned long rate, uint64_t dataSize)
+{
+    unsigned formatTag;
+    unsigned bits = containerSize * 8;
+
+    switch(sampleType)
+    {
+    case OPNMIDI_SampleType_U8:
+        formatTag = 1; // PCM
+        if(containerSize != 1)
+            return false;
+        break;
+    case OPNMIDI_SampleType_S16:
+        formatTag = 1;
+        if(containerSize != 2)
+            return false;
+        break;
+    case OPNMIDI_SampleType_S32:
+        formatTag = 1;
+        if(containerSize != 4)
+            return false;
+        break;
+    case OPNMIDI_SampleType_F32:
+        formatTag = 3; // IEEE float
+        if(containerSize != 4)
+            return false;
+        break;
+    case OPNMIDI_SampleType_F64:
+        formatTag = 3;
+        if(containerSize != 8)
+            return false;
+        break;
+    default:
+        return false; // Not representable by the canonical WAV header
+    }
+
+    // Sizes of files over 4 GiB can't be represented, readers usually accept the maximum value
+    const uint64_t maxData = 0xFFFFFFFFu - (OPN_WAV_HEADER_SIZE - 8);
+    const uint32_t data = static_cast<uint32_t>(dataSize > maxData ? maxData : dataSize);
+    const unsigned channels = 2;
+
+    std::memcpy(header + 0, "RIFF", 4);
+    writeLE(header + 4, data + (OPN_WAV_HEADER_SIZE - 8), 4);
+    std::memcpy(header + 8, "WAVE", 4);
+    std::memcpy(header + 12, "fmt ", 4);
+    writeLE(header + 16, 16, 4);
+    writeLE(header + 20, formatTag, 2);
+    writeLE(header + 22, channels, 2);
+    writeLE(header + 24, static_cast<uint32_t>(rate), 4);
+    writeLE(header + 28, static_cast<uint32_t>(rate * channels * containerSize), 4);
+    writeLE(header + 32, channels * containerSize, 2);
+    writeLE(header + 34, bits, 2);
+    std::memcpy(header + 36, "data", 4);
+    writeLE(header + 40, data, 4);
+
+    return true;
+}
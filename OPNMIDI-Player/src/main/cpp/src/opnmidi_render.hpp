@@ -0,0 +1,130 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_RENDER_HPP
+#define OPNMIDI_RENDER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "opnmidi_threads.hpp"
+
+//! Count of blocks in the ring buffer between the renderer and the writer thread
+#define OPN_RENDER_RING_BLOCKS 8
+
+/**
+ * @brief Ring buffer of rendered blocks drained by a separate writer thread
+ *
+ * The rendering thread fills free blocks taken by acquire() and passes them
+ * by commit(), while the writer thread hands them to the sink in the same order.
+ */
+class OpnRenderWriter
+{
+public:
+    /**
+     * @brief Receiver of rendered data, called by the writer thread
+     * @param userData User data passed into start()
+     * @param data Rendered data
+     * @param size Size of data in bytes
+     * @return 0 on success, <0 to stop rendering
+     */
+    typedef int (*SinkProc)(void *userData, const uint8_t *data, size_t size);
+
+    OpnRenderWriter();
+    ~OpnRenderWriter();
+
+    /**
+     * @brief Allocate the ring buffer and start the writer thread
+     * @param sink Receiver of rendered data
+     * @param userData User data for the receiver
+     * @param blockSize Maximum size of one block in bytes
+     * @return true on success
+     */
+    bool start(SinkProc sink, void *userData, size_t blockSize);
+
+    /**
+     * @brief Wait for a free block
+     * @return Pointer to the block to fill, or NULL when the sink has failed
+     */
+    uint8_t *acquire();
+
+    /**
+     * @brief Pass the block taken by acquire() to the writer thread
+     * @param size Count of bytes filled in the block
+     */
+    void commit(size_t size);
+
+    /**
+     * @brief Wait for all committed blocks are written and stop the writer thread
+     * @return true if all data has been accepted by the sink
+     */
+    bool finish();
+
+    /**
+     * @brief Sink which writes data into the stdio file
+     * @param file Pointer to the FILE
+     */
+    static int fileSink(void *file, const uint8_t *data, size_t size);
+
+private:
+    static void writerEntry(void *self);
+    void writerLoop();
+
+    SinkProc            m_sink;
+    void               *m_sinkData;
+    std::vector<uint8_t> m_buffer;
+    size_t              m_sizes[OPN_RENDER_RING_BLOCKS];
+    size_t              m_blockSize;
+    //! Index of the next block to fill
+    size_t              m_head;
+    //! Index of the next block to write
+    size_t              m_tail;
+    //! Count of committed and not yet written blocks
+    size_t              m_filled;
+    bool                m_finishing;
+    bool                m_failed;
+    OpnMutex            m_mutex;
+    OpnCondition        m_filledCond;
+    OpnCondition        m_freeCond;
+    OpnThread           m_thread;
+
+    OpnRenderWriter(const OpnRenderWriter &);
+    OpnRenderWriter &operator=(const OpnRenderWriter &);
+};
+
+//! Size of the canonical WAV file header
+#define OPN_WAV_HEADER_SIZE 44
+
+/**
+ * @brief Make the WAV file header
+ * @param [_out] header Output buffer of OPN_WAV_HEADER_SIZE bytes
+ * @param sampleType Type of samples (OPNMIDI_SampleType)
+ * @param containerSize Size of one sample in bytes
+ * @param rate Sample rate
+ * @param dataSize Size of the sample data in bytes
+ * @return false if given sample format can't be stored in WAV
+ */
+extern bool opn2_makeWavHeader(uint8_t *header, int sampleType, unsigned containerSize,
+                               unsigned long rate, uint64_t dataSize);
+
+#endif // OPNMIDI_RENDER_HPP
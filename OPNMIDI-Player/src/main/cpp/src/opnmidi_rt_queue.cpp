@@ -0,0 +1,96 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_rt_queue.hpp"
+#include "opnmidi_threads.hpp"
+#include <cstring>
+
+/*
+ * Bounded queue with per-slot sequence counters: a producer claims the slot
+ * by advancing the push position with CAS, fills it, and then publishes it
+ * by the sequence update. The consumer reads only published slots.
+ */
+
+OpnRtEventQueue::OpnRtEventQueue() :
+    m_slots(OPN_RT_QUEUE_SIZE),
+    m_pushPos(0),
+    m_popPos(0)
+{
+    for(size_t i = 0; i < m_slots.size(); ++i)
+    {
+        m_slots[i].sequence = static_cast<long>(i);
+        std::memset(&m_slots[i].event, 0, sizeof(Event));
+    }
+}
+
+bool OpnRtEventQueue::push(uint32_t frame, const uint8_t *data, size_t size)
+{
+    const unsigned long mask = OPN_RT_QUEUE_SIZE - 1;
+
+    if(size > OPN_RT_EVENT_MAX_SIZE)
+        return false;
+
+    unsigned long pos = static_cast<unsigned long>(opn_atomicLoad(&m_pushPos));
+    Slot *slot;
+
+    for(;;)
+    {
+        slot = &m_slots[pos & mask];
+        unsigned long seq = static_cast<unsigned long>(opn_atomicLoad(&slot->sequence));
+        long diff = static_cast<long>(seq - pos);
+
+        if(diff == 0)
+        {
+            if(opn_atomicCompareSwap(&m_pushPos, static_cast<long>(pos), static_cast<long>(pos + 1)))
+                break;
+            pos = static_cast<unsigned long>(opn_atomicLoad(&m_pushPos));
+        }
+        else if(diff < 0)
+            return false; // Queue is full
+        else
+            pos = static_cast<unsigned long>(opn_atomicLoad(&m_pushPos));
+    }
+
+    slot->event.frame = frame;
+    slot->event.size = static_cast<uint16_t>(size);
+    std::memcpy(slot->event.data, data, size);
+    opn_atomicStore(&slot->sequence, static_cast<long>(pos + 1));
+
+    return true;
+}
+
+bool OpnRtEventQueue::pop(Event &event)
+{
+    const unsigned long mask = OPN_RT_QUEUE_SIZE - 1;
+    Slot &slot = m_slots[m_popPos & mask];
+    unsigned long seq = static_cast<unsigned long>(opn_atomicLoad(&slot.sequence));
+
+    if(seq != m_popPos + 1)
+        return false; // Queue is empty, or the next slot is not published yet
+
+    event = slot.event;
+    opn_atomicStore(&slot.sequence, static_cast<long>(m_popPos + mask + 1));
+    ++m_popPos;
+
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_RT_QUEUE_HPP
+#define OPNMIDI_RT_QUEUE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//! Maximum size of one queued real-time MIDI message in bytes
+#define OPN_RT_EVENT_MAX_SIZE 32
+//! Capacity of the real-time MIDI event queue (must be power of two)
+#define OPN_RT_QUEUE_SIZE 1024
+
+/**
+ * @brief Bounded lock-free queue of timestamped real-time MIDI messages
+ *
+ * Any number of threads may push events at the same time,
+ * while only one thread (the audio renderer) may pop them.
+ */
+class OpnRtEventQueue
+{
+public:
+    /**
+     * @brief Queued MIDI message
+     */
+    struct Event
+    {
+        //! Offset in frames from the begin of the next rendered chunk
+        uint32_t frame;
+        //! Size of the message
+        uint16_t size;
+        //! Raw MIDI message
+        uint8_t  data[OPN_RT_EVENT_MAX_SIZE];
+    };
+
+    OpnRtEventQueue();
+
+    /**
+     * @brief Push the MIDI message, can be called from any thread
+     * @param frame Offset in frames from the begin of the next rendered chunk
+     * @param data Raw MIDI message
+     * @param size Size of the message, must not exceed the OPN_RT_EVENT_MAX_SIZE
+     * @return true on success, false if queue is full
+     */
+    bool push(uint32_t frame, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Pop the oldest MIDI message, must be called by the consumer thread only
+     * @param [_out] event Popped message
+     * @return true on success, false if queue is empty
+     */
+    bool pop(Event &event);
+
+private:
+    struct Slot
+    {
+        //! Position of the push which may use this slot, or position+1 when it's filled
+        volatile long sequence;
+        Event event;
+    };
+
+    std::vector<Slot> m_slots;
+    //! Position of the next push
+    volatile long m_pushPos;
+    //! Position of the next pop
+    unsigned long m_popPos;
+
+    OpnRtEventQueue(const OpnRtEventQueue &);
+    OpnRtEventQueue &operator=(const OpnRtEventQueue &);
+};
+
+#endif // OPNMIDI_RT_QUEUE_HPP
@@ -0,0 +1,167 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_private.hpp"
+#include "opnmidi_sample_cvt.hpp"
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#   define OPNMIDI_CVT_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#   include <emmintrin.h>
+#   define OPNMIDI_CVT_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define OPNMIDI_CVT_NEON
+#endif
+
+/*
+ * Saturation of packs/vqmovn equals the clamping of opn2_cvtS16().
+ * Integer to float conversion rounds to nearest in both scalar and vector
+ * code, and the multiplication by the same constant gives the same result.
+ */
+
+void opn2_cvtBlockS16(int16_t *dst, const int32_t *src, size_t samples)
+{
+    size_t i = 0;
+
+#if defined(OPNMIDI_CVT_AVX2)
+    for(; i + 16 <= samples; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8));
+        // packs works within 128-bit lanes, restore the order of quad-words
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), p);
+    }
+#endif
+
+#if defined(OPNMIDI_CVT_SSE2)
+    for(; i + 8 <= samples; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+    }
+#elif defined(OPNMIDI_CVT_NEON)
+    for(; i + 8 <= samples; i += 8)
+    {
+        int16x4_t a = vqmovn_s32(vld1q_s32(src + i));
+        int16x4_t b = vqmovn_s32(vld1q_s32(src + i + 4));
+        vst1q_s16(dst + i, vcombine_s16(a, b));
+    }
+#endif
+
+    for(; i < samples; ++i)
+        dst[i] = static_cast<int16_t>(opn2_cvtS16(src[i]));
+}
+
+void opn2_cvtBlockF32(float *dst, const int32_t *src, size_t samples)
+{
+    size_t i = 0;
+
+#if defined(OPNMIDI_CVT_AVX2)
+    {
+        const __m256 scale = _mm256_set1_ps(1.0f / static_cast<float>(INT16_MAX));
+        for(; i + 8 <= samples; i += 8)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+        }
+    }
+#endif
+
+#if defined(OPNMIDI_CVT_SSE2)
+    {
+        const __m128 scale = _mm_set1_ps(1.0f / static_cast<float>(INT16_MAX));
+        for(; i + 4 <= samples; i += 4)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+        }
+    }
+#elif defined(OPNMIDI_CVT_NEON)
+    {
+        const float32x4_t scale = vdupq_n_f32(1.0f / static_cast<float>(INT16_MAX));
+        for(; i + 4 <= samples; i += 4)
+            vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+    }
+#endif
+
+    for(; i < samples; ++i)
+        dst[i] = opn2_cvtReal<float>(src[i]);
+}
+
+void opn2_cvtBlockF32Planar(float *left, float *right, const int32_t *src, size_t frames)
+{
+    size_t i = 0;
+
+#if defined(OPNMIDI_CVT_AVX2)
+    {
+        const __m256 scale = _mm256_set1_ps(1.0f / static_cast<float>(INT16_MAX));
+        // Gather even (left) samples into the low lane and odd (right) into the high
+        const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        for(; i + 8 <= frames; i += 8)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * i + 8));
+            a = _mm256_permutevar8x32_epi32(a, split);
+            b = _mm256_permutevar8x32_epi32(b, split);
+            __m256 l = _mm256_cvtepi32_ps(_mm256_permute2x128_si256(a, b, 0x20));
+            __m256 r = _mm256_cvtepi32_ps(_mm256_permute2x128_si256(a, b, 0x31));
+            _mm256_storeu_ps(left + i, _mm256_mul_ps(l, scale));
+            _mm256_storeu_ps(right + i, _mm256_mul_ps(r, scale));
+        }
+    }
+#endif
+
+#if defined(OPNMIDI_CVT_SSE2)
+    {
+        const __m128 scale = _mm_set1_ps(1.0f / static_cast<float>(INT16_MAX));
+        for(; i + 4 <= frames; i += 4)
+        {
+            __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i)));
+            __m128 b = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 4)));
+            _mm_storeu_ps(left + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), scale));
+            _mm_storeu_ps(right + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), scale));
+        }
+    }
+#elif defined(OPNMIDI_CVT_NEON)
+    {
+        const float32x4_t scale = vdupq_n_f32(1.0f / static_cast<float>(INT16_MAX));
+        for(; i + 4 <= frames; i += 4)
+        {
+            int32x4x2_t lr = vld2q_s32(src + 2 * i);
+            vst1q_f32(left + i, vmulq_f32(vcvtq_f32_s32(lr.val[0]), scale));
+            vst1q_f32(right + i, vmulq_f32(vcvtq_f32_s32(lr.val[1]), scale));
+        }
+    }
+#endif
+
+    for(; i < frames; ++i)
+    {
+        left[i] = opn2_cvtReal<float>(src[2 * i]);
+        right[i] = opn2_cvtReal<float>(src[2 * i + 1]);
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_SAMPLE_CVT_HPP
+#define OPNMIDI_SAMPLE_CVT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Block converters of the int32 mix bus into the contiguous output.
+ * Results are identical to the per-sample opn2_cvtS16() and opn2_cvtReal<float>()
+ */
+
+/**
+ * @brief Convert the block of samples into saturated signed 16-bit
+ * @param dst Destination buffer, no alignment requirement
+ * @param src Source samples
+ * @param samples Count of samples (not frames) to convert
+ */
+extern void opn2_cvtBlockS16(int16_t *dst, const int32_t *src, size_t samples);
+
+/**
+ * @brief Convert the block of samples into 32-bit float
+ * @param dst Destination buffer, no alignment requirement
+ * @param src Source samples
+ * @param samples Count of samples (not frames) to convert
+ */
+extern void opn2_cvtBlockF32(float *dst, const int32_t *src, size_t samples);
+
+/**
+ * @brief Convert the block of interleaved stereo frames into planar 32-bit float
+ * @param left Destination of the left channel, no alignment requirement
+ * @param right Destination of the right channel, no alignment requirement
+ * @param src Source interleaved stereo frames
+ * @param frames Count of stereo frames to convert
+ */
+extern void opn2_cvtBlockF32Planar(float *left, float *right, const int32_t *src, size_t frames);
+
+#endif // OPNMIDI_SAMPLE_CVT_HPP
@@ -0,0 +1,341 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_threads.hpp"
+#include <cassert>
+#ifndef _WIN32
+#   include <time.h>
+#endif
+
+
+/* Monotonic clock */
+
+double opn_monotonicTime()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return static_cast<double>(counter.QuadPart) / static_cast<double>(freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+
+/* OpnMutex */
+
+#ifdef _WIN32
+OpnMutex::OpnMutex()
+{
+    InitializeCriticalSection(&m_mutex);
+}
+
+OpnMutex::~OpnMutex()
+{
+    DeleteCriticalSection(&m_mutex);
+}
+
+void OpnMutex::lock()
+{
+    EnterCriticalSection(&m_mutex);
+}
+
+void OpnMutex::unlock()
+{
+    LeaveCriticalSection(&m_mutex);
+}
+#else
+OpnMutex::OpnMutex()
+{
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+OpnMutex::~OpnMutex()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void OpnMutex::lock()
+{
+    pthread_mutex_lock(&m_mutex);
+}
+
+void OpnMutex::unlock()
+{
+    pthread_mutex_unlock(&m_mutex);
+}
+#endif
+
+OpnMutex g_opnChipTablesLock;
+
+
+/* OpnCondition */
+
+#ifdef _WIN32
+OpnCondition::OpnCondition()
+{
+    InitializeConditionVariable(&m_cond);
+}
+
+OpnCondition::~OpnCondition()
+{}
+
+void OpnCondition::wait(OpnMutex &mutex)
+{
+    SleepConditionVariableCS(&m_cond, &mutex.m_mutex, INFINITE);
+}
+
+void OpnCondition::signal()
+{
+    WakeConditionVariable(&m_cond);
+}
+
+void OpnCondition::broadcast()
+{
+    WakeAllConditionVariable(&m_cond);
+}
+#else
+OpnCondition::OpnCondition()
+{
+    pthread_cond_init(&m_cond, NULL);
+}
+
+OpnCondition::~OpnCondition()
+{
+    pthread_cond_destroy(&m_cond);
+}
+
+void OpnCondition::wait(OpnMutex &mutex)
+{
+    pthread_cond_wait(&m_cond, &mutex.m_mutex);
+}
+
+void OpnCondition::signal()
+{
+    pthread_cond_signal(&m_cond);
+}
+
+void OpnCondition::broadcast()
+{
+    pthread_cond_broadcast(&m_cond);
+}
+#endif
+
+
+/* OpnThread */
+
+OpnThread::OpnThread() :
+#ifdef _WIN32
+    m_thread(NULL),
+#endif
+    m_running(false),
+    m_proc(NULL),
+    m_userData(NULL)
+{}
+
+OpnThread::~OpnThread()
+{
+    join();
+}
+
+#ifdef _WIN32
+DWORD WINAPI OpnThread::entry(LPVOID arg)
+{
+    OpnThread *self = reinterpret_cast<OpnThread *>(arg);
+    self->m_proc(self->m_userData);
+    return 0;
+}
+
+bool OpnThread::start(Proc proc, void *userData)
+{
+    assert(!m_running);
+    m_proc = proc;
+    m_userData = userData;
+    m_thread = CreateThread(NULL, 0, &entry, this, 0, NULL);
+    m_running = (m_thread != NULL);
+    return m_running;
+}
+
+void OpnThread::join()
+{
+    if(!m_running)
+        return;
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+    m_thread = NULL;
+    m_running = false;
+}
+#else
+void *OpnThread::entry(void *arg)
+{
+    OpnThread *self = reinterpret_cast<OpnThread *>(arg);
+    self->m_proc(self->m_userData);
+    return NULL;
+}
+
+bool OpnThread::start(Proc proc, void *userData)
+{
+    assert(!m_running);
+    m_proc = proc;
+    m_userData = userData;
+    m_running = (pthread_create(&m_thread, NULL, &entry, this) == 0);
+    return m_running;
+}
+
+void OpnThread::join()
+{
+    if(!m_running)
+        return;
+    pthread_join(m_thread, NULL);
+    m_running = false;
+}
+#endif
+
+
+/* OpnWorkerPool */
+
+OpnWorkerPool::OpnWorkerPool() :
+    m_generation(0),
+    m_pending(0),
+    m_quit(false),
+    m_proc(NULL),
+    m_userData(NULL),
+    m_jobs(0)
+{}
+
+OpnWorkerPool::~OpnWorkerPool()
+{
+    stop();
+}
+
+bool OpnWorkerPool::setThreads(unsigned threads)
+{
+    unsigned workers = (threads > 1) ? (threads - 1) : 0;
+    if(workers == m_workers.size())
+        return true;
+
+    stop();
+
+    m_workers.reserve(workers);
+    for(unsigned i = 0; i < workers; ++i)
+    {
+        Worker *w = new Worker;
+        w->pool = this;
+        w->index = i + 1;
+        w->generation = m_generation;
+        if(!w->thread.start(&workerEntry, w))
+        {
+            delete w;
+            stop();
+            return false;
+        }
+        m_workers.push_back(w);
+    }
+
+    return true;
+}
+
+unsigned OpnWorkerPool::threads() const
+{
+    return static_cast<unsigned>(m_workers.size()) + 1;
+}
+
+void OpnWorkerPool::run(JobProc proc, void *userData, size_t jobs)
+{
+    if(m_workers.empty())
+    {
+        for(size_t j = 0; j < jobs; ++j)
+            proc(userData, j);
+        return;
+    }
+
+    m_mutex.lock();
+    m_proc = proc;
+    m_userData = userData;
+    m_jobs = jobs;
+    m_pending = static_cast<unsigned>(m_workers.size());
+    ++m_generation;
+    m_wakeCond.broadcast();
+    m_mutex.unlock();
+
+    runJobs(0);
+
+    m_mutex.lock();
+    while(m_pending > 0)
+        m_doneCond.wait(m_mutex);
+    m_mutex.unlock();
+}
+
+void OpnWorkerPool::workerEntry(void *userData)
+{
+    Worker *w = reinterpret_cast<Worker *>(userData);
+    w->pool->workerLoop(w->index, w->generation);
+}
+
+void OpnWorkerPool::workerLoop(unsigned index, unsigned long seen)
+{
+    m_mutex.lock();
+    for(;;)
+    {
+        while(!m_quit && m_generation == seen)
+            m_wakeCond.wait(m_mutex);
+        if(m_quit)
+            break;
+        seen = m_generation;
+        m_mutex.unlock();
+
+        runJobs(index);
+
+        m_mutex.lock();
+        if(--m_pending == 0)
+            m_doneCond.signal();
+    }
+    m_mutex.unlock();
+}
+
+void OpnWorkerPool::runJobs(unsigned index)
+{
+    const size_t step = m_workers.size() + 1;
+    for(size_t j = index; j < m_jobs; j += step)
+        m_proc(m_userData, j);
+}
+
+void OpnWorkerPool::stop()
+{
+    m_mutex.lock();
+    m_quit = true;
+    m_wakeCond.broadcast();
+    m_mutex.unlock();
+
+    for(size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i]->thread.join();
+        delete m_workers[i];
+    }
+    m_workers.clear();
+
+    m_quit = false;
+}
@@ -0,0 +1,270 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_THREADS_HPP
+#define OPNMIDI_THREADS_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX 1
+#   endif
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+/*
+ * Atomic operations on the long integer with the full memory barrier,
+ * used by lock-free structures shared between threads
+ */
+
+/**
+ * @brief Read the value shared between threads
+ * @param ptr Pointer to the shared value
+ * @return Value which was written before the barrier
+ */
+inline long opn_atomicLoad(const volatile long *ptr)
+{
+    long value = *ptr;
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+    return value;
+}
+
+/**
+ * @brief Write the value shared between threads, all previous writes become visible before it
+ * @param ptr Pointer to the shared value
+ * @param value Value to write
+ */
+inline void opn_atomicStore(volatile long *ptr, long value)
+{
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+    *ptr = value;
+}
+
+/**
+ * @brief Compare and swap the value shared between threads
+ * @param ptr Pointer to the shared value
+ * @param expected Value expected to be stored
+ * @param desired Value to store when the stored value is equal to the expected
+ * @return true when value has been swapped
+ */
+inline bool opn_atomicCompareSwap(volatile long *ptr, long expected, long desired)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(ptr, desired, expected) == expected;
+#else
+    return __sync_bool_compare_and_swap(ptr, expected, desired);
+#endif
+}
+
+/**
+ * @brief Read the monotonic clock
+ * @return Time in seconds from an unspecified point
+ */
+extern double opn_monotonicTime();
+
+/**
+ * @brief Minimal portable mutex
+ */
+class OpnMutex
+{
+#ifdef _WIN32
+    CRITICAL_SECTION m_mutex;
+#else
+    pthread_mutex_t m_mutex;
+#endif
+    friend class OpnCondition;
+    OpnMutex(const OpnMutex &);
+    OpnMutex &operator=(const OpnMutex &);
+public:
+    OpnMutex();
+    ~OpnMutex();
+    void lock();
+    void unlock();
+};
+
+/**
+ * @brief Scoped lock of the OpnMutex
+ */
+class OpnMutexLocker
+{
+    OpnMutex &m_mutex;
+    OpnMutexLocker(const OpnMutexLocker &);
+    OpnMutexLocker &operator=(const OpnMutexLocker &);
+public:
+    explicit OpnMutexLocker(OpnMutex &mutex) : m_mutex(mutex) { m_mutex.lock(); }
+    ~OpnMutexLocker() { m_mutex.unlock(); }
+};
+
+/**
+ * @brief Process-wide lock held by chip emulators while they build their shared lookup tables,
+ * so that players running in different threads can construct the chips at the same time
+ */
+extern OpnMutex g_opnChipTablesLock;
+
+/**
+ * @brief Minimal portable condition variable
+ */
+class OpnCondition
+{
+#ifdef _WIN32
+    CONDITION_VARIABLE m_cond;
+#else
+    pthread_cond_t m_cond;
+#endif
+    OpnCondition(const OpnCondition &);
+    OpnCondition &operator=(const OpnCondition &);
+public:
+    OpnCondition();
+    ~OpnCondition();
+    /**
+     * @brief Wait for the signal. The mutex must be locked by the caller
+     * @param mutex Mutex which protects the condition state
+     */
+    void wait(OpnMutex &mutex);
+    void signal();
+    void broadcast();
+};
+
+/**
+ * @brief Minimal portable joinable thread
+ */
+class OpnThread
+{
+public:
+    typedef void (*Proc)(void *userData);
+private:
+#ifdef _WIN32
+    HANDLE      m_thread;
+    static DWORD WINAPI entry(LPVOID arg);
+#else
+    pthread_t   m_thread;
+    static void *entry(void *arg);
+#endif
+    bool        m_running;
+    Proc        m_proc;
+    void       *m_userData;
+    OpnThread(const OpnThread &);
+    OpnThread &operator=(const OpnThread &);
+public:
+    OpnThread();
+    ~OpnThread();
+    /**
+     * @brief Start the thread
+     * @param proc Thread function
+     * @param userData Argument of the thread function
+     * @return true on success
+     */
+    bool start(Proc proc, void *userData);
+    /**
+     * @brief Wait for the thread completion
+     */
+    void join();
+    bool running() const { return m_running; }
+};
+
+/**
+ * @brief Fork-join pool of worker threads
+ *
+ * Splits a batch of independent jobs between the calling thread and
+ * the workers. The job N is always executed by the thread (N % threads),
+ * where the thread 0 is a caller of run().
+ */
+class OpnWorkerPool
+{
+public:
+    /**
+     * @brief Job handler
+     * @param userData User data passed into run()
+     * @param job Index of the job to execute
+     */
+    typedef void (*JobProc)(void *userData, size_t job);
+
+    OpnWorkerPool();
+    ~OpnWorkerPool();
+
+    /**
+     * @brief Set the total number of threads including the caller of run()
+     * @param threads Number of threads, values below 2 stop all workers
+     * @return true on success, false if any thread has failed to start
+     */
+    bool setThreads(unsigned threads);
+
+    /**
+     * @brief Total number of threads including the caller of run()
+     */
+    unsigned threads() const;
+
+    /**
+     * @brief Execute the batch of jobs and wait for their completion
+     * @param proc Job handler
+     * @param userData User data for the job handler
+     * @param jobs Number of jobs in the batch
+     */
+    void run(JobProc proc, void *userData, size_t jobs);
+
+private:
+    struct Worker
+    {
+        OpnWorkerPool *pool;
+        unsigned index;
+        //! Batch generation at the moment of the thread start
+        unsigned long generation;
+        OpnThread thread;
+    };
+
+    static void workerEntry(void *userData);
+    void workerLoop(unsigned index, unsigned long seen);
+    void runJobs(unsigned index);
+    void stop();
+
+    std::vector<Worker *> m_workers;
+    OpnMutex        m_mutex;
+    OpnCondition    m_wakeCond;
+    OpnCondition    m_doneCond;
+    //! Increased on every new batch
+    unsigned long   m_generation;
+    //! Count of workers which are still busy with the current batch
+    unsigned        m_pending;
+    bool            m_quit;
+
+    JobProc         m_proc;
+    void           *m_userData;
+    size_t          m_jobs;
+
+    OpnWorkerPool(const OpnWorkerPool &);
+    OpnWorkerPool &operator=(const OpnWorkerPool &);
+};
+
+#endif // OPNMIDI_THREADS_HPP
@@ -0,0 +1,68 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_tone.hpp"
+#include <cmath>
+
+uint32_t opn2_toneToFtone(double tone, OPNFamily family)
+{
+    double coef;
+    switch(family)
+    {
+    case OPNChip_OPN2: default:
+        coef = 321.88557; break;
+    case OPNChip_OPNA:
+        coef = 309.12412; break;
+    }
+    double hertz = std::exp(0.057762265 * tone) * coef;
+
+    uint32_t octave = 0, mul_offset = 0;
+
+    //Basic range until max of octaves reaching
+    while((hertz >= 1023.75) && (octave < 0x3800))
+    {
+        hertz /= 2.0;    // Calculate octave
+        octave += 0x800;
+    }
+    //Extended range, rely on frequency multiplication increment
+    while(hertz >= 2036.75)
+    {
+        hertz /= 2.0;    // Calculate octave
+        mul_offset++;
+    }
+    return (mul_offset << 14) | (octave + static_cast<uint32_t>(hertz + 0.5));
+}
+
+OpnToneTable::OpnToneTable() :
+    m_family(OPNChip_OPN2)
+{}
+
+void OpnToneTable::build(OPNFamily family)
+{
+    if(!m_table.empty() && m_family == family)
+        return;
+    m_family = family;
+    m_table.resize(range * steps);
+    for(size_t i = 0; i < m_table.size(); ++i)
+        m_table[i] = static_cast<uint16_t>(opn2_toneToFtone(static_cast<double>(i) / steps, family));
+}
@@ -0,0 +1,79 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_TONE_HPP
+#define OPNMIDI_TONE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "chips/opn_chip_family.h"
+
+/**
+ * @brief Converts the tone into block and F-number with an offset of the frequency multiplier
+ * @param tone MIDI tone in semitones
+ * @param family Chip family
+ * @return Block and F-number in the low 14 bits, and the offset of the multiplier above them
+ */
+extern uint32_t opn2_toneToFtone(double tone, OPNFamily family);
+
+/**
+ * @brief Results of opn2_toneToFtone() for the chip family by fractions of semitone
+ */
+class OpnToneTable
+{
+public:
+    //! Steps of the table in one semitone, and its range in semitones
+    enum { steps = 64, range = 144 };
+
+    OpnToneTable();
+
+    /**
+     * @brief Fill the table for the chip family, kept when it is for that family already
+     * @param family Chip family
+     */
+    void build(OPNFamily family);
+
+    /**
+     * @brief Block, F-number and multiplier offset of the tone, packed as by opn2_toneToFtone()
+     * @param tone MIDI tone in semitones, rounded to the nearest step of the table.
+     * Tones out of the table are rare, they take the exact way
+     * @return Block and F-number in the low 14 bits, and the offset of the multiplier above them
+     */
+    uint32_t ftone(double tone) const
+    {
+        const double step = tone * steps + 0.5;
+        if(step >= 0.0 && step < static_cast<double>(m_table.size()))
+            return m_table[static_cast<size_t>(step)];
+        return opn2_toneToFtone(tone, m_family);
+    }
+
+private:
+    //! Chip family of the table
+    OPNFamily m_family;
+    //! Packed entries by steps, the multiplier offset stays under 4 through the range
+    std::vector<uint16_t> m_table;
+};
+
+#endif // OPNMIDI_TONE_HPP
@@ -0,0 +1,68 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opnmidi_volume.hpp"
+
+// The steps of 2 * (int)(log(volume) * 11.541560327111707 - 160.1379199767093)
+const uint32_t opn2_genericVolumeSteps[64] =
+{
+    1157227,   1261965,   1376183,   1500738,   1636566,   1784688,   1946216,   2122363,
+    2314454,   2523930,   2752365,   3001475,   3273132,   3569375,   3892431,   4244726,
+    4628907,   5047859,   5504729,   6002950,   6546263,   7138750,   7784862,   8489452,
+    9257814,   10095717,  11009458,  12005899,  13092525,  14277500,  15569724,  16978904,
+    18515627,  20191434,  22018915,  24011797,  26185050,  28554999,  31139448,  33957808,
+    37031253,  40382867,  44037829,  48023593,  52370100,  57109998,  62278895,  67915616,
+    74062505,  80765734,  88075658,  96047186,  104740199, 114219996, 124557789, 135831232,
+    148125009, 161531468, 176151315, 192094371, 209480397, 228439992, 249115578, 271662464,
+};
+
+// round(127 * sqrt(brightness / 127))
+const uint8_t opn2_brightnessCurve[128] =
+{
+    0,   11,  16,  20,  23,  25,  28,  30,  32,  34,  36,  37,  39,  41,  42,  44,
+    45,  46,  48,  49,  50,  52,  53,  54,  55,  56,  57,  59,  60,  61,  62,  63,
+    64,  65,  66,  67,  68,  69,  69,  70,  71,  72,  73,  74,  75,  76,  76,  77,
+    78,  79,  80,  80,  81,  82,  83,  84,  84,  85,  86,  87,  87,  88,  89,  89,
+    90,  91,  92,  92,  93,  94,  94,  95,  96,  96,  97,  98,  98,  99,  100, 100,
+    101, 101, 102, 103, 103, 104, 105, 105, 106, 106, 107, 108, 108, 109, 109, 110,
+    110, 111, 112, 112, 113, 113, 114, 114, 115, 115, 116, 117, 117, 118, 118, 119,
+    119, 120, 120, 121, 121, 122, 122, 123, 123, 124, 124, 125, 125, 126, 126, 127,
+};
+
+/*
+ * Bits of the carriers in order of registers.
+ * Yeah, Operator 2 and 3 are seems swapped
+ * which we can see in the algorithm 4
+ */
+const uint8_t opn2_algCarriers[8] =
+{
+    //OP4 OP2 OP3 OP1 (3C 38 34 30)
+    0x8, //Algorithm #0:  W = 1 * 2 * 3 * 4
+    0x8, //Algorithm #1:  W = (1 + 2) * 3 * 4
+    0x8, //Algorithm #2:  W = (1 + (2 * 3)) * 4
+    0x8, //Algorithm #3:  W = ((1 * 2) + 3) * 4
+    0xC, //Algorithm #4:  W = (1 * 2) + (3 * 4)
+    0xE, //Algorithm #5:  W = (1 * (2 + 3 + 4)
+    0xE, //Algorithm #6:  W = (1 * 2) + 3 + 4
+    0xF, //Algorithm #7:  W = 1 + 2 + 3 + 4
+};
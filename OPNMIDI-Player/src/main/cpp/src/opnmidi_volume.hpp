@@ -0,0 +1,68 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPNMIDI_VOLUME_HPP
+#define OPNMIDI_VOLUME_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+//! Least volume products of the generic model reaching the levels 2, 4, ... 128
+extern const uint32_t opn2_genericVolumeSteps[64];
+
+//! Brightness curve, round(127 * sqrt(brightness / 127))
+extern const uint8_t opn2_brightnessCurve[128];
+
+//! Carrier operators of every algorithm, bits in order of registers
+extern const uint8_t opn2_algCarriers[8];
+
+/**
+ * @brief Level of the generic volume model, 2 * (int)(log(volume) * 11.541560327111707 - 160.1379199767093)
+ * @param volume Product of the velocity, master volume, channel volume and expression
+ * @return Even level of 0 to 128, looked up by its steps
+ */
+inline uint_fast32_t opn2_genericVolumeLevel(uint_fast32_t volume)
+{
+    size_t lo = 0, hi = 64;
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if(opn2_genericVolumeSteps[mid] <= volume)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return static_cast<uint_fast32_t>(lo * 2);
+}
+
+/**
+ * @brief Whether the operator is a carrier of the algorithm
+ * @param alg Algorithm of the FB/ALG register
+ * @param op Operator in order of registers (30, 34, 38, 3C)
+ */
+inline bool opn2_isCarrier(uint8_t alg, uint8_t op)
+{
+    return ((opn2_algCarriers[alg & 7] >> op) & 1) != 0;
+}
+
+#endif // OPNMIDI_VOLUME_HPP
@@ -0,0 +1,186 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Chip channel index test
+ *
+ * Runs a song of dense short notes over chords held for more than twelve
+ * minutes through the library built with OPNMIDI_CHECK_CHANNEL_INDEX.
+ * That build reports every chip channel picked for a note together with
+ * the pick of the full goodness scan, and both must be the same. With
+ * enough chips the held notes get older than aged_note_kon_us, so the
+ * picks while busy channels may win over idle ones are checked as well.
+ *
+ * Usage: channel_index <bank.wopn>
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <opnmidi.h>
+
+#include "smf_writer.h"
+
+/* Seconds of the song, longer than the notes take to get aged */
+static const unsigned g_songSeconds = 760;
+
+static const int g_chipCounts[] = {1, 2, 4};
+
+/**
+ * @brief Chords held through the whole song, one of them by the sustain pedal,
+ * under short notes of all other channels with drums, which pause for a few
+ * seconds every half of minute to let the chip channels go idle
+ */
+static std::vector<unsigned char> makeAgedSong()
+{
+    SmfWriter smf;
+    smf.tempo(500000);
+    for(unsigned ch = 0; ch < 16; ++ch)
+        smf.event(0xC0 | ch, static_cast<unsigned char>(ch * 8 + 1), 0);
+
+    smf.event(0x90, 48, 100);
+    smf.event(0x90, 55, 100);
+    smf.event(0xB1, 64, 127);
+    smf.event(0x91, 60, 100);
+    smf.event(0x81, 60, 0);
+
+    // Eight steps per second at 120 BPM, the notes last one to four steps
+    const unsigned step = SmfWriter::Division / 4;
+    const unsigned steps = g_songSeconds * 8;
+    unsigned char ends[4][6][2];
+    std::memset(ends, 0, sizeof(ends));
+    for(unsigned i = 0; i < steps + 4; ++i)
+    {
+        for(unsigned n = 0; n < 6; ++n)
+        {
+            unsigned char *end = ends[i % 4][n];
+            if(end[1] != 0)
+                smf.event(0x80 | end[0], end[1], 0);
+            end[1] = 0;
+        }
+        const bool pause = (i >= steps) || (i % 240) >= 216;
+        for(unsigned n = 0; n < 6 && !pause; ++n)
+        {
+            const unsigned char ch = static_cast<unsigned char>(2 + (i * 5 + n * 3) % 14);
+            const unsigned char note = static_cast<unsigned char>(ch == 9 ? 35 + (i + n) % 47 : 36 + (i * 7 + n * 5) % 48);
+            smf.event(0x90 | ch, note, static_cast<unsigned char>(70 + n * 8));
+            unsigned char *end = ends[(i + 1 + n % 4) % 4][n];
+            end[0] = ch;
+            end[1] = note;
+        }
+        smf.wait(step);
+    }
+
+    smf.event(0x80, 48, 0);
+    smf.event(0x80, 55, 0);
+    smf.event(0xB1, 64, 0);
+    return smf.finish();
+}
+
+struct Checks
+{
+    unsigned long picks;
+    unsigned long aged;
+    unsigned long mismatches;
+};
+
+static void debugHook(void *userData, const char *fmt, ...)
+{
+    if(std::strncmp(fmt, "Chip channel check:", 19) != 0)
+        return;
+    Checks &checks = *static_cast<Checks *>(userData);
+    va_list args;
+    va_start(args, fmt);
+    const int picked = va_arg(args, int);
+    const int scan = va_arg(args, int);
+    const int aged = va_arg(args, int);
+    va_end(args);
+
+    ++checks.picks;
+    if(aged)
+        ++checks.aged;
+    if(picked != scan && checks.mismatches++ < 5)
+        std::printf("Picked chip channel %d, the scan picks %d%s\n", picked, scan, aged ? " (aged)" : "");
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    const std::vector<unsigned char> song = makeAgedSong();
+    int failures = 0;
+    unsigned long aged = 0;
+
+    for(size_t i = 0; i < sizeof(g_chipCounts) / sizeof(int); ++i)
+    {
+        const int chips = g_chipCounts[i];
+        OPN2_MIDIPlayer *player = opn2_init(44100);
+        if(!player || opn2_setNumChips(player, chips) < 0 ||
+           opn2_openBankFile(player, argv[1]) < 0 ||
+           opn2_openData(player, &song[0], static_cast<unsigned long>(song.size())) < 0)
+        {
+            std::fprintf(stderr, "Can't set up the player: %s\n", opn2_errorInfo(player));
+            opn2_close(player);
+            return 2;
+        }
+
+        Checks checks = {0, 0, 0};
+        opn2_setDebugMessageHook(player, debugHook, &checks);
+        // No sound is needed, the sequencer runs alone
+        while(!opn2_atEnd(player))
+            opn2_tickEvents(player, 0.01, 0.001);
+        opn2_close(player);
+
+        std::printf("%d chips: %lu picks, %lu of them aged, %lu differ\n",
+                    chips, checks.picks, checks.aged, checks.mismatches);
+        if(checks.picks == 0)
+        {
+            std::printf("%d chips: the checks didn't run, is the library built without the check?\n", chips);
+            ++failures;
+        }
+        if(checks.mismatches > 0)
+            ++failures;
+        aged += checks.aged;
+    }
+
+    // Fewer chips take the held chords away for the short notes before they get aged
+    if(aged == 0)
+    {
+        std::printf("No picks were made while the notes were aged\n");
+        ++failures;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d chip counts\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Player setup and rendering shared by the tests
+ */
+
+#ifndef OPNMIDI_TEST_PLAYER_H
+#define OPNMIDI_TEST_PLAYER_H
+
+#include <opnmidi.h>
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief Whether the emulator is built in
+ * @param emulator Emulator ID
+ */
+inline bool testEmulatorAvailable(int emulator)
+{
+    OPN2_MIDIPlayer *probe = opn2_init(44100);
+    const bool available = probe && opn2_switchEmulator(probe, emulator) == 0;
+    opn2_close(probe);
+    return available;
+}
+
+/**
+ * @brief Open the player of the song at 44100 Hz, looped
+ * @param bankPath Path to the WOPN bank
+ * @param song Standard MIDI File data
+ * @param emulator Emulator ID
+ * @param chips Count of chips
+ * @return Player, or NULL with the reason printed into stderr
+ */
+inline OPN2_MIDIPlayer *openTestPlayer(const char *bankPath, const std::vector<unsigned char> &song,
+                                       int emulator, int chips)
+{
+    OPN2_MIDIPlayer *player = opn2_init(44100);
+    if(!player)
+    {
+        std::fprintf(stderr, "Can't create the player\n");
+        return NULL;
+    }
+    if(opn2_switchEmulator(player, emulator) < 0 ||
+       opn2_setNumChips(player, chips) < 0 ||
+       opn2_openBankFile(player, bankPath) < 0 ||
+       opn2_openData(player, &song[0], static_cast<unsigned long>(song.size())) < 0)
+    {
+        std::fprintf(stderr, "Can't set up the player: %s\n", opn2_errorInfo(player));
+        opn2_close(player);
+        return NULL;
+    }
+    opn2_setLoopEnabled(player, 1);
+    return player;
+}
+
+/**
+ * @brief Render stereo frames by opn2_play() in chunks
+ * @param player Player
+ * @param output Destination of the interleaved frames
+ * @param frames Count of frames to render
+ * @param chunkFrames Largest count of frames per call
+ * @return Count of rendered frames, less than requested when the player stops
+ */
+inline size_t renderTestPlayer(OPN2_MIDIPlayer *player, short *output, size_t frames, size_t chunkFrames)
+{
+    size_t done = 0;
+    while(done < frames)
+    {
+        size_t want = frames - done;
+        if(want > chunkFrames)
+            want = chunkFrames;
+        int got = opn2_play(player, static_cast<int>(want * 2), output + done * 2);
+        if(got <= 0)
+            break;
+        done += static_cast<size_t>(got) / 2;
+    }
+    return done;
+}
+
+#endif // OPNMIDI_TEST_PLAYER_H
@@ -0,0 +1,109 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Songs generated for the tests, so they need no files besides the bank
+ */
+
+#ifndef OPNMIDI_TEST_SONGS_H
+#define OPNMIDI_TEST_SONGS_H
+
+#include <vector>
+
+#include "smf_writer.h"
+
+/**
+ * @brief All 16 channels play chords under running pitch bends, modulation
+ * and sustain, with drums, SysEx, tempo changes and a loop over the whole body,
+ * piling up more notes than chip channels
+ */
+inline std::vector<unsigned char> makeStressSong()
+{
+    static const unsigned char gsReset[10] = {0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7};
+    static const unsigned char chord[4] = {0, 4, 7, 11};
+    SmfWriter smf;
+
+    smf.tempo(500000);
+    smf.sysex(gsReset, sizeof(gsReset));
+    for(unsigned ch = 0; ch < 16; ++ch)
+    {
+        smf.event(0xB0 | ch, 0, 0);
+        smf.event(0xC0 | ch, static_cast<unsigned char>(ch * 8 + 3), 0);
+        smf.event(0xB0 | ch, 7, 100);
+        smf.event(0xB0 | ch, 10, static_cast<unsigned char>(ch * 8));
+    }
+    smf.marker("loopStart");
+
+    const unsigned step = SmfWriter::Division / 4;
+    for(unsigned i = 0; i < 64; ++i)
+    {
+        if((i % 16) == 8)
+            smf.tempo(i < 32 ? 400000 : 600000);
+        if((i % 8) == 0)
+        {
+            unsigned char masterVolume[7] = {0x7F, 0x7F, 0x04, 0x01, 0x00, 0, 0xF7};
+            masterVolume[5] = static_cast<unsigned char>(96 + (i % 32));
+            smf.sysex(masterVolume, sizeof(masterVolume));
+        }
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            if(ch == 9)
+            {
+                smf.event(0x99, static_cast<unsigned char>(35 + ((i * 7) % 47)), 110);
+                smf.event(0x99, static_cast<unsigned char>(35 + ((i * 13 + 3) % 47)), 90);
+                continue;
+            }
+            if((i % 8) == 0)
+            {
+                smf.event(0xB0 | ch, 64, 0);
+                smf.event(0xB0 | ch, 64, 127);
+            }
+            if((i % 16) == 4)
+                smf.event(0xC0 | ch, static_cast<unsigned char>((ch * 8 + i) & 0x7F), 0);
+            smf.event(0xB0 | ch, 1, static_cast<unsigned char>((i * 9 + ch) & 0x7F));
+            smf.event(0xB0 | ch, 11, static_cast<unsigned char>(64 + ((i * 3 + ch) % 64)));
+            unsigned char root = static_cast<unsigned char>(36 + ((i * 5 + ch * 3) % 36));
+            for(unsigned n = 0; n < 4; ++n)
+                smf.event(0x90 | ch, root + chord[n], static_cast<unsigned char>(64 + (n * 16)));
+            int bend = 0x2000 + (static_cast<int>(i & 7) - 4) * 0x200;
+            smf.event(0xE0 | ch, static_cast<unsigned char>(bend & 0x7F), static_cast<unsigned char>(bend >> 7));
+        }
+        smf.wait(step);
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            if(ch == 9)
+            {
+                smf.event(0x89, static_cast<unsigned char>(35 + ((i * 7) % 47)), 0);
+                smf.event(0x89, static_cast<unsigned char>(35 + ((i * 13 + 3) % 47)), 0);
+                continue;
+            }
+            unsigned char root = static_cast<unsigned char>(36 + ((i * 5 + ch * 3) % 36));
+            for(unsigned n = 0; n < 4; ++n)
+                smf.event(0x80 | ch, root + chord[n], 0);
+        }
+    }
+    smf.marker("loopEnd");
+    return smf.finish();
+}
+
+#endif // OPNMIDI_TEST_SONGS_H
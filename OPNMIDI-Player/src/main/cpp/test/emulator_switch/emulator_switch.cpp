@@ -0,0 +1,201 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Emulator switch test
+ *
+ * Plays a song with a chord held from its start to its end under a running
+ * melody, and switches the emulator every few tenths of a second: through
+ * every built-in one, to the lockstep one and back between each of them.
+ * The chord must keep sounding through every switch, and the chips must
+ * fall silent once the song releases it.
+ *
+ * Usage: emulator_switch <bank.wopn>
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "smf_writer.h"
+#include "test_player.h"
+
+/* Frames each emulator plays before the next switch */
+static const size_t g_segmentFrames = 13230;
+
+/* Frames of the windows whose level is measured */
+static const size_t g_windowFrames = 2048;
+
+static const int g_chipCounts[] = {1, 3};
+
+/* Organ chord held through the whole song, the piano melody keeps the song going */
+static std::vector<unsigned char> makeHeldChordSong(size_t segments)
+{
+    static const unsigned char melody[8] = {72, 74, 76, 77, 79, 77, 76, 74};
+    SmfWriter smf;
+
+    smf.tempo(500000);
+    smf.event(0xC0, 19, 0);
+    smf.event(0xC1, 0, 0);
+    smf.event(0x90, 60, 100);
+    smf.event(0x90, 64, 100);
+    smf.event(0x90, 67, 100);
+
+    // 960 ticks per second
+    const unsigned songTicks = static_cast<unsigned>((segments * g_segmentFrames * 960) / 44100);
+    const unsigned step = SmfWriter::Division / 4;
+    for(unsigned t = 0; t + step <= songTicks; t += step)
+    {
+        const unsigned char note = melody[(t / step) % 8];
+        smf.event(0x91, note, 90);
+        smf.wait(step / 2);
+        smf.event(0x81, note, 0);
+        smf.wait(step - step / 2);
+    }
+
+    smf.event(0x80, 60, 0);
+    smf.event(0x80, 64, 0);
+    smf.event(0x80, 67, 0);
+    // Time for the release before the end
+    smf.wait(SmfWriter::Division * 4);
+    return smf.finish();
+}
+
+static double windowLevel(const std::vector<short> &out, size_t frame)
+{
+    double sum = 0.0;
+    for(size_t s = 2 * frame; s < 2 * (frame + g_windowFrames); ++s)
+        sum += static_cast<double>(out[s]) * out[s];
+    return std::sqrt(sum / (2 * g_windowFrames));
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    // Through every emulator, by the lockstep one between each two
+    const bool lockstep = testEmulatorAvailable(OPNMIDI_EMU_NUKED_LOCKSTEP);
+    std::vector<int> order;
+    for(int emu = 0; emu < OPNMIDI_EMU_end; ++emu)
+    {
+        if(emu == OPNMIDI_VGM_DUMPER || emu == OPNMIDI_EMU_NUKED_LOCKSTEP || !testEmulatorAvailable(emu))
+            continue;
+        if(lockstep && !order.empty())
+            order.push_back(OPNMIDI_EMU_NUKED_LOCKSTEP);
+        order.push_back(emu);
+    }
+    if(order.size() < 2)
+    {
+        std::printf("Less than two emulators are built in, skipped\n");
+        return 0;
+    }
+    order.push_back(order[0]);
+
+    const std::vector<unsigned char> song = makeHeldChordSong(order.size());
+    int failures = 0;
+
+    for(size_t c = 0; c < sizeof(g_chipCounts) / sizeof(int); ++c)
+    {
+        const int chips = g_chipCounts[c];
+        OPN2_MIDIPlayer *player = openTestPlayer(argv[1], song, order[0], chips);
+        if(!player)
+            return 2;
+        opn2_setLoopEnabled(player, 0);
+
+        std::vector<short> out(2 * g_segmentFrames * order.size());
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            if(i > 0 && opn2_switchEmulator(player, order[i]) < 0)
+            {
+                std::fprintf(stderr, "Can't switch to emulator %d: %s\n", order[i], opn2_errorInfo(player));
+                opn2_close(player);
+                return 2;
+            }
+            if(renderTestPlayer(player, &out[2 * g_segmentFrames * i], g_segmentFrames, 777) < g_segmentFrames)
+            {
+                std::printf("%d chips: the song ended early, at emulator %d\n", chips, order[i]);
+                ++failures;
+                break;
+            }
+        }
+
+        // The rest of the song, with the chord released
+        std::vector<short> tail(2 * 44100 * 4);
+        const size_t tailFrames = renderTestPlayer(player, &tail[0], tail.size() / 2, 777);
+        opn2_close(player);
+
+        // Level of the chord once it has settled on the first emulator
+        const double settled = windowLevel(out, g_segmentFrames - g_windowFrames);
+        if(settled < 100.0)
+        {
+            std::printf("%d chips: the chord is silent, level %.1f\n", chips, settled);
+            ++failures;
+            continue;
+        }
+
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            double lowest = settled;
+            size_t lowestAt = 0;
+            for(size_t f = g_segmentFrames * i; f + g_windowFrames <= g_segmentFrames * (i + 1); f += g_windowFrames / 2)
+            {
+                const double level = windowLevel(out, f);
+                if(level < lowest)
+                {
+                    lowest = level;
+                    lowestAt = f;
+                }
+            }
+            if(lowest < settled / 4)
+            {
+                std::printf("%d chips: the chord drops to level %.1f of %.1f on emulator %d, at frame %u\n",
+                            chips, lowest, settled, order[i], static_cast<unsigned>(lowestAt));
+                ++failures;
+            }
+        }
+
+        // Released keys must not come back on the new chips
+        double lastLevel = settled;
+        if(tailFrames >= g_windowFrames)
+            lastLevel = windowLevel(tail, tailFrames - g_windowFrames);
+        if(lastLevel > settled / 100)
+        {
+            std::printf("%d chips: still sounding at level %.1f after the release\n", chips, lastLevel);
+            ++failures;
+        }
+        else
+            std::printf("%d chips: held through %u switches\n", chips, static_cast<unsigned>(order.size() - 1));
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d checks of held notes over the switches\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lockstep emulator test
+ *
+ * Renders the stress song through the scalar Nuked emulator and through
+ * the lockstep one at chip counts which give groups of every width, and
+ * expects the same samples. Bursts of real-time notes run the write
+ * buffers of all chips full, which sends the lanes solo and back.
+ *
+ * Usage: lockstep <bank.wopn>
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "test_player.h"
+#include "test_songs.h"
+
+/* Seconds of the song rendered by every case */
+static const int g_renderSeconds = 3;
+
+static const int g_chipCounts[] = {1, 2, 3, 5, 8, 9};
+
+/* Sets up more notes at once than the write buffers of the chips hold */
+static void noteBurst(OPN2_MIDIPlayer *player, int chips, bool on)
+{
+    for(int n = 0; n < 128 * chips; ++n)
+    {
+        const OPN2_UInt8 ch = static_cast<OPN2_UInt8>(n % 16);
+        const OPN2_UInt8 note = static_cast<OPN2_UInt8>(24 + (n / 16) % 72);
+        if(ch == 9)
+            continue;
+        if(on)
+            opn2_rt_noteOn(player, ch, note, 100);
+        else
+            opn2_rt_noteOff(player, ch, note);
+    }
+}
+
+/* Returns false when the player can't be set up */
+static bool render(const char *bankPath, const std::vector<unsigned char> &song,
+                   int emulator, int chips, std::vector<short> &out)
+{
+    OPN2_MIDIPlayer *player = openTestPlayer(bankPath, song, emulator, chips);
+    if(!player)
+        return false;
+
+    // Odd chunk size which crosses the render blocks
+    const size_t chunkFrames = 777;
+    const size_t frames = 44100 * g_renderSeconds;
+    out.resize(2 * frames);
+    size_t done = 0;
+    for(unsigned chunk = 0; done < frames; ++chunk)
+    {
+        if((chunk % 16) == 5 || (chunk % 16) == 10)
+            noteBurst(player, chips, (chunk % 16) == 5);
+        const size_t want = (frames - done < chunkFrames) ? frames - done : chunkFrames;
+        const size_t got = renderTestPlayer(player, &out[2 * done], want, chunkFrames);
+        done += got;
+        if(got < want)
+            break;
+    }
+    opn2_close(player);
+    return done == frames;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    const bool available = testEmulatorAvailable(OPNMIDI_EMU_NUKED) &&
+                           testEmulatorAvailable(OPNMIDI_EMU_NUKED_LOCKSTEP);
+    if(!available)
+    {
+        std::printf("Nuked emulators are not built in, skipped\n");
+        return 0;
+    }
+
+    const std::vector<unsigned char> song = makeStressSong();
+    std::vector<short> scalar, lockstep;
+    int failures = 0;
+
+    for(size_t i = 0; i < sizeof(g_chipCounts) / sizeof(int); ++i)
+    {
+        const int chips = g_chipCounts[i];
+        if(!render(argv[1], song, OPNMIDI_EMU_NUKED, chips, scalar) ||
+           !render(argv[1], song, OPNMIDI_EMU_NUKED_LOCKSTEP, chips, lockstep))
+            return 2;
+
+        size_t firstDiff = scalar.size();
+        for(size_t s = 0; s < scalar.size(); ++s)
+        {
+            if(scalar[s] != lockstep[s])
+            {
+                firstDiff = s;
+                break;
+            }
+        }
+
+        if(firstDiff == scalar.size())
+            std::printf("%d chips: same\n", chips);
+        else
+        {
+            std::printf("%d chips: MISMATCH from frame %u\n", chips, static_cast<unsigned>(firstDiff / 2));
+            ++failures;
+        }
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d chip counts differ from the scalar emulator\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Real-time safety test
+ *
+ * Replaces malloc() and friends of glibc by counting wrappers, sets every
+ * emulator up, then renders a long stretch of the looped stress song through
+ * opn2_play(), opn2_playFormat() and opn2_generate() mixed with opn2_rt_*()
+ * calls. Any heap call during the render fails the test.
+ *
+ * Usage: no_alloc <bank.wopn>
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "test_player.h"
+#include "test_songs.h"
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static volatile int g_armed = 0;
+static volatile long g_heapCalls = 0;
+
+static void countHeapCall()
+{
+    if(g_armed)
+        __sync_fetch_and_add(&g_heapCalls, 1);
+}
+
+extern "C" void *malloc(size_t size)
+{
+    countHeapCall();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    countHeapCall();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    countHeapCall();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    countHeapCall();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    countHeapCall();
+    *out = __libc_memalign(alignment, size);
+    return *out ? 0 : 12 /* ENOMEM */;
+}
+
+extern "C" void free(void *ptr)
+{
+    if(ptr)
+        countHeapCall();
+    __libc_free(ptr);
+}
+
+/* Seconds of the song rendered by every case */
+static const int g_renderSeconds = 20;
+
+/* Largest block size the cases use, and the largest chunk rendered at once */
+static const int g_largeBlock = 16384;
+static const int g_maxChunk = g_largeBlock + 2000;
+
+struct Case
+{
+    int chips;
+    int threads;
+    // Frames of the render block, 0 keeps the default
+    int blockSize;
+};
+
+static const Case g_cases[] =
+{
+    {1, 1, 0},
+    {3, 1, 0},
+    {3, 2, 0},
+    {4, 1, g_largeBlock},
+    {4, 2, g_largeBlock}
+};
+
+/* Deterministic real-time events between the chunks */
+static void realTimeEvents(OPN2_MIDIPlayer *player, unsigned seed)
+{
+    static const OPN2_UInt8 masterVolume[8] = {0xF0, 0x7F, 0x7F, 0x04, 0x01, 0x00, 0x60, 0xF7};
+    const OPN2_UInt8 ch = static_cast<OPN2_UInt8>(seed % 16);
+    const OPN2_UInt8 note = static_cast<OPN2_UInt8>(36 + (seed * 7) % 48);
+    switch(seed % 8)
+    {
+    case 0:
+        opn2_rt_noteOn(player, ch, note, 100);
+        break;
+    case 1:
+        opn2_rt_noteOff(player, ch, note);
+        break;
+    case 2:
+        opn2_rt_patchChange(player, ch, static_cast<OPN2_UInt8>((seed * 5) % 128));
+        break;
+    case 3:
+        opn2_rt_controllerChange(player, ch, 1, static_cast<OPN2_UInt8>(seed % 128));
+        break;
+    case 4:
+        opn2_rt_pitchBend(player, ch, static_cast<OPN2_UInt16>((seed * 97) % 16384));
+        break;
+    case 5:
+        opn2_rt_noteAfterTouch(player, ch, note, 64);
+        break;
+    case 6:
+        opn2_rt_channelAfterTouch(player, ch, 64);
+        break;
+    default:
+        opn2_rt_systemExclusive(player, masterVolume, sizeof(masterVolume));
+        break;
+    }
+}
+
+/* Returns the count of heap calls during the render, -1 when the case
+ * can't run, -2 when the emulator is not built in */
+static long runCase(const char *bankPath, const std::vector<unsigned char> &song, int emulator, const Case &c)
+{
+    if(!testEmulatorAvailable(emulator))
+        return -2;
+    OPN2_MIDIPlayer *player = openTestPlayer(bankPath, song, emulator, c.chips);
+    if(!player)
+        return -1;
+    opn2_setRenderThreads(player, c.threads);
+    if(c.blockSize > 0)
+        opn2_setBlockSize(player, c.blockSize);
+
+    static short s16[2 * g_maxChunk];
+    static float left[g_maxChunk], right[g_maxChunk];
+    static const OPNMIDI_AudioFormat f32 = {OPNMIDI_SampleType_F32, sizeof(float), sizeof(float)};
+    const long total = 44100L * g_renderSeconds;
+    long done = 0;
+    unsigned chunk = 0;
+
+    g_heapCalls = 0;
+    g_armed = 1;
+    while(done < total)
+    {
+        // Odd chunk sizes which cross the render blocks, and fill the large ones
+        const int spread = (c.blockSize > 0) ? c.blockSize + 1700 : 1700;
+        const int frames = 300 + static_cast<int>((chunk * 397) % spread);
+        switch(chunk % 3)
+        {
+        case 0:
+            opn2_play(player, frames * 2, s16);
+            break;
+        case 1:
+            opn2_playFormat(player, frames * 2,
+                            reinterpret_cast<OPN2_UInt8 *>(left),
+                            reinterpret_cast<OPN2_UInt8 *>(right), &f32);
+            break;
+        default:
+            realTimeEvents(player, chunk);
+            opn2_generate(player, frames * 2, s16);
+            break;
+        }
+        done += frames;
+        ++chunk;
+    }
+    opn2_rt_resetState(player);
+    opn2_panic(player);
+    opn2_generate(player, 4096, s16);
+    g_armed = 0;
+
+    opn2_close(player);
+    return g_heapCalls;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    const std::vector<unsigned char> song = makeStressSong();
+    int failures = 0;
+
+    for(int emulator = 0; emulator < OPNMIDI_EMU_end; ++emulator)
+    {
+        if(emulator == OPNMIDI_VGM_DUMPER)
+            continue;
+        for(size_t i = 0; i < sizeof(g_cases) / sizeof(Case); ++i)
+        {
+            const Case &c = g_cases[i];
+            long calls = runCase(argv[1], song, emulator, c);
+            if(calls == -2)
+                break; // Emulator is not built in
+            if(calls < 0)
+                return 2;
+            std::printf("emulator %d, %d chips, %d threads, block %d: %ld heap calls\n",
+                        emulator, c.chips, c.threads, c.blockSize, calls);
+            if(calls > 0)
+                ++failures;
+        }
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d cases touched the heap while rendering\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Plain clock test of Nuked OPN2
+ *
+ * Runs random register traces through two chips: one is clocked by
+ * OPN2_Clock() only, the other one the way OPN2_Generate() does, by
+ * OPN2_ClockPlain() while OPN2_ClockIsPlain() allows. Every clock must give
+ * the same output and every sample the same chip state. The static
+ * functions are reached by including the core itself.
+ *
+ * Usage: nuked_plain
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ym3438.c"
+
+/* Samples of every trace, 24 clocks each */
+#define TRACE_SAMPLES 100000
+#define TRACE_SEEDS 3
+
+enum TraceKind
+{
+    /* Channel, operator, LFO and key-on writes only, stays plain */
+    TRACE_MUSIC = 0,
+    /* Adds SSG-EG, DAC and the channel 3 special mode */
+    TRACE_CH3_SSG_DAC,
+    /* Adds timers and CSM */
+    TRACE_TIMERS_CSM,
+    /* Adds the LSI test registers */
+    TRACE_TEST_REGS,
+    TRACE_KINDS
+};
+
+static const char *trace_names[TRACE_KINDS] =
+{
+    "music", "ch3/SSG-EG/DAC", "timers/CSM", "test registers"
+};
+
+static Bit32u rng_state;
+
+static Bit32u rng_next(Bit32u range)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (rng_state >> 8) % range;
+}
+
+/* Random data of a mode register, zero for a half of the writes */
+static Bit8u rng_mode(void)
+{
+    return (Bit8u)(rng_next(2) ? 0 : rng_next(256));
+}
+
+static void pick_write(int kind, Bit32u *port, Bit8u *address, Bit8u *data)
+{
+    static const Bit8u key_channels[6] = { 0, 1, 2, 4, 5, 6 };
+    Bit32u pick = rng_next(kind == TRACE_MUSIC ? 6 : 10);
+
+    *port = rng_next(2) * 2;
+    *data = (Bit8u)rng_next(256);
+    switch (pick)
+    {
+    case 0:
+    case 1:
+        *port = 0;
+        *address = 0x28;
+        *data = (Bit8u)((rng_next(16) << 4) | key_channels[rng_next(6)]);
+        break;
+    case 2:
+    case 3:
+        *address = (Bit8u)(0x30 + rng_next(0x60));
+        break;
+    case 4:
+        *address = (Bit8u)(0xa0 + rng_next(3) + 4 * rng_next(2));
+        break;
+    case 5:
+        if (rng_next(8) == 0)
+        {
+            *port = 0;
+            *address = 0x22;
+        }
+        else
+        {
+            *address = (Bit8u)(0xb0 + rng_next(3) + 4 * rng_next(2));
+        }
+        break;
+    case 6:
+        *address = (Bit8u)(0x90 + rng_next(0x10));
+        break;
+    case 7:
+        *port = 0;
+        *address = (Bit8u)(0x2a + rng_next(2));
+        break;
+    case 8:
+        *port = 0;
+        *address = (Bit8u)(0xa8 + rng_next(3) + 4 * rng_next(2));
+        break;
+    default:
+        *port = 0;
+        *address = 0x27;
+        *data = (Bit8u)(rng_next(2) ? 0 : 0x40);
+        if (kind == TRACE_TIMERS_CSM)
+        {
+            switch (rng_next(4))
+            {
+            case 0:
+                *address = (Bit8u)(0x24 + rng_next(3));
+                *data = (Bit8u)rng_next(256);
+                break;
+            default:
+                *data = rng_mode();
+                break;
+            }
+        }
+        else if (kind == TRACE_TEST_REGS && rng_next(2))
+        {
+            *address = (Bit8u)(rng_next(2) ? 0x21 : 0x2c);
+            *data = rng_mode();
+        }
+        break;
+    }
+}
+
+/* Returns the count of mismatches, stops at the first one */
+static int run_trace(int kind, Bit32u seed, ym3438_t *ref, ym3438_t *fast)
+{
+    /* The write buffer isn't used by the clock, everything above it is */
+    const size_t state_size = offsetof(ym3438_t, writebuf_samplecnt);
+    Bit16s ref_out[2], fast_out[2];
+    Bit32u sample, i, plain;
+    Bit32u wait = 0, data_next = 0, port = 0;
+    Bit8u address = 0, data = 0;
+    unsigned long plain_clocks = 0;
+
+    rng_state = seed;
+    memset(ref, 0, sizeof(ym3438_t));
+    OPN2_Reset(ref, 0, 0);
+    memcpy(fast, ref, sizeof(ym3438_t));
+
+    for (sample = 0; sample < TRACE_SAMPLES; sample++)
+    {
+        plain = OPN2_ClockIsPlain(fast);
+        for (i = 0; i < 24; i++)
+        {
+            if (wait == 0)
+            {
+                /* Address and data bytes of a write go to both chips */
+                if (!data_next)
+                {
+                    pick_write(kind, &port, &address, &data);
+                    OPN2_Write(ref, port, address);
+                    OPN2_Write(fast, port, address);
+                }
+                else
+                {
+                    OPN2_Write(ref, port + 1, data);
+                    OPN2_Write(fast, port + 1, data);
+                }
+                data_next = !data_next;
+                wait = 24 + rng_next(400);
+            }
+            wait--;
+
+            OPN2_Clock(ref, ref_out);
+            if (plain)
+            {
+                OPN2_ClockPlain(fast, fast_out);
+                plain_clocks++;
+                if (fast->write_d_en)
+                {
+                    plain = OPN2_ClockIsPlain(fast);
+                }
+            }
+            else
+            {
+                OPN2_Clock(fast, fast_out);
+            }
+
+            if (ref_out[0] != fast_out[0] || ref_out[1] != fast_out[1])
+            {
+                printf("%s, seed %u: output differs at sample %u, clock %u\n",
+                       trace_names[kind], (unsigned)seed, (unsigned)sample, (unsigned)i);
+                return 1;
+            }
+        }
+        if (memcmp(ref, fast, state_size) != 0)
+        {
+            printf("%s, seed %u: chip state differs after sample %u\n",
+                   trace_names[kind], (unsigned)seed, (unsigned)sample);
+            return 1;
+        }
+    }
+
+    printf("%s, seed %u: same, %lu of %lu clocks plain\n",
+           trace_names[kind], (unsigned)seed, plain_clocks, 24ul * TRACE_SAMPLES);
+    if (plain_clocks == 0 || (kind == TRACE_MUSIC && plain_clocks != 24ul * TRACE_SAMPLES)
+        || (kind != TRACE_MUSIC && plain_clocks == 24ul * TRACE_SAMPLES))
+    {
+        printf("%s, seed %u: the trace doesn't cover the clock paths it should\n",
+               trace_names[kind], (unsigned)seed);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    /* Too large for the stack */
+    static ym3438_t ref, fast;
+    int kind, failures = 0;
+    Bit32u seed;
+
+    for (kind = 0; kind < TRACE_KINDS; kind++)
+    {
+        for (seed = 1; seed <= TRACE_SEEDS; seed++)
+        {
+            failures += run_trace(kind, seed * 7919u + (Bit32u)kind, &ref, &fast);
+        }
+    }
+
+    if (failures > 0)
+    {
+        printf("FAILED: %d traces differ between the plain and the generic clock\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
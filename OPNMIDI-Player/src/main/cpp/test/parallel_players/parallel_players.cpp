@@ -0,0 +1,144 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Multi-instance thread safety test
+ *
+ * Starts many players at once, one per thread, over all emulators and
+ * a few chip counts, then renders every one of them again alone and
+ * compares the outputs. Any state shared between the instances shows
+ * up as a mismatch.
+ *
+ * Usage: parallel_players <bank.wopn> [players]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "opnmidi_threads.hpp"
+#include "test_player.h"
+#include "test_songs.h"
+
+/* Seconds of the song rendered by every player */
+static const int g_renderSeconds = 3;
+
+struct Player
+{
+    const char *bankPath;
+    const std::vector<unsigned char> *song;
+    int emulator;
+    int chips;
+    bool ok;
+    unsigned long long hash;
+};
+
+/* FNV-1a over the whole output */
+static void renderPlayer(void *userData)
+{
+    Player *p = static_cast<Player *>(userData);
+    p->ok = false;
+    p->hash = 14695981039346656037ULL;
+
+    OPN2_MIDIPlayer *player = openTestPlayer(p->bankPath, *p->song, p->emulator, p->chips);
+    if(!player)
+        return;
+
+    std::vector<short> output(2 * 44100 * g_renderSeconds);
+    const size_t frames = output.size() / 2;
+    p->ok = (renderTestPlayer(player, &output[0], frames, 1024) == frames);
+    opn2_close(player);
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&output[0]);
+    for(size_t i = 0; i < output.size() * sizeof(short); ++i)
+    {
+        p->hash ^= bytes[i];
+        p->hash *= 1099511628211ULL;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn> [players]\n", argv[0]);
+        return 2;
+    }
+    const int count = (argc > 2) ? std::atoi(argv[2]) : 24;
+    const std::vector<unsigned char> song = makeStressSong();
+
+    // Emulators which are built in
+    std::vector<int> emulators;
+    for(int emulator = 0; emulator < OPNMIDI_EMU_end; ++emulator)
+    {
+        if(emulator != OPNMIDI_VGM_DUMPER && testEmulatorAvailable(emulator))
+            emulators.push_back(emulator);
+    }
+
+    std::vector<Player> players(static_cast<size_t>(count));
+    for(size_t i = 0; i < players.size(); ++i)
+    {
+        Player &p = players[i];
+        p.bankPath = argv[1];
+        p.song = &song;
+        p.emulator = emulators[i % emulators.size()];
+        p.chips = 1 + static_cast<int>((i / emulators.size()) % 3);
+    }
+
+    std::vector<OpnThread *> threads(players.size());
+    for(size_t i = 0; i < players.size(); ++i)
+    {
+        threads[i] = new OpnThread;
+        if(!threads[i]->start(&renderPlayer, &players[i]))
+        {
+            std::fprintf(stderr, "Can't start the thread %u\n", static_cast<unsigned>(i));
+            return 2;
+        }
+    }
+    for(size_t i = 0; i < players.size(); ++i)
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    int failures = 0;
+    for(size_t i = 0; i < players.size(); ++i)
+    {
+        Player serial = players[i];
+        renderPlayer(&serial);
+        const bool same = players[i].ok && serial.ok && players[i].hash == serial.hash;
+        std::printf("player %u, emulator %d, %d chips: %s\n",
+                    static_cast<unsigned>(i), serial.emulator, serial.chips,
+                    same ? "same" : "MISMATCH");
+        if(!same)
+            ++failures;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d players differ from their serial render\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Planar output test
+ *
+ * Plays the stress song through three players in chunks of odd sizes: by
+ * opn2_playPlanar(), by opn2_playFormat() into interleaved floats, and by
+ * opn2_playFormat() into a strided layout which takes the per-sample path.
+ * Then does the same by the generate functions under real-time notes. The
+ * planar channels must carry the same bits as the de-interleaved frames.
+ *
+ * Usage: planar_output <bank.wopn>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "test_player.h"
+#include "test_songs.h"
+
+/* Frames rendered by every case */
+static const size_t g_renderFrames = 44100 * 2;
+
+static const size_t g_chunks[] = {1, 7, 256, 777, 4096, 333, 2, 1000};
+
+struct PlanarCase
+{
+    int emulator;
+    int chips;
+};
+
+static const PlanarCase g_cases[] =
+{
+    {OPNMIDI_EMU_MAME, 2},
+    {OPNMIDI_EMU_GENS, 3},
+    {OPNMIDI_EMU_NUKED, 1}
+};
+
+enum OutputPath
+{
+    PathPlanar,
+    PathInterleaved,
+    PathStrided
+};
+
+static const char *const g_pathNames[] = {"planar", "interleaved", "strided"};
+
+/* Three floats per frame, the third one stays untouched */
+static const unsigned g_stride = 3 * sizeof(float);
+
+/* Plays into the left and right channels by the path, returns the count of frames */
+static size_t playChunk(OPN2_MIDIPlayer *player, bool sequencer, OutputPath path,
+                        size_t frames, std::vector<float> &scratch, float *left, float *right)
+{
+    const int count = static_cast<int>(frames);
+    if(path == PathPlanar)
+    {
+        const int got = sequencer ? opn2_playPlanar(player, count, left, right)
+                                  : opn2_generatePlanar(player, count, left, right);
+        return got > 0 ? static_cast<size_t>(got) : 0;
+    }
+
+    const unsigned perFrame = (path == PathInterleaved) ? 2 : 3;
+    OPNMIDI_AudioFormat format;
+    format.type = OPNMIDI_SampleType_F32;
+    format.containerSize = sizeof(float);
+    format.sampleOffset = perFrame * sizeof(float);
+    scratch.assign(perFrame * frames, 0.0f);
+    OPN2_UInt8 *l = reinterpret_cast<OPN2_UInt8 *>(&scratch[0]);
+    OPN2_UInt8 *r = l + sizeof(float);
+    const int got = sequencer ? opn2_playFormat(player, 2 * count, l, r, &format)
+                              : opn2_generateFormat(player, 2 * count, l, r, &format);
+    const size_t done = got > 0 ? static_cast<size_t>(got) / 2 : 0;
+    for(size_t i = 0; i < done; ++i)
+    {
+        left[i] = scratch[perFrame * i];
+        right[i] = scratch[perFrame * i + 1];
+    }
+    return done;
+}
+
+/* Returns false when the player can't be set up */
+static bool render(const char *bankPath, const std::vector<unsigned char> &song,
+                   const PlanarCase &c, bool sequencer, OutputPath path,
+                   std::vector<float> &left, std::vector<float> &right)
+{
+    OPN2_MIDIPlayer *player = openTestPlayer(bankPath, song, c.emulator, c.chips);
+    if(!player)
+        return false;
+
+    left.assign(g_renderFrames, 0.0f);
+    right.assign(g_renderFrames, 0.0f);
+    std::vector<float> scratch;
+    size_t done = 0;
+    for(size_t chunk = 0; done < g_renderFrames; ++chunk)
+    {
+        if(!sequencer && (chunk % 4) == 0)
+        {
+            const OPN2_UInt8 ch = static_cast<OPN2_UInt8>(chunk % 16);
+            const OPN2_UInt8 note = static_cast<OPN2_UInt8>(40 + chunk % 48);
+            opn2_rt_noteOn(player, ch, note, 100);
+            if(chunk >= 8)
+                opn2_rt_noteOff(player, static_cast<OPN2_UInt8>((chunk - 8) % 16),
+                                static_cast<OPN2_UInt8>(40 + (chunk - 8) % 48));
+        }
+        size_t want = g_chunks[chunk % (sizeof(g_chunks) / sizeof(size_t))];
+        if(want > g_renderFrames - done)
+            want = g_renderFrames - done;
+        const size_t got = playChunk(player, sequencer, path, want, scratch, &left[done], &right[done]);
+        done += got;
+        if(got < want)
+            break;
+    }
+    opn2_close(player);
+    return done == g_renderFrames;
+}
+
+static bool sameBits(const std::vector<float> &a, const std::vector<float> &b)
+{
+    return std::memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    const std::vector<unsigned char> song = makeStressSong();
+    int failures = 0;
+
+    for(size_t i = 0; i < sizeof(g_cases) / sizeof(PlanarCase); ++i)
+    {
+        const PlanarCase &c = g_cases[i];
+        if(!testEmulatorAvailable(c.emulator))
+            continue;
+
+        for(int s = 0; s < 2; ++s)
+        {
+            const bool sequencer = (s == 0);
+            std::vector<float> left[3], right[3];
+            for(int p = PathPlanar; p <= PathStrided; ++p)
+            {
+                if(!render(argv[1], song, c, sequencer, static_cast<OutputPath>(p), left[p], right[p]))
+                {
+                    std::fprintf(stderr, "The %s output ended early\n", g_pathNames[p]);
+                    return 2;
+                }
+            }
+
+            bool audible = false;
+            for(size_t f = 0; !audible && f < g_renderFrames; ++f)
+                audible = (left[PathPlanar][f] != 0.0f);
+
+            const char *fn = sequencer ? "play" : "generate";
+            const int before = failures;
+            for(int p = PathInterleaved; p <= PathStrided; ++p)
+            {
+                if(!sameBits(left[PathPlanar], left[p]) || !sameBits(right[PathPlanar], right[p]))
+                {
+                    std::printf("Emulator %d, %d chips, %s: planar output differs from the %s one\n",
+                                c.emulator, c.chips, fn, g_pathNames[p]);
+                    ++failures;
+                }
+            }
+            if(!audible)
+            {
+                std::printf("Emulator %d, %d chips, %s: silent\n", c.emulator, c.chips, fn);
+                ++failures;
+            }
+            else if(failures == before)
+                std::printf("Emulator %d, %d chips, %s: same\n", c.emulator, c.chips, fn);
+        }
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d outputs differ\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
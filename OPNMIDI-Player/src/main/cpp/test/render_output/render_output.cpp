@@ -0,0 +1,254 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Offline rendering test
+ *
+ * Renders the stress song to its end by opn2_renderToCallback() into a
+ * slow receiver, which keeps the ring of the writer thread full, and by
+ * opn2_renderToFile() into WAV and raw files of 16-bit and float samples.
+ * Every output must hold the same samples as opn2_play() and
+ * opn2_playFormat() called in a loop by blocks of the same size, and an
+ * aborting receiver must fail the rendering.
+ *
+ * Usage: render_output <bank.wopn>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "test_player.h"
+#include "test_songs.h"
+
+static const int g_blockSizes[] = {512, 67};
+
+static const char *const g_wavPath = "render_output_test.wav";
+static const char *const g_rawPath = "render_output_test.raw";
+
+static OPN2_MIDIPlayer *openPlayer(const char *bankPath, const std::vector<unsigned char> &song, int blockSize)
+{
+    OPN2_MIDIPlayer *player = openTestPlayer(bankPath, song, OPNMIDI_EMU_MAME, 2);
+    if(player && opn2_setBlockSize(player, blockSize) < 0)
+    {
+        opn2_close(player);
+        return NULL;
+    }
+    return player;
+}
+
+/* Bytes of the song played to its end by opn2_playFormat() in blocks */
+static bool playLoop(const char *bankPath, const std::vector<unsigned char> &song, int blockSize,
+                     const OPNMIDI_AudioFormat &format, std::vector<OPN2_UInt8> &out)
+{
+    OPN2_MIDIPlayer *player = openPlayer(bankPath, song, blockSize);
+    if(!player)
+        return false;
+    opn2_setLoopEnabled(player, 0);
+
+    const size_t blockBytes = static_cast<size_t>(blockSize) * format.sampleOffset;
+    out.clear();
+    for(;;)
+    {
+        const size_t at = out.size();
+        out.resize(at + blockBytes);
+        const int got = opn2_playFormat(player, 2 * blockSize, &out[at], &out[at] + format.containerSize, &format);
+        out.resize(at + (got > 0 ? static_cast<size_t>(got) * format.containerSize : 0));
+        if(got < 2 * blockSize)
+            break;
+    }
+    opn2_close(player);
+    return true;
+}
+
+struct Receiver
+{
+    std::vector<OPN2_UInt8> data;
+    size_t calls;
+    //! Call which aborts the rendering, 0 to never abort
+    size_t abortAt;
+};
+
+static int receive(void *userData, const OPN2_UInt8 *data, size_t size)
+{
+    Receiver *r = static_cast<Receiver *>(userData);
+    if(++r->calls == r->abortAt)
+        return -1;
+    r->data.insert(r->data.end(), data, data + size);
+    // Slower than the synthesis, the renderer waits for free blocks
+    volatile unsigned spin = 0;
+    for(unsigned i = 0; i < 20000; ++i)
+        spin += i;
+    return 0;
+}
+
+static bool readFile(const char *path, std::vector<OPN2_UInt8> &out)
+{
+    FILE *f = std::fopen(path, "rb");
+    if(!f)
+        return false;
+    out.clear();
+    OPN2_UInt8 buf[4096];
+    size_t got;
+    while((got = std::fread(buf, 1, sizeof(buf), f)) > 0)
+        out.insert(out.end(), buf, buf + got);
+    std::fclose(f);
+    return true;
+}
+
+static unsigned readLE32(const OPN2_UInt8 *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<unsigned>(in[3]) << 24);
+}
+
+static bool sameData(const char *what, int blockSize, const std::vector<OPN2_UInt8> &got,
+                     const std::vector<OPN2_UInt8> &expect)
+{
+    if(got.size() == expect.size() && std::memcmp(&got[0], &expect[0], got.size()) == 0)
+        return true;
+    size_t firstDiff = 0;
+    while(firstDiff < got.size() && firstDiff < expect.size() && got[firstDiff] == expect[firstDiff])
+        ++firstDiff;
+    std::printf("Block size %d, %s: %u bytes, expected %u, differ from byte %u\n", blockSize, what,
+                static_cast<unsigned>(got.size()), static_cast<unsigned>(expect.size()),
+                static_cast<unsigned>(firstDiff));
+    return false;
+}
+
+/* Returns the count of failed checks, or -1 when the player can't be set up */
+static int testBlockSize(const char *bankPath, const std::vector<unsigned char> &song, int blockSize)
+{
+    const OPNMIDI_AudioFormat s16 = {OPNMIDI_SampleType_S16, sizeof(OPN2_SInt16), 2 * sizeof(OPN2_SInt16)};
+    const OPNMIDI_AudioFormat f32 = {OPNMIDI_SampleType_F32, sizeof(float), 2 * sizeof(float)};
+    std::vector<OPN2_UInt8> expectS16, expectF32, file;
+    if(!playLoop(bankPath, song, blockSize, s16, expectS16) ||
+       !playLoop(bankPath, song, blockSize, f32, expectF32))
+        return -1;
+
+    int failures = 0;
+    OPN2_MIDIPlayer *player;
+    OPNMIDI_RenderStats stats;
+
+    // Into the slow receiver, the default format is signed 16-bit
+    Receiver receiver;
+    receiver.calls = 0;
+    receiver.abortAt = 0;
+    if(!(player = openPlayer(bankPath, song, blockSize)))
+        return -1;
+    if(opn2_renderToCallback(player, NULL, &receive, &receiver, &stats) < 0)
+    {
+        std::printf("Block size %d: rendering to the callback failed: %s\n", blockSize, opn2_errorInfo(player));
+        ++failures;
+    }
+    else if(!sameData("callback", blockSize, receiver.data, expectS16) || stats.frames * 4 != expectS16.size())
+        ++failures;
+    opn2_close(player);
+
+    // WAV file of 16-bit samples
+    if(!(player = openPlayer(bankPath, song, blockSize)))
+        return -1;
+    if(opn2_renderToFile(player, g_wavPath, OPNMIDI_RenderFile_WAV, &s16, &stats) < 0 || !readFile(g_wavPath, file))
+    {
+        std::printf("Block size %d: rendering to the WAV file failed: %s\n", blockSize, opn2_errorInfo(player));
+        ++failures;
+    }
+    else
+    {
+        const bool header = file.size() >= 44 && std::memcmp(&file[0], "RIFF", 4) == 0 &&
+                            std::memcmp(&file[36], "data", 4) == 0 &&
+                            readLE32(&file[40]) == expectS16.size() &&
+                            readLE32(&file[4]) == expectS16.size() + 36;
+        if(!header)
+        {
+            std::printf("Block size %d: the WAV header doesn't tell the size of the data\n", blockSize);
+            ++failures;
+        }
+        else if(!sameData("WAV file", blockSize, std::vector<OPN2_UInt8>(file.begin() + 44, file.end()), expectS16))
+            ++failures;
+    }
+    opn2_close(player);
+    std::remove(g_wavPath);
+
+    // Raw file of float samples
+    if(!(player = openPlayer(bankPath, song, blockSize)))
+        return -1;
+    if(opn2_renderToFile(player, g_rawPath, OPNMIDI_RenderFile_RAW, &f32, &stats) < 0 || !readFile(g_rawPath, file))
+    {
+        std::printf("Block size %d: rendering to the raw file failed: %s\n", blockSize, opn2_errorInfo(player));
+        ++failures;
+    }
+    else if(!sameData("raw float file", blockSize, file, expectF32))
+        ++failures;
+    opn2_close(player);
+    std::remove(g_rawPath);
+
+    // The receiver stops the rendering
+    Receiver aborting;
+    aborting.calls = 0;
+    aborting.abortAt = 3;
+    if(!(player = openPlayer(bankPath, song, blockSize)))
+        return -1;
+    if(opn2_renderToCallback(player, NULL, &receive, &aborting, NULL) >= 0)
+    {
+        std::printf("Block size %d: the aborted rendering succeeds\n", blockSize);
+        ++failures;
+    }
+    opn2_close(player);
+
+    if(failures == 0)
+        std::printf("Block size %d: %u frames, same\n", blockSize, static_cast<unsigned>(expectS16.size() / 4));
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    if(!testEmulatorAvailable(OPNMIDI_EMU_MAME))
+    {
+        std::printf("MAME emulator is not built in, skipped\n");
+        return 0;
+    }
+
+    const std::vector<unsigned char> song = makeStressSong();
+    int failures = 0;
+    for(size_t i = 0; i < sizeof(g_blockSizes) / sizeof(int); ++i)
+    {
+        const int r = testBlockSize(argv[1], song, g_blockSizes[i]);
+        if(r < 0)
+            return 2;
+        failures += r;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d outputs differ from the play loop\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
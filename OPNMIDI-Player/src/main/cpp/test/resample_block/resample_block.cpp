@@ -0,0 +1,142 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Block resampling test
+ *
+ * Feeds the same full-scale noise through two chips of a test backend:
+ * one renders its output in chunks of odd sizes through the block path,
+ * the other one frame at a time through resampledGenerate(). Every output
+ * rate, resampler and running at PCM rate must give the same samples.
+ *
+ * Usage: resample_block
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "chips/opn_chip_base.h"
+
+/* Noise over the whole 16-bit range, the worst case of the interpolation */
+template <int PreAmplify, int PostAttenuate>
+class NoiseChip final : public OPNChipBaseT<NoiseChip<PreAmplify, PostAttenuate> >
+{
+    uint32_t m_seed;
+public:
+    NoiseChip() : OPNChipBaseT<NoiseChip<PreAmplify, PostAttenuate> >(OPNChip_OPN2), m_seed(1) {}
+
+    bool canRunAtPcmRate() const override { return true; }
+    void writeReg(uint32_t, uint16_t, uint8_t) override {}
+    void nativePreGenerate() override {}
+    void nativePostGenerate() override {}
+    void nativeGenerate(int16_t *frame) override
+    {
+        m_seed = m_seed * 1664525u + 1013904223u;
+        frame[0] = static_cast<int16_t>(m_seed >> 16);
+        // Runs of full scale on the right, the largest sums of the interpolation
+        frame[1] = ((m_seed >> 8) & 0x40) ? ((m_seed & 0x80) ? 32767 : -32768) : frame[0];
+    }
+    const char *emulatorName() override { return "Noise"; }
+
+    void generateFrameByFrame(int32_t *output, size_t frames)
+    {
+        for(size_t i = 0; i < frames; ++i)
+            this->resampledGenerate(output + 2 * i);
+    }
+
+    enum { resamplerPreAmplify = PreAmplify, resamplerPostAttenuate = PostAttenuate };
+};
+
+/* Output frames rendered by every case */
+static const size_t g_frames = 20000;
+
+/* Sizes of the successive chunks: single frames, around the block of 256 frames, and longer */
+static const size_t g_chunks[] = {1, 3, 255, 256, 257, 7, 1000, 511, 4097};
+
+/* Down to the rates which don't fit a single output frame into the block */
+static const uint32_t g_rates[] = {150, 8000, 11025, 22050, 44100, 48000, 53267, 96000, 192000};
+
+template <class Chip>
+static bool sameOutput(uint32_t rate, int quality, bool pcmRate)
+{
+    const uint32_t clock = opn2_getNativeClockRate(OPNChip_OPN2);
+    Chip block, reference;
+    Chip *chips[2] = {&block, &reference};
+    for(int c = 0; c < 2; ++c)
+    {
+        chips[c]->setResamplerQuality(quality);
+        chips[c]->setRunningAtPcmRate(pcmRate);
+        chips[c]->setRate(rate, clock);
+    }
+
+    std::vector<int32_t> got(2 * g_frames), want(2 * g_frames);
+    size_t done = 0;
+    for(size_t c = 0; done < g_frames; ++c)
+    {
+        size_t count = g_chunks[c % (sizeof(g_chunks) / sizeof(size_t))];
+        count = (count < g_frames - done) ? count : g_frames - done;
+        block.generate32(&got[2 * done], count);
+        done += count;
+    }
+    reference.generateFrameByFrame(&want[0], g_frames);
+
+    for(size_t s = 0; s < got.size(); ++s)
+    {
+        if(got[s] != want[s])
+        {
+            std::printf("rate %u, quality %d, PCM rate %d, scale %d/%d: MISMATCH at frame %u\n",
+                        rate, quality, pcmRate ? 1 : 0,
+                        static_cast<int>(Chip::resamplerPreAmplify),
+                        static_cast<int>(Chip::resamplerPostAttenuate),
+                        static_cast<unsigned>(s / 2));
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    int failures = 0;
+    for(size_t r = 0; r < sizeof(g_rates) / sizeof(uint32_t); ++r)
+    {
+        for(int quality = OPNChipResampler::Quality_Linear; quality <= OPNChipResampler::Quality_High; ++quality)
+        {
+            // The plain scale, and the one of Nuked OPN2
+            if(!sameOutput<NoiseChip<1, 1> >(g_rates[r], quality, false))
+                ++failures;
+            if(!sameOutput<NoiseChip<11, 2> >(g_rates[r], quality, false))
+                ++failures;
+        }
+        if(!sameOutput<NoiseChip<11, 2> >(g_rates[r], OPNChipResampler::Quality_Linear, true))
+            ++failures;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d cases differ from the frame by frame output\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
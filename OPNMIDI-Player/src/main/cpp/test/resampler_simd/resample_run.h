@@ -0,0 +1,97 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Resampler runs shared by the vector and the scalar builds of the resampler
+ */
+
+#ifndef OPNMIDI_RESAMPLE_RUN_H
+#define OPNMIDI_RESAMPLE_RUN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct ResampleCase
+{
+    uint32_t rate;
+    int quality;
+    float gain;
+    //! Sizes of the successive blocks, up to maxBlock
+    const size_t *blocks;
+    size_t blockCount;
+    //! Feed the 32-bit sums of several chips instead of a single chip
+    bool wide;
+};
+
+enum { resampleMaxBlock = 512, resampleFrames = 30000 };
+
+void resampleVector(const ResampleCase &c, std::vector<int32_t> &out);
+void resampleVector(const ResampleCase &c, std::vector<float> &out);
+void resampleScalar(const ResampleCase &c, std::vector<int32_t> &out);
+void resampleScalar(const ResampleCase &c, std::vector<float> &out);
+
+static inline void resampleProcess(OPN_RESAMPLER *r, int32_t *out, size_t frames)
+{
+    r->process(out, frames);
+}
+
+static inline void resampleProcess(OPN_RESAMPLER *r, float *out, size_t frames)
+{
+    r->process(out, frames, 1.0f / 32767.0f);
+}
+
+/* Feeds the same noise to every run, whatever its blocks */
+template <class Sample>
+static void runResampler(const ResampleCase &c, std::vector<Sample> &out)
+{
+    OPN_RESAMPLER r;
+    r.setup(OPN_RESAMPLER::nativeStep(7670454, c.rate, c.quality), c.quality, c.gain, resampleMaxBlock);
+    out.resize(2 * resampleFrames);
+    std::vector<int16_t> narrow;
+    std::vector<int32_t> wide;
+    uint32_t seed = 1;
+    size_t done = 0;
+    for(size_t b = 0; done < resampleFrames; ++b)
+    {
+        size_t count = c.blocks[b % c.blockCount];
+        count = (count < resampleFrames - done) ? count : resampleFrames - done;
+        const size_t need = r.inputFrames(count);
+        narrow.resize(2 * need + 2);
+        wide.resize(2 * need + 2);
+        for(size_t i = 0; i < 2 * need; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            narrow[i] = static_cast<int16_t>(seed >> 16);
+            wide[i] = static_cast<int32_t>(seed) >> 13;
+        }
+        if(c.wide)
+            r.feed(&wide[0], need);
+        else
+            r.feed(&narrow[0], need);
+        resampleProcess(&r, &out[2 * done], count);
+        done += count;
+    }
+}
+
+#endif // OPNMIDI_RESAMPLE_RUN_H
@@ -0,0 +1,43 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The resampler built with the scalar kernel only, under its own name
+ */
+
+#define OPNMIDI_DISABLE_SIMD
+#define OPNChipResampler OPNChipResamplerScalar
+#include "chips/opn_chip_resampler.cpp"
+
+#define OPN_RESAMPLER OPNChipResamplerScalar
+#include "resample_run.h"
+
+void resampleScalar(const ResampleCase &c, std::vector<int32_t> &out)
+{
+    runResampler(c, out);
+}
+
+void resampleScalar(const ResampleCase &c, std::vector<float> &out)
+{
+    runResampler(c, out);
+}
@@ -0,0 +1,138 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Vector resampler kernel test
+ *
+ * Runs the resampler built with the SSE or NEON kernel of the target and
+ * the one built with the scalar kernel over the same noise, for every
+ * quality, a few output rates and gains, the 16-bit and the wide inputs,
+ * and the integer and float outputs. Both must give the same samples, and
+ * so must the same run split into blocks of other sizes.
+ *
+ * Usage: resampler_simd
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "chips/opn_chip_resampler.cpp"
+
+#define OPN_RESAMPLER OPNChipResampler
+#include "resample_run.h"
+
+void resampleVector(const ResampleCase &c, std::vector<int32_t> &out)
+{
+    runResampler(c, out);
+}
+
+void resampleVector(const ResampleCase &c, std::vector<float> &out)
+{
+    runResampler(c, out);
+}
+
+static const size_t g_wholeBlocks[] = {resampleMaxBlock};
+static const size_t g_oddBlocks[] = {1, 7, 255, 256, 257, 3, 511, 100};
+
+static const uint32_t g_rates[] = {8000, 22050, 44100, 48000, 96000};
+
+static const char *kernelName()
+{
+#if defined(OPN_RESAMPLER_SSE)
+    return "SSE";
+#elif defined(OPN_RESAMPLER_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+template <class Sample>
+static bool sameSamples(const char *what, const ResampleCase &c,
+                        const std::vector<Sample> &got, const std::vector<Sample> &want)
+{
+    for(size_t s = 0; s < want.size(); ++s)
+    {
+        if(got[s] != want[s])
+        {
+            std::printf("%s: rate %u, quality %d, gain %g%s: MISMATCH at frame %u\n",
+                        what, c.rate, c.quality, static_cast<double>(c.gain),
+                        c.wide ? ", wide input" : "", static_cast<unsigned>(s / 2));
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Sample>
+static int runCase(ResampleCase c)
+{
+    int failures = 0;
+    std::vector<Sample> vector, scalar, split;
+    c.blocks = g_wholeBlocks;
+    c.blockCount = sizeof(g_wholeBlocks) / sizeof(size_t);
+    resampleVector(c, vector);
+    resampleScalar(c, scalar);
+    c.blocks = g_oddBlocks;
+    c.blockCount = sizeof(g_oddBlocks) / sizeof(size_t);
+    resampleVector(c, split);
+    if(!sameSamples("vector vs scalar", c, vector, scalar))
+        ++failures;
+    if(!sameSamples("odd blocks", c, split, vector))
+        ++failures;
+    return failures;
+}
+
+int main()
+{
+    std::printf("Vector kernel: %s\n", kernelName());
+
+    int failures = 0;
+    for(size_t r = 0; r < sizeof(g_rates) / sizeof(uint32_t); ++r)
+    {
+        for(int quality = OPNChipResampler::Quality_Linear; quality <= OPNChipResampler::Quality_High; ++quality)
+        {
+            for(int wide = 0; wide < 2; ++wide)
+            {
+                ResampleCase c;
+                c.rate = g_rates[r];
+                c.quality = quality;
+                // The gain of Nuked OPN2 on one chip, the plain one on the bus
+                c.gain = wide ? 1.0f : 5.5f;
+                c.blocks = g_wholeBlocks;
+                c.blockCount = 1;
+                c.wide = (wide != 0);
+                failures += runCase<int32_t>(c);
+                failures += runCase<float>(c);
+            }
+        }
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d comparisons differ\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
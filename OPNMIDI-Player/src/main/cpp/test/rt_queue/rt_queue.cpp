@@ -0,0 +1,284 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Real-time event queue test
+ *
+ * Several threads push numbered messages into the queue at once while the
+ * renderer thread pops them: every message must come out once, in the order
+ * of its producer. Then messages queued by opn2_rt_enqueue() at frames on
+ * both sides of the render block splits and of the chunk ends must sound the
+ * same as the real-time calls made after rendering exactly up to their frames.
+ *
+ * Usage: rt_queue <bank.wopn>
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "opnmidi_rt_queue.hpp"
+#include "opnmidi_threads.hpp"
+#include "test_player.h"
+
+static const int g_producers = 4;
+static const uint32_t g_messagesPerProducer = 50000;
+
+struct Producer
+{
+    OpnRtEventQueue *queue;
+    uint8_t id;
+    //! Pushes refused by the full queue
+    unsigned long refused;
+};
+
+static void produce(void *userData)
+{
+    Producer *p = static_cast<Producer *>(userData);
+    for(uint32_t seq = 0; seq < g_messagesPerProducer; ++seq)
+    {
+        const uint8_t msg[4] =
+        {
+            static_cast<uint8_t>(0x90 | p->id),
+            static_cast<uint8_t>(seq & 0x7F),
+            static_cast<uint8_t>((seq >> 7) & 0x7F),
+            static_cast<uint8_t>((seq >> 14) & 0x7F)
+        };
+        while(!p->queue->push(seq, msg, sizeof(msg)))
+            p->refused++;
+    }
+}
+
+static int testProducers()
+{
+    OpnRtEventQueue queue;
+    Producer producers[g_producers];
+    OpnThread threads[g_producers];
+    for(int i = 0; i < g_producers; ++i)
+    {
+        producers[i].queue = &queue;
+        producers[i].id = static_cast<uint8_t>(i);
+        producers[i].refused = 0;
+        if(!threads[i].start(&produce, &producers[i]))
+        {
+            std::fprintf(stderr, "Can't start the thread %d\n", i);
+            return -1;
+        }
+    }
+
+    uint32_t expect[g_producers] = {0};
+    const uint32_t total = g_producers * g_messagesPerProducer;
+    uint32_t got = 0;
+    int failures = 0;
+    while(got < total && failures == 0)
+    {
+        OpnRtEventQueue::Event e;
+        if(!queue.pop(e))
+            continue;
+        ++got;
+        const int id = e.data[0] & 0x0F;
+        const uint32_t seq = e.data[1] | (e.data[2] << 7) | (e.data[3] << 14);
+        if(e.size != 4 || id >= g_producers || seq != e.frame || seq != expect[id])
+        {
+            std::printf("Message %u: producer %d, number %u of frame %u, expected number %u\n",
+                        got, id, seq, e.frame, id < g_producers ? expect[id] : 0);
+            ++failures;
+            break;
+        }
+        expect[id]++;
+    }
+
+    unsigned long refused = 0;
+    for(int i = 0; i < g_producers; ++i)
+    {
+        threads[i].join();
+        refused += producers[i].refused;
+    }
+
+    OpnRtEventQueue::Event extra;
+    if(failures == 0 && queue.pop(extra))
+    {
+        std::printf("The queue gives more messages than were pushed\n");
+        ++failures;
+    }
+    if(failures == 0)
+        std::printf("%d producers: %u messages in order, %lu pushes refused by the full queue\n",
+                    g_producers, total, refused);
+    return failures;
+}
+
+struct TimedMessage
+{
+    //! Frame from the start of the render
+    uint32_t frame;
+    uint8_t data[3];
+};
+
+/* Frames at and around the splits of the render blocks and of the chunks */
+static const TimedMessage g_messages[] =
+{
+    {0,    {0x90, 60, 100}},
+    {99,   {0x91, 64, 100}},
+    {100,  {0xE0, 0x00, 0x50}},
+    {511,  {0x92, 67, 100}},
+    {512,  {0xB1, 7, 60}},
+    {513,  {0xE0, 0x00, 0x30}},
+    {1024, {0x80, 60, 0}},
+    {1024, {0x90, 62, 100}}, // Same frame, after the note off
+    {2999, {0x93, 48, 110}},
+    {3000, {0x81, 64, 0}},
+    {3511, {0x94, 72, 90}},
+    {5000, {0x95, 76, 100}},
+    {5000, {0x85, 76, 0}}, // Released at once, nothing sounds
+    {6143, {0xE2, 0x7F, 0x7F}},
+    {8999, {0x84, 72, 0}}
+};
+
+static const size_t g_chunkFrames = 3000;
+static const size_t g_renderFrames = 3 * g_chunkFrames;
+
+static void sendNow(OPN2_MIDIPlayer *player, const uint8_t *data)
+{
+    const OPN2_UInt8 ch = data[0] & 0x0F;
+    switch(data[0] & 0xF0)
+    {
+    case 0x80:
+        opn2_rt_noteOff(player, ch, data[1]);
+        break;
+    case 0x90:
+        opn2_rt_noteOn(player, ch, data[1], data[2]);
+        break;
+    case 0xB0:
+        opn2_rt_controllerChange(player, ch, data[1], data[2]);
+        break;
+    case 0xE0:
+        opn2_rt_pitchBendML(player, ch, data[2], data[1]);
+        break;
+    }
+}
+
+static OPN2_MIDIPlayer *openPlayer(const char *bankPath, int blockSize)
+{
+    OPN2_MIDIPlayer *player = opn2_init(44100);
+    if(!player)
+        return NULL;
+    if(opn2_setNumChips(player, 2) < 0 ||
+       opn2_openBankFile(player, bankPath) < 0 ||
+       opn2_setBlockSize(player, blockSize) < 0)
+    {
+        std::fprintf(stderr, "Can't set up the player: %s\n", opn2_errorInfo(player));
+        opn2_close(player);
+        return NULL;
+    }
+    return player;
+}
+
+static bool generate(OPN2_MIDIPlayer *player, short *out, size_t frames)
+{
+    return frames == 0 || opn2_generate(player, static_cast<int>(2 * frames), out) == static_cast<int>(2 * frames);
+}
+
+/* Returns -1 when the players can't be set up */
+static int testFrames(const char *bankPath, int blockSize)
+{
+    const size_t count = sizeof(g_messages) / sizeof(TimedMessage);
+    OPN2_MIDIPlayer *queued = openPlayer(bankPath, blockSize);
+    OPN2_MIDIPlayer *direct = openPlayer(bankPath, blockSize);
+    if(!queued || !direct)
+    {
+        opn2_close(queued);
+        opn2_close(direct);
+        return -1;
+    }
+
+    std::vector<short> outQueued(2 * g_renderFrames), outDirect(2 * g_renderFrames);
+    bool rendered = true;
+
+    // All messages queued at once, the later ones wait for their chunks
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(opn2_rt_enqueue(queued, g_messages[i].frame, g_messages[i].data, 3) < 0)
+            rendered = false;
+    }
+    for(size_t f = 0; rendered && f < g_renderFrames; f += g_chunkFrames)
+        rendered = generate(queued, &outQueued[2 * f], g_chunkFrames);
+
+    size_t done = 0;
+    for(size_t i = 0; rendered && i <= count; ++i)
+    {
+        const size_t until = (i < count) ? g_messages[i].frame : g_renderFrames;
+        rendered = generate(direct, &outDirect[2 * done], until - done);
+        done = until;
+        if(i < count)
+            sendNow(direct, g_messages[i].data);
+    }
+
+    opn2_close(queued);
+    opn2_close(direct);
+    if(!rendered)
+    {
+        std::fprintf(stderr, "Block size %d: can't queue or render\n", blockSize);
+        return -1;
+    }
+
+    for(size_t s = 0; s < outQueued.size(); ++s)
+    {
+        if(outQueued[s] != outDirect[s])
+        {
+            std::printf("Block size %d: MISMATCH from frame %u\n", blockSize, static_cast<unsigned>(s / 2));
+            return 1;
+        }
+    }
+    std::printf("Block size %d: same\n", blockSize);
+    return 0;
+}
+
+static const int g_blockSizes[] = {512, 100, 4096};
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    int failures = testProducers();
+    if(failures < 0)
+        return 2;
+
+    for(size_t i = 0; i < sizeof(g_blockSizes) / sizeof(int); ++i)
+    {
+        const int r = testFrames(argv[1], g_blockSizes[i]);
+        if(r < 0)
+            return 2;
+        failures += r;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d checks of the queue\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
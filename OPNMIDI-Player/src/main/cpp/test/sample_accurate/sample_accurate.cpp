@@ -0,0 +1,175 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Sample-accurate timing test
+ *
+ * Plays a song of lone notes, each one starting on a whole frame after the
+ * previous one has died out, by opn2_play() in chunks of odd sizes with the
+ * sample-accurate timing on. Every note must start exactly its distance in
+ * frames after the first one, whatever the chunks, and every chunk size must
+ * give the same samples. The chips run at the output rate, so a note starts
+ * on the frame of its key-on.
+ *
+ * Usage: sample_accurate <bank.wopn>
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "smf_writer.h"
+#include "test_player.h"
+
+/* 64 ticks of the song take 2940 frames at 44100 Hz */
+static const unsigned g_tickStep = 64;
+static const size_t g_framesPerStep = 2940;
+
+/* Steps between the notes, long enough for the release to fall silent */
+static const unsigned g_noteSteps = 23;
+static const unsigned g_notes = 6;
+
+static const size_t g_renderFrames = (g_notes + 1) * g_noteSteps * g_framesPerStep;
+
+static const size_t g_chunks[] = {44100, 1, 7, 100, 333, 777, 4096};
+
+static std::vector<unsigned char> makeLoneNotesSong()
+{
+    SmfWriter smf;
+    smf.tempo(500000);
+    smf.event(0xC0, 0, 0);
+    smf.wait(g_tickStep);
+    for(unsigned n = 0; n < g_notes; ++n)
+    {
+        smf.event(0x90, 60, 100);
+        smf.wait(4 * g_tickStep);
+        smf.event(0x80, 60, 0);
+        smf.wait((g_noteSteps - 4) * g_tickStep);
+    }
+    return smf.finish();
+}
+
+/* Returns false when the player can't be set up */
+static bool render(const char *bankPath, const std::vector<unsigned char> &song,
+                   size_t chunk, std::vector<short> &out)
+{
+    OPN2_MIDIPlayer *player = openTestPlayer(bankPath, song, OPNMIDI_EMU_MAME, 1);
+    if(!player)
+        return false;
+    opn2_setLoopEnabled(player, 0);
+    opn2_setRunAtPcmRate(player, 1);
+    opn2_setSampleAccurate(player, 1);
+
+    out.assign(2 * g_renderFrames, 0);
+    renderTestPlayer(player, &out[0], g_renderFrames, chunk);
+    opn2_close(player);
+    return true;
+}
+
+/* Frames where the sound starts after the silence */
+static std::vector<size_t> findOnsets(const std::vector<short> &out)
+{
+    std::vector<size_t> onsets;
+    size_t quiet = g_framesPerStep; // The song starts after the silence
+    for(size_t f = 0; f < out.size() / 2; ++f)
+    {
+        if(out[2 * f] == 0 && out[2 * f + 1] == 0)
+        {
+            ++quiet;
+            continue;
+        }
+        if(quiet >= g_framesPerStep)
+            onsets.push_back(f);
+        quiet = 0;
+    }
+    return onsets;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    if(!testEmulatorAvailable(OPNMIDI_EMU_MAME))
+    {
+        std::printf("MAME emulator is not built in, skipped\n");
+        return 0;
+    }
+
+    const std::vector<unsigned char> song = makeLoneNotesSong();
+    std::vector<short> reference, out;
+    int failures = 0;
+
+    for(size_t c = 0; c < sizeof(g_chunks) / sizeof(size_t); ++c)
+    {
+        const size_t chunk = g_chunks[c];
+        if(!render(argv[1], song, chunk, c == 0 ? reference : out))
+            return 2;
+        const std::vector<short> &played = (c == 0) ? reference : out;
+
+        const std::vector<size_t> onsets = findOnsets(played);
+        bool onTime = (onsets.size() == g_notes);
+        for(size_t n = 1; onTime && n < onsets.size(); ++n)
+            onTime = (onsets[n] - onsets[0] == n * g_noteSteps * g_framesPerStep);
+        if(!onTime)
+        {
+            std::printf("Chunks of %u frames: %u notes start at", static_cast<unsigned>(chunk),
+                        static_cast<unsigned>(onsets.size()));
+            for(size_t n = 0; n < onsets.size(); ++n)
+                std::printf(" %u", static_cast<unsigned>(onsets[n]));
+            std::printf(", expected %u apart\n", static_cast<unsigned>(g_noteSteps * g_framesPerStep));
+            ++failures;
+            continue;
+        }
+
+        size_t firstDiff = played.size();
+        for(size_t s = 0; c > 0 && s < played.size(); ++s)
+        {
+            if(played[s] != reference[s])
+            {
+                firstDiff = s;
+                break;
+            }
+        }
+        if(firstDiff != played.size())
+        {
+            std::printf("Chunks of %u frames: MISMATCH from frame %u\n", static_cast<unsigned>(chunk),
+                        static_cast<unsigned>(firstDiff / 2));
+            ++failures;
+        }
+        else
+            std::printf("Chunks of %u frames: notes from frame %u, on time\n", static_cast<unsigned>(chunk),
+                        static_cast<unsigned>(onsets[0]));
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d chunk sizes move the events\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Block sample converter test
+ *
+ * Converts blocks of every length up to a few vectors, and a long one, at
+ * unaligned addresses, by the block converters of the target (SSE2 or NEON,
+ * and AVX2 when the processor has it) and sample by sample by opn2_cvtS16()
+ * and opn2_cvtReal<float>(). The samples run over the whole int32 range,
+ * past the clipping of 16-bit output and past the precision of float, and
+ * both ways must give the same bits without writing out of the block.
+ *
+ * Usage: sample_cvt
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "opnmidi_private.hpp"
+#include "opnmidi_sample_cvt.hpp"
+
+#ifdef OPNMIDI_TEST_AVX2
+extern void opn2_cvtBlockS16Avx2(int16_t *dst, const int32_t *src, size_t samples);
+extern void opn2_cvtBlockF32Avx2(float *dst, const int32_t *src, size_t samples);
+extern void opn2_cvtBlockF32PlanarAvx2(float *left, float *right, const int32_t *src, size_t frames);
+#endif
+
+struct BlockConverters
+{
+    const char *name;
+    void (*s16)(int16_t *, const int32_t *, size_t);
+    void (*f32)(float *, const int32_t *, size_t);
+    void (*f32Planar)(float *, float *, const int32_t *, size_t);
+};
+
+/* Samples around the clipping and the float precision, taken before the random ones */
+static const int32_t g_edges[] =
+{
+    0, 1, -1, INT16_MAX, INT16_MAX + 1, INT16_MIN, INT16_MIN - 1, 70000, -70000,
+    INT32_MAX, INT32_MIN, INT32_MAX - 64, INT32_MIN + 1, 16777217, -16777217, 33554435
+};
+
+/* Guard value of the destination around the block */
+static const int16_t g_guard16 = 0x5A5A;
+static const float g_guardF = -12345.0f;
+/* Destination offset from the start of the buffer, keeps the stores unaligned */
+static const size_t g_skew = 1;
+
+static void makeSamples(std::vector<int32_t> &src, size_t count, uint32_t &seed)
+{
+    const size_t edges = sizeof(g_edges) / sizeof(int32_t);
+    src.resize(count + g_skew);
+    for(size_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int32_t s;
+        if(i < edges)
+            s = g_edges[(i + count) % edges];
+        else if(seed & 0x100)
+            s = static_cast<int32_t>(seed); // Anywhere in the range
+        else
+            s = static_cast<int32_t>(seed >> 12) - 0x80000; // Around the 16-bit range
+        src[g_skew + i] = s;
+    }
+}
+
+static bool sameFloats(const float *a, const float *b, size_t count)
+{
+    return std::memcmp(a, b, count * sizeof(float)) == 0;
+}
+
+static int testConverters(const BlockConverters &cvt)
+{
+    std::vector<size_t> lengths;
+    for(size_t n = 0; n <= 67; ++n)
+        lengths.push_back(n);
+    lengths.push_back(4099);
+
+    int failures = 0;
+    uint32_t seed = 1;
+    std::vector<int32_t> src;
+
+    for(size_t l = 0; l < lengths.size(); ++l)
+    {
+        const size_t n = lengths[l];
+        makeSamples(src, n, seed);
+        const int32_t *in = &src[g_skew];
+
+        std::vector<int16_t> s16(n + 2 * g_skew, g_guard16);
+        cvt.s16(&s16[g_skew], in, n);
+        bool good = (s16[0] == g_guard16 && s16[n + g_skew] == g_guard16);
+        for(size_t i = 0; good && i < n; ++i)
+            good = (s16[g_skew + i] == static_cast<int16_t>(opn2_cvtS16(in[i])));
+        if(!good)
+        {
+            std::printf("%s: S16 of %u samples differs\n", cvt.name, static_cast<unsigned>(n));
+            ++failures;
+        }
+
+        std::vector<float> expect(n + 1), f32(n + 2 * g_skew, g_guardF);
+        for(size_t i = 0; i < n; ++i)
+            expect[i] = opn2_cvtReal<float>(in[i]);
+        cvt.f32(&f32[g_skew], in, n);
+        if(f32[0] != g_guardF || f32[n + g_skew] != g_guardF || !sameFloats(&f32[g_skew], &expect[0], n))
+        {
+            std::printf("%s: F32 of %u samples differs\n", cvt.name, static_cast<unsigned>(n));
+            ++failures;
+        }
+
+        const size_t frames = n / 2;
+        std::vector<float> expectL(frames + 1), expectR(frames + 1);
+        std::vector<float> left(frames + 2 * g_skew, g_guardF), right(frames + 2 * g_skew, g_guardF);
+        for(size_t i = 0; i < frames; ++i)
+        {
+            expectL[i] = opn2_cvtReal<float>(in[2 * i]);
+            expectR[i] = opn2_cvtReal<float>(in[2 * i + 1]);
+        }
+        cvt.f32Planar(&left[g_skew], &right[g_skew], in, frames);
+        if(left[0] != g_guardF || left[frames + g_skew] != g_guardF ||
+           right[0] != g_guardF || right[frames + g_skew] != g_guardF ||
+           !sameFloats(&left[g_skew], &expectL[0], frames) ||
+           !sameFloats(&right[g_skew], &expectR[0], frames))
+        {
+            std::printf("%s: planar F32 of %u frames differs\n", cvt.name, static_cast<unsigned>(frames));
+            ++failures;
+        }
+    }
+
+    if(failures == 0)
+        std::printf("%s: same\n", cvt.name);
+    return failures;
+}
+
+static const char *targetName()
+{
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    return "SSE2";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+int main()
+{
+    int failures = 0;
+
+    const BlockConverters target = {targetName(), opn2_cvtBlockS16, opn2_cvtBlockF32, opn2_cvtBlockF32Planar};
+    failures += testConverters(target);
+
+#ifdef OPNMIDI_TEST_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        const BlockConverters avx2 = {"AVX2", opn2_cvtBlockS16Avx2, opn2_cvtBlockF32Avx2, opn2_cvtBlockF32PlanarAvx2};
+        failures += testConverters(avx2);
+    }
+    else
+        std::printf("AVX2: not supported by the processor, skipped\n");
+#endif
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d blocks differ from the per-sample conversion\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
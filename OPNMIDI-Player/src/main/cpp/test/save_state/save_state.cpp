@@ -0,0 +1,279 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * State snapshot test
+ *
+ * For every emulator which saves its state and every resampler setup,
+ * snapshots one player in the middle of held notes, and loads the
+ * snapshot into a twin which went its own way meanwhile. Both must then
+ * continue with the same samples. A snapshot with one broken chip must
+ * be refused with the twin left as it was, not restored in part.
+ *
+ * Usage: save_state <bank.wopn>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <opnmidi.h>
+
+/* Frames rendered before the snapshot, and after it */
+static const size_t g_framesBefore = 22050;
+static const size_t g_framesAfter = 22050;
+/* Frames the twin renders beyond the snapshot before it gets loaded */
+static const size_t g_framesAside = 1237;
+
+static const int g_chips = 2;
+
+struct Setup
+{
+    const char *name;
+    int quality;
+    int pcmRate;
+    int busResampling;
+};
+
+static const Setup g_setups[] =
+{
+    {"linear", OPNMIDI_Resampler_Linear, 0, 0},
+    {"low", OPNMIDI_Resampler_Low, 0, 0},
+    {"medium", OPNMIDI_Resampler_Medium, 0, 0},
+    {"high", OPNMIDI_Resampler_High, 0, 0},
+    {"bus", OPNMIDI_Resampler_Medium, 0, 1},
+    {"pcm rate", OPNMIDI_Resampler_Linear, 1, 0}
+};
+
+static OPN2_MIDIPlayer *openPlayer(const char *bankPath, int emulator, const Setup &setup)
+{
+    OPN2_MIDIPlayer *player = opn2_init(44100);
+    if(!player)
+        return NULL;
+    if(opn2_switchEmulator(player, emulator) < 0 ||
+       opn2_setResamplerQuality(player, setup.quality) < 0 ||
+       opn2_setRunAtPcmRate(player, setup.pcmRate) < 0 ||
+       opn2_setBusResampling(player, setup.busResampling) < 0 ||
+       opn2_setNumChips(player, g_chips) < 0 ||
+       opn2_openBankFile(player, bankPath) < 0)
+    {
+        opn2_close(player);
+        return NULL;
+    }
+    return player;
+}
+
+/* Fewer notes than the chips have channels, so none of them arpeggiates */
+static void notes(OPN2_MIDIPlayer *player, bool on, int first, int count)
+{
+    for(int n = first; n < first + count; ++n)
+    {
+        const OPN2_UInt8 ch = static_cast<OPN2_UInt8>(n % 8);
+        const OPN2_UInt8 note = static_cast<OPN2_UInt8>(48 + n * 5);
+        if(on)
+        {
+            opn2_rt_patchChange(player, ch, static_cast<OPN2_UInt8>(n * 9));
+            opn2_rt_noteOn(player, ch, note, 110);
+        }
+        else
+            opn2_rt_noteOff(player, ch, note);
+    }
+}
+
+static void render(OPN2_MIDIPlayer *player, std::vector<short> &out, size_t frames)
+{
+    // Odd chunks, so the snapshot falls inside the buffers of the chips
+    const size_t chunkFrames = 333;
+    out.resize(2 * frames);
+    for(size_t done = 0; done < frames;)
+    {
+        const size_t want = (frames - done < chunkFrames) ? frames - done : chunkFrames;
+        opn2_generate(player, static_cast<int>(want * 2), &out[2 * done]);
+        done += want;
+    }
+}
+
+/* Renders the part after the snapshot, releasing half of the notes midway */
+static void renderAfter(OPN2_MIDIPlayer *player, std::vector<short> &out)
+{
+    std::vector<short> tail;
+    render(player, out, g_framesAfter / 2);
+    notes(player, false, 0, 4);
+    render(player, tail, g_framesAfter - g_framesAfter / 2);
+    out.insert(out.end(), tail.begin(), tail.end());
+}
+
+/* Finds the header of the second chip, the same as the one of the first chip */
+static size_t secondChipOffset(const std::vector<unsigned char> &state)
+{
+    const size_t first = 24; // After the header of the snapshot
+    const size_t key = 16; // Rate, clock, resampler and PCM rate flag
+    for(size_t i = first + key; i + key <= state.size(); ++i)
+    {
+        if(std::memcmp(&state[first], &state[i], key) == 0)
+            return i;
+    }
+    return 0;
+}
+
+/* Returns the count of failures, or -1 when the players can't be set up */
+static int runCase(const char *bankPath, int emulator, const Setup &setup)
+{
+    OPN2_MIDIPlayer *source = openPlayer(bankPath, emulator, setup);
+    OPN2_MIDIPlayer *twin = openPlayer(bankPath, emulator, setup);
+    OPN2_MIDIPlayer *untouched = openPlayer(bankPath, emulator, setup);
+    if(!source || !twin || !untouched)
+    {
+        opn2_close(source);
+        opn2_close(twin);
+        opn2_close(untouched);
+        return -1;
+    }
+
+    int failures = 0;
+    std::vector<short> a, b, c;
+    OPN2_MIDIPlayer *players[3] = {source, twin, untouched};
+    for(int p = 0; p < 3; ++p)
+    {
+        notes(players[p], true, 0, 8);
+        render(players[p], a, g_framesBefore);
+    }
+
+    std::vector<unsigned char> state(opn2_stateSize(source));
+    if(opn2_saveState(source, &state[0], state.size()) < 0)
+    {
+        std::printf("%s: saving failed: %s\n", setup.name, opn2_errorInfo(source));
+        ++failures;
+    }
+    render(twin, b, g_framesAside);
+    render(untouched, c, g_framesAside);
+
+    // One chip which doesn't match must leave all of them as they were
+    std::vector<unsigned char> broken = state;
+    const size_t second = secondChipOffset(broken);
+    if(second == 0)
+    {
+        std::printf("%s: header of the second chip is not found\n", setup.name);
+        ++failures;
+    }
+    else
+    {
+        broken[second + 8] ^= 1; // Resampler quality
+        if(opn2_loadState(twin, &broken[0], broken.size()) == 0)
+        {
+            std::printf("%s: the broken snapshot was loaded\n", setup.name);
+            ++failures;
+        }
+        renderAfter(twin, b);
+        renderAfter(untouched, c);
+        if(b != c)
+        {
+            std::printf("%s: the refused snapshot changed the player\n", setup.name);
+            ++failures;
+        }
+    }
+
+    // The short snapshot is refused as well
+    if(opn2_loadState(twin, &state[0], state.size() - 1) == 0)
+    {
+        std::printf("%s: the short snapshot was loaded\n", setup.name);
+        ++failures;
+    }
+
+    // The twin continues like the source after the load
+    opn2_close(twin);
+    twin = openPlayer(bankPath, emulator, setup);
+    notes(twin, true, 0, 8);
+    render(twin, b, g_framesBefore + g_framesAside);
+    if(opn2_loadState(twin, &state[0], state.size()) < 0)
+    {
+        std::printf("%s: loading failed: %s\n", setup.name, opn2_errorInfo(twin));
+        ++failures;
+    }
+    renderAfter(source, a);
+    renderAfter(twin, b);
+    if(a != b)
+    {
+        size_t s = 0;
+        while(s < a.size() && a[s] == b[s])
+            ++s;
+        std::printf("%s: MISMATCH from frame %u after the load\n", setup.name, static_cast<unsigned>(s / 2));
+        ++failures;
+    }
+
+    opn2_close(source);
+    opn2_close(twin);
+    opn2_close(untouched);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <bank.wopn>\n", argv[0]);
+        return 2;
+    }
+
+    int failures = 0;
+    for(int emulator = 0; emulator < OPNMIDI_EMU_end; ++emulator)
+    {
+        // Writes a file instead of sound
+        if(emulator == OPNMIDI_VGM_DUMPER)
+            continue;
+        OPN2_MIDIPlayer *probe = opn2_init(44100);
+        const bool available = probe && opn2_switchEmulator(probe, emulator) == 0;
+        const size_t stateSize = available ? opn2_stateSize(probe) : 0;
+        const char *name = available ? opn2_chipEmulatorName(probe) : "";
+        opn2_close(probe);
+        if(!available)
+            continue;
+        if(stateSize == 0)
+        {
+            std::printf("%s: no snapshots, skipped\n", name);
+            continue;
+        }
+
+        int emulatorFailures = 0;
+        for(size_t i = 0; i < sizeof(g_setups) / sizeof(Setup); ++i)
+        {
+            const int result = runCase(argv[1], emulator, g_setups[i]);
+            if(result < 0)
+            {
+                std::fprintf(stderr, "%s: can't set up the players\n", name);
+                return 2;
+            }
+            emulatorFailures += result;
+        }
+        std::printf("%s: %s\n", name, emulatorFailures ? "FAILED" : "same");
+        failures += emulatorFailures;
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %d snapshot checks\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
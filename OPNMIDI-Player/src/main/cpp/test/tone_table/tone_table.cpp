@@ -0,0 +1,108 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tone table test
+ *
+ * Compares the block and F-number looked up in the tone table against
+ * the exact conversion of opn2_toneToFtone() for both chip families:
+ * the steps of the table and the tones out of it must match exactly,
+ * tones between the steps must stay within one F-number step.
+ *
+ * Usage: tone_table
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "opnmidi_tone.hpp"
+
+/* Random tones between the steps of every family */
+static const long g_randomTones = 2000000;
+
+/* Frequency of the packed ftone in units of the lowest F-number step */
+static uint64_t ftoneFrequency(uint32_t ftone)
+{
+    return static_cast<uint64_t>(ftone & 0x7FF) << (((ftone >> 11) & 7) + (ftone >> 14));
+}
+
+/* Size of one F-number step of the packed ftone in the same units */
+static uint64_t ftoneStep(uint32_t ftone)
+{
+    return static_cast<uint64_t>(1) << (((ftone >> 11) & 7) + (ftone >> 14));
+}
+
+/* Returns the count of failed tones, prints the first few */
+static long checkFamily(OPNFamily family, const char *name)
+{
+    OpnToneTable table;
+    table.build(family);
+    long failures = 0;
+    double worst = 0.0;
+
+    for(long i = 0; i < OpnToneTable::range * OpnToneTable::steps; ++i)
+    {
+        const double tone = static_cast<double>(i) / OpnToneTable::steps;
+        if(table.ftone(tone) != opn2_toneToFtone(tone, family) && failures++ < 5)
+            std::printf("%s: step %ld (tone %.6f) differs\n", name, i, tone);
+    }
+
+    static const double outside[] = {-24.0, -0.5, 144.0, 150.25, 170.0};
+    for(size_t i = 0; i < sizeof(outside) / sizeof(double); ++i)
+    {
+        if(table.ftone(outside[i]) != opn2_toneToFtone(outside[i], family) && failures++ < 5)
+            std::printf("%s: tone %.6f out of the table differs\n", name, outside[i]);
+    }
+
+    std::srand(1);
+    for(long i = 0; i < g_randomTones; ++i)
+    {
+        const double tone = (static_cast<double>(std::rand()) / RAND_MAX) * (OpnToneTable::range - 1);
+        const uint32_t got = table.ftone(tone);
+        const uint32_t exact = opn2_toneToFtone(tone, family);
+        const uint64_t a = ftoneFrequency(got), b = ftoneFrequency(exact);
+        const uint64_t distance = (a > b) ? a - b : b - a;
+        const uint64_t step = (ftoneStep(got) > ftoneStep(exact)) ? ftoneStep(got) : ftoneStep(exact);
+        const double steps = static_cast<double>(distance) / static_cast<double>(step);
+        if(steps > worst)
+            worst = steps;
+        if(distance > step && failures++ < 5)
+            std::printf("%s: tone %.6f gives %04X, exact is %04X\n", name, tone,
+                        static_cast<unsigned>(got), static_cast<unsigned>(exact));
+    }
+
+    std::printf("%s: largest distance between the steps is %.2f F-number steps\n", name, worst);
+    return failures;
+}
+
+int main()
+{
+    long failures = checkFamily(OPNChip_OPN2, "OPN2") + checkFamily(OPNChip_OPNA, "OPNA");
+    if(failures > 0)
+    {
+        std::printf("FAILED: %ld tones off the exact conversion\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Volume table test
+ *
+ * Compares the tables of the volume models against the math they
+ * replaced: the generic volume level against the logarithm for every
+ * volume product, the brightness curve against the square root, and the
+ * carriers of every algorithm against the former table of operators.
+ *
+ * Usage: volume_tables
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "opnmidi_volume.hpp"
+
+/* The largest product of the velocity, master volume, channel volume and expression */
+static const uint_fast32_t g_maxVolume = 127u * 127u * 127u * 127u;
+
+/* The former generic model */
+static uint_fast32_t genericLevel(uint_fast32_t volume)
+{
+    const double c1 = 11.541560327111707;
+    const double c2 = 1.601379199767093e+02;
+    const uint_fast32_t minVolume = 1108075; // 8725 * 127
+
+    // The formula below: SOLVE(V=127^4 * 2^( (A-63.49999) / 8), A)
+    if(volume > minVolume)
+    {
+        double lv = std::log(static_cast<double>(volume));
+        return static_cast<uint_fast32_t>(static_cast<uint_fast32_t>(lv * c1 - c2) * 2.0);
+    }
+    return 0;
+}
+
+/* The former brightness curve */
+static uint32_t brightnessLevel(uint32_t brightness)
+{
+    return static_cast<uint32_t>(::round(127.0 * ::sqrt((static_cast<double>(brightness)) * (1.0 / 127.0))));
+}
+
+/* The former carriers of every algorithm */
+static const bool g_algDo[8][4] =
+{
+    //OP1   OP3   OP2    OP4
+    //30    34    38     3C
+    {false,false,false,true},//Algorithm #0:  W = 1 * 2 * 3 * 4
+    {false,false,false,true},//Algorithm #1:  W = (1 + 2) * 3 * 4
+    {false,false,false,true},//Algorithm #2:  W = (1 + (2 * 3)) * 4
+    {false,false,false,true},//Algorithm #3:  W = ((1 * 2) + 3) * 4
+    {false,false,true, true},//Algorithm #4:  W = (1 * 2) + (3 * 4)
+    {false,true ,true ,true},//Algorithm #5:  W = (1 * (2 + 3 + 4)
+    {false,true ,true ,true},//Algorithm #6:  W = (1 * 2) + 3 + 4
+    {true ,true ,true ,true},//Algorithm #7:  W = 1 + 2 + 3 + 4
+};
+
+int main()
+{
+    long failures = 0;
+
+    // Every product of the volumes
+    for(uint_fast32_t v = 0; v <= g_maxVolume; ++v)
+    {
+        if(opn2_genericVolumeLevel(v) != genericLevel(v) && failures++ < 5)
+            std::printf("Generic volume %lu: level %lu, the logarithm gives %lu\n",
+                        static_cast<unsigned long>(v),
+                        static_cast<unsigned long>(opn2_genericVolumeLevel(v)),
+                        static_cast<unsigned long>(genericLevel(v)));
+    }
+
+    for(uint32_t b = 0; b < 128; ++b)
+    {
+        if(opn2_brightnessCurve[b] != brightnessLevel(b) && failures++ < 5)
+            std::printf("Brightness %u: %u, the square root gives %u\n",
+                        b, opn2_brightnessCurve[b], brightnessLevel(b));
+    }
+
+    for(uint8_t alg = 0; alg < 8; ++alg)
+    {
+        for(uint8_t op = 0; op < 4; ++op)
+        {
+            if(opn2_isCarrier(alg, op) != g_algDo[alg][op] && failures++ < 5)
+                std::printf("Algorithm %u, operator %u: carrier differs\n", alg, op);
+        }
+    }
+
+    if(failures > 0)
+    {
+        std::printf("FAILED: %ld values off the former math\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
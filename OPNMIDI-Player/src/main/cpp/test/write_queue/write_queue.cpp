@@ -0,0 +1,248 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Register write queue test
+ *
+ * Drives the buffered chip base with a test backend which outputs the
+ * last value written to it and the count of writes, in chunks of odd
+ * sizes with writes between them: single ones, batches, pans, and bursts
+ * larger than the queue of 1024 writes, at one frame and spread over the
+ * frames of one buffer, which flush the queue early. Every write must
+ * reach the backend in order and show up exactly one buffer after the
+ * frame it was issued at.
+ *
+ * Usage: write_queue
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "chips/opn_chip_base.h"
+
+/* Outputs the last written value on the left, and the count of writes on the right */
+class WriteRecorder final : public OPNChipBaseBufferedT<WriteRecorder>
+{
+    int16_t m_value;
+    int16_t m_count;
+public:
+    std::vector<uint16_t> applied;
+
+    WriteRecorder() : OPNChipBaseBufferedT<WriteRecorder>(OPNChip_OPN2), m_value(0), m_count(0) {}
+
+    bool canRunAtPcmRate() const override { return true; }
+    void nativeWriteReg(uint32_t port, uint16_t addr, uint8_t data)
+    {
+        record(static_cast<uint16_t>(((addr & 0x7F) << 8) | (port << 15) | data));
+    }
+    void nativeWritePan(uint16_t chan, uint8_t data)
+    {
+        record(static_cast<uint16_t>(((chan & 0x7F) << 8) | 0x8000 | data));
+    }
+    void nativePreGenerate() override {}
+    void nativePostGenerate() override {}
+    void nativeGenerateN(int16_t *output, size_t frames) override
+    {
+        for(size_t i = 0; i < frames; ++i)
+        {
+            output[2 * i] = m_value;
+            output[2 * i + 1] = m_count;
+        }
+    }
+    const char *emulatorName() override { return "Write recorder"; }
+
+private:
+    void record(uint16_t value)
+    {
+        applied.push_back(value);
+        m_value = static_cast<int16_t>(value);
+        ++m_count;
+    }
+};
+
+struct IssuedWrite
+{
+    //! Frames given out before the write
+    size_t frame;
+    uint16_t value;
+};
+
+class WriteScript
+{
+    WriteRecorder &m_chip;
+    size_t m_frame;
+    uint16_t m_next;
+public:
+    std::vector<IssuedWrite> issued;
+
+    explicit WriteScript(WriteRecorder &chip) : m_chip(chip), m_frame(0), m_next(0) {}
+
+    void reg(uint32_t port)
+    {
+        const uint16_t value = nextValue(port == 1);
+        m_chip.writeReg(port, static_cast<uint16_t>((value >> 8) & 0x7F), static_cast<uint8_t>(value));
+    }
+
+    void regs(size_t count)
+    {
+        std::vector<OPNRegPair> batch(count);
+        for(size_t i = 0; i < count; ++i)
+        {
+            const uint16_t value = nextValue(false);
+            batch[i].addr = static_cast<uint16_t>((value >> 8) & 0x7F);
+            batch[i].data = static_cast<uint8_t>(value);
+        }
+        m_chip.writeRegs(0, &batch[0], count);
+    }
+
+    void pan()
+    {
+        const uint16_t value = nextValue(true);
+        m_chip.writePan(static_cast<uint16_t>((value >> 8) & 0x7F), static_cast<uint8_t>(value));
+    }
+
+    void render(std::vector<int16_t> &out, size_t frames)
+    {
+        const size_t at = out.size();
+        out.resize(at + 2 * frames);
+        m_chip.nativeGenerateBlock(&out[at], frames);
+        m_frame += frames;
+    }
+
+    void renderFrame(std::vector<int16_t> &out)
+    {
+        const size_t at = out.size();
+        out.resize(at + 2);
+        m_chip.nativeGenerate(&out[at]);
+        ++m_frame;
+    }
+
+private:
+    uint16_t nextValue(bool high)
+    {
+        // Values which tell every write apart, the high bit stands for port 1 and pans
+        const uint16_t value = static_cast<uint16_t>((m_next++ & 0x7FFF) | (high ? 0x8000 : 0));
+        IssuedWrite w;
+        w.frame = m_frame;
+        w.value = value;
+        issued.push_back(w);
+        return value;
+    }
+};
+
+static const size_t g_chunks[] = {1, 3, 100, 255, 256, 257, 700, 13, 512, 77};
+
+int main()
+{
+    const size_t latency = WriteRecorder::buffer_size;
+    WriteRecorder chip;
+    chip.setRunningAtPcmRate(true);
+    chip.setRate(opn2_getNativeRate(OPNChip_OPN2), opn2_getNativeClockRate(OPNChip_OPN2));
+    WriteScript script(chip);
+    std::vector<int16_t> out;
+
+    uint32_t seed = 1;
+    for(size_t step = 0; step < 600; ++step)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        switch((seed >> 16) % 8)
+        {
+        case 0:
+            break;
+        case 1:
+            script.reg(0);
+            break;
+        case 2:
+            script.reg(1);
+            script.pan();
+            break;
+        case 3:
+            script.regs(1 + (seed >> 8) % 40);
+            break;
+        case 4:
+            // More writes at one frame than the queue holds
+            for(size_t i = 0; i < 700; ++i)
+                script.reg(i & 1);
+            script.regs(900);
+            break;
+        case 5:
+            // Writes spread over the frames of one buffer overflow the queue
+            // before the buffer ends, it gets rendered ahead to the oldest one
+            for(size_t f = 0; f < 6; ++f)
+            {
+                script.regs(300);
+                script.renderFrame(out);
+            }
+            break;
+        default:
+            script.reg(0);
+            script.regs(3);
+            break;
+        }
+        script.render(out, g_chunks[step % (sizeof(g_chunks) / sizeof(size_t))]);
+    }
+    // Output of the last writes
+    script.render(out, 2 * latency);
+
+    int failures = 0;
+    const std::vector<IssuedWrite> &issued = script.issued;
+
+    bool sameOrder = (chip.applied.size() == issued.size());
+    for(size_t i = 0; sameOrder && i < issued.size(); ++i)
+        sameOrder = (chip.applied[i] == issued[i].value);
+    if(!sameOrder)
+    {
+        std::printf("The backend got %u writes, out of the order of %u issued ones\n",
+                    static_cast<unsigned>(chip.applied.size()), static_cast<unsigned>(issued.size()));
+        ++failures;
+    }
+
+    // Every frame shows the writes issued one buffer before it or earlier
+    size_t landed = 0;
+    int16_t value = 0;
+    for(size_t frame = 0; frame < out.size() / 2; ++frame)
+    {
+        while(landed < issued.size() && issued[landed].frame + latency <= frame)
+            value = static_cast<int16_t>(issued[landed++].value);
+        if(out[2 * frame] != value || out[2 * frame + 1] != static_cast<int16_t>(landed))
+        {
+            std::printf("Frame %u: value %04X after %d writes, expected %04X after %u writes\n",
+                        static_cast<unsigned>(frame),
+                        static_cast<unsigned>(static_cast<uint16_t>(out[2 * frame])),
+                        out[2 * frame + 1],
+                        static_cast<unsigned>(static_cast<uint16_t>(value)),
+                        static_cast<unsigned>(landed));
+            ++failures;
+            break;
+        }
+    }
+
+    std::printf("%u writes over %u frames\n", static_cast<unsigned>(issued.size()), static_cast<unsigned>(out.size() / 2));
+    if(failures > 0)
+    {
+        std::printf("FAILED: writes off their frames\n");
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
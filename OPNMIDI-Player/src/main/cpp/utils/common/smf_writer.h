@@ -0,0 +1,139 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Writer of the synthetic songs of the benchmark and the tests
+ */
+
+#ifndef OPNMIDI_SMF_WRITER_H
+#define OPNMIDI_SMF_WRITER_H
+
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Minimal writer of the single-track Standard MIDI File
+ */
+class SmfWriter
+{
+    std::vector<unsigned char> m_track;
+    unsigned m_pending;
+
+    void putVarLen(unsigned value)
+    {
+        unsigned char bytes[5];
+        int count = 0;
+        do
+        {
+            bytes[count++] = static_cast<unsigned char>(value & 0x7F);
+            value >>= 7;
+        } while(value);
+        while(count > 1)
+            m_track.push_back(bytes[--count] | 0x80);
+        m_track.push_back(bytes[0]);
+    }
+
+    void putDelta()
+    {
+        putVarLen(m_pending);
+        m_pending = 0;
+    }
+
+public:
+    enum { Division = 480 };
+
+    SmfWriter() : m_pending(0) {}
+
+    void wait(unsigned ticks)
+    {
+        m_pending += ticks;
+    }
+
+    void event(unsigned char status, unsigned char data1, unsigned char data2)
+    {
+        putDelta();
+        m_track.push_back(status);
+        m_track.push_back(data1 & 0x7F);
+        if((status & 0xE0) != 0xC0) // Program change and channel aftertouch are two bytes
+            m_track.push_back(data2 & 0x7F);
+    }
+
+    void sysex(const unsigned char *body, unsigned size)
+    {
+        putDelta();
+        m_track.push_back(0xF0);
+        putVarLen(size);
+        m_track.insert(m_track.end(), body, body + size);
+    }
+
+    void marker(const char *text)
+    {
+        unsigned size = static_cast<unsigned>(std::strlen(text));
+        putDelta();
+        m_track.push_back(0xFF);
+        m_track.push_back(0x06);
+        putVarLen(size);
+        m_track.insert(m_track.end(), text, text + size);
+    }
+
+    void tempo(unsigned usPerQuarter)
+    {
+        putDelta();
+        m_track.push_back(0xFF);
+        m_track.push_back(0x51);
+        m_track.push_back(0x03);
+        m_track.push_back(static_cast<unsigned char>((usPerQuarter >> 16) & 0xFF));
+        m_track.push_back(static_cast<unsigned char>((usPerQuarter >> 8) & 0xFF));
+        m_track.push_back(static_cast<unsigned char>(usPerQuarter & 0xFF));
+    }
+
+    std::vector<unsigned char> finish()
+    {
+        putDelta();
+        m_track.push_back(0xFF);
+        m_track.push_back(0x2F);
+        m_track.push_back(0x00);
+
+        static const unsigned char head[14] =
+        {
+            'M', 'T', 'h', 'd', 0, 0, 0, 6,
+            0, 0, /* Format 0 */
+            0, 1, /* One track */
+            Division >> 8, Division & 0xFF
+        };
+        std::vector<unsigned char> out(head, head + 14);
+        size_t len = m_track.size();
+        out.push_back('M');
+        out.push_back('T');
+        out.push_back('r');
+        out.push_back('k');
+        out.push_back(static_cast<unsigned char>((len >> 24) & 0xFF));
+        out.push_back(static_cast<unsigned char>((len >> 16) & 0xFF));
+        out.push_back(static_cast<unsigned char>((len >> 8) & 0xFF));
+        out.push_back(static_cast<unsigned char>(len & 0xFF));
+        out.insert(out.end(), m_track.begin(), m_track.end());
+        return out;
+    }
+};
+
+#endif // OPNMIDI_SMF_WRITER_H
@@ -0,0 +1,528 @@
+/*
+ * libOPNMIDI is a free Software MIDI synthesizer library with OPN2 (YM2612) emulation
+ *
+ * MIDI parser and player (Original code from ADLMIDI): Copyright (c) 2010-2014 Joel Yliluoma <bisqwit@iki.fi>
+ * OPNMIDI Library and YM2612 support:   Copyright (c) 2017-2020 Vitaly Novichkov <admin@wohlnet.ru>
+ *
+ * Library is based on the ADLMIDI, a MIDI player for Linux and Windows with OPL3 emulation:
+ * http://iki.fi/bisqwit/source/adlmidi.html
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Emulator throughput benchmark
+ *
+ * Renders synthetic and real MIDI workloads through every enabled emulator,
+ * sweeping chip counts, sample rates, run-at-PCM-rate and output formats,
+ * and prints the measurements as JSON.
+ */
+
+#include <opnmidi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "opnmidi_threads.hpp"
+#include "smf_writer.h"
+
+
+/* Synthetic workloads */
+
+/**
+ * @brief All 16 channels strike 4-note chords every 16th note with running pitch bends
+ */
+static std::vector<unsigned char> makeDenseSong()
+{
+    SmfWriter smf;
+    smf.tempo(500000);
+    for(unsigned ch = 0; ch < 16; ++ch)
+    {
+        smf.event(0xC0 | ch, static_cast<unsigned char>(ch * 8 + 1), 0);
+        smf.event(0xB0 | ch, 7, 100);
+        smf.event(0xB0 | ch, 10, static_cast<unsigned char>(ch * 8));
+    }
+
+    static const unsigned char chord[4] = {0, 4, 7, 11};
+    const unsigned step = SmfWriter::Division / 4;
+    for(unsigned i = 0; i < 64; ++i) // 8 seconds at 120 BPM
+    {
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            unsigned char root = static_cast<unsigned char>(ch == 9 ? 35 + (i % 12) : 36 + ((i * 5 + ch * 3) % 36));
+            for(unsigned n = 0; n < 4; ++n)
+                smf.event(0x90 | ch, root + chord[n], static_cast<unsigned char>(64 + (n * 16)));
+            int bend = 0x2000 + (static_cast<int>(i & 7) - 4) * 0x200;
+            smf.event(0xE0 | ch, static_cast<unsigned char>(bend & 0x7F), static_cast<unsigned char>(bend >> 7));
+        }
+        smf.wait(step);
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            unsigned char root = static_cast<unsigned char>(ch == 9 ? 35 + (i % 12) : 36 + ((i * 5 + ch * 3) % 36));
+            for(unsigned n = 0; n < 4; ++n)
+                smf.event(0x80 | ch, root + chord[n], 0);
+        }
+    }
+    return smf.finish();
+}
+
+/**
+ * @brief Runs of notes on all 16 channels held by the sustain pedal over every beat,
+ * with a drum roll, piling up more notes than chip channels to allocate them
+ */
+static std::vector<unsigned char> makePolyphonySong()
+{
+    SmfWriter smf;
+    smf.tempo(500000);
+    for(unsigned ch = 0; ch < 16; ++ch)
+    {
+        smf.event(0xC0 | ch, static_cast<unsigned char>(ch * 8 + 4), 0);
+        smf.event(0xB0 | ch, 7, 100);
+    }
+
+    const unsigned step = SmfWriter::Division / 8;
+    for(unsigned i = 0; i < 128; ++i) // 8 seconds at 120 BPM
+    {
+        if((i % 8) == 0)
+        {
+            for(unsigned ch = 0; ch < 16; ++ch)
+            {
+                if(ch == 9)
+                    continue;
+                smf.event(0xB0 | ch, 64, 0);
+                smf.event(0xB0 | ch, 64, 127);
+            }
+        }
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            unsigned char note = static_cast<unsigned char>(ch == 9 ? 35 + ((i * 7) % 47) : 36 + ((i * 11 + ch * 5) % 48));
+            smf.event(0x90 | ch, note, static_cast<unsigned char>(80 + (i % 40)));
+            if(ch == 9)
+                smf.event(0x90 | ch, static_cast<unsigned char>(35 + ((i * 13 + 3) % 47)), 100);
+        }
+        smf.wait(step);
+        for(unsigned ch = 0; ch < 16; ++ch)
+        {
+            unsigned char note = static_cast<unsigned char>(ch == 9 ? 35 + ((i * 7) % 47) : 36 + ((i * 11 + ch * 5) % 48));
+            smf.event(0x80 | ch, note, 0);
+            if(ch == 9)
+                smf.event(0x80 | ch, static_cast<unsigned char>(35 + ((i * 13 + 3) % 47)), 0);
+        }
+    }
+    return smf.finish();
+}
+
+/**
+ * @brief One monophonic melody line, the cheapest possible song
+ */
+static std::vector<unsigned char> makeSparseSong()
+{
+    SmfWriter smf;
+    smf.tempo(500000);
+    smf.event(0xC0, 0, 0);
+    const unsigned step = SmfWriter::Division / 2;
+    for(unsigned i = 0; i < 16; ++i) // 8 seconds at 120 BPM
+    {
+        unsigned char note = static_cast<unsigned char>(60 + ((i * 7) % 12));
+        smf.event(0x90, note, 100);
+        smf.wait(step);
+        smf.event(0x80, note, 0);
+    }
+    return smf.finish();
+}
+
+
+/* Benchmark cases */
+
+struct Workload
+{
+    std::string name;
+    std::string path;
+    std::vector<unsigned char> data;
+};
+
+struct Format
+{
+    const char *name;
+    OPNMIDI_AudioFormat format;
+};
+
+struct Result
+{
+    double setupTime;
+    double renderTime;
+    double sequencerTime;
+    size_t frames;
+};
+
+static const Format g_formats[] =
+{
+    {"s16", {OPNMIDI_SampleType_S16, 2, 4}},
+    {"s32", {OPNMIDI_SampleType_S32, 4, 8}},
+    {"f32", {OPNMIDI_SampleType_F32, 4, 8}}
+};
+static const size_t g_formatsCount = sizeof(g_formats) / sizeof(Format);
+
+static OPN2_MIDIPlayer *openPlayer(const Workload &work, const char *bankPath,
+                                   int emulator, int chips, long rate, int pcmRate, int blockFrames)
+{
+    OPN2_MIDIPlayer *player = opn2_init(rate);
+    if(!player)
+        return NULL;
+
+    bool ok = opn2_switchEmulator(player, emulator) >= 0 &&
+              opn2_setNumChips(player, chips) >= 0 &&
+              opn2_setRunAtPcmRate(player, pcmRate) >= 0 &&
+              opn2_setBlockSize(player, blockFrames) >= 0 &&
+              opn2_openBankFile(player, bankPath) >= 0;
+    if(ok)
+    {
+        if(work.path.empty())
+            ok = opn2_openData(player, &work.data[0], static_cast<unsigned long>(work.data.size())) >= 0;
+        else
+            ok = opn2_openFile(player, work.path.c_str()) >= 0;
+    }
+
+    if(!ok)
+    {
+        std::fprintf(stderr, "opnmidi_bench: %s\n", opn2_errorInfo(player));
+        opn2_close(player);
+        return NULL;
+    }
+
+    opn2_setLoopEnabled(player, 1);
+    return player;
+}
+
+static bool runCase(const Workload &work, const char *bankPath, int emulator, int chips,
+                    long rate, int pcmRate, int blockFrames, const Format &fmt, double seconds, Result &res)
+{
+    std::memset(&res, 0, sizeof(Result));
+
+    double start = opn_monotonicTime();
+    OPN2_MIDIPlayer *player = openPlayer(work, bankPath, emulator, chips, rate, pcmRate, blockFrames);
+    if(!player)
+        return false;
+    res.setupTime = opn_monotonicTime() - start;
+
+    const size_t total = static_cast<size_t>(seconds * static_cast<double>(rate));
+    const size_t block = static_cast<size_t>(blockFrames);
+    std::vector<OPN2_UInt8> buffer(block * fmt.format.containerSize * 2);
+    OPN2_UInt8 *left = &buffer[0];
+    OPN2_UInt8 *right = left + fmt.format.containerSize;
+
+    // Full pipeline: sequencer, chip synthesis and sample conversion
+    start = opn_monotonicTime();
+    while(res.frames < total)
+    {
+        int got = opn2_playFormat(player, blockFrames * 2, left, right, &fmt.format);
+        if(got <= 0)
+            break;
+        res.frames += static_cast<size_t>(got) / 2;
+    }
+    res.renderTime = opn_monotonicTime() - start;
+
+    // Sequencer only: MIDI events and register writes without synthesis
+    opn2_positionRewind(player);
+    opn2_panic(player);
+    const double blockTime = static_cast<double>(blockFrames) / static_cast<double>(rate);
+    start = opn_monotonicTime();
+    for(size_t done = 0; done < res.frames; done += block)
+        opn2_tickEvents(player, blockTime, blockTime);
+    res.sequencerTime = opn_monotonicTime() - start;
+
+    opn2_close(player);
+    return res.frames > 0;
+}
+
+
+/* Command line */
+
+static std::vector<long> parseList(const char *arg)
+{
+    std::vector<long> out;
+    const char *cur = arg;
+    while(*cur)
+    {
+        char *end;
+        long value = std::strtol(cur, &end, 10);
+        if(end == cur)
+            break;
+        out.push_back(value);
+        cur = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+static std::string jsonString(const std::string &in)
+{
+    std::string out = "\"";
+    for(size_t i = 0; i < in.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(in[i]);
+        if(c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(static_cast<char>(c));
+        }
+        else if(c < 0x20)
+        {
+            char esc[8];
+            std::sprintf(esc, "\\u%04x", c);
+            out += esc;
+        }
+        else
+            out.push_back(static_cast<char>(c));
+    }
+    out.push_back('"');
+    return out;
+}
+
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: opnmidi_bench -b <bank.wopn> [options] [file.mid ...]\n"
+        "\n"
+        "  -b <path>    WOPN bank file (required)\n"
+        "  -s <sec>     Seconds of audio to render per case (default 5)\n"
+        "  -e <list>    Emulator IDs to run (default: all enabled)\n"
+        "  -c <list>    Chip counts (default 1,2,4,8,16)\n"
+        "  -r <list>    Sample rates (default 44100,48000)\n"
+        "  -p <list>    Run-at-PCM-rate modes, 0 and/or 1 (default 0,1)\n"
+        "  -k <list>    Block sizes in frames, set by opn2_setBlockSize (default 512)\n"
+        "  -f <list>    Output formats: s16,s32,f32 (default s16,f32)\n"
+        "  -o <path>    Write JSON into the file instead of stdout\n"
+        "  -n           Skip the synthetic workloads\n"
+        "\n"
+        "Lists are comma-separated. Progress is printed into stderr.\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *bankPath = NULL;
+    const char *outPath = NULL;
+    double seconds = 5.0;
+    bool synthetic = true;
+    std::vector<long> emulators, chips, rates, pcmRates, blockSizes;
+    std::vector<const Format *> formats;
+    std::vector<Workload> workloads;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if(std::strcmp(arg, "-n") == 0)
+        {
+            synthetic = false;
+            continue;
+        }
+        if(std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+        {
+            printUsage();
+            return 0;
+        }
+        if(arg[0] != '-')
+        {
+            Workload w;
+            w.name = arg;
+            w.path = arg;
+            workloads.push_back(w);
+            continue;
+        }
+        if(i + 1 >= argc || std::strlen(arg) != 2)
+        {
+            printUsage();
+            return 1;
+        }
+
+        const char *value = argv[++i];
+        switch(arg[1])
+        {
+        case 'b':
+            bankPath = value;
+            break;
+        case 'o':
+            outPath = value;
+            break;
+        case 's':
+            seconds = std::atof(value);
+            break;
+        case 'e':
+            emulators = parseList(value);
+            break;
+        case 'c':
+            chips = parseList(value);
+            break;
+        case 'r':
+            rates = parseList(value);
+            break;
+        case 'p':
+            pcmRates = parseList(value);
+            break;
+        case 'k':
+            blockSizes = parseList(value);
+            break;
+        case 'f':
+        {
+            std::string list = value;
+            for(size_t f = 0; f < g_formatsCount; ++f)
+            {
+                if(list.find(g_formats[f].name) != std::string::npos)
+                    formats.push_back(&g_formats[f]);
+            }
+            break;
+        }
+        default:
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(!bankPath || seconds <= 0.0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    if(emulators.empty())
+    {
+        for(long e = 0; e < OPNMIDI_EMU_end; ++e)
+        {
+            if(e != OPNMIDI_VGM_DUMPER) // Writes files instead of producing audio
+                emulators.push_back(e);
+        }
+    }
+    if(chips.empty())
+    {
+        static const long def[] = {1, 2, 4, 8, 16};
+        chips.assign(def, def + 5);
+    }
+    if(rates.empty())
+    {
+        rates.push_back(44100);
+        rates.push_back(48000);
+    }
+    if(pcmRates.empty())
+    {
+        pcmRates.push_back(0);
+        pcmRates.push_back(1);
+    }
+    if(blockSizes.empty())
+        blockSizes.push_back(512);
+    if(formats.empty())
+    {
+        formats.push_back(&g_formats[0]);
+        formats.push_back(&g_formats[2]);
+    }
+
+    if(synthetic)
+    {
+        Workload dense, polyphony, sparse;
+        dense.name = "synthetic-dense";
+        dense.data = makeDenseSong();
+        polyphony.name = "synthetic-polyphony";
+        polyphony.data = makePolyphonySong();
+        sparse.name = "synthetic-sparse";
+        sparse.data = makeSparseSong();
+        workloads.insert(workloads.begin(), sparse);
+        workloads.insert(workloads.begin(), polyphony);
+        workloads.insert(workloads.begin(), dense);
+    }
+
+    if(workloads.empty())
+    {
+        std::fprintf(stderr, "opnmidi_bench: nothing to render\n");
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if(outPath)
+    {
+        out = std::fopen(outPath, "w");
+        if(!out)
+        {
+            std::fprintf(stderr, "opnmidi_bench: can't open %s\n", outPath);
+            return 1;
+        }
+    }
+
+    std::fprintf(out, "{\n  \"library\": %s,\n  \"seconds_per_case\": %g,\n  \"results\": [",
+                 jsonString(opn2_linkedLibraryVersion()).c_str(), seconds);
+
+    bool first = true;
+    int failures = 0;
+    for(size_t w = 0; w < workloads.size(); ++w)
+    for(size_t e = 0; e < emulators.size(); ++e)
+    {
+        // Skip emulators which aren't built into this library
+        OPN2_MIDIPlayer *probe = opn2_init(44100);
+        bool available = probe && opn2_switchEmulator(probe, static_cast<int>(emulators[e])) >= 0;
+        std::string emuName = available ? opn2_chipEmulatorName(probe) : "";
+        opn2_close(probe);
+        if(!available)
+            continue;
+
+        for(size_t c = 0; c < chips.size(); ++c)
+        for(size_t r = 0; r < rates.size(); ++r)
+        for(size_t p = 0; p < pcmRates.size(); ++p)
+        for(size_t k = 0; k < blockSizes.size(); ++k)
+        for(size_t f = 0; f < formats.size(); ++f)
+        {
+            const Format &fmt = *formats[f];
+            std::fprintf(stderr, "%s: %s, %ld chips, %ld Hz, pcm-rate %ld, %ld frames, %s... ",
+                         workloads[w].name.c_str(), emuName.c_str(), chips[c], rates[r], pcmRates[p],
+                         blockSizes[k], fmt.name);
+            std::fflush(stderr);
+
+            Result res;
+            if(!runCase(workloads[w], bankPath, static_cast<int>(emulators[e]), static_cast<int>(chips[c]),
+                        rates[r], static_cast<int>(pcmRates[p]), static_cast<int>(blockSizes[k]),
+                        fmt, seconds, res))
+            {
+                std::fprintf(stderr, "FAILED\n");
+                ++failures;
+                continue;
+            }
+
+            double audioTime = static_cast<double>(res.frames) / static_cast<double>(rates[r]);
+            double nsPerFrame = res.renderTime * 1e9 / static_cast<double>(res.frames);
+            double seqPerFrame = res.sequencerTime * 1e9 / static_cast<double>(res.frames);
+            double synthPerFrame = nsPerFrame > seqPerFrame ? nsPerFrame - seqPerFrame : 0.0;
+            double rtf = res.renderTime > 0.0 ? audioTime / res.renderTime : 0.0;
+            std::fprintf(stderr, "%.1fx real-time\n", rtf);
+
+            std::fprintf(out, "%s\n    {\"workload\": %s, \"emulator\": %s, \"emulator_id\": %ld, \"chips\": %ld, "
+                              "\"sample_rate\": %ld, \"run_at_pcm_rate\": %s, \"block_frames\": %ld, \"format\": \"%s\", "
+                              "\"frames\": %lu, \"audio_seconds\": %.6f, \"render_seconds\": %.6f, "
+                              "\"realtime_factor\": %.3f, \"ns_per_frame\": %.2f, "
+                              "\"stages\": {\"setup_ns\": %.0f, \"sequencer_ns_per_frame\": %.2f, \"synthesis_ns_per_frame\": %.2f}}",
+                         first ? "" : ",",
+                         jsonString(workloads[w].name).c_str(), jsonString(emuName).c_str(), emulators[e],
+                         chips[c], rates[r], pcmRates[p] ? "true" : "false", blockSizes[k], fmt.name,
+                         static_cast<unsigned long>(res.frames), audioTime, res.renderTime,
+                         rtf, nsPerFrame,
+                         res.setupTime * 1e9, seqPerFrame, synthPerFrame);
+            std::fflush(out);
+            first = false;
+        }
+    }
+
+    std::fprintf(out, "\n  ]\n}\n");
+    if(out != stdout)
+        std::fclose(out);
+
+    return failures ? 2 : 0;
+}